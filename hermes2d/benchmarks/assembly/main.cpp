@@ -0,0 +1,444 @@
+#include "hermes2d.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+// Times DiscreteProblem::assemble() on synthetic meshes of the unit square, for all space types,
+// polynomial degrees, element shapes, with and without multimesh and with and without the assembly cache.
+//
+// Usage: assembly [-t threads] [-n elements] [-p min_degree max_degree] [-s space] [-r repeats] [-o output.json]
+//   -t  number of threads (Hermes2DApi parameter numThreads), default 1,
+//   -n  number of elements along a side of the square, default 8 (i.e. 64 quads or 128 triangles),
+//   -p  the range of the polynomial degrees, default 1 10,
+//   -s  only one space type (H1, Hcurl, Hdiv, L2), default all,
+//   -r  number of repeated assemblies of the same system, default 3,
+//   -o  output file, default the standard output.
+//
+// The problem is a system of two equations of the same space type with the forms
+//   (u, v) + (D u, D v) for both diagonal blocks and (u, v) for the coupling block,
+//   (1, v) for both right-hand sides,
+// where D is the gradient (H1, L2), the curl (Hcurl) or the divergence (Hdiv). Both equations live on the same
+// mesh, or (multimesh) the second one on the mesh with the elements of the lower half refined once more.
+// Hdiv is only run on quads, the Hdiv shapeset has no triangles.
+//
+// For every configuration, the output (JSON) contains the number of DOFs, elements and threads, and for the first
+// assembly (which creates the sparse structure and fills the cache) and for the fastest of the repeated ones
+// (with the cache on, all elements are marked as not changed before them, as after an adaptation step)
+// the total time and the times of the phases of the assembly (DiscreteProblem::AssemblyPhase):
+// traversal, order (calc_order_matrix_form / calc_order_vector_form), basis (tabulation of the shape functions and
+// the geometry), forms (evaluation), insertion (into the global matrix and vector).
+// The times of the phases are summed over the threads, they include the overhead of the profiling itself.
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+using namespace Hermes::Algebra;
+
+static const SpaceType space_types[] = { HERMES_H1_SPACE, HERMES_HCURL_SPACE, HERMES_HDIV_SPACE, HERMES_L2_SPACE };
+static const char* space_names[] = { "H1", "Hcurl", "Hdiv", "L2" };
+static const int num_space_types = 4;
+
+static const char* phase_names[] = { "traversal", "order", "basis", "forms", "insertion" };
+
+/// (u, v) + (D u, D v), D depending on the space type. Only the mass part if coupling is true.
+class BenchmarkMatrixForm : public MatrixFormVol<double>
+{
+public:
+  BenchmarkMatrixForm(int i, int j, SpaceType space_type, bool coupling) : MatrixFormVol<double>(i, j), space_type(space_type), coupling(coupling)
+  {
+  }
+
+  template<typename Real, typename Scalar>
+  Scalar matrix_form(int n, double *wt, Func<Real> *u, Func<Real> *v) const
+  {
+    Scalar result = Scalar(0);
+    for (int i = 0; i < n; i++)
+    {
+      switch(space_type)
+      {
+      case HERMES_H1_SPACE:
+      case HERMES_L2_SPACE:
+        result += wt[i] * (u->val[i] * v->val[i]);
+        if(!coupling)
+          result += wt[i] * (u->dx[i] * v->dx[i] + u->dy[i] * v->dy[i]);
+        break;
+      case HERMES_HCURL_SPACE:
+        result += wt[i] * (u->val0[i] * v->val0[i] + u->val1[i] * v->val1[i]);
+        if(!coupling)
+          result += wt[i] * (u->curl[i] * v->curl[i]);
+        break;
+      default:
+        result += wt[i] * (u->val0[i] * v->val0[i] + u->val1[i] * v->val1[i]);
+        if(!coupling)
+          result += wt[i] * (u->div[i] * v->div[i]);
+      }
+    }
+    return result;
+  }
+
+  virtual double value(int n, double *wt, Func<double> *u_ext[], Func<double> *u, Func<double> *v, Geom<double> *e, Func<double> **ext) const
+  {
+    return matrix_form<double, double>(n, wt, u, v);
+  }
+
+  virtual Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, Geom<Ord> *e, Func<Ord> **ext) const
+  {
+    return matrix_form<Ord, Ord>(n, wt, u, v);
+  }
+
+  virtual MatrixFormVol<double>* clone() const
+  {
+    return new BenchmarkMatrixForm(*this);
+  }
+
+private:
+  SpaceType space_type;
+  bool coupling;
+};
+
+/// (1, v), the first component for the vector valued spaces.
+class BenchmarkVectorForm : public VectorFormVol<double>
+{
+public:
+  BenchmarkVectorForm(int i, SpaceType space_type) : VectorFormVol<double>(i), space_type(space_type)
+  {
+  }
+
+  template<typename Real, typename Scalar>
+  Scalar vector_form(int n, double *wt, Func<Real> *v) const
+  {
+    Scalar result = Scalar(0);
+    if(space_type == HERMES_H1_SPACE || space_type == HERMES_L2_SPACE)
+      for (int i = 0; i < n; i++)
+        result += wt[i] * v->val[i];
+    else
+      for (int i = 0; i < n; i++)
+        result += wt[i] * v->val0[i];
+    return result;
+  }
+
+  virtual double value(int n, double *wt, Func<double> *u_ext[], Func<double> *v, Geom<double> *e, Func<double> **ext) const
+  {
+    return vector_form<double, double>(n, wt, v);
+  }
+
+  virtual Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, Func<Ord> **ext) const
+  {
+    return vector_form<Ord, Ord>(n, wt, v);
+  }
+
+  virtual VectorFormVol<double>* clone() const
+  {
+    return new BenchmarkVectorForm(*this);
+  }
+
+private:
+  SpaceType space_type;
+};
+
+class BenchmarkWeakForm : public WeakForm<double>
+{
+public:
+  BenchmarkWeakForm(SpaceType space_type) : WeakForm<double>(2)
+  {
+    add_matrix_form(new BenchmarkMatrixForm(0, 0, space_type, false));
+    add_matrix_form(new BenchmarkMatrixForm(1, 1, space_type, false));
+    add_matrix_form(new BenchmarkMatrixForm(0, 1, space_type, true));
+    add_vector_form(new BenchmarkVectorForm(0, space_type));
+    add_vector_form(new BenchmarkVectorForm(1, space_type));
+  }
+
+  virtual WeakForm<double>* clone() const
+  {
+    // The forms are cloned by cloneMembers().
+    return new BenchmarkWeakForm(*this);
+  }
+};
+
+/// Unit square divided into n x n quads, or into 2 n x n triangles.
+static void create_square_mesh(Mesh* mesh, int n, bool triangles)
+{
+  int nv = (n + 1) * (n + 1);
+  double2* verts = new double2[nv];
+  for (int j = 0; j <= n; j++)
+    for (int i = 0; i <= n; i++)
+    {
+      verts[j * (n + 1) + i][0] = (double)i / n;
+      verts[j * (n + 1) + i][1] = (double)j / n;
+    }
+
+  int nt = triangles ? 2 * n * n : 0, nq = triangles ? 0 : n * n;
+  int3* tris = new int3[nt];
+  int4* quads = new int4[nq];
+  std::string* tri_markers = new std::string[nt];
+  std::string* quad_markers = new std::string[nq];
+  for (int j = 0; j < n; j++)
+    for (int i = 0; i < n; i++)
+    {
+      int v0 = j * (n + 1) + i, v1 = v0 + 1, v2 = v1 + n + 1, v3 = v0 + n + 1;
+      int cell = j * n + i;
+      if(triangles)
+      {
+        tris[2 * cell][0] = v0; tris[2 * cell][1] = v1; tris[2 * cell][2] = v2;
+        tris[2 * cell + 1][0] = v0; tris[2 * cell + 1][1] = v2; tris[2 * cell + 1][2] = v3;
+        tri_markers[2 * cell] = tri_markers[2 * cell + 1] = "domain";
+      }
+      else
+      {
+        quads[cell][0] = v0; quads[cell][1] = v1; quads[cell][2] = v2; quads[cell][3] = v3;
+        quad_markers[cell] = "domain";
+      }
+    }
+
+  int nm = 4 * n;
+  int2* mark = new int2[nm];
+  std::string* boundary_markers = new std::string[nm];
+  for (int i = 0; i < n; i++)
+  {
+    mark[i][0] = i; mark[i][1] = i + 1;
+    mark[n + i][0] = i * (n + 1) + n; mark[n + i][1] = (i + 1) * (n + 1) + n;
+    mark[2 * n + i][0] = n * (n + 1) + i; mark[2 * n + i][1] = n * (n + 1) + i + 1;
+    mark[3 * n + i][0] = i * (n + 1); mark[3 * n + i][1] = (i + 1) * (n + 1);
+  }
+  for (int i = 0; i < nm; i++)
+    boundary_markers[i] = "boundary";
+
+  mesh->create(nv, verts, nt, tris, tri_markers, nq, quads, quad_markers, nm, mark, boundary_markers);
+
+  delete [] verts;
+  delete [] tris;
+  delete [] quads;
+  delete [] tri_markers;
+  delete [] quad_markers;
+  delete [] mark;
+  delete [] boundary_markers;
+}
+
+/// Space that can mark all elements as not changed, as after an adaptation step that did not touch them.
+/// Only the data of such elements are taken from the assembly cache.
+class UnchangedSpace
+{
+public:
+  virtual void set_unchanged() = 0;
+};
+
+template<typename SpaceT>
+class BenchmarkSpace : public SpaceT, public UnchangedSpace
+{
+public:
+  BenchmarkSpace(const Mesh* mesh, int p) : SpaceT(mesh, p)
+  {
+  }
+
+  virtual void set_unchanged()
+  {
+    Element* e;
+    for_all_active_elements(e, this->get_mesh())
+      this->edata[e->id].changed_in_last_adaptation = false;
+  }
+};
+
+static Space<double>* create_space(SpaceType space_type, const Mesh* mesh, int p)
+{
+  switch(space_type)
+  {
+  case HERMES_H1_SPACE:
+    return new BenchmarkSpace<H1Space<double> >(mesh, p);
+  case HERMES_HCURL_SPACE:
+    return new BenchmarkSpace<HcurlSpace<double> >(mesh, p);
+  case HERMES_HDIV_SPACE:
+    return new BenchmarkSpace<HdivSpace<double> >(mesh, p);
+  default:
+    return new BenchmarkSpace<L2Space<double> >(mesh, p);
+  }
+}
+
+/// Times of one assemble().
+struct AssemblyTimes
+{
+  double total;
+  double phases[DiscreteProblem<double>::AssemblyPhaseCount];
+};
+
+static AssemblyTimes assemble_once(DiscreteProblem<double>& dp, SparseMatrix<double>* matrix, Vector<double>* rhs)
+{
+  Hermes::Mixins::TimeMeasurable timer;
+  timer.tick(Hermes::Mixins::TimeMeasurable::HERMES_SKIP);
+  dp.assemble(matrix, rhs);
+  AssemblyTimes times;
+  times.total = timer.tick().last();
+  for (int phase = 0; phase < DiscreteProblem<double>::AssemblyPhaseCount; phase++)
+    times.phases[phase] = dp.get_assembly_time((DiscreteProblem<double>::AssemblyPhase)phase);
+  return times;
+}
+
+static void write_times(std::ostream& out, const char* name, const AssemblyTimes& times)
+{
+  out << "\"" << name << "\": {\"total\": " << times.total;
+  for (int phase = 0; phase < DiscreteProblem<double>::AssemblyPhaseCount; phase++)
+    out << ", \"" << phase_names[phase] << "\": " << times.phases[phase];
+  out << "}";
+}
+
+/// Writes a string as a JSON string literal.
+static void write_json_string(std::ostream& out, const char* str)
+{
+  out << "\"";
+  for (const char* c = str; *c != '\0'; c++)
+  {
+    switch(*c)
+    {
+    case '"': out << "\\\""; break;
+    case '\\': out << "\\\\"; break;
+    case '\n': out << "\\n"; break;
+    case '\r': out << "\\r"; break;
+    case '\t': out << "\\t"; break;
+    default:
+      if((unsigned char)*c < 0x20)
+      {
+        char code[8];
+        sprintf(code, "\\u%04x", (unsigned char)*c);
+        out << code;
+      }
+      else
+        out << *c;
+    }
+  }
+  out << "\"";
+}
+
+int main(int argc, char* argv[])
+{
+  int num_threads = 1, n = 8, p_min = 1, p_max = 10, repeats = 3;
+  const char* output_file = NULL;
+  const char* only_space = NULL;
+  for (int i = 1; i < argc; i++)
+  {
+    if(!strcmp(argv[i], "-t") && i + 1 < argc)
+      num_threads = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-n") && i + 1 < argc)
+      n = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-p") && i + 2 < argc)
+    {
+      p_min = atoi(argv[++i]);
+      p_max = atoi(argv[++i]);
+    }
+    else if(!strcmp(argv[i], "-s") && i + 1 < argc)
+      only_space = argv[++i];
+    else if(!strcmp(argv[i], "-r") && i + 1 < argc)
+      repeats = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-o") && i + 1 < argc)
+      output_file = argv[++i];
+    else
+    {
+      printf("Usage: %s [-t threads] [-n elements] [-p min_degree max_degree] [-s space] [-r repeats] [-o output.json]\n", argv[0]);
+      return 1;
+    }
+  }
+  if(num_threads < 1 || n < 1 || p_min < 1 || p_max < p_min || repeats < 1)
+  {
+    printf("Invalid parameters.\n");
+    return 1;
+  }
+
+  Hermes2DApi.set_integral_param_value(Hermes::Hermes2D::numThreads, num_threads);
+
+  std::ofstream file;
+  if(output_file != NULL)
+  {
+    file.open(output_file);
+    if(!file.is_open())
+    {
+      printf("Cannot open %s.\n", output_file);
+      return 1;
+    }
+  }
+  std::ostream& out = output_file != NULL ? file : std::cout;
+  out.precision(6);
+
+  out << "{\"threads\": " << num_threads << ", \"elements_per_side\": " << n << ", \"repeats\": " << repeats << ", \"results\": [";
+  bool first_record = true;
+
+  for (int shape = 0; shape < 2; shape++)
+  {
+    bool triangles = (shape == 0);
+    Mesh mesh, multimesh;
+    create_square_mesh(&mesh, n, triangles);
+    multimesh.copy(&mesh);
+    Element* e;
+    for_all_active_elements(e, &mesh)
+      if(e->vn[0]->y < 0.5 && e->vn[1]->y < 0.5 && e->vn[2]->y < 0.5)
+        multimesh.refine_element_id(e->id);
+
+    for (int space_i = 0; space_i < num_space_types; space_i++)
+    {
+      if(only_space != NULL && strcmp(only_space, space_names[space_i]))
+        continue;
+      // The Hdiv shapeset only has quads.
+      if(triangles && space_types[space_i] == HERMES_HDIV_SPACE)
+        continue;
+
+      for (int p = p_min; p <= p_max; p++)
+        for (int multi = 0; multi < 2; multi++)
+          for (int cache = 1; cache >= 0; cache--)
+          {
+            out << (first_record ? "\n" : ",\n");
+            first_record = false;
+            out << "  {\"space\": \"" << space_names[space_i] << "\", \"p\": " << p << ", \"elements\": \"" << (triangles ? "triangles" : "quads")
+              << "\", \"multimesh\": " << (multi ? "true" : "false") << ", \"cache\": " << (cache ? "true" : "false");
+
+            Space<double>* space_1 = NULL;
+            Space<double>* space_2 = NULL;
+            SparseMatrix<double>* matrix = NULL;
+            Vector<double>* rhs = NULL;
+            try
+            {
+              space_1 = create_space(space_types[space_i], &mesh, p);
+              space_2 = create_space(space_types[space_i], multi ? &multimesh : &mesh, p);
+              BenchmarkWeakForm wf(space_types[space_i]);
+              DiscreteProblem<double> dp(&wf, Hermes::vector<const Space<double>*>(space_1, space_2));
+              if(!cache)
+                dp.set_do_not_use_cache();
+              dp.set_assembly_profiling();
+
+              matrix = create_matrix<double>();
+              rhs = create_vector<double>();
+
+              AssemblyTimes first = assemble_once(dp, matrix, rhs);
+              if(cache)
+              {
+                dynamic_cast<UnchangedSpace*>(space_1)->set_unchanged();
+                dynamic_cast<UnchangedSpace*>(space_2)->set_unchanged();
+              }
+              AssemblyTimes best = first;
+              for (int repeat_i = 0; repeat_i < repeats; repeat_i++)
+              {
+                AssemblyTimes times = assemble_once(dp, matrix, rhs);
+                if(repeat_i == 0 || times.total < best.total)
+                  best = times;
+              }
+
+              out << ", \"dofs\": " << dp.get_num_dofs() << ", \"active_elements\": " << mesh.get_num_active_elements()
+                << ", \"nnz\": " << matrix->get_nnz() << ", ";
+              write_times(out, "first", first);
+              out << ", ";
+              write_times(out, "repeated", best);
+            }
+            catch(std::exception& e)
+            {
+              out << ", \"error\": ";
+              write_json_string(out, e.what());
+            }
+            out << "}";
+            out.flush();
+
+            delete matrix;
+            delete rhs;
+            delete space_1;
+            delete space_2;
+          }
+    }
+  }
+
+  out << "\n]}\n";
+  return 0;
+}
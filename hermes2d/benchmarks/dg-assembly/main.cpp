@@ -0,0 +1,233 @@
+#include "definitions.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+// Times DiscreteProblem::assemble() of the linear advection DG problem of test_examples/10-linear-advection-dg-adapt
+// (volume, boundary and interface forms on an L2 space) on meshes resembling the adapted ones: the square.mesh
+// of the example refined uniformly, and then repeatedly along the circle of radius 0.5 (the discontinuity
+// of the solution), which gives hanging nodes of several levels, i.e. interfaces with several neighbors.
+//
+// Usage: dg-assembly [-m mesh] [-i initial_refinements] [-l levels] [-p min_degree max_degree] [-t threads] [-r repeats] [-o output.json]
+//   -m  mesh file, default square.mesh (copied from the example by CMake),
+//   -i  number of uniform refinements, default 3,
+//   -l  number of refinements along the circle, default 3,
+//   -p  the range of the polynomial degrees, default 0 4,
+//   -t  number of threads (Hermes2DApi parameter numThreads), default 1,
+//   -r  number of repeated assemblies of the same system, default 3,
+//   -o  output file, default the standard output.
+//
+// For every polynomial degree, the output (JSON) contains the number of DOFs, elements and interface segments,
+// and for the first assembly (which creates the sparse structure) and for the fastest of the repeated ones
+// the total time and the times of the phases of the assembly (DiscreteProblem::AssemblyPhase).
+// The times of the phases are summed over the threads, they include the overhead of the profiling itself.
+
+using namespace Hermes::Algebra;
+
+static const char* phase_names[] = { "traversal", "order", "basis", "forms", "insertion" };
+
+/// Refines the elements crossing the circle of radius 0.5 centered at the origin, levels times.
+static void refine_along_circle(Mesh* mesh, int levels)
+{
+  for (int level = 0; level < levels; level++)
+  {
+    std::vector<int> ids;
+    Element* e;
+    for_all_active_elements(e, mesh)
+    {
+      bool inside = false, outside = false;
+      for (unsigned int i = 0; i < e->get_nvert(); i++)
+      {
+        double r = std::sqrt(e->vn[i]->x * e->vn[i]->x + e->vn[i]->y * e->vn[i]->y);
+        if(r < 0.5)
+          inside = true;
+        else
+          outside = true;
+      }
+      if(inside && outside)
+        ids.push_back(e->id);
+    }
+    for (unsigned int i = 0; i < ids.size(); i++)
+      mesh->refine_element_id(ids[i]);
+  }
+}
+
+/// Number of inner edge segments, i.e. of the DG interface integrals.
+static int count_interface_segments(Mesh* mesh)
+{
+  int count = 0;
+  Element* e;
+  for_all_active_elements(e, mesh)
+    for (unsigned int edge = 0; edge < e->get_nvert(); edge++)
+    {
+      if(e->en[edge]->bnd)
+        continue;
+      NeighborSearch<double> ns(e, mesh);
+      ns.set_active_edge(edge);
+      count += ns.get_num_neighbors();
+    }
+  // Every segment is found from both of its elements.
+  return count / 2;
+}
+
+/// Times of one assemble().
+struct AssemblyTimes
+{
+  double total;
+  double phases[DiscreteProblem<double>::AssemblyPhaseCount];
+};
+
+static AssemblyTimes assemble_once(DiscreteProblem<double>& dp, SparseMatrix<double>* matrix, Vector<double>* rhs)
+{
+  Hermes::Mixins::TimeMeasurable timer;
+  timer.tick(Hermes::Mixins::TimeMeasurable::HERMES_SKIP);
+  dp.assemble(matrix, rhs);
+  AssemblyTimes times;
+  times.total = timer.tick().last();
+  for (int phase = 0; phase < DiscreteProblem<double>::AssemblyPhaseCount; phase++)
+    times.phases[phase] = dp.get_assembly_time((DiscreteProblem<double>::AssemblyPhase)phase);
+  return times;
+}
+
+static void write_times(std::ostream& out, const char* name, const AssemblyTimes& times)
+{
+  out << "\"" << name << "\": {\"total\": " << times.total;
+  for (int phase = 0; phase < DiscreteProblem<double>::AssemblyPhaseCount; phase++)
+    out << ", \"" << phase_names[phase] << "\": " << times.phases[phase];
+  out << "}";
+}
+
+/// Writes a string as a JSON string literal.
+static void write_json_string(std::ostream& out, const char* str)
+{
+  out << "\"";
+  for (const char* c = str; *c != '\0'; c++)
+  {
+    switch(*c)
+    {
+    case '"': out << "\\\""; break;
+    case '\\': out << "\\\\"; break;
+    case '\n': out << "\\n"; break;
+    case '\r': out << "\\r"; break;
+    case '\t': out << "\\t"; break;
+    default:
+      if((unsigned char)*c < 0x20)
+      {
+        char code[8];
+        sprintf(code, "\\u%04x", (unsigned char)*c);
+        out << code;
+      }
+      else
+        out << *c;
+    }
+  }
+  out << "\"";
+}
+
+int main(int argc, char* argv[])
+{
+  const char* mesh_file = "square.mesh";
+  int init_ref = 3, levels = 3, p_min = 0, p_max = 4, num_threads = 1, repeats = 3;
+  const char* output_file = NULL;
+  for (int i = 1; i < argc; i++)
+  {
+    if(!strcmp(argv[i], "-m") && i + 1 < argc)
+      mesh_file = argv[++i];
+    else if(!strcmp(argv[i], "-i") && i + 1 < argc)
+      init_ref = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-l") && i + 1 < argc)
+      levels = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-p") && i + 2 < argc)
+    {
+      p_min = atoi(argv[++i]);
+      p_max = atoi(argv[++i]);
+    }
+    else if(!strcmp(argv[i], "-t") && i + 1 < argc)
+      num_threads = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-r") && i + 1 < argc)
+      repeats = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-o") && i + 1 < argc)
+      output_file = argv[++i];
+    else
+    {
+      printf("Usage: %s [-m mesh] [-i initial_refinements] [-l levels] [-p min_degree max_degree] [-t threads] [-r repeats] [-o output.json]\n", argv[0]);
+      return 1;
+    }
+  }
+  if(init_ref < 0 || levels < 0 || p_min < 0 || p_max < p_min || num_threads < 1 || repeats < 1)
+  {
+    printf("Invalid parameters.\n");
+    return 1;
+  }
+
+  Hermes2DApi.set_integral_param_value(Hermes::Hermes2D::numThreads, num_threads);
+
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load(mesh_file, &mesh);
+  for (int i = 0; i < init_ref; i++)
+    mesh.refine_all_elements();
+  refine_along_circle(&mesh, levels);
+
+  std::ofstream file;
+  if(output_file != NULL)
+  {
+    file.open(output_file);
+    if(!file.is_open())
+    {
+      printf("Cannot open %s.\n", output_file);
+      return 1;
+    }
+  }
+  std::ostream& out = output_file != NULL ? file : std::cout;
+  out.precision(6);
+
+  out << "{\"threads\": " << num_threads << ", \"active_elements\": " << mesh.get_num_active_elements()
+    << ", \"interface_segments\": " << count_interface_segments(&mesh) << ", \"repeats\": " << repeats << ", \"results\": [";
+
+  for (int p = p_min; p <= p_max; p++)
+  {
+    out << (p == p_min ? "\n" : ",\n");
+    out << "  {\"p\": " << p;
+
+    SparseMatrix<double>* matrix = NULL;
+    Vector<double>* rhs = NULL;
+    try
+    {
+      L2Space<double> space(&mesh, p);
+      CustomWeakForm wf("Bdy_bottom_left", &mesh);
+      DiscreteProblem<double> dp(&wf, &space);
+      dp.set_assembly_profiling();
+
+      matrix = create_matrix<double>();
+      rhs = create_vector<double>();
+
+      AssemblyTimes first = assemble_once(dp, matrix, rhs);
+      AssemblyTimes best = first;
+      for (int repeat_i = 0; repeat_i < repeats; repeat_i++)
+      {
+        AssemblyTimes times = assemble_once(dp, matrix, rhs);
+        if(repeat_i == 0 || times.total < best.total)
+          best = times;
+      }
+
+      out << ", \"dofs\": " << dp.get_num_dofs() << ", \"nnz\": " << matrix->get_nnz() << ", ";
+      write_times(out, "first", first);
+      out << ", ";
+      write_times(out, "repeated", best);
+    }
+    catch(std::exception& e)
+    {
+      out << ", \"error\": ";
+      write_json_string(out, e.what());
+    }
+    out << "}";
+    out.flush();
+
+    delete matrix;
+    delete rhs;
+  }
+
+  out << "\n]}\n";
+  return 0;
+}
@@ -0,0 +1,366 @@
+#include "hermes_common.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+// Replays captured linear systems on all linear solvers compiled in, to compare them on
+// the problems they are actually used for.
+//
+// Usage: solver-replay [-r repeats] file [file ...]
+//
+// The files are systems captured by the matrix output of the solvers (see MatrixRhsOutput):
+//   - DF_HERMES_CSC (CSCMatrix::save_binary()), memory-mapped, with the right-hand side if it was stored,
+//   - DF_HERMES_BIN, the right-hand side dumped with DF_HERMES_BIN may directly follow the matrix file,
+//   - DF_MATRIX_MARKET (both the symmetric files Hermes writes and general ones).
+// Systems without a right-hand side are solved with b = A * (1, ..., 1).
+//
+// For every solver the following is reported:
+//   - setup: copying the system into the solver's matrix and vector and creating the solver,
+//   - memory: growth of the resident set size by the setup and the first solve,
+//   - first: the first solve (HERMES_FACTORIZE_FROM_SCRATCH),
+//   - one column per factorization scheme: the fastest of the repeated solves with that scheme, i.e.
+//     the factorization (whatever the scheme does not reuse) and the solve, the column
+//     HERMES_REUSE_FACTORIZATION_COMPLETELY is thus the solve alone,
+//   - residual: the largest relative residual ||b - Ax|| / ||b|| of all the solves.
+// Only real (double) systems are supported.
+
+using namespace Hermes;
+using namespace Hermes::Algebra;
+using namespace Hermes::Solvers;
+
+/// Solvers compiled in.
+static const MatrixSolverType solver_types[] =
+{
+#ifdef WITH_UMFPACK
+  SOLVER_UMFPACK,
+#endif
+#ifdef WITH_SUPERLU
+  SOLVER_SUPERLU,
+#endif
+#ifdef WITH_MUMPS
+  SOLVER_MUMPS,
+#endif
+#ifdef WITH_PETSC
+  SOLVER_PETSC,
+#endif
+#if defined HAVE_AMESOS && defined HAVE_EPETRA
+  SOLVER_AMESOS,
+#endif
+#if defined HAVE_AZTECOO && defined HAVE_EPETRA
+  SOLVER_AZTECOO,
+#endif
+  // Terminator.
+  (MatrixSolverType)-1
+};
+
+static const char* solver_names[] = { "UMFPACK", "PETSc", "MUMPS", "SuperLU", "Amesos", "AztecOO" };
+
+static const FactorizationScheme schemes[] =
+{
+  HERMES_FACTORIZE_FROM_SCRATCH,
+  HERMES_REUSE_MATRIX_REORDERING,
+  HERMES_REUSE_MATRIX_REORDERING_AND_SCALING,
+  HERMES_REUSE_FACTORIZATION_COMPLETELY
+};
+static const int num_schemes = 4;
+static const char* scheme_names[] = { "scratch", "reorder", "reord+scal", "reuse" };
+
+/// A captured system in the CSC form.
+struct CapturedSystem
+{
+  std::string name;
+  CSCMatrix<double> matrix;
+  std::vector<double> rhs;
+};
+
+/// Resident set size in bytes, -1 if not known.
+static double resident_set_size()
+{
+#ifdef __linux__
+  std::ifstream statm("/proc/self/statm");
+  long pages_total, pages_resident;
+  if(statm >> pages_total >> pages_resident)
+    return (double)pages_resident * sysconf(_SC_PAGESIZE);
+#endif
+  return -1;
+}
+
+/// Loads a matrix dumped with DF_HERMES_BIN.
+static bool load_hermes_bin(const char* filename, CapturedSystem& system)
+{
+  FILE* file = fopen(filename, "rb");
+  if(file == NULL)
+    return false;
+  char magic[8];
+  int scalar_size, size, nnz;
+  bool ok = fread(magic, 1, 8, file) == 8 && memcmp(magic, "HERMESX\001", 8) == 0
+    && fread(&scalar_size, sizeof(int), 1, file) == 1 && fread(&size, sizeof(int), 1, file) == 1
+    && fread(&nnz, sizeof(int), 1, file) == 1;
+  if(!ok || scalar_size != sizeof(double) || size < 0 || nnz < 0)
+  {
+    fclose(file);
+    if(ok)
+      throw Exceptions::Exception("%s: only real matrices are supported.", filename);
+    return false;
+  }
+
+  std::vector<int> ap(size + 1), ai(nnz + 1);
+  std::vector<double> ax(nnz + 1);
+  ok = fread(&ap[0], sizeof(int), size + 1, file) == (size_t)size + 1
+    && fread(&ai[0], sizeof(int), nnz, file) == (size_t)nnz && fread(&ax[0], sizeof(double), nnz, file) == (size_t)nnz;
+  fclose(file);
+  if(ok)
+    system.matrix.create(size, nnz, &ap[0], &ai[0], &ax[0]);
+  return ok;
+}
+
+/// Loads a right-hand side dumped with DF_HERMES_BIN.
+static bool load_hermes_bin_rhs(const char* filename, CapturedSystem& system)
+{
+  FILE* file = fopen(filename, "rb");
+  if(file == NULL)
+    return false;
+  char magic[8];
+  int scalar_size, size;
+  bool ok = fread(magic, 1, 8, file) == 8 && memcmp(magic, "HERMESR\001", 8) == 0
+    && fread(&scalar_size, sizeof(int), 1, file) == 1 && fread(&size, sizeof(int), 1, file) == 1
+    && scalar_size == sizeof(double) && size == (int)system.matrix.get_size();
+  if(ok)
+  {
+    system.rhs.resize(size);
+    ok = fread(&system.rhs[0], sizeof(double), size, file) == (size_t)size;
+  }
+  fclose(file);
+  return ok;
+}
+
+/// Loads a matrix in the Matrix Market coordinate format.
+static bool load_matrix_market(const char* filename, CapturedSystem& system)
+{
+  std::ifstream file(filename);
+  std::string line;
+  if(!std::getline(file, line) || line.compare(0, 2, "%%") != 0)
+    return false;
+  if(line.find("coordinate") == std::string::npos || line.find("complex") != std::string::npos)
+    throw Exceptions::Exception("%s: only real matrices in the coordinate format are supported.", filename);
+  bool symmetric = line.find("symmetric") != std::string::npos;
+
+  while(std::getline(file, line) && line[0] == '%')
+    ;
+  int rows, cols, entries;
+  std::istringstream header(line);
+  if(!(header >> rows >> cols >> entries) || rows != cols)
+    throw Exceptions::Exception("%s: a square matrix expected.", filename);
+
+  // gather the entries by columns
+  std::vector<std::vector<std::pair<int, double> > > columns(cols);
+  for (int k = 0; k < entries; k++)
+  {
+    int i, j;
+    double value;
+    if(!(file >> i >> j >> value))
+      throw Exceptions::Exception("%s is truncated.", filename);
+    columns[j - 1].push_back(std::make_pair(i - 1, value));
+    if(symmetric && i != j)
+      columns[i - 1].push_back(std::make_pair(j - 1, value));
+  }
+
+  std::vector<int> ap(cols + 1, 0), ai;
+  std::vector<double> ax;
+  for (int j = 0; j < cols; j++)
+  {
+    std::sort(columns[j].begin(), columns[j].end());
+    for (unsigned int k = 0; k < columns[j].size(); k++)
+    {
+      ai.push_back(columns[j][k].first);
+      ax.push_back(columns[j][k].second);
+    }
+    ap[j + 1] = ai.size();
+  }
+  system.matrix.create(cols, ai.size(), &ap[0], ai.empty() ? NULL : &ai[0], ax.empty() ? NULL : &ax[0]);
+  return true;
+}
+
+/// Loads the system from the file argv[i], returns the index of the last file used.
+static int load_system(char** argv, int argc, int i, CapturedSystem& system)
+{
+  system.name = argv[i];
+  system.rhs.clear();
+
+  // The binary CSC container.
+  char magic[8] = { 0 };
+  FILE* file = fopen(argv[i], "rb");
+  if(file == NULL)
+    throw Exceptions::Exception("Could not open %s.", argv[i]);
+  size_t read = fread(magic, 1, 8, file);
+  fclose(file);
+  if(read == 8 && memcmp(magic, "HERMESBF", 8) == 0)
+  {
+    UMFPackVector<double> rhs;
+    try
+    {
+      system.matrix.load_mmap(argv[i], &rhs);
+      system.rhs.resize(rhs.length());
+      rhs.extract(&system.rhs[0]);
+    }
+    catch(Exceptions::Exception&)
+    {
+      // stored without the right-hand side
+      system.matrix.load_mmap(argv[i]);
+    }
+  }
+  else if(load_hermes_bin(argv[i], system))
+  {
+    if(i + 1 < argc && load_hermes_bin_rhs(argv[i + 1], system))
+      i++;
+  }
+  else if(!load_matrix_market(argv[i], system))
+    throw Exceptions::Exception("%s is not a captured linear system.", argv[i]);
+
+  if(system.rhs.empty())
+  {
+    std::vector<double> ones(system.matrix.get_size(), 1.0);
+    system.rhs.resize(system.matrix.get_size());
+    system.matrix.multiply_with_vector(&ones[0], &system.rhs[0]);
+  }
+  return i;
+}
+
+/// Relative residual ||b - Ax|| / ||b||.
+static double relative_residual(CapturedSystem& system, double* x)
+{
+  unsigned int size = system.matrix.get_size();
+  std::vector<double> ax(size);
+  system.matrix.multiply_with_vector(x, &ax[0]);
+  double residual = 0, norm = 0;
+  for (unsigned int i = 0; i < size; i++)
+  {
+    residual += (system.rhs[i] - ax[i]) * (system.rhs[i] - ax[i]);
+    norm += system.rhs[i] * system.rhs[i];
+  }
+  return norm > 0 ? std::sqrt(residual / norm) : std::sqrt(residual);
+}
+
+/// Runs all the solves of one solver on the system and prints a line of the report.
+static void run_solver(CapturedSystem& system, MatrixSolverType solver_type, int repeats)
+{
+  HermesCommonApi.set_integral_param_value(matrixSolverType, solver_type);
+  Mixins::TimeMeasurable timer;
+  double memory_before = resident_set_size();
+
+  // setup
+  timer.tick();
+  SparseMatrix<double>* matrix = create_matrix<double>();
+  Vector<double>* rhs = create_vector<double>();
+  matrix->alloc_with_structure(system.matrix.get_size(), system.matrix.get_Ap(), system.matrix.get_Ai());
+  for (unsigned int j = 0; j < system.matrix.get_size(); j++)
+    for (int k = system.matrix.get_Ap()[j]; k < system.matrix.get_Ap()[j + 1]; k++)
+      matrix->add(system.matrix.get_Ai()[k], j, system.matrix.get_Ax()[k]);
+  matrix->finish();
+  rhs->alloc(system.matrix.get_size());
+  for (unsigned int i = 0; i < system.matrix.get_size(); i++)
+    rhs->set(i, system.rhs[i]);
+  rhs->finish();
+  LinearMatrixSolver<double>* solver = create_linear_solver<double>(matrix, rhs);
+  solver->set_verbose_output(false);
+  double setup_time = timer.tick().last();
+
+  double max_residual = 0;
+  bool failed = false;
+  solver->set_factorization_scheme(HERMES_FACTORIZE_FROM_SCRATCH);
+  timer.tick();
+  failed = !solver->solve();
+  double first_time = timer.tick().last();
+  if(!failed)
+    max_residual = relative_residual(system, solver->get_sln_vector());
+  double memory = resident_set_size() - memory_before;
+
+  double scheme_times[num_schemes];
+  for (int s = 0; s < num_schemes && !failed; s++)
+  {
+    scheme_times[s] = -1;
+    for (int r = 0; r < repeats && !failed; r++)
+    {
+      solver->set_factorization_scheme(schemes[s]);
+      timer.tick();
+      failed = !solver->solve();
+      double time = timer.tick().last();
+      if(scheme_times[s] < 0 || time < scheme_times[s])
+        scheme_times[s] = time;
+      if(!failed)
+        max_residual = std::max(max_residual, relative_residual(system, solver->get_sln_vector()));
+    }
+  }
+
+  printf("  %-8s %10.4f %9.1f %10.4f", solver_names[solver_type], setup_time, memory / 1048576.0, first_time);
+  if(failed)
+    printf("  failed\n");
+  else
+  {
+    for (int s = 0; s < num_schemes; s++)
+      printf(" %10.4f", scheme_times[s]);
+    printf(" %10.2e\n", max_residual);
+  }
+
+  delete solver;
+  delete matrix;
+  delete rhs;
+}
+
+int main(int argc, char* argv[])
+{
+  int repeats = 3;
+  int first_file = 1;
+  if(argc > 2 && strcmp(argv[1], "-r") == 0)
+  {
+    repeats = std::max(1, atoi(argv[2]));
+    first_file = 3;
+  }
+  if(first_file >= argc)
+  {
+    printf("Usage: %s [-r repeats] file [file ...]\n", argv[0]);
+    return 1;
+  }
+  if(solver_types[0] == (MatrixSolverType)-1)
+  {
+    printf("No linear solver compiled in.\n");
+    return 1;
+  }
+
+  for (int i = first_file; i < argc; i++)
+  {
+    CapturedSystem system;
+    try
+    {
+      i = load_system(argv, argc, i, system);
+    }
+    catch(std::exception& e)
+    {
+      printf("%s\n", e.what());
+      continue;
+    }
+
+    printf("%s: size %u, nnz %u\n", system.name.c_str(), system.matrix.get_size(), system.matrix.get_nnz());
+    printf("  %-8s %10s %9s %10s", "solver", "setup [s]", "mem [MB]", "first [s]");
+    for (int s = 0; s < num_schemes; s++)
+      printf(" %10s", scheme_names[s]);
+    printf(" %10s\n", "residual");
+
+    for (int k = 0; solver_types[k] != (MatrixSolverType)-1; k++)
+    {
+      try
+      {
+        run_solver(system, solver_types[k], repeats);
+      }
+      catch(std::exception& e)
+      {
+        printf("  %-8s %s\n", solver_names[solver_types[k]], e.what());
+      }
+    }
+  }
+  return 0;
+}
@@ -39,7 +39,9 @@ namespace Hermes
     {
       numThreads,
 			xmlSchemasDirPath,
-			precalculatedFormsDirPath
+			precalculatedFormsDirPath,
+      solutionElementCacheSize,
+      solutionElementCacheMemory
     };
 
     /// API Class containing settings for the whole Hermes2D.
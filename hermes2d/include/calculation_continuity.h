@@ -23,6 +23,8 @@
 #include "config.h"
 #include "compat.h"
 #include "function/solution.h"
+#include <deque>
+#include <list>
 
 namespace Hermes
 {
@@ -61,6 +63,14 @@ namespace Hermes
 
     /// Class used for resuming an interrupted calculation.
     /// Its purpose is to store everything necessary to resume it from a certain point.
+    ///
+    /// Records are checkpoints in the binary formats (MeshReaderH2DBinary, Space::save_binary(), Solution::save_binary()).
+    /// add_record() only copies the data to memory images, the files are written by a background thread
+    /// (unless switched off in the constructor), so the calculation goes on while the record is being written.
+    /// Meshes and spaces that did not change since the previous record (their seq is the same) are not written
+    /// again, the record refers to the files of the previous one instead (see Record::save_manifest()).
+    /// A record is appended to the index file (e.g. "timeAndNumber.h2d") only after all of its files
+    /// are on the disk, so an interrupted calculation always resumes from a complete record.
     template<typename Scalar>
     class HERMES_API CalculationContinuity
     {
@@ -74,7 +84,11 @@ namespace Hermes
         onlyNumber
       };
 
-      CalculationContinuity(IdentificationMethod identification_method);
+      /// \param[in] asynchronous Write the records in a background thread.
+      CalculationContinuity(IdentificationMethod identification_method, bool asynchronous = true);
+
+      /// Waits for the records that are being written.
+      ~CalculationContinuity();
 
       /// One record of the calculation. Stores every information to resume a calculation from this one point.
       class HERMES_API Record
@@ -141,6 +155,23 @@ namespace Hermes
         unsigned int get_number();
 
       private:
+        /// Name of a file of this record.
+        /// \param[in] index Index of the entity, -1 for the files that are not indexed (time steps, error, manifest).
+        std::string get_file_name(const std::string& prefix, int index) const;
+
+        /// Returns the content of the manifest, the list of files of the meshes, spaces and solutions.
+        std::string get_manifest() const;
+        /// Saves the manifest of this record.
+        void save_manifest();
+        /// Loads the manifest of this record, if there is none, the record was saved in the XML formats by an older version.
+        void load_manifest();
+
+        /// Loads the space with the given index in the record.
+        Space<Scalar>* load_space_index(unsigned int index, Mesh* mesh, EssentialBCs<Scalar>* essential_bcs, Shapeset* shapeset);
+
+        /// The record is in the binary formats and has a manifest.
+        bool binary;
+
         /// Storage of filenames of needed mesh files.
         Hermes::vector<std::string> meshFiles;
         /// Storage of filenames of needed space files.
@@ -151,6 +182,8 @@ namespace Hermes
         /// Internals. Used for identifying.
         double time;
         unsigned int number;
+
+        friend class CalculationContinuity<Scalar>;
       };
 
       /// Add a record.
@@ -178,12 +211,17 @@ namespace Hermes
       /// Returns the count of records.
       int get_num() const;
 
+      /// Waits until all the records added so far are written.
+      /// Throws if the background writing of any of them failed.
+      void flush();
+
       /// Setting of the names for the file stored.
       static void set_mesh_file_name(std::string mesh_file_nameToSet);
       static void set_space_file_name(std::string space_file_nameToSet);
       static void set_solution_file_name(std::string solution_file_nameToSet);
       static void set_time_step_file_name(std::string time_step_file_nameToSet);
       static void set_error_file_name(std::string error_file_nameToSet);
+      static void set_record_file_name(std::string record_file_nameToSet);
 
     private:
       /// Names for the file stored.
@@ -193,6 +231,7 @@ namespace Hermes
       static std::string time_step_file_name;
       static std::string time_stepNMinusOne_file_name;
       static std::string error_file_name;
+      static std::string record_file_name;
 
       /// For time dependent adaptive problems.
       std::map<std::pair<double, unsigned int>, Record*> records;
@@ -215,6 +254,75 @@ namespace Hermes
       /// Count of records.
       int num;
 
+      /// A file waiting for the background writer.
+      struct PendingFile
+      {
+        std::string filename;
+        std::vector<char> data;
+        CalculationContinuityException::exceptionEntityType type;
+      };
+
+      /// A record waiting for the background writer, the line is appended to the index file after all the files are written.
+      struct PendingRecord
+      {
+        std::list<PendingFile> files;
+        std::string index_file;
+        std::string index_line;
+
+        /// Adds an empty file to be filled in.
+        std::vector<char>& add_file(const std::string& filename, CalculationContinuityException::exceptionEntityType type);
+        /// Adds a text file.
+        void add_file(const std::string& filename, CalculationContinuityException::exceptionEntityType type, const std::string& text);
+      };
+
+      /// A mesh or a space written by some of the previous records.
+      struct WrittenEntity
+      {
+        WrittenEntity();
+        const void* entity;
+        int seq;
+        int mesh_seq;
+        std::string filename;
+      };
+
+      /// Common part of all add_record() methods.
+      /// Takes the snapshot of the entities on the calling thread and hands it over to the writer.
+      /// If it throws, written_meshes and written_spaces are left unchanged.
+      void save_record(Record* record, const char* index_file, const std::string& index_line, Hermes::vector<Mesh*> meshes, Hermes::vector<Space<Scalar>*> spaces, Hermes::vector<Solution<Scalar>*> slns, double time_step, double time_step_n_minus_one, double error);
+
+      /// Writes all the files of a pending record and its index line, returns false on error (see writer_error).
+      bool write_record(PendingRecord* pending);
+
+      /// The body of the background writer.
+      static void* writer_thread_function(void* data);
+
+      /// Throws the error of the background writer, if there was one.
+      /// \param[in] reset Forget the error, so that the following records are written.
+      void check_writer_error(bool reset = false);
+
+      /// Write the records in a background thread.
+      bool asynchronous;
+      /// The background writer, started with the first record.
+      pthread_t writer_thread;
+      bool writer_started;
+      /// Protects pending_records, writer_busy, writer_stop and the error of the writer.
+      pthread_mutex_t writer_mutex;
+      /// Signals both a new pending record and a written one.
+      pthread_cond_t writer_cond;
+      std::deque<PendingRecord*> pending_records;
+      /// The writer is writing a record taken from pending_records.
+      bool writer_busy;
+      /// The writer should finish.
+      bool writer_stop;
+      /// Error of the writer, no more records are written after it.
+      std::string writer_error;
+      std::string writer_error_file;
+      CalculationContinuityException::exceptionEntityType writer_error_type;
+
+      /// Meshes and spaces written by the previous records, by their index in the record.
+      std::vector<WrittenEntity> written_meshes;
+      std::vector<WrittenEntity> written_spaces;
+
       friend class Record;
     };
   }
@@ -17,6 +17,7 @@
 #define __H2D_DISCRETE_PROBLEM_H
 
 #include "hermes_common.h"
+#include <typeinfo>
 #include "adapt/adapt.h"
 #include "graph.h"
 #include "forms.h"
@@ -89,6 +90,24 @@ namespace Hermes
       /// If the cache should not be used for any reason.
       inline void set_do_not_use_cache() { this->do_not_use_cache = true; }
 
+      /// Phases of assemble() timed by the assembly profiling, see set_assembly_profiling().
+      enum AssemblyPhase
+      {
+        AssemblyTraversal, ///< Getting the next state of the traversal and the assembly lists of its elements.
+        AssemblyOrder, ///< Integration order of the forms (calc_order_matrix_form(), calc_order_vector_form()).
+        AssemblyBasis, ///< Shape functions, geometry and external functions in the integration points, cache records.
+        AssemblyForms, ///< Evaluation of the forms into the local matrices and vectors.
+        AssemblyInsertion, ///< Adding the local matrices and vectors to the global ones.
+        AssemblyPhaseCount
+      };
+
+      /// Turns the timing of the phases of assemble() on / off. Off by default, when on, every change of the
+      /// phase costs a reading of the clock, so the total assembly time grows a little.
+      void set_assembly_profiling(bool to_set = true);
+
+      /// Time (in seconds) spent in a phase by the last assemble() with the profiling on, summed over the threads.
+      double get_assembly_time(AssemblyPhase phase) const;
+
       /// Get the weak forms.
       const WeakForm<Scalar>* get_weak_formulation() const;
 
@@ -170,6 +189,21 @@ namespace Hermes
       void create_sparse_structure();
       void create_sparse_structure(SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs = NULL);
 
+      /// Patches the stored sparse structure after an incremental DOF reassignment of the spaces
+      /// (see Space::set_incremental_dof_assignment()) and allocates the matrix with it.
+      /// Only the entries of the elements that changed are recalculated, the rest of the structure
+      /// is renumbered by the old-to-new DOF maps of the spaces. Entries that do not exist anymore
+      /// between two unchanged DOFs are kept (as zeros).
+      /// \return false if the structure cannot be patched and has to be created from scratch.
+      bool patch_sparse_structure();
+
+      /// Stores the sparse structure gathered in current_mat, if any of the spaces uses the
+      /// incremental DOF assignment, and allocates current_mat.
+      void store_sparse_structure();
+
+      /// Frees the stored sparse structure.
+      void free_sparse_structure();
+
       /// Set the special handling of external functions of Runge-Kutta methods, including information how many spaces were there in the original problem.
       inline void set_RK(int original_spaces_count) { this->RungeKutta = true; RK_original_spaces_count = original_spaces_count; }
 
@@ -185,6 +219,16 @@ namespace Hermes
       void assemble_one_state(PrecalcShapeset** current_pss, PrecalcShapeset** current_spss, RefMap** current_refmaps, Solution<Scalar>** current_u_ext, 
         AsmList<Scalar>** current_als, Traverse::State* current_state, WeakForm<Scalar>* current_wf);
 
+      /// Switches the quadrature of the shape functions, reference mappings and external functions (of the form, of the weak
+      /// formulation and of the previous Newton iteration) of the state.
+      void set_state_quad_2d(Quad2D* quad_2d, Form<Scalar>* form, PrecalcShapeset** current_pss, PrecalcShapeset** current_spss, RefMap** current_refmaps, Solution<Scalar>** current_u_ext,
+        Traverse::State* current_state, WeakForm<Scalar>* current_wf);
+
+      /// Assembles a volumetric form with its own quadrature (MatrixFormVol::set_quad_2d(), VectorFormVol::set_quad_2d()),
+      /// its shape functions and geometry are calculated here instead of taken from the cache records.
+      void assemble_form_own_quad(Form<Scalar>* form, PrecalcShapeset** current_pss, PrecalcShapeset** current_spss, RefMap** current_refmaps, Solution<Scalar>** current_u_ext,
+        AsmList<Scalar>** current_als, Traverse::State* current_state, WeakForm<Scalar>* current_wf);
+
       /// Adjusts order to refmaps.
       void adjust_order_to_refmaps(Form<Scalar> *form, int& order, Hermes::Ord* o, RefMap** current_refmaps);
 
@@ -227,6 +271,17 @@ namespace Hermes
       /// Seq numbers of Space instances in spaces.
       int* sp_seq;
 
+      /// The sparse structure of the last matrix (compressed columns, see SparseMatrix::extract_structure()),
+      /// stored only if any of the spaces uses the incremental DOF assignment.
+      int* structure_col_ptr;
+      int* structure_row_idx;
+      int structure_ndof;
+      /// Seq numbers, first DOFs and numbers of DOFs of the spaces the stored structure belongs to.
+      int* structure_sp_seq;
+      int* structure_first_dofs;
+      int* structure_sp_ndof;
+      bool structure_force_diagonal_blocks;
+
       /// Number of DOFs of all Space instances in spaces.
       int ndof;
 
@@ -300,32 +355,110 @@ namespace Hermes
       int cache_size;
       bool do_not_use_cache;
 
+      /// The quadrature (WeakForm::get_quad_2d()) the cached values have been calculated with,
+      /// all of them are recalculated by an assembling with another one.
+      Quad2D* cache_quad_2d;
+      bool cache_quad_2d_changed;
+
+      /// Assembly profiling of one thread, padded so that the threads do not share a cache line.
+      struct AssemblyProfile
+      {
+        Hermes::Mixins::TimeMeasurable timer;
+        int phase;
+        double times[AssemblyPhaseCount];
+        char padding[64];
+      };
+
+      /// Ends the current assembly phase of the calling thread and starts phase, if the profiling is on.
+      /// AssemblyPhaseCount stops the timing of the thread.
+      inline void switch_assembly_phase(int phase) { if(this->assembly_profiling) this->tick_assembly_phase(phase); }
+      void tick_assembly_phase(int phase);
+
+      /// Allocates the per-thread profiles and resets their times, if the profiling is on. Called from init_assembling().
+      void init_assembly_profiling();
+
+      bool assembly_profiling;
+      AssemblyProfile* assembly_profiles;
+      int assembly_profiles_count;
+
       /// Exception caught in a parallel region.
       Hermes::Exceptions::Exception* caughtException;
+
+      /// Memo of the integration orders of the forms.
+      /// What the form's ord() returns in calc_order_matrix_form() and calc_order_vector_form() depends only on the form and
+      /// the orders of the functions it is evaluated with (u_ext, ext, basis and test functions), so it is calculated once
+      /// for every such combination and reused for all elements and all assemblies.
+      /// Key: the index of the form in WeakForm::get_forms() followed by the orders, value: the order of the form
+      /// (without the increase due to the reference mapping), [thread].
+      std::map<std::vector<int>, int>* order_memo;
+      /// Keys being looked up in order_memo, kept to avoid reallocations, [thread].
+      std::vector<int>* order_memo_keys;
+      unsigned int order_memo_count;
+      /// The forms of the weak formulation order_memo has been filled for, and their types.
+      /// Besides the orders in the key, a memoized order depends on the form only (its ord()).
+      Hermes::vector<Form<Scalar>*> order_memo_forms;
+      std::vector<const std::type_info*> order_memo_form_types;
+
+      /// (Re)creates order_memo unless it is up to date (the number of threads and the forms of the weak formulation).
+      void init_order_memo();
+      /// Whether order_memo_forms, order_memo_form_types describe the forms of the weak formulation, form by form.
+      bool order_memo_forms_up_to_date() const;
+      void free_order_memo();
+
+      /// Fills order_memo_keys[thread] with the index of the form and the orders of its external functions
+      /// (those init_ext_orders() uses).
+      std::vector<int>& get_order_memo_key(Form<Scalar>* form, Solution<Scalar>** current_u_ext, Traverse::State* current_state);
     
       
       ///* DG *///
 
       /// Assemble DG forms.
-      void assemble_one_DG_state(PrecalcShapeset** current_pss, PrecalcShapeset** current_spss, RefMap** current_refmaps, AsmList<Scalar>** current_als,
-        Traverse::State* current_state, Hermes::vector<MatrixFormDG<Scalar>*> current_mfDG, Hermes::vector<VectorFormDG<Scalar>*> current_vfDG, Transformable** fn, WeakForm<Scalar>* current_wf);
+      /// \param[in] current_state_ordinal The ordinal number of current_state in the traversal, see DG_first_states.
+      void assemble_one_DG_state(PrecalcShapeset** current_pss, PrecalcShapeset** current_spss, RefMap** current_refmaps,
+        PrecalcShapeset** current_npss, PrecalcShapeset** current_nspss, RefMap** current_nrefmaps, AsmList<Scalar>** current_als,
+        Traverse::State* current_state, int current_state_ordinal, Hermes::vector<MatrixFormDG<Scalar>*>& current_mfDG, Hermes::vector<VectorFormDG<Scalar>*>& current_vfDG, Transformable** fn, WeakForm<Scalar>* current_wf);
+
+      /// Neighbor precalculated shapesets, slave precalculated shapesets and reference maps for DG forms, [thread][space].
+      /// Created in init_assembling() and kept for the whole assembling, so that the precalculated tables are reused between states.
+      PrecalcShapeset*** DG_npss;
+      PrecalcShapeset*** DG_nspss;
+      RefMap*** DG_nrefmaps;
+
+      /// Ownership of the DG edges. For every space and every element of its mesh, the ordinal number of the first
+      /// state of the traversal that contains the element (DG_first_states[space][element id]).
+      /// A segment of an edge is owned by the first state containing the element on either side of it: the matrix DG forms
+      /// of the segment are assembled in a state unless all its neighbors (over all space meshes) already appeared in this or
+      /// an earlier state, in which case the segment was assembled from the neighbors' side.
+      /// So exactly one state assembles every segment, whichever thread processes it and in whatever order - no Element::visited
+      /// flags and no critical section are needed.
+      /// Only the space meshes are recorded: the neighbor searches (init_neighbors()) are built for the space meshes only, so the
+      /// neighbors tested are always elements of a space mesh, the same as with the former Element::visited flags.
+      int** DG_first_states;
+      unsigned int DG_first_states_count;
+
+      /// Seqs of the traversed meshes DG_first_states were calculated for.
+      Hermes::vector<unsigned int> DG_first_states_seqs;
+
+      /// Calculates DG_first_states by a traversal of meshes (the spaces' meshes first), unless they are up to date.
+      void init_DG_first_states(Hermes::vector<const Mesh*>& meshes);
+      void free_DG_first_states();
 
       /// Assemble one DG neighbor.
       void assemble_DG_one_neighbor(bool edge_processed, unsigned int neighbor_i,
         PrecalcShapeset** current_pss, PrecalcShapeset** current_spss, RefMap** current_refmaps, AsmList<Scalar>** current_als,
-        Traverse::State* current_state, Hermes::vector<MatrixFormDG<Scalar>*> current_mfDG, Hermes::vector<VectorFormDG<Scalar>*> current_vfDG, Transformable** fn,
-        std::map<unsigned int, PrecalcShapeset *> npss, std::map<unsigned int, PrecalcShapeset *> nspss, std::map<unsigned int, RefMap *> nrefmap,
+        Traverse::State* current_state, Hermes::vector<MatrixFormDG<Scalar>*>& current_mfDG, Hermes::vector<VectorFormDG<Scalar>*>& current_vfDG, Transformable** fn,
+        PrecalcShapeset** npss, PrecalcShapeset** nspss, RefMap** nrefmap,
         LightArray<NeighborSearch<Scalar>*>& neighbor_searches, unsigned int min_dg_mesh_seq, WeakForm<Scalar>* current_wf);
 
       /// Assemble DG matrix forms.
       void assemble_DG_matrix_forms(PrecalcShapeset** current_pss, PrecalcShapeset** current_spss, RefMap** current_refmaps, AsmList<Scalar>** current_als,
-        Traverse::State* current_state, MatrixFormDG<Scalar>** current_mfDG, std::map<unsigned int, PrecalcShapeset*> npss,
-        std::map<unsigned int, PrecalcShapeset*> nspss, std::map<unsigned int, RefMap*> nrefmap, LightArray<NeighborSearch<Scalar>*>& neighbor_searches);
+        Traverse::State* current_state, MatrixFormDG<Scalar>** current_mfDG, PrecalcShapeset** npss,
+        PrecalcShapeset** nspss, RefMap** nrefmap, LightArray<NeighborSearch<Scalar>*>& neighbor_searches);
 
       /// Assemble DG vector forms.
       void assemble_DG_vector_forms(PrecalcShapeset** current_spss, RefMap** current_refmaps, AsmList<Scalar>** current_als,
-        Traverse::State* current_state, VectorFormDG<Scalar>** current_vfDG, std::map<unsigned int, PrecalcShapeset*> nspss,
-        std::map<unsigned int, RefMap*> nrefmap, LightArray<NeighborSearch<Scalar>*>& neighbor_searches);
+        Traverse::State* current_state, VectorFormDG<Scalar>** current_vfDG, PrecalcShapeset** nspss,
+        RefMap** nrefmap, LightArray<NeighborSearch<Scalar>*>& neighbor_searches);
 
       DiscontinuousFunc<Hermes::Ord>* init_ext_fn_ord(NeighborSearch<Scalar>* ns, MeshFunction<Scalar>* fu);
 
@@ -101,6 +101,21 @@ namespace Hermes
       /// restores the solution in the memory.
       void load(const char* filename, Space<Scalar>* space);
 
+      /// Saves the solution to a compact binary file (see Hermes::BinaryFile), the coefficient arrays
+      /// are written as they are, so this is suitable for frequent checkpointing of large solutions.
+      /// The mesh and the space are not included, see MeshReaderH2DBinary and Space::save_binary().
+      void save_binary(const char* filename) const;
+
+      /// Saves the solution to the end of a memory image (see BinaryFileWriter) instead of a file.
+      /// This is a plain copy of the coefficient arrays, the image can be written later from another thread.
+      void save_binary(std::vector<char>& image) const;
+
+      /// Loads the solution from a file previously created by Solution::save_binary().
+      void load_binary(const char* filename, Space<Scalar>* space);
+
+      /// Version of the layout written by save_binary().
+      static const unsigned int binary_format_version = 1;
+
       /// Returns solution value or derivatives at element e, in its reference domain point (xi1, xi2).
       /// 'item' controls the returned value: 0 = value, 1 = dx, 2 = dy, 3 = dxx, 4 = dyy, 5 = dxy.
       /// NOTE: This function should be used for postprocessing only, it is not effective
@@ -171,12 +186,37 @@ namespace Hermes
       /// Internal.
       virtual void set_active_element(Element* e);
 
+      /// Switches the quadrature; the values of an active element are from then on those of its entry in the
+      /// element cache of the new quadrature, so that the quadrature can be switched in the middle of an element.
+      virtual void set_quad_2d(Quad2D* quad_2d);
+
       virtual MeshFunction<Scalar>* clone() const;
 
       static void set_static_verbose_output(bool verbose);
 
       void set_type(SolutionType type) { sln_type = type; };
 
+      /// Sets the limits of the cache of precalculated values.
+      /// The values of the solution (at all sub-elements, integration orders and for all requested
+      /// derivatives) are cached for the recently used elements, the least recently used element is
+      /// dropped when any of the limits is reached. The defaults are given by the Hermes2DApi parameters
+      /// solutionElementCacheSize and solutionElementCacheMemory; clones (e.g. the per-thread copies
+      /// used in assembling) inherit the limits, but each of them has its own cache, so that looking up
+      /// and calculating the values never needs locking. Setting the limits empties the cache.
+      /// \param[in] max_elements Maximum number of cached elements (for each quadrature), at least 1.
+      /// \param[in] max_memory Maximum memory (in kB) used by the precalculated values, the current element
+      /// is kept even if it alone exceeds the limit.
+      void set_element_cache_limits(int max_elements, int max_memory);
+
+      /// Returns the number of set_active_element() calls that found the element in the cache.
+      unsigned long get_element_cache_hits() const;
+
+      /// Returns the number of set_active_element() calls that had to start a new cache entry.
+      unsigned long get_element_cache_misses() const;
+
+      /// Resets the counters of hits and misses of the cache.
+      void reset_element_cache_statistics();
+
     protected:
       static bool static_verbose_output;
 
@@ -199,23 +239,91 @@ namespace Hermes
 
       virtual void set_coeff_vector(const Space<Scalar>* space, const Scalar* coeffs, bool add_dir_lift, int start_index);
 
+      /// Throws if the solution can not be saved by save_binary().
+      void check_binary_save() const;
+
+      /// Writes the arrays of save_binary().
+      void write_binary(BinaryFileWriter& writer) const;
+
       SolutionType sln_type;
       SpaceType space_type;
 
       bool transform;
 
-      /// Precalculated tables for last four used elements.
+      /// One cached element with its precalculated tables.
       /// There is a 2-layer structure of the precalculated tables.
       /// The first (the lowest) one is the layer where mapping of integral orders to
       /// Function::Node takes place. See function.h for details.
       /// The second one is the layer with mapping of sub-element transformation to
       /// a table from the lowest layer.
       /// The highest layer (in contrast to the PrecalcShapeset class) is represented
-      /// here only by this array.
-      std::map<uint64_t, LightArray<struct Function<Scalar>::Node*>*>* tables[H2D_MAX_QUADRATURES][H2D_SOLUTION_ELEMENT_CACHE_SIZE];
-
-      Element* elems[H2D_MAX_QUADRATURES][H2D_SOLUTION_ELEMENT_CACHE_SIZE];
-      int cur_elem, oldest[H2D_SOLUTION_ELEMENT_CACHE_SIZE];
+      /// here by the element cache.
+      struct ElementCacheEntry
+      {
+        Element* e; ///< NULL for an unused entry
+        std::map<uint64_t, LightArray<struct Function<Scalar>::Node*>*>* tables;
+        int pins; ///< 1 while the element is active, such an entry is never evicted
+        int prev, next; ///< neighbours in the LRU list, -1 at its ends
+      };
+
+      /// LRU cache of precalculated tables for the recently used elements (with one quadrature).
+      struct ElementCache
+      {
+        Quad2D* quad; ///< quadrature of the tables, NULL if the cache has not been used yet
+        Hermes::vector<ElementCacheEntry> entries;
+        Hermes::vector<int> unused; ///< indices of unused entries
+        std::map<Element*, int> index; ///< entry of each cached element
+        int first, last; ///< the most and the least recently used entry, -1 if none
+      };
+
+      /// The element caches of all quadratures of this solution (clones have their own).
+      struct ElementCaches
+      {
+        ElementCache caches[H2D_MAX_QUADRATURES];
+        int max_elements; ///< maximum number of elements in each of caches
+        int max_memory; ///< maximum memory (in bytes) of the precalculated tables
+        int memory; ///< memory (in bytes) of the precalculated tables
+        unsigned long hits, misses;
+
+        ElementCaches(int max_elements, int max_memory) : max_elements(max_elements), max_memory(max_memory),
+          memory(0), hits(0), misses(0)
+        {
+          for(int i = 0; i < H2D_MAX_QUADRATURES; i++)
+          {
+            caches[i].quad = NULL;
+            caches[i].first = caches[i].last = -1;
+          }
+        }
+      };
+
+      ElementCaches* element_cache;
+
+      /// The cache and the entry of the active element (pinned there), NULL and -1 if none.
+      ElementCache* active_cache;
+      int active_entry;
+
+      /// Frees the element cache and starts an empty one with the same limits.
+      void reset_element_cache();
+
+      /// Unpins the entry of the active element.
+      void element_cache_unpin();
+
+      /// Looks the element up in the cache of the current quadrature, starts a new entry if it is not there,
+      /// and pins the entry. Returns false if there is no cache left for the current quadrature.
+      bool element_cache_activate(Element* e);
+
+      /// Makes the entry the most recently used one (the entry must not be in the LRU list).
+      void element_cache_push_front(ElementCache& cache, int i);
+
+      /// Removes the entry from the LRU list.
+      void element_cache_unlink(ElementCache& cache, int i);
+
+      /// Frees the tables of the least recently used entry of the cache that is not pinned.
+      /// Returns false if there is no such entry.
+      bool element_cache_evict(ElementCache& cache);
+
+      /// Frees the tables of a cache entry, including its nodes.
+      void free_entry_tables(ElementCacheEntry& entry);
 
       Scalar* mono_coeffs;  ///< monomial coefficient array
       int* elem_coeffs[H2D_MAX_SOLUTION_COMPONENTS];  ///< array of pointers into mono_coeffs
@@ -228,6 +336,10 @@ namespace Hermes
 
       virtual void precalculate(int order, int mask);
 
+      /// Calculates a new node with the tables of the mask at the points of the order, the tables
+      /// of the current node are copied.
+      struct Function<Scalar>::Node* calculate_node(int order, int mask);
+
       Scalar* dxdy_coeffs[H2D_MAX_SOLUTION_COMPONENTS][6];
 
       Scalar* dxdy_buffer;
@@ -33,7 +33,8 @@
 
 /// Internal.
 #define H2D_NUM_MODES 2 ///< A number of modes, see enum ElementMode2D.
-#define H2D_SOLUTION_ELEMENT_CACHE_SIZE 2 ///< A maximum number of vertices of an element.
+#define H2D_SOLUTION_ELEMENT_CACHE_SIZE 64 ///< Default number of elements in the cache of precalculated values of a Solution.
+#define H2D_SOLUTION_ELEMENT_CACHE_MEMORY 16384 ///< Default memory limit (kB) of the cache of precalculated values of a Solution.
 #define H2D_MAX_NODE_ID 10000000
 #define H2D_MAX_SOLUTION_COMPONENTS 2
 
@@ -164,6 +164,7 @@ namespace Hermes
       friend class MeshReader;
       friend class MeshReaderH2D;
       friend class MeshReaderH2DXML;
+      friend class MeshReaderH2DBinary;
       friend CurvMap* create_son_curv_map(Element* e, int son);
     };
   }
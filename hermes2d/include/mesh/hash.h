@@ -38,6 +38,12 @@ namespace Hermes
     /// HashTable is a base class for Mesh. It serves as a container for all nodes
     /// of a mesh. Moreover, it has node searching functions based on hash tables.
     ///
+    /// Vertex and edge nodes are found by the id numbers of their parents (p1, p2).
+    /// Both tables use open addressing with linear probing; a slot stores the key
+    /// together with the node id, so that a lookup does not touch the node itself
+    /// until the key matches. The tables grow (double) whenever their load factor
+    /// exceeds H2D_HASH_MAX_LOAD, so lookups stay short on meshes of any size.
+    ///
     class HERMES_API HashTable : public Hermes::Mixins::Loggable
     {
     public:
@@ -47,8 +53,8 @@ namespace Hermes
       /// Returns the maximum node id number plus one.
       int get_max_node_id() const;
 
-      static const int H2D_DEFAULT_HASH_SIZE = 0x8000; // 32K entries
-
+      /// Initial capacity of each table, the tables grow as needed.
+      static const int H2D_DEFAULT_HASH_SIZE = 0x400; // 1K entries
 
     protected:
       HashTable();
@@ -76,15 +82,26 @@ namespace Hermes
       Array<Node> nodes; ///< Array storing all nodes
 
       /// Initializes the hash table.
-      /// \param size[in] Hash table size; must be a power of two.
+      /// \param size[in] Initial capacity of each table; must be a power of two.
       void init(int size = H2D_DEFAULT_HASH_SIZE);
 
-      /// Copies another hash table contents
+      /// Makes sure that the given numbers of vertex and edge nodes can be stored
+      /// without any rehashing. Used by the mesh readers before creating elements.
+      void reserve(int num_vertex_nodes, int num_edge_nodes);
+
+      /// Copies another hash table contents.
+      /// The slot arrays are copied as a whole, no node is rehashed.
       void copy(const HashTable* ht);
 
       /// Reconstructs the hashtable, after, e.g., the nodes have been loaded from a file.
+      /// This is the bulk-build path: the tables are sized once for all nodes present
+      /// and the nodes are inserted without searching for duplicates.
       void rebuild();
 
+      /// Inserts the nodes with ids first_id, ..., first_id + count - 1 into the tables.
+      /// The nodes must be fully initialized and must not be present in the tables yet.
+      void insert_nodes(int first_id, int count);
+
       /// Frees all memory used by the instance.
       void free();
 
@@ -96,20 +113,55 @@ namespace Hermes
 
       // Internal members
     private:
-
-      Node** v_table; ///< Vertex node hash table
-      Node** e_table; ///< Edge node hash table
-
-      int mask;
-
-      inline int hash(int p1, int p2) const { return (984120265*p1 + 125965121*p2) & mask; }
-
-      /// Searches a list of hash synonyms given the first list item.
-      /// Returns the node matching the parent ids p1 and p2.
-      Node* search_list(Node* node, int p1, int p2) const;
-
-      /// Creates a copy of a hash synonym list.
-      void copy_list(Node** ptr, Node* node);
+      /// One slot of the open-addressing tables.
+      /// Empty slots have id == -1.
+      struct Slot
+      {
+        int p1, p2;
+        int id;
+      };
+
+      /// One open-addressing table (there is one for vertex and one for edge nodes).
+      struct Table
+      {
+        Slot* slots;
+        int mask;
+        int count;
+      };
+
+      Table v_table; ///< Vertex node hash table
+      Table e_table; ///< Edge node hash table
+
+      /// Maximum load factor of a table (in percent) before it is grown.
+      static const int H2D_HASH_MAX_LOAD = 50;
+
+      /// 64-bit mix (the finalizer of MurmurHash3) of the parent id pair.
+      inline static unsigned int hash(int p1, int p2, int mask)
+      {
+        uint64_t key = ((uint64_t)(unsigned int)p1 << 32) | (uint64_t)(unsigned int)p2;
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return (unsigned int)key & (unsigned int)mask;
+      }
+
+      /// (Re)allocates the table with the given capacity (power of two) and reinserts its contents.
+      void resize_table(Table& table, int size);
+
+      /// Grows the table if one more item would exceed the maximum load factor.
+      void check_table_load(Table& table);
+
+      /// Returns the slot matching the parent ids p1 and p2, or the empty
+      /// slot where such an item would be inserted.
+      Slot* search_table(const Table& table, int p1, int p2) const;
+
+      /// Inserts an item known not to be present in the table.
+      void insert_table(Table& table, int p1, int p2, int id);
+
+      /// Removes the item with the given node id from the table.
+      void remove_table(Table& table, int p1, int p2, int id);
 
       friend struct Node;
       friend class MeshReaderH2D;
@@ -36,6 +36,7 @@ namespace Hermes
 
     template<typename Scalar> class Space;
     template<typename Scalar> class KellyTypeAdapt;
+    template<typename Scalar> class NeighborSearch;
     struct MItem;
     struct Rect;
     extern unsigned g_mesh_seq;
@@ -87,7 +88,6 @@ namespace Hermes
       };
 
       int p1, p2; ///< parent id numbers
-      Node* next_hash; ///< next node in hash synonym list
 
       /// Returns true if the (vertex) node is constrained.
       bool is_constrained_vertex() const;
@@ -198,6 +198,7 @@ namespace Hermes
       friend class MeshReaderH2D;
       friend class MeshReaderH1DXML;
       friend class MeshReaderH2DXML;
+      friend class MeshReaderH2DBinary;
       friend class PrecalcShapeset;
       template<typename Scalar> friend class Space;
       template<typename Scalar> friend class Adapt;
@@ -233,6 +234,61 @@ namespace Hermes
       friend CurvMap* create_son_curv_map(Element* e, int son);
     };
 
+    /// \brief Face connectivity of a mesh.
+    /// For every inner edge of every active element, what NeighborSearch::set_active_edge() finds: the neighbor elements
+    /// (one per segment of the edge), the local numbers and orientations of their edges and the transformations of the
+    /// central element (or of the neighbor) to the common segments.
+    /// Calculated for one state of the mesh (Mesh::get_seq()) by Mesh::update_face_connectivity() and only read
+    /// afterwards, so that it can be shared by any number of threads.
+    class HERMES_API MeshFaceConnectivity
+    {
+    public:
+      MeshFaceConnectivity() : seq((unsigned)-1) {}
+
+      /// One neighbor of an edge.
+      struct Neighbor
+      {
+        Element* element;
+        int local_num_of_edge;
+        bool orientation;
+        /// Offsets to MeshFaceConnectivity::transformations and the numbers of levels of the transformations
+        /// of the central element (go-down neighborhood), resp. of the neighbor (go-up neighborhood).
+        unsigned int central_transformations, central_num_levels;
+        unsigned int neighbor_transformations, neighbor_num_levels;
+      };
+
+      /// One edge of an active element.
+      struct Edge
+      {
+        /// NeighborSearch::NeighborhoodType, H2D_DG_NOT_INITIALIZED (-1) if the edge has not been stored
+        /// (boundary edges and edges the search failed on).
+        int neighborhood_type;
+        /// The neighbors are neighbors[first_neighbor], ..., neighbors[first_neighbor + n_neighbors - 1].
+        unsigned int first_neighbor, n_neighbors;
+        /// The last neighbor found by the search and the local number of its edge (the state NeighborSearch is left in).
+        Element* neighb_el;
+        int local_num_of_edge;
+      };
+
+      /// The seq of the mesh this was calculated for.
+      unsigned seq;
+
+      /// Returns the edge, NULL if it has not been stored.
+      inline const Edge* get_edge(int element_id, int edge) const
+      {
+        const Edge* e = &edges[element_id * H2D_MAX_NUMBER_EDGES + edge];
+        return e->neighborhood_type == -1 ? NULL : e;
+      }
+
+    private:
+      /// [element id * H2D_MAX_NUMBER_EDGES + edge].
+      std::vector<Edge> edges;
+      std::vector<Neighbor> neighbors;
+      std::vector<unsigned int> transformations;
+
+      template<typename T> friend class NeighborSearch;
+    };
+
     /// \brief Represents a finite element mesh.
     /// Typical usage:
     /// Hermes::Hermes2D::Mesh mesh;
@@ -272,7 +328,10 @@ namespace Hermes
       /// Copies the active elements of a converted mesh.
       void copy_converted(Mesh* mesh);
 
-      /// Creates a mesh from given vertex, triangle, quad, and marker arrays
+      /// Creates a mesh from given vertex, triangle, quad, and marker arrays.
+      /// Triangles get the ids 0, ..., nt - 1, quads nt, ..., nt + nq - 1. This is the bulk path:
+      /// the edge nodes are built from the sorted list of element sides instead of hash table
+      /// probes and the nodes and elements are initialized in parallel (numThreads).
       void create(int nv, double2* verts, int nt, int3* tris, std::string* tri_markers,
                   int nq, int4* quads, std::string* quad_markers, int nm, int2* mark, std::string* boundary_markers);
 
@@ -312,6 +371,8 @@ namespace Hermes
       void refine_element_id(int id, int refinement = 0);
 
       /// Refines all elements.
+      /// Uniform refinements (refinement == 0) use the bulk (parallel) path,
+      /// see refine_all_elements_bulk().
       /// \param refinement[in] Same meaning as in refine_element_id().
       void refine_all_elements(int refinement = 0, bool mark_as_initial = false);
 
@@ -370,6 +431,14 @@ namespace Hermes
       /// For internal use.
       void set_seq(unsigned seq);
 
+      /// Returns the face connectivity (see MeshFaceConnectivity) if it has been calculated for the current
+      /// state of the mesh, NULL otherwise. NeighborSearch uses it when it is available.
+      const MeshFaceConnectivity* get_face_connectivity() const;
+
+      /// Calculates the face connectivity unless it is up to date.
+      /// Not thread-safe, to be called before the face connectivity is used by more threads.
+      void update_face_connectivity() const;
+
       /// Class for creating reference mesh.
       class HERMES_API ReferenceMeshCreator
       {
@@ -408,6 +477,13 @@ namespace Hermes
       /// Convert all active elements to a base mesh.
       void convert_to_base();
 
+      /// Bulk uniform refinement of all active elements (triangles to four triangles,
+      /// quads to four quads).
+      /// New nodes and son elements are counted first and allocated in one pass,
+      /// then they are filled in parallel. The node and element ids depend only on
+      /// the order of the active elements, never on the number of threads.
+      void refine_all_elements_bulk();
+
       void refine_element_to_quads_id(int id);
 
       void refine_triangle_to_quads(Mesh* mesh, Element* e, Element** elems_out = NULL);
@@ -430,6 +506,9 @@ namespace Hermes
       int nactive;
       unsigned seq;
 
+      /// See get_face_connectivity(), a cache that does not change the mesh itself.
+      mutable MeshFaceConnectivity* face_connectivity;
+
       int nbase, ntopvert;
       int ninitial;
 
@@ -546,6 +625,7 @@ namespace Hermes
 
       friend class MeshReaderH2D;
       friend class MeshReaderH2DXML;
+      friend class MeshReaderH2DBinary;
       friend class MeshReaderH1DXML;
       friend class MeshReaderExodusII;
       friend class DiscreteProblem<double>;
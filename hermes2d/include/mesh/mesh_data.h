@@ -37,16 +37,43 @@ namespace Hermes
     /// The variables are stored in a vector of strings. This is true for single-valued variables, lists and list of lists.
     /// The contents of the variables are thus accessed differently depending on their contents.
     ///.
+    /// The file is memory-mapped and parsed in a single pass, the tokens of a line point into one reused buffer
+    /// and the numbers are converted right from it (no streams or temporary strings per value).
+    ///.
     class MeshData
     {
       std::string mesh_file_; ///< Mesh Filename (private)
 
-      /// Removes brackets, commas and other unessential details from the input file.
-      /// Meaningful blank spaces are temporarily replaced with a ';'
-      void strip(std::string &str);
-
-      /// Restores ';' to blank spaces
-      std::string restore(std::string &str);
+      /// A token of the current line, points into line_.
+      struct Token
+      {
+        const char* begin;
+        const char* end;
+      };
+
+      std::string line_; ///< The current line without comments, brackets and unessential blank spaces.
+      std::vector<Token> tokens_; ///< Tokens of the current line.
+
+      /// Splits a line of the file into tokens_.
+      /// Removes brackets, commas and other unessential details, meaningful blank spaces are kept in the tokens.
+      void split_line(const char* begin, const char* end);
+
+      /// Tests if the token starts by a number (and is not a name of a variable).
+      /// \param[in] allow_point Allow a number starting by the decimal point.
+      static bool is_number(const char* begin, const char* end, bool allow_point);
+      /// The leading integer of the token, as atoi().
+      static int parse_int(const char* begin, const char* end);
+      /// The leading floating point number of the token, as atof().
+      static double parse_double(const char* begin, const char* end);
+      /// The token without quotes.
+      static std::string to_string(const char* begin, const char* end);
+
+      /// The first value of the variable named by the token, throws if there is none.
+      const std::string& variable_value(const char* begin, const char* end);
+      /// The value of the token, a number or a variable.
+      int token_to_int(const Token& token);
+      /// The value of the token, a number or a variable.
+      double token_to_double(const Token& token);
 
     public:
       std::map< std::string, std::vector< std::string > > vars_; ///< Map for storing variables in input mesh file
@@ -83,7 +110,8 @@ namespace Hermes
       std::vector<int> ref_elt; ///< List of elements to be refined
       std::vector<int> ref_type; ///< List of element refinement type
 
-      /// This function parses a given input mesh file line by line and extracts the necessary information into the MeshData class variables
+      /// This function parses a given input mesh file line by line and extracts the necessary information into the MeshData class variables.
+      /// Throws MeshLoadFailureException on an incomplete entity or an undefined variable.
       void parse_mesh(void);
 
       /// MeshData Constructor
@@ -0,0 +1,69 @@
+// This file is part of Hermes2D
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, see <http://www.gnu.prg/licenses/>.
+
+#ifndef _MESH_READER_H2D_BINARY_H_
+#define _MESH_READER_H2D_BINARY_H_
+
+#include "mesh_reader.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// Mesh reader of the compact binary format.
+    ///
+    /// @ingroup mesh_readers
+    /// Stores the same information as MeshReaderH2DXML (vertices, elements, boundary markers, curves
+    /// and the refinement history Mesh::refinements, so that element ids are reproduced by load()),
+    /// but as raw arrays in a versioned binary file (see Hermes::BinaryFile), which is memory-mapped
+    /// on loading - there is no parsing of individual values. Meant for checkpoints and large meshes,
+    /// the file is only portable between little-endian platforms.
+    /// Typical usage:
+    /// Hermes::Hermes2D::MeshReaderH2DBinary mloader;
+    /// mloader.save("mesh.h2db", &mesh);
+    /// ...
+    /// mloader.load("mesh.h2db", &mesh);
+    class HERMES_API MeshReaderH2DBinary : public MeshReader
+    {
+    public:
+      MeshReaderH2DBinary();
+      virtual ~MeshReaderH2DBinary();
+
+      /// This method loads a single mesh from a file.
+      virtual bool load(const char *filename, Mesh *mesh);
+
+      /// This method saves a single mesh to a file.
+      bool save(const char *filename, Mesh *mesh);
+
+      /// This method saves a single mesh to the end of a memory image (see BinaryFileWriter),
+      /// writing the image to a file gives the same file as save(const char*, Mesh*).
+      void save(std::vector<char>& image, Mesh *mesh);
+
+      /// Version of the layout written by save().
+      static const unsigned int format_version = 1;
+
+    protected:
+      /// Writes the mesh, common part of both versions of save().
+      void write(BinaryFileWriter& writer, Mesh *mesh);
+
+      /// Creates the Nurbs of a curve, the end points are taken from the vertices p1, p2.
+      Nurbs* create_nurbs(Mesh *mesh, int p1, int p2, int degree, int np, bool arc, double angle, const double* inner_points, const double* knots);
+
+      /// Reads the marker names and inserts them into the conversion, returns the internal markers in the order of the names.
+      std::vector<int> read_marker_names(BinaryFileReader& reader, Mesh::MarkersConversion& conversion);
+    };
+  }
+}
+#endif
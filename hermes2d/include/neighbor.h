@@ -408,6 +408,17 @@ namespace Hermes
       /// Cleaning of internal structures before a new edge is set as active.
       void reset_neighb_info();
 
+      /// The search of the neighbors across the active edge (set_active_edge() without the face connectivity of the mesh).
+      void find_neighbors();
+
+      /// Sets the neighbors across the active edge from the face connectivity of the mesh, the same state find_neighbors() leaves.
+      /// \return false if the active edge is not stored there (find_neighbors() is to be used).
+      bool load_neighbors(const MeshFaceConnectivity* face_connectivity);
+
+      /// Calculates the face connectivity of the mesh by searching the neighbors across all inner edges of all active elements,
+      /// see Mesh::update_face_connectivity().
+      static void calculate_face_connectivity(const Mesh* mesh, MeshFaceConnectivity* face_connectivity);
+
       /*** Quadrature on the active edge. ***/
       Quad2D* quad;
 
@@ -420,6 +431,7 @@ namespace Hermes
       template<typename T> friend class DiscontinuousFunc;
       template<typename T> friend class DiscreteProblem;
       template<typename T> friend class DiscreteProblemLinear;
+      friend class Mesh;
     };
   }
 }
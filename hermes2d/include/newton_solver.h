@@ -182,6 +182,18 @@ namespace Hermes
       /// \param[in] steps Number of steps.
       void set_necessary_successful_steps_to_increase(unsigned int steps);
 
+      /// Set the ratio of the current residual norm and the previous residual norm below which the jacobian kept by solve_keep_jacobian()
+      /// is still deemed good enough. If the residual norm does not decrease this much, the jacobian is recalculated (and factorized again).
+      /// Default: not used, the jacobian is kept until the spaces change.
+      /// \param[in] ratio The ratio, must be positive.
+      void set_sufficient_improvement_factor_jacobian(double ratio);
+
+      /// Set the maximum number of steps (counted across the calls of solve_keep_jacobian(), e.g. in time steps) in which
+      /// the kept jacobian is used, then it is recalculated.
+      /// Default: 0, i.e. unlimited.
+      /// \param[in] steps Number of steps.
+      void set_max_steps_with_reused_jacobian(unsigned int steps);
+
       /// Set the weak forms.
       void set_weak_formulation(const WeakForm<Scalar>* wf);
 
@@ -195,6 +207,10 @@ namespace Hermes
       /// Internal setting of default values (see individual set methods).
       void init_attributes();
 
+      /// Outputs the Jacobian of the iteration it (see MatrixRhsOutput). With DF_HERMES_CSC the file
+      /// holds the whole linear system of the iteration, the right-hand side (-residual) included.
+      void output_jacobian(SparseMatrix<Scalar>* jacobian, int it);
+
       /// Jacobian.
       SparseMatrix<Scalar>* jacobian;
 
@@ -226,6 +242,12 @@ namespace Hermes
       double sufficient_improvement_factor;
       /// necessary number of steps to increase back the damping coeff.
       unsigned int necessary_successful_steps_to_increase;
+
+      /// Recalculation of the kept jacobian, see set_sufficient_improvement_factor_jacobian(), set_max_steps_with_reused_jacobian().
+      double sufficient_improvement_factor_jacobian;
+      unsigned int max_steps_with_reused_jacobian;
+      /// Number of steps in which the kept jacobian has been used.
+      unsigned int kept_jacobian_age;
     };
   }
 }
@@ -19,6 +19,8 @@
 // This is a common header for all available 1D and 2D quadrature tables
 
 #include "quad.h"
+#include <string>
+#include <vector>
 
 namespace Hermes
 {
@@ -43,6 +45,70 @@ namespace Hermes
 
     extern HERMES_API Quad1DStd g_quad_1d_std;
     extern HERMES_API Quad2DStd g_quad_2d_std;
+
+    /// Base of the 2D quadratures whose tables are calculated at run time.
+    /// The orders and the layout of the tables (volume tables, then edge tables, see Quad2D::get_edge_points()) are those
+    /// of Quad2DStd, so that any of them can replace g_quad_2d_std; the tables of an element mode a quadrature
+    /// does not redefine are taken from g_quad_2d_std.
+    /// Quad2DLobatto and Quad2DCollapsed are chosen for the position of their points, neither has fewer points per order
+    /// than Quad2DStd: the triangle rules of Quad2DStd are the symmetric ones of Dunavant, and on quads the order is the degree in each
+    /// of the variables, for which the tensor Gauss rules are the smallest ones.
+    class HERMES_API Quad2DFamily : public Quad2D
+    {
+    public:
+      virtual ~Quad2DFamily();
+
+    protected:
+      Quad2DFamily();
+
+      /// Sets the volume table of the order.
+      void set_table(ElementMode2D mode, int order, double3* table, int np);
+
+      /// Sets the edge tables of the order: the 1D rule (points on (-1, 1), weights) mapped onto the edges of the reference element.
+      void set_edge_tables(ElementMode2D mode, int order, double2* rule_1d, int np_1d);
+
+      double3** mode_tables[H2D_NUM_MODES];
+      int* mode_np[H2D_NUM_MODES];
+
+      /// Tables calculated by this quadrature (those taken from g_quad_2d_std are not owned).
+      std::vector<double3*> own_tables;
+
+      virtual void dummy_fn() {}
+    };
+
+    /// 2D quadrature with Gauss-Lobatto rules on quads: tensor products of 1D Gauss-Lobatto rules, which include the end points,
+    /// so that the vertices and the edges of the element are among the points. A rule with n points per direction is exact
+    /// for polynomials of degree 2n - 3, i.e. it has one point more per direction than the Gauss rule of Quad2DStd of the same order.
+    /// The point of the family is the mass lumping (the mass matrix of a nodal basis with the nodes in the integration points
+    /// is diagonal), typically for the mass form only (see MatrixFormVol::set_quad_2d()).
+    /// The edge tables are the 1D Gauss-Lobatto rules as well, triangles use the tables of Quad2DStd.
+    class HERMES_API Quad2DLobatto : public Quad2DFamily
+    {
+    public:
+      Quad2DLobatto();
+
+      /// Points (on (-1, 1)) and weights of the 1D Gauss-Lobatto rule with np points, np >= 2.
+      static void calculate_rule_1d(int np, double2* rule);
+    };
+
+    /// 2D quadrature with collapsed-coordinate (Duffy) rules on triangles: tensor products of 1D Gauss rules on the square
+    /// mapped onto the triangle. All points are strictly inside the triangle for every order (Quad2DStd has points outside
+    /// for the highest one), at the cost of more points than the symmetric rules of Quad2DStd.
+    /// Quads and all edges use the tables of Quad2DStd.
+    class HERMES_API Quad2DCollapsed : public Quad2DFamily
+    {
+    public:
+      Quad2DCollapsed();
+    };
+
+    /// Registry of 2D quadratures, to choose the quadrature of a WeakForm (WeakForm::set_quad_2d()) or of a volumetric form
+    /// (MatrixFormVol::set_quad_2d(), VectorFormVol::set_quad_2d()) by name.
+    /// Registered by default: "std" (g_quad_2d_std), "lobatto" (Quad2DLobatto), "collapsed" (Quad2DCollapsed).
+    /// The registry does not take the ownership of the quadratures registered by register_quad_2d().
+    HERMES_API void register_quad_2d(const std::string& name, Quad2D* quad_2d);
+
+    /// Returns the quadrature registered under the name, throws an exception if there is none.
+    HERMES_API Quad2D* get_quad_2d(const std::string& name);
   }
 }
 #endif
\ No newline at end of file
@@ -74,6 +74,27 @@ namespace Hermes
         TrfShape* cached_shape_ortho_vals; ///< Precalculated valus of orthogonalized shape functions.
         TrfShape* cached_shape_vals; ///< Precalculate values of shape functions.
 
+        /// A projection matrix factorized by the function ludcmp().
+        struct FactorizedProjMatrix
+        {
+          double** lu; ///< LU decomposition of the matrix, allocated through the function new_matrix().
+          int* indx; ///< Row permutation of the decomposition.
+        };
+
+        /// A projection matrix cache type.
+        /** Defines a cache of factorized projection matrices for all possible permutations of orders. */
+        typedef FactorizedProjMatrix* ProjMatrixCache[H2DRS_MAX_ORDER + 2][H2DRS_MAX_ORDER + 2];
+
+        /// An array of factorized projection matrices.
+        /** The first index is the mode (see the enum ElementMode2D). The second and the third index
+        *  is the horizontal and the vertical order respectively. If record is NULL, the corresponding matrix has to be calculated.
+        *
+        *  The matrices do not depend on the element, they are calculated when candidates of their orders
+        *  first occur (in the method precalc_proj_matrices()) and then only read. Clones of the selector share the array
+        *  of the original selector, as the cached values of shape functions; precalc_proj_matrices() accesses it
+        *  in the critical section proj_matrix_cache. */
+        ProjMatrixCache* proj_matrix_cache;
+
       protected: //evaluated shape basis
         /// A transform shaped function expansions.
         /** The contents of the class can be accessed through an array index operator.
@@ -216,18 +237,6 @@ namespace Hermes
           T value; ///< A value stored in the item.
           int state; ///< A state of the image: ::H2DRS_VALCACHE_INVALID or ::H2DRS_VALCACHE_VALID or any other user-defined value. The first user defined state has to have number ::H2DRS_VALCACHE_USER.
         };
-        /// A projection matrix cache type.
-        /** Defines a cache of projection matrices for all possible permutations of orders. */
-        typedef double** ProjMatrixCache[H2DRS_MAX_ORDER + 2][H2DRS_MAX_ORDER + 2];
-
-        /// An array of projection matrices.
-        /** The first index is the mode (see the enum ElementMode2D). The second and the third index
-        *  is the horizontal and the vertical order respectively.
-        *
-        *  All matrices are square dense matrices and they have to be created through the function new_matrix().
-        *  If record is NULL, the corresponding matrix has to be calculated. */
-        ProjMatrixCache proj_matrix_cache[H2D_NUM_MODES];
-
         /// An array of cached right-hand side values.
         /** The first index is an index of the shape function.
         *
@@ -278,6 +287,23 @@ namespace Hermes
         *  \param[out] errors_squared Calculated squared errors for all orders specified through \a info. */
         void calc_error_cand_element(const ElementMode2D mode, double3* gip_points, int num_gip_points, const int num_sub, Element** sub_domains, Trf** sub_trfs, Scalar*** sub_rvals, Hermes::vector<TrfShapeExp>** sub_nonortho_svals, Hermes::vector<TrfShapeExp>** sub_ortho_svals, const typename OptimumSelector<Scalar>::CandsInfo& info, CandElemProjError errors_squared);
 
+        /// Calculates and factorizes the projection matrices of the orders of candidates which are not cached yet.
+        /** \param[in] mode A mode (enum ElementMode2D).
+        *  \param[in] gip_points Integration points in the reference domain.
+        *  \param[in] num_gip_points A number of integration points.
+        *  \param[in] infos Information about the candidates, the orders of their elements are those iterated by calc_error_cand_element().
+        *  \param[in] num_infos A number of items in the array infos. */
+        void precalc_proj_matrices(const ElementMode2D mode, double3* gip_points, int num_gip_points, const typename OptimumSelector<Scalar>::CandsInfo** infos, int num_infos);
+
+        /// Builds a list of shape indices of shape functions used by an element of a candidate of given orders.
+        /** \param[in] mode A mode (enum ElementMode2D).
+        *  \param[in] order_h A horizontal order.
+        *  \param[in] order_v A vertical order.
+        *  \param[out] shape_inxs The shape indices. The array has to have at least \a max_num_shapes items.
+        *  \param[in] max_num_shapes A maximum number of shape indices.
+        *  \return A number of shape indices. */
+        int build_shape_inxs(const ElementMode2D mode, int order_h, int order_v, int* shape_inxs, int max_num_shapes);
+
       protected: //projection
         /// Projection of an element of a candidate.
         struct ElemProj {
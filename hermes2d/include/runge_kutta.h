@@ -27,38 +27,30 @@ namespace Hermes
   {
     // TODO LIST:
     //
-    // (1) With explicit and diagonally implicit methods, the matrix is treated
-    //     in the same way as with fully implicit ones. To make this more
-    //     efficient, with explicit and diagonally implicit methods one should
-    //     first only solve for the upper left block, then eliminate all blocks
-    //     under it, then solve for block at position 22, eliminate all blocks
-    //     under it, etc. Currently this is not done and everything is left to
-    //     the matrix solver.
-    //
-    // (2) In example 03-timedep-adapt-space-and-time with implicit Euler
+    // (1) In example 03-timedep-adapt-space-and-time with implicit Euler
     //     method, Newton's method takes much longer than in 01-timedep-adapt-space-only
     //     (that also uses implicit Euler method). This means that the initial guess for
     //     the K_vector should be improved (currently it is zero).
     //
-    // (3) At the end of rk_time_step_newton(), the previous time level solution is
+    // (2) At the end of rk_time_step_newton(), the previous time level solution is
     //     projected onto the space of the new time-level solution so that
     //     it can be added to the stages. This projection is slow so we should
     //     find a way to do this differently. In any case, the projection
     //     is not necessary when no adaptivity in space takes place and the
     //     two spaces are the same (but it is done anyway).
     //
-    // (4) We do not take advantage of the fact that all blocks in the
+    // (3) We do not take advantage of the fact that all blocks in the
     //     Jacobian matrix have the same structure. Thus it is enough to
     //     assemble the matrix M (one block) and copy the sparsity structure
     //     into all remaining nonzero blocks (and diagonal blocks). Right
     //     now, the sparsity structure is created expensively in each block
     //     again.
     //
-    // (5) If space does not change, the sparsity does not change. Right now
+    // (4) If space does not change, the sparsity does not change. Right now
     //     we discard everything at the end of every time step, we should not
     //     do it.
     //
-    // (6) If the problem does not depend explicitly on time, then all the blocks
+    // (5) If the problem does not depend explicitly on time, then all the blocks
     //     in the Jacobian matrix of the stationary residual are the same up
     //     to a multiplicative constant. Thus they do not have to be aassembled
     //     from scratch.
@@ -89,6 +81,13 @@ namespace Hermes
       void set_residual_as_solutions();
       void set_block_diagonal_jacobian();
 
+      /// Explicit methods (ButcherTable::is_explicit()) will use the lumped mass matrix instead of the consistent one,
+      /// then the stages are obtained by a division and a time step costs only the evaluations of the stationary residual.
+      /// The diagonal is assembled directly as the integrals of the basis functions, i.e. the row sums of the mass matrix
+      /// for the lowest-order H1 and L2 spaces (the same as the mass matrix integrated by the Gauss-Lobatto quadrature
+      /// in the vertices). With the higher-order hierarchic shape functions the integrals may be negative or vanish (then an exception is thrown).
+      void set_lumped_mass();
+
       /// Destructor.
       ~RungeKutta();
 
@@ -111,7 +110,37 @@ namespace Hermes
       void rk_time_step_newton(Hermes::vector<Solution<Scalar>*> slns_time_prev, Hermes::vector<Solution<Scalar>*> slns_time_new);
       void rk_time_step_newton(Solution<Scalar>* sln_time_prev, Solution<Scalar>* sln_time_new);
 
+      /// Advances the solution from the current time (set_time()) to end_time by the embedded method (ButcherTable::is_embedded()),
+      /// starting with the current time step (set_time_step()) and choosing the next ones by a PI controller
+      /// from the error estimate given by the B2-row. Steps with the error estimate above the tolerance
+      /// (set_time_step_control()) or with a failed Newton's method are rejected and repeated with a shorter time step.
+      /// The previous time level solution is projected only once, the discrete problems, the mass matrix and (with set_freeze_jacobian())
+      /// the Jacobian factorization are reused from step to step.
+      /// After the call, the time is end_time and the time step is the one proposed for the next step.
+      void rk_integrate_adaptive(Hermes::vector<Solution<Scalar>*> slns_time_prev, Hermes::vector<Solution<Scalar>*> slns_time_new, double end_time);
+      void rk_integrate_adaptive(Solution<Scalar>* sln_time_prev, Solution<Scalar>* sln_time_new, double end_time);
+
+      /// Tolerances of rk_integrate_adaptive(), a step is accepted if the root mean square of the coefficients of the error estimate
+      /// is at most abs_tol + rel_tol times the root mean square of the coefficients of the new solution.
+      /// error_order is the order of the less accurate solution of the embedded pair (e.g. 2 for Bogacki-Shampine 2(3)).
+      void set_time_step_control(double rel_tol, double abs_tol, int error_order);
+
+      /// Statistics of the last rk_integrate_adaptive(), the numbers of the accepted and rejected time steps and the time spent in them (s).
+      int get_accepted_steps() const;
+      int get_rejected_steps() const;
+      double get_accepted_steps_time() const;
+      double get_rejected_steps_time() const;
+
       void set_freeze_jacobian();
+
+      /// With set_freeze_jacobian(), the factorized Jacobian is kept across the Newton's iterations, stages and time steps (while
+      /// the spaces and h a_ii stay the same). It is recalculated if the residual norm does not decrease below ratio times the previous one.
+      /// Default: not used.
+      void set_sufficient_improvement_factor_jacobian(double ratio);
+
+      /// With set_freeze_jacobian(), the maximum number of the Newton's steps (across stages and time steps) with the same Jacobian.
+      /// Default: 0, i.e. unlimited.
+      void set_max_steps_with_reused_jacobian(unsigned int steps);
       void set_newton_tol(double newton_tol);
       void set_newton_max_iter(int newton_max_iter);
       void set_newton_damping_coeff(double newton_damping_coeff);
@@ -157,6 +186,28 @@ namespace Hermes
       /// Updates the augmented weak formulation.
       void update_stage_wf(Hermes::vector<Solution<Scalar>*> slns_time_prev);
 
+      /// Calculates K_vector of one time step from the previous time level solution.
+      void calculate_stages(Hermes::vector<Solution<Scalar>*> slns_time_prev, Hermes::vector<Solution<Scalar>*> slns_time_new);
+
+      /// Calculates K_vector by the Newton's method on the stage system (all stages at once).
+      void calculate_stages_newton(Hermes::vector<Solution<Scalar>*> slns_time_new);
+
+      /// Calculates K_vector of an explicit or diagonally implicit method stage by stage,
+      /// M K_i = F(t + c_i h, Y + h \sum_{j < i} a_{ij} K_j + h a_{ii} K_i), with the Newton's method on the system
+      /// of size ndof (Jacobian M - h a_{ii} J) in the implicit stages. With set_freeze_jacobian(), the factorization
+      /// is reused by all stages (and time steps) with the same h a_{ii} (SDIRK methods).
+      void calculate_stages_serial(Hermes::vector<Solution<Scalar>*> slns_time_new);
+
+      /// Assembles (and factorizes in calculate_stages_serial()) the matrix M, or the lumped one, only when the spaces change.
+      void update_mass_matrix(bool lumped);
+
+      /// Whether the frozen Jacobian has to be recalculated in the Newton's iteration it.
+      bool jacobian_outdated(int it, double residual_norm, double last_residual_norm) const;
+
+      /// Output of the residual vector and of the Jacobian matrix of the Newton's iteration it.
+      void dump_rhs(int it);
+      void dump_matrix(int it);
+
       // Prepare u_ext_vec.
       void prepare_u_ext_vec();
 
@@ -194,6 +245,21 @@ namespace Hermes
       WeakForm<Scalar> stage_wf_left;
       DiscreteProblem<Scalar>* stage_dp_left;
 
+      /// Stationary residual F of one stage and its Jacobian (size ndof), used by the explicit and diagonally implicit methods.
+      WeakForm<Scalar> stage_wf_single;
+      DiscreteProblem<Scalar>* stage_dp_single;
+
+      /// Right-hand side of one explicit stage, and the solver with the matrix M.
+      Vector<Scalar>* vector_single;
+      LinearMatrixSolver<Scalar>* mass_solver;
+
+      /// Diagonal of the lumped mass matrix, if set_lumped_mass() was called.
+      bool lumped_mass;
+      Scalar* lumped_mass_vector;
+
+      /// Seq numbers of the spaces of the currently assembled (factorized, lumped) M.
+      Hermes::vector<int> mass_spaces_seqs;
+
       bool start_from_zero_K_vector;
       bool block_diagonal_jacobian;
       bool residual_as_vector;
@@ -207,7 +273,28 @@ namespace Hermes
       int newton_max_iter;
       double newton_damping_coeff;
       double newton_max_allowed_residual_norm;
-      
+
+      /// h a_{ii} of the currently factorized stage Jacobian M - h a_{ii} J in calculate_stages_serial()
+      /// (h in calculate_stages_newton()), zero if none.
+      double factorized_stage_coeff;
+
+      /// Recalculation of the frozen Jacobian, see set_sufficient_improvement_factor_jacobian(), set_max_steps_with_reused_jacobian().
+      double sufficient_improvement_factor_jacobian;
+      unsigned int max_steps_with_reused_jacobian;
+      /// Number of the Newton's steps with the currently factorized Jacobian.
+      unsigned int jacobian_age;
+
+      /// Parameters of rk_integrate_adaptive().
+      double time_step_rel_tol;
+      double time_step_abs_tol;
+      int time_step_error_order;
+
+      /// Statistics of rk_integrate_adaptive().
+      int accepted_steps;
+      int rejected_steps;
+      double accepted_steps_time;
+      double rejected_steps_time;
+
       Hermes::vector<Solution<Scalar>*> residuals_vector;
 
       /// Vector K_vector of length num_stages * ndof. will represent
@@ -186,6 +186,20 @@ namespace Hermes
       /// Loads a space from a file.
       static Space<Scalar>* load(const char *filename, Mesh* mesh, bool validate, EssentialBCs<Scalar>* essential_bcs = NULL, Shapeset* shapeset = NULL);
 
+      /// Saves this space into a compact binary file (see Hermes::BinaryFile), e.g. for checkpointing.
+      /// The file only contains the element data, the mesh has to be saved separately (MeshReaderH2DBinary).
+      bool save_binary(const char *filename) const;
+
+      /// Saves this space to the end of a memory image (see BinaryFileWriter) instead of a file,
+      /// e.g. to write it later from another thread.
+      bool save_binary(std::vector<char>& image) const;
+
+      /// Loads a space saved by save_binary(), the mesh has to be the one the space was saved with.
+      static Space<Scalar>* load_binary(const char *filename, Mesh* mesh, EssentialBCs<Scalar>* essential_bcs = NULL, Shapeset* shapeset = NULL);
+
+      /// Version of the layout written by save_binary().
+      static const unsigned int binary_format_version = 1;
+
       /// Obtains an assembly list for the given element.
       virtual void get_element_assembly_list(Element* e, AsmList<Scalar>* al, unsigned int first_dof = 0) const;
 
@@ -240,6 +254,24 @@ namespace Hermes
       /// \brief Assings the degrees of freedom to all Spaces in the Hermes::vector.
       static int assign_dofs(Hermes::vector<Space<Scalar>*> spaces);
 
+      /// \brief Turns the incremental reassignment of DOFs on or off (off by default).
+      /// \details With the incremental reassignment, assign_dofs() keeps the numbers of all basis
+      /// functions that did not change since the previous assignment (after a step of adaptivity,
+      /// typically most of them). The new basis functions get the numbers freed by the removed ones,
+      /// so the DOFs are no longer ordered as vertex, edge and bubble functions.
+      /// DiscreteProblem uses the old-to-new DOF map (see get_dof_map()) to patch the sparse
+      /// structure of the matrix instead of building it from scratch.
+      void set_incremental_dof_assignment(bool incremental = true);
+
+      /// \brief Returns the old-to-new DOF map of the last assign_dofs().
+      /// \details The map is indexed by (old DOF - first_dof) / stride and gives the new DOF the same
+      /// way; basis functions that do not exist anymore are mapped to -1.
+      /// \return NULL if the last assignment was not incremental (see set_incremental_dof_assignment()).
+      const int* get_dof_map() const;
+
+      /// \brief Returns the number of DOFs before the last assign_dofs(), i.e. the length of get_dof_map().
+      int get_dof_map_size() const;
+
       virtual Scalar* get_bc_projection(SurfPos* surf_pos, int order, EssentialBoundaryCondition<Scalar> *bc) = 0;
 
       static void update_essential_bc_values(Hermes::vector<Space<Scalar>*> spaces, double time);
@@ -350,6 +382,56 @@ namespace Hermes
       int nsize, ndata_allocated; ///< number of items in ndata, allocated space
       int esize;
 
+      /// DOFs of a node in the previous assignment (incremental DOF assignment).
+      /// The node is identified by its type and parents, since node ids are reused by the mesh.
+      struct NodeDofHistory
+      {
+        int type, p1, p2; ///< type == -1 for unused ids
+        int dof, n; ///< first DOF (relative to first_dof, in units of stride), -1 if none
+      };
+
+      /// Bubble DOFs of an element in the previous assignment (incremental DOF assignment).
+      struct ElementDofHistory
+      {
+        int vn[H2D_MAX_NUMBER_VERTICES]; ///< vertex node ids identifying the element
+        int nvert, order; ///< nvert == 0 for elements that were not active
+        int dof, n; ///< first DOF (relative to first_dof, in units of stride), -1 if none
+        unsigned int al_hash; ///< signature of the assembly list (the DOFs as above)
+        int al_cnt; ///< number of DOFs in the assembly list, -1 if no signature is stored
+        int al_start; ///< start of the sorted assembly list in element_al_dof_history
+      };
+
+      bool incremental_dof_assignment;
+      NodeDofHistory* node_dof_history;
+      ElementDofHistory* element_dof_history;
+      /// Sorted assembly lists of the elements in the previous assignment, see ElementDofHistory::al_start.
+      int* element_al_dof_history;
+      int node_dof_history_size, element_dof_history_size;
+      int dof_history_ndof, dof_history_stride;
+
+      /// Old-to-new DOF map of the last incremental assignment, see get_dof_map().
+      int* dof_map;
+      int dof_map_size;
+      /// Seq of the assignment the dof_map starts from.
+      int dof_map_seq;
+      /// Elements (by id) whose assembly lists differ from the previous assignment (after renumbering
+      /// the old DOFs by dof_map). Valid together with dof_map.
+      bool* changed_elements;
+      int changed_elements_size;
+
+      /// Renumbers the DOFs just assigned, so that the basis functions present in the previous
+      /// assignment keep their numbers where possible, and fills in dof_map.
+      void renumber_dofs_incremental();
+
+      /// Stores the DOFs of the current assignment for the next incremental assignment.
+      void store_dof_history();
+
+      /// Compares the assembly lists of all elements with the previous assignment (fills in changed_elements)
+      /// and stores their signatures for the next one. Needs the constraints to be up to date.
+      void find_changed_elements();
+
+      void free_dof_history();
+
       virtual int get_edge_order_internal(Node* en) const;
 
       /// \brief Updates internal node and element tables.
@@ -361,6 +443,12 @@ namespace Hermes
       /// enough to contain all node and element id's, and to reallocate them if not.
       virtual void resize_tables();
 
+      /// Creates a space of the given type with empty element data, common part of load() and load_binary().
+      static Space<Scalar>* create_for_loading(SpaceType type, const char *filename, Mesh* mesh, EssentialBCs<Scalar>* essential_bcs, Shapeset* shapeset);
+
+      /// Collects the arrays written by save_binary(), returns false for types that can not be saved.
+      bool get_binary_data(int header[2], std::vector<int>& element_data) const;
+
       void update_orders_recurrent(Element* e, int order);
 
       virtual void reset_dof_assignment(); ///< Resets assignment of DOF to an unassigned state.
@@ -26,6 +26,27 @@ namespace Hermes
   {
     namespace Views
     {
+      /// Receiver of the pieces of a linearization produced by Linearizer::process_solution_streamed().
+      /// Every piece is self-contained (the vertex indices of triangles refer to the vertices of the piece)
+      /// and its arrays are valid only during the call of write_piece().
+      class HERMES_API LinearizerOutput
+      {
+      public:
+        virtual ~LinearizerOutput() {}
+
+        /// Called before the first piece.
+        virtual void begin() {}
+
+        /// Called for every finished piece.
+        /// \param[in] verts Vertices: (x, y, value) triplets.
+        /// \param[in] tris Triangles: vertex index triplets.
+        /// \param[in] tri_markers Element markers of the triangles.
+        virtual void write_piece(const double3* verts, int vertex_count, const int3* tris, const int* tri_markers, int triangle_count) = 0;
+
+        /// Called after the last piece.
+        virtual void end() {}
+      };
+
       /// Linearizer is a utility class which converts a higher-order FEM solution defined on
       /// a curvilinear, irregular mesh to a linear FEM solution defined on a straight-edged,
       /// regular mesh. This is done by adaptive refinement of the higher-order mesh and its
@@ -47,11 +68,36 @@ namespace Hermes
         /// \param[in] eps - tolerance parameter controlling how fine the resulting linearized approximation of the solution is.
         void process_solution(MeshFunction<double>* sln, int item = H2D_FN_VAL_0, double eps = HERMES_EPS_NORMAL);
 
+        /// Streaming version of process_solution() for outputs that would not fit in the memory.
+        /// The active elements are linearized in chunks, every chunk is passed to the output as a separate piece
+        /// and freed, so the memory used is given by the chunk size rather than by the size of the whole output.
+        /// The vertices on the boundaries of the chunks are duplicated. The triangles on the edges between the chunks
+        /// are passed in the piece of the chunk processed later, regularized together with it (see conform_chunk_edges()),
+        /// so that the pieces have no cracks between them.
+        /// Afterwards the instance holds no data, only the range of the values (get_min_value(), get_max_value()).
+        /// \param[in] output Receiver of the pieces.
+        /// \param[in] chunk_size Number of active elements in one piece.
+        void process_solution_streamed(MeshFunction<double>* sln, LinearizerOutput* output, int item = H2D_FN_VAL_0,
+          double eps = HERMES_EPS_NORMAL, int chunk_size = 10000);
+
         /// Save a MeshFunction (Solution, Filter) in VTK format.
         void save_solution_vtk(MeshFunction<double>* sln, const char* filename, const char* quantity_name,
           bool mode_3D = true, int item = H2D_FN_VAL_0,
           double eps = HERMES_EPS_NORMAL);
 
+        /// Save a MeshFunction (Solution, Filter) in the binary VTK XML format (.vtu).
+        /// The triangle markers are stored as cell data.
+        /// \param[in] writer Output settings (encoding, precision, compression).
+        void save_solution_vtu(MeshFunction<double>* sln, const char* filename, const char* quantity_name,
+          bool mode_3D = true, int item = H2D_FN_VAL_0,
+          double eps = HERMES_EPS_NORMAL, const VtuWriter& writer = VtuWriter());
+
+        /// Save a MeshFunction (Solution, Filter) in the VTK XML format (.vtu) using process_solution_streamed(),
+        /// every chunk of elements is written as a piece of the file.
+        void save_solution_vtu_streamed(MeshFunction<double>* sln, const char* filename, const char* quantity_name,
+          bool mode_3D = true, int item = H2D_FN_VAL_0,
+          double eps = HERMES_EPS_NORMAL, const VtuWriter& writer = VtuWriter(), int chunk_size = 10000);
+
         /// Set the displacement, i.e. set two functions that will deform the domain for visualization, in the x-direction, and the y-direction.
         void set_displacement(MeshFunction<double>* xdisp, MeshFunction<double>* ydisp, double dmult = 1.0);
 
@@ -100,23 +146,171 @@ namespace Hermes
         /// What kind of information do we want to get out of the solution.
         int item, component, value_type;
 
-        int add_vertex();
-        int get_vertex(int p1, int p2, double x, double y, double value);
+        /// A vertex of the linearization of a single element.
+        /// The elements are linearized independently (in parallel), the vertices shared by more elements
+        /// are identified afterwards by their position on the element boundary, see merge_elements().
+        struct LocalVertex
+        {
+          double coords[3]; ///< x, y, value
+          /// Parents (local indices), -1 - (mesh vertex id) for both parents of the element vertices.
+          int p1, p2;
+          /// Next vertex in the same slot of the local hash table.
+          int next;
+          /// Position on the element boundary, independent of the element: the (sorted) mesh vertex ids of the edge
+          /// and a dyadic position on it, or (id, id, 0) for a mesh vertex; key[0] == -1 for interior vertices.
+          int key[3];
+          /// Index of the representative of the vertex in the list of boundary vertices of all elements.
+          int boundary_index;
+          /// Index in the resulting vertex array.
+          int global;
+        };
+
+        /// Linearized elements processed by one thread.
+        struct ThreadData
+        {
+          std::vector<LocalVertex> verts;
+          std::vector<int> tris; ///< triples of local vertex indices, relative to the element
+          std::vector<int> tri_markers;
+          std::vector<int> hash_table; ///< heads of the chains of the local hash table
+          /// The element being processed.
+          int first_vert;
+          int vertex_ids[H2D_MAX_NUMBER_VERTICES];
+          int nvert;
+        };
+
+        /// Linearization of one traversal state in the per-thread buffers.
+        struct ElementRecord
+        {
+          int thread;
+          int first_vert, num_verts;
+          int first_tri, num_tris;
+          int first_global; ///< index of the first vertex owned by the element in the resulting vertex array
+        };
+
+        /// Adds an element vertex to the linearization of the current element.
+        int add_corner_vertex(ThreadData& data, int id, double x, double y, double value);
+
+        /// Finds or adds a vertex of the current element with the given parents.
+        int get_vertex(ThreadData& data, int p1, int p2, double x, double y, double value);
 
-        void process_triangle(MeshFunction<double>** fns, int iv0, int iv1, int iv2, int level,
+        /// Adds a triangle to the linearization of the current element.
+        void add_local_triangle(ThreadData& data, int iv0, int iv1, int iv2, int marker);
+
+        /// The boundary key of the midpoint of two vertices of the current element.
+        void mid_key(ThreadData& data, const LocalVertex& v1, const LocalVertex& v2, int* key) const;
+
+        /// Identifies the vertices shared by the elements, numbers the vertices (in the traversal order, so that
+        /// the result does not depend on the number of threads) and fills verts, tris and the vertex hash table.
+        void merge_elements(ThreadData* thread_data, std::vector<ElementRecord>& records, int num_threads_used);
+
+        void process_triangle(MeshFunction<double>** fns, ThreadData& data, int iv0, int iv1, int iv2, int level,
           double* val, double* phx, double* phy, int* indices, bool curved);
 
-        void process_quad(MeshFunction<double>** fns, int iv0, int iv1, int iv2, int iv3, int level,
+        void process_quad(MeshFunction<double>** fns, ThreadData& data, int iv0, int iv1, int iv2, int iv3, int level,
           double* val, double* phx, double* phy, int* indices, bool curved);
 
         void find_min_max();
 
+        /// Decodes the item into component and value_type.
+        void set_item(int item_, double eps);
+
+        /// Per-thread copies of the solution and of the displacement functions, meshes receives their meshes.
+        MeshFunction<double>*** create_functions(MeshFunction<double>* sln, Hermes::vector<const Mesh*>& meshes, int num_threads_used);
+        void delete_functions(MeshFunction<double>*** fns, int num_threads_used);
+
+        /// Sets the element and the sub-element transformation of the state to the functions.
+        void set_state(MeshFunction<double>** fns, Traverse::State* state);
+
+        /// Appends copies of (at most max_states, all if max_states <= 0) next states of the traversal.
+        /// \return Whether the traversal may continue.
+        bool next_states(Traverse& trav, std::vector<Traverse::State*>& states, int max_states);
+
+        /// Updates max by the values in the element vertices and in the points of the first refinement level.
+        void estimate_max(MeshFunction<double>*** fns, std::vector<Traverse::State*>& states, int num_threads_used);
+
+        /// Linearizes the elements of the states in parallel into the per-thread buffers.
+        void linearize_states(MeshFunction<double>*** fns, std::vector<Traverse::State*>& states, ThreadData* thread_data,
+          std::vector<ElementRecord>& records, int num_threads_used);
+
+        /// A vertex on an element edge between two chunks of process_solution_streamed().
+        struct ChunkEdgeVertex
+        {
+          int position; ///< position on the edge, LocalVertex::key[2] of the edge vertices
+          double coords[3]; ///< x, y, value
+          bool operator<(const ChunkEdgeVertex& other) const { return position < other.position; }
+        };
+
+        /// The sorted mesh vertex ids of an element edge and a position on it.
+        typedef std::pair<std::pair<int, int>, int> ChunkEdgeKey;
+
+        /// A triangle on an element edge between two chunks, held back until the chunk with the other side of the edge.
+        struct ChunkEdgeTriangle
+        {
+          double coords[3][3]; ///< x, y, value of the vertices
+          int marker;
+          std::vector<ChunkEdgeKey> keys[3]; ///< positions of the vertices on the open edges
+        };
+
+        /// What process_solution_streamed() keeps between the chunks to make the edges between them conforming.
+        struct ChunkEdges
+        {
+          /// The vertices (sorted by the position) of the open edges, those whose other side was not processed yet,
+          /// by the sorted mesh vertex ids of the edge.
+          std::map<std::pair<int, int>, std::vector<ChunkEdgeVertex> > edges;
+          /// The triangles of the processed chunks on the open edges.
+          std::vector<ChunkEdgeTriangle> triangles;
+          /// Positions of the vertices of the current chunk on the open edges, by the vertex index.
+          std::multimap<int, ChunkEdgeKey> keys;
+        };
+
+        /// Makes the edges of the merged chunk that a previous chunk left open conforming, and opens the edges of this chunk
+        /// whose other side was not processed yet. The vertices that only the previous chunk has on an edge are added,
+        /// the triangles held back on the edge are added with the vertices of this chunk, regularize() then splits both.
+        /// An edge with different values on its sides is left as it is, as merge_elements() does not identify the vertices
+        /// there either. In the last chunk, all held triangles are added.
+        void conform_chunk_edges(std::vector<Traverse::State*>& states, ThreadData* thread_data, std::vector<ElementRecord>& records,
+          ChunkEdges& chunk_edges, bool last_chunk);
+
+        /// Adds the vertices of other between the positions t1 and t2 (the vertices iv1 and iv2) of an edge, recursively halving it.
+        /// The added vertices are stored by their position to vertices.
+        void add_chunk_edge_vertices(int iv1, int t1, int iv2, int t2, const std::vector<ChunkEdgeVertex>& other, std::map<int, int>& vertices);
+
+        /// Moves the regularized triangles on the open edges to chunk_edges.
+        void hold_chunk_edge_triangles(ChunkEdges& chunk_edges);
+
+        /// Adds a vertex with the parents p1, p2 to the merged linearization, growing the vertex arrays and the hash table if needed.
+        int add_merged_vertex(int p1, int p2, const double* coords);
+
+        /// Adds the element edges of the merged linearization.
+        void add_element_edges(std::vector<Traverse::State*>& states, ThreadData* thread_data, std::vector<ElementRecord>& records);
+
+        /// Regularizes the hanging vertices of the merged linearization.
+        void regularize();
+
         /// Internal.
         void push_transforms(MeshFunction<double>** fns, int transform);
 
         /// Internal.
         void pop_transforms(MeshFunction<double>** fns);
       };
+
+      /// LinearizerOutput writing the pieces into one VTU file, see VtuWriter::begin_pieces().
+      class HERMES_API LinearizerVtuOutput : public LinearizerOutput
+      {
+      public:
+        /// \param[in] writer Output settings (precision, compression).
+        LinearizerVtuOutput(const char* filename, const char* quantity_name, bool mode_3D = true, const VtuWriter& writer = VtuWriter());
+
+        virtual void begin();
+        virtual void write_piece(const double3* verts, int vertex_count, const int3* tris, const int* tri_markers, int triangle_count);
+        virtual void end();
+
+      protected:
+        std::string filename;
+        std::string quantity_name;
+        bool mode_3D;
+        VtuWriter writer;
+      };
     }
   }
 }
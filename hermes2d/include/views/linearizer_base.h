@@ -23,6 +23,7 @@
 
 #include "global.h"
 #include "../quadrature/quad_all.h"
+#include "vtu_writer.h"
 
 namespace Hermes
 {
@@ -147,6 +148,18 @@ namespace Hermes
         friend class StreamView;
       };
 
+      /// Holds the lock of the data of a linearizer (LinearizerBase::lock_data()) for its lifetime,
+      /// so that the data are unlocked also when an exception is thrown.
+      class HERMES_API LinearizerDataLock
+      {
+      public:
+        LinearizerDataLock(const LinearizerBase* linearizer);
+        ~LinearizerDataLock();
+
+      private:
+        const LinearizerBase* linearizer;
+      };
+
       const int LIN_MAX_LEVEL = 6;
     }
   }
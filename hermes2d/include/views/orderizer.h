@@ -44,6 +44,16 @@ namespace Hermes
         template<typename Scalar>
         void save_mesh_vtk(const Space<Scalar>* space, const char* file_name);
 
+        /// Saves the polynomial orders (and element markers) in the binary VTK XML format (.vtu).
+        /// \param[in] writer Output settings (encoding, precision, compression).
+        template<typename Scalar>
+        void save_orders_vtu(const Space<Scalar>* space, const char* file_name, const VtuWriter& writer = VtuWriter());
+
+        /// Saves the mesh edges (and edge markers) in the binary VTK XML format (.vtu).
+        /// \param[in] writer Output settings (encoding, precision, compression).
+        template<typename Scalar>
+        void save_mesh_vtu(const Space<Scalar>* space, const char* file_name, const VtuWriter& writer = VtuWriter());
+
         int get_labels(int*& lvert, char**& ltext, double2*& lbox) const;
 
         void calc_vertices_aabb(double* min_x, double* max_x,
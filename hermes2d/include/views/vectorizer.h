@@ -44,6 +44,12 @@ namespace Hermes
         /// \param[in] eps - tolerance parameter controlling how fine the resulting linearized approximation of the solution is.
         void process_solution(MeshFunction<double>* xsln, MeshFunction<double>* ysln, int xitem = H2D_FN_VAL_0, int yitem = H2D_FN_VAL_0, double eps = HERMES_EPS_NORMAL);
 
+        /// Save a vector-valued pair of MeshFunctions in the binary VTK XML format (.vtu).
+        /// The vectors are stored as point data, the triangle markers as cell data.
+        /// \param[in] writer Output settings (encoding, precision, compression).
+        void save_solution_vtu(MeshFunction<double>* xsln, MeshFunction<double>* ysln, const char* filename, const char* quantity_name,
+          int xitem = H2D_FN_VAL_0, int yitem = H2D_FN_VAL_0, double eps = HERMES_EPS_NORMAL, const VtuWriter& writer = VtuWriter());
+
         /// Set the displacement, i.e. set two functions that will deform the domain for visualization, in the x-direction, and the y-direction.
         void set_displacement(MeshFunction<double>* xdisp, MeshFunction<double>* ydisp, double dmult = 1.0);
 
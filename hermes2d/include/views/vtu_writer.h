@@ -0,0 +1,196 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_VTU_WRITER_H
+#define __H2D_VTU_WRITER_H
+
+#include "../global.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    namespace Views
+    {
+      /// Encoding of the appended data section of a VTU file.
+      enum VtuEncoding
+      {
+        /// Raw binary data, the smallest and fastest option.
+        HERMES_VTU_RAW,
+        /// Base64-encoded data, the file is a valid XML document.
+        HERMES_VTU_BASE64
+      };
+
+      /// Writer of the VTK XML unstructured grid format (.vtu) with the data arrays in the appended binary section.
+      /// The writer does not copy the data, it only stores pointers to the arrays registered by set_points(), set_cells(),
+      /// add_point_data() and add_cell_data(), these have to be valid until write() is called. Any number of point and cell
+      /// data arrays may be stored in a single file. The values are converted (to Float32 or Float64), possibly compressed
+      /// (zlib, if Hermes is built WITH_ZLIB) and written in blocks, so the memory overhead does not depend on the size of the data.
+      /// Linearizer, Vectorizer and Orderizer use this class in their save_*_vtu() methods.
+      class HERMES_API VtuWriter
+      {
+      public:
+        /// Constructor.
+        /// \param[in] encoding Encoding of the appended data.
+        /// \param[in] double_precision Write floating point arrays as Float64 (default is Float32).
+        /// \param[in] compression_level zlib compression level (1 - fastest, 9 - best), 0 means no compression.
+        VtuWriter(VtuEncoding encoding = HERMES_VTU_RAW, bool double_precision = false, int compression_level = 0);
+        /// Copies the settings and the registered arrays, not an open file (see begin_pieces()).
+        VtuWriter(const VtuWriter& other);
+        VtuWriter& operator=(const VtuWriter& other);
+        ~VtuWriter();
+
+        void set_encoding(VtuEncoding encoding);
+        void set_double_precision(bool double_precision);
+        /// \param[in] compression_level zlib compression level (1 - fastest, 9 - best), 0 means no compression.
+        void set_compression_level(int compression_level);
+
+        /// Sets the points of the grid.
+        /// \param[in] count Number of points.
+        /// \param[in] coords Coordinates of the first point.
+        /// \param[in] stride Distance (in doubles) of coordinates of two consecutive points.
+        /// \param[in] dimension Number of coordinates read for each point (2 or 3), missing coordinates are zero.
+        void set_points(int count, const double* coords, int stride, int dimension);
+
+        /// Sets the cells of the grid.
+        /// \param[in] count Number of cells.
+        /// \param[in] connectivity Point indices of the first cell.
+        /// \param[in] stride Distance (in ints) of point indices of two consecutive cells.
+        /// \param[in] cell_size Number of points of each cell (2 - lines, 3 - triangles, 4 - quadrilaterals).
+        void set_cells(int count, const int* connectivity, int stride, int cell_size);
+
+        /// Adds a point data array, the number of values is given by set_points().
+        /// \param[in] name Name of the quantity.
+        /// \param[in] values Components of the value at the first point.
+        /// \param[in] stride Distance (in doubles) of values at two consecutive points.
+        /// \param[in] num_components Number of components, two-component values are written as 3D vectors.
+        void add_point_data(const char* name, const double* values, int stride = 1, int num_components = 1);
+
+        /// Adds a floating point cell data array, the number of values is given by set_cells().
+        /// See add_point_data() for the parameters.
+        void add_cell_data(const char* name, const double* values, int stride = 1, int num_components = 1);
+
+        /// Adds an integer cell data array (e.g. markers, polynomial orders), the number of values is given by set_cells().
+        void add_cell_data(const char* name, const int* values, int stride = 1);
+
+        /// Writes the file.
+        void write(const char* filename);
+
+        /// Writing of a file with more pieces, e.g. produced one by one to save memory: begin_pieces(), then
+        /// write_piece() for every piece set up by set_points(), set_cells() and add_*_data(), and end_pieces().
+        /// All pieces have to contain the same data arrays. The data are written inline in base64 (the appended
+        /// section would need the sizes of all pieces in advance), the encoding setting does not apply.
+        void begin_pieces(const char* filename);
+        void write_piece();
+        void end_pieces();
+
+        /// Forgets the points, cells and all data arrays, the output settings are kept.
+        void clear();
+
+        /// Whether compression is available (Hermes built WITH_ZLIB).
+        static bool compression_available();
+
+      protected:
+        /// Kind of the array, determines the conversion of the values.
+        enum ArrayKind
+        {
+          ARRAY_DOUBLE,
+          ARRAY_INT,
+          ARRAY_OFFSETS,
+          ARRAY_TYPES
+        };
+
+        /// A registered array and the description of its conversion to the output.
+        struct DataArray
+        {
+          std::string name;
+          ArrayKind kind;
+          const void* data;
+          int stride;
+          int num_components; ///< number of components read from data
+          int out_components; ///< number of components written
+          int count; ///< number of tuples
+          int param; ///< cell size for ARRAY_OFFSETS, cell type for ARRAY_TYPES
+
+          /// Size in bytes of one written component.
+          int component_size(bool double_precision) const;
+          /// Type name in the VTK format.
+          const char* type_name(bool double_precision) const;
+          /// Converts the tuples [first, first + num) into buffer.
+          void fill(char* buffer, int first, int num, bool double_precision) const;
+        };
+
+        /// Output stream handling the encoding.
+        class Output;
+
+        DataArray make_array(const char* name, ArrayKind kind, const void* data, int stride, int num_components, int out_components, int count, int param) const;
+
+        /// All arrays (point data, cell data, points, cells) in the order of the file.
+        void collect_arrays(std::vector<DataArray>& arrays) const;
+
+        /// Writes the data of one array to the appended section.
+        void write_array(Output& out, const DataArray& array, const std::vector<char>* compressed);
+
+        /// Compresses the data of one array in the format of vtkZLibDataCompressor (header followed by the blocks).
+        void compress_array(const DataArray& array, std::vector<char>& result);
+
+        /// Size of the array in the appended section.
+        uint64_t appended_size(const DataArray& array, const std::vector<char>* compressed) const;
+
+        VtuEncoding encoding;
+        bool double_precision;
+        int compression_level;
+
+        int num_points, num_cells;
+        DataArray points, connectivity;
+        std::vector<DataArray> point_data, cell_data;
+
+        /// The file written by write_piece().
+        FILE* stream;
+      };
+
+      /// Writer of a ParaView collection (.pvd) referencing a time series of VTU files.
+      /// The collection file is rewritten after each added data set, so that it is usable
+      /// already during the computation.
+      class HERMES_API PvdWriter
+      {
+      public:
+        /// \param[in] filename The .pvd file.
+        PvdWriter(const char* filename);
+
+        /// Adds a data set (typically written by VtuWriter) and saves the collection.
+        /// \param[in] time Time level of the data set.
+        /// \param[in] vtu_filename File name of the data set, relative to the directory of the collection file.
+        /// \param[in] part Part number (for several data sets at the same time level).
+        void add_dataset(double time, const char* vtu_filename, int part = 0);
+
+        /// Saves the collection.
+        void save() const;
+
+      protected:
+        std::string filename;
+
+        struct DataSet
+        {
+          double time;
+          int part;
+          std::string file;
+        };
+        std::vector<DataSet> datasets;
+      };
+    }
+  }
+}
+#endif
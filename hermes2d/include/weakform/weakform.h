@@ -156,6 +156,14 @@ namespace Hermes
       /// Get external functions.
       Hermes::vector<MeshFunction<Scalar>*> get_ext() const;
 
+      /// Sets the quadrature the forms are integrated with, e.g. get_quad_2d("lobatto"), see quad_all.h; g_quad_2d_std by default.
+      /// The forms assembled on an element share the shape functions tabulated in the integration points of this quadrature,
+      /// a volumetric form can be integrated with another one (MatrixFormVol::set_quad_2d(), VectorFormVol::set_quad_2d()).
+      void set_quad_2d(Quad2D* quad_2d);
+
+      /// Returns the quadrature the forms are integrated with.
+      Quad2D* get_quad_2d() const;
+
       /// Cloning.
       virtual WeakForm* clone() const;
 
@@ -182,6 +190,9 @@ namespace Hermes
 
       bool is_matfree;
 
+      /// See set_quad_2d().
+      Quad2D* quad_2d;
+
       /// Holds all forms.
       Hermes::vector<Form<Scalar> *> forms;
 
@@ -249,6 +260,9 @@ namespace Hermes
       /// scaling factor
       void setScalingFactor(double scalingFactor);
 
+      /// The quadrature of this form, NULL if it is integrated with the one of its WeakForm.
+      Quad2D* get_quad_2d() const;
+
     protected:
       /// Set pointer to a WeakForm.
       inline void set_weakform(WeakForm<Scalar>* wf) { this->wf = wf; }
@@ -276,6 +290,10 @@ namespace Hermes
 
       WeakForm<Scalar>* wf;
       double stage_time;
+
+      /// See get_quad_2d(), set by MatrixFormVol::set_quad_2d() and VectorFormVol::set_quad_2d().
+      Quad2D* quad_2d;
+
       void set_uExtOffset(int u_ext_offset);
       friend class WeakForm<Scalar>;
       friend class RungeKutta<Scalar>;
@@ -322,6 +340,13 @@ namespace Hermes
       void setSymFlag(SymFlag sym);
       SymFlag getSymFlag() const;
 
+      /// Integrates this form with its own quadrature instead of the one of the WeakForm, e.g. a mass form with
+      /// get_quad_2d("lobatto") for the mass lumping. NULL returns to the quadrature of the WeakForm.
+      /// The quadrature has to have the orders of Quad2DStd (as all of quad_all.h have). The form is not covered by the
+      /// assembly cache: its shape functions and geometry are calculated in each assembling. Its external functions
+      /// and those of the WeakForm have to be Solutions.
+      void set_quad_2d(Quad2D* quad_2d);
+
       virtual ~MatrixFormVol();
 
       virtual MatrixFormVol* clone() const;
@@ -396,6 +421,9 @@ namespace Hermes
 
       virtual ~VectorFormVol();
 
+      /// Integrates this form with its own quadrature, see MatrixFormVol::set_quad_2d().
+      void set_quad_2d(Quad2D* quad_2d);
+
       virtual VectorFormVol* clone() const;
     };
 
@@ -178,6 +178,15 @@ namespace Hermes
         }
       }
 
+      // The neighbors across the inner edges are searched once per mesh.
+      for (unsigned int iest = 0; iest < error_estimators_surf.size(); iest++)
+        if(error_estimators_surf[iest]->area == H2D_DG_INNER_EDGE)
+        {
+          for (unsigned int j = 0; j < this->spaces.size(); j++)
+            this->spaces[j]->get_mesh()->update_face_connectivity();
+          break;
+        }
+
       // Begin the multimesh traversal.
       trav.begin(this->num, meshes, fns);
       while ((ee = trav.get_next_state()) != NULL)
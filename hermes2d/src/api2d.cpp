@@ -22,6 +22,7 @@
 #include "common.h"
 #include "exceptions.h"
 #include "api2d.h"
+#include "global.h"
 #include <xercesc/util/PlatformUtils.hpp>
 
 using namespace xercesc;
@@ -49,6 +50,8 @@ namespace Hermes
       XMLPlatformUtils::Initialize();   
 
       this->integral_parameters.insert(std::pair<Hermes2DApiParam, Parameter<int>*> (Hermes::Hermes2D::numThreads,new Parameter<int>(NUM_THREADS)));
+      this->integral_parameters.insert(std::pair<Hermes2DApiParam, Parameter<int>*> (Hermes::Hermes2D::solutionElementCacheSize,new Parameter<int>(H2D_SOLUTION_ELEMENT_CACHE_SIZE)));
+      this->integral_parameters.insert(std::pair<Hermes2DApiParam, Parameter<int>*> (Hermes::Hermes2D::solutionElementCacheMemory,new Parameter<int>(H2D_SOLUTION_ELEMENT_CACHE_MEMORY)));
       this->text_parameters.insert(std::pair<Hermes2DApiParam, Parameter<std::string>*> (Hermes::Hermes2D::xmlSchemasDirPath,new Parameter<std::string>(*(new std::string(H2D_XML_SCHEMAS_DIRECTORY)))));
       std::stringstream ss;
       ss << H2D_PRECALCULATED_FORMS_DIRECTORY;
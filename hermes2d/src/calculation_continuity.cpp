@@ -15,6 +15,7 @@
 
 #include "calculation_continuity.h"
 #include "mesh_reader_h2d_xml.h"
+#include "mesh_reader_h2d_binary.h"
 #include "space_h1.h"
 #include "space_hdiv.h"
 #include "space_hcurl.h"
@@ -36,7 +37,7 @@ namespace Hermes
 
     void CalculationContinuityException::init(exceptionEntityType type, const char * reason)
     {
-      char * msg =  new char[34 + strlen(reason)];
+      char * msg =  new char[64 + strlen(reason)];
       char * typeMsg = new char[15];
       switch(type)
       {
@@ -61,13 +62,14 @@ namespace Hermes
       }
 
       sprintf(msg, "Exception in CalculationContinuity (%s): \"%s\"", typeMsg, reason);
+      delete [] message;
       message = msg;
       delete [] typeMsg;
     }
 
     IOCalculationContinuityException::IOCalculationContinuityException(exceptionEntityType type, inputOutput inputOutput, const char * filename) : CalculationContinuityException()
     {
-      char * msg =  new char[34 + strlen(filename)];
+      char * msg =  new char[64 + strlen(filename)];
       char * typeMsg = new char[7];
       switch(inputOutput)
       {
@@ -80,11 +82,13 @@ namespace Hermes
       }
       sprintf(msg, "I/O exception: %s, filename: \"%s\"", typeMsg, filename);
       this->init(type, msg);
+      delete [] msg;
+      delete [] typeMsg;
     }
 
     IOCalculationContinuityException::IOCalculationContinuityException(exceptionEntityType type, inputOutput inputOutput, const char * filename, const char * reason) : CalculationContinuityException()
     {
-      char * msg =  new char[34 + strlen(filename)];
+      char * msg =  new char[64 + strlen(filename) + strlen(reason)];
       char * typeMsg = new char[7];
       switch(inputOutput)
       {
@@ -97,11 +101,17 @@ namespace Hermes
       }
       sprintf(msg, "I/O exception: %s, filename: \"%s\", reason: %s", typeMsg, filename, reason);
       this->init(type, msg);
+      delete [] msg;
+      delete [] typeMsg;
     }
 
     template<typename Scalar>
-    CalculationContinuity<Scalar>::CalculationContinuity(IdentificationMethod identification_method) : last_record(NULL), record_available(false), identification_method(identification_method), num(0)
+    CalculationContinuity<Scalar>::CalculationContinuity(IdentificationMethod identification_method, bool asynchronous) : last_record(NULL), record_available(false), identification_method(identification_method), num(0),
+      asynchronous(asynchronous), writer_started(false), writer_busy(false), writer_stop(false), writer_error_type(CalculationContinuityException::general)
     {
+      pthread_mutex_init(&this->writer_mutex, NULL);
+      pthread_cond_init(&this->writer_cond, NULL);
+
       double last_time;
       unsigned int last_number;
       std::stringstream ss;
@@ -160,119 +170,352 @@ namespace Hermes
           this->last_record = record;
           break;
         }
+        this->last_record->load_manifest();
       }
     }
 
     template<typename Scalar>
-    void CalculationContinuity<Scalar>::add_record(double time, unsigned int number, Mesh* mesh, Space<Scalar>* space, Solution<Scalar>* sln, double time_step, double time_step_n_minus_one, double error)
+    CalculationContinuity<Scalar>::~CalculationContinuity()
     {
-      std::ofstream ofile("timeAndNumber.h2d", std::ios_base::app);
-      if(ofile)
+      if(this->writer_started)
       {
-        ofile << ++this->num << ' ' << time << ' ' << number << std::endl;
-        ofile.close();
+        pthread_mutex_lock(&this->writer_mutex);
+        this->writer_stop = true;
+        pthread_cond_broadcast(&this->writer_cond);
+        pthread_mutex_unlock(&this->writer_mutex);
+        pthread_join(this->writer_thread, NULL);
       }
-      else
-        throw IOCalculationContinuityException(CalculationContinuityException::general, IOCalculationContinuityException::output, "timeAndNumber.h2d");
+      pthread_cond_destroy(&this->writer_cond);
+      pthread_mutex_destroy(&this->writer_mutex);
+
+      for(typename std::map<std::pair<double, unsigned int>, Record*>::iterator it = this->records.begin(); it != this->records.end(); it++)
+        delete it->second;
+      for(typename std::map<double, Record*>::iterator it = this->time_records.begin(); it != this->time_records.end(); it++)
+        delete it->second;
+      for(typename std::map<unsigned int, Record*>::iterator it = this->numbered_records.begin(); it != this->numbered_records.end(); it++)
+        delete it->second;
+    }
 
-      CalculationContinuity<Scalar>::Record* record = new CalculationContinuity<Scalar>::Record(time, number);
-      record->save_mesh(mesh);
-      if(space != NULL)
-        record->save_space(space);
-      if(sln != NULL)
-        record->save_solution(sln);
-      if(time_step > 0.0)
-        record->save_time_step_length(time_step);
-      if(time_step_n_minus_one > 0.0)
-        record->save_time_step_length_n_minus_one(time_step_n_minus_one);
-      if(error > 0.0)
-        record->save_error(error);
+    template<typename Scalar>
+    CalculationContinuity<Scalar>::WrittenEntity::WrittenEntity() : entity(NULL), seq(-1), mesh_seq(-1)
+    {
+    }
 
-      this->records.insert(std::pair<std::pair<double, unsigned int>, CalculationContinuity<Scalar>::Record*>(std::pair<double, unsigned int>(time, number), record));
-      this->last_record = record;
+    template<typename Scalar>
+    std::vector<char>& CalculationContinuity<Scalar>::PendingRecord::add_file(const std::string& filename, CalculationContinuityException::exceptionEntityType type)
+    {
+      this->files.push_back(PendingFile());
+      this->files.back().filename = filename;
+      this->files.back().type = type;
+      return this->files.back().data;
     }
 
     template<typename Scalar>
-    void CalculationContinuity<Scalar>::add_record(double time, unsigned int number, Hermes::vector<Mesh*> meshes, Hermes::vector<Space<Scalar>*> spaces, Hermes::vector<Solution<Scalar>*> slns, double time_step, double time_step_n_minus_one, double error)
+    void CalculationContinuity<Scalar>::PendingRecord::add_file(const std::string& filename, CalculationContinuityException::exceptionEntityType type, const std::string& text)
     {
-      std::ofstream ofile("timeAndNumber.h2d", std::ios_base::app);
-      if(ofile)
+      std::vector<char>& data = this->add_file(filename, type);
+      data.assign(text.begin(), text.end());
+    }
+
+    template<typename Scalar>
+    void CalculationContinuity<Scalar>::save_record(Record* record, const char* index_file, const std::string& index_line, Hermes::vector<Mesh*> meshes, Hermes::vector<Space<Scalar>*> spaces, Hermes::vector<Solution<Scalar>*> slns, double time_step, double time_step_n_minus_one, double error)
+    {
+      this->check_writer_error();
+
+      PendingRecord* pending = new PendingRecord;
+      pending->index_file = index_file;
+      pending->index_line = index_line;
+
+      // The snapshot: unchanged meshes and spaces refer to the files of the previous records, the rest is copied to memory images.
+      // What is written is recorded in copies of written_meshes, written_spaces, these replace the originals only once the record is handed over.
+      std::vector<WrittenEntity> written_meshes(this->written_meshes);
+      std::vector<WrittenEntity> written_spaces(this->written_spaces);
+      std::string filename;
+      try
       {
-        ofile << ++this->num << ' ' << time << ' ' << number << std::endl;
-        ofile.close();
+        if(written_meshes.size() < meshes.size())
+          written_meshes.resize(meshes.size());
+        MeshReaderH2DBinary mesh_writer;
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+          WrittenEntity& written = written_meshes[i];
+          if(written.entity != meshes[i] || written.seq != (int)meshes[i]->get_seq())
+          {
+            filename = record->get_file_name(CalculationContinuity<Scalar>::mesh_file_name, i);
+            mesh_writer.save(pending->add_file(filename, CalculationContinuityException::meshes), meshes[i]);
+            written.entity = meshes[i];
+            written.seq = meshes[i]->get_seq();
+            written.filename = filename;
+          }
+          record->meshFiles.push_back(written.filename);
+        }
+      }
+      catch(std::exception& e)
+      {
+        delete pending;
+        throw IOCalculationContinuityException(CalculationContinuityException::meshes, IOCalculationContinuityException::output, filename.c_str(), e.what());
       }
-      else
-        throw IOCalculationContinuityException(CalculationContinuityException::general, IOCalculationContinuityException::output, "timeAndNumber.h2d");
 
-      CalculationContinuity<Scalar>::Record* record = new CalculationContinuity<Scalar>::Record(time, number);
-      record->save_meshes(meshes);
-      if(spaces != Hermes::vector<Space<Scalar>*>())
-        record->save_spaces(spaces);
-      if(slns != Hermes::vector<Solution<Scalar>*>())
-        record->save_solutions(slns);
+      try
+      {
+        if(written_spaces.size() < spaces.size())
+          written_spaces.resize(spaces.size());
+        for(unsigned int i = 0; i < spaces.size(); i++)
+        {
+          WrittenEntity& written = written_spaces[i];
+          if(written.entity != spaces[i] || written.seq != spaces[i]->get_seq() || written.mesh_seq != (int)spaces[i]->get_mesh()->get_seq())
+          {
+            filename = record->get_file_name(CalculationContinuity<Scalar>::space_file_name, i);
+            if(!spaces[i]->save_binary(pending->add_file(filename, CalculationContinuityException::spaces)))
+              throw Exceptions::Exception("This type of space can not be saved.");
+            written.entity = spaces[i];
+            written.seq = spaces[i]->get_seq();
+            written.mesh_seq = spaces[i]->get_mesh()->get_seq();
+            written.filename = filename;
+          }
+          record->spaceFiles.push_back(written.filename);
+        }
+      }
+      catch(std::exception& e)
+      {
+        delete pending;
+        throw IOCalculationContinuityException(CalculationContinuityException::spaces, IOCalculationContinuityException::output, filename.c_str(), e.what());
+      }
+
+      try
+      {
+        for(unsigned int i = 0; i < slns.size(); i++)
+        {
+          filename = record->get_file_name(CalculationContinuity<Scalar>::solution_file_name, i);
+          slns[i]->save_binary(pending->add_file(filename, CalculationContinuityException::solutions));
+          record->solutionFiles.push_back(filename);
+        }
+      }
+      catch(std::exception& e)
+      {
+        delete pending;
+        throw IOCalculationContinuityException(CalculationContinuityException::solutions, IOCalculationContinuityException::output, filename.c_str(), e.what());
+      }
+
+      std::stringstream value;
       if(time_step > 0.0)
-        record->save_time_step_length(time_step);
+      {
+        value.str("");
+        value << time_step;
+        pending->add_file(record->get_file_name(CalculationContinuity<Scalar>::time_step_file_name, -1), CalculationContinuityException::time_steps, value.str());
+      }
       if(time_step_n_minus_one > 0.0)
-        record->save_time_step_length_n_minus_one(time_step_n_minus_one);
+      {
+        value.str("");
+        value << time_step_n_minus_one;
+        pending->add_file(record->get_file_name(CalculationContinuity<Scalar>::time_stepNMinusOne_file_name, -1), CalculationContinuityException::time_steps, value.str());
+      }
       if(error > 0.0)
-        record->save_error(error);
+      {
+        value.str("");
+        value << error;
+        pending->add_file(record->get_file_name(CalculationContinuity<Scalar>::error_file_name, -1), CalculationContinuityException::error, value.str());
+      }
 
-      this->records.insert(std::pair<std::pair<double, unsigned int>, CalculationContinuity<Scalar>::Record*>(std::pair<double, unsigned int>(time, number), record));
-      this->last_record = record;
+      // The manifest goes last, after the files it lists.
+      pending->add_file(record->get_file_name(CalculationContinuity<Scalar>::record_file_name, -1), CalculationContinuityException::general, record->get_manifest());
+
+      if(!this->asynchronous)
+      {
+        bool written = this->write_record(pending);
+        delete pending;
+        // No other record refers to the files of this one, so the error does not affect the following records.
+        if(!written)
+          this->check_writer_error(true);
+      }
+      else
+      {
+        if(!this->writer_started)
+        {
+          int err = pthread_create(&this->writer_thread, NULL, writer_thread_function, this);
+          if(err)
+          {
+            delete pending;
+            throw CalculationContinuityException(CalculationContinuityException::general, "Failed to create the thread writing the records.");
+          }
+          this->writer_started = true;
+        }
+
+        pthread_mutex_lock(&this->writer_mutex);
+        this->pending_records.push_back(pending);
+        pthread_cond_broadcast(&this->writer_cond);
+        pthread_mutex_unlock(&this->writer_mutex);
+      }
+
+      this->written_meshes.swap(written_meshes);
+      this->written_spaces.swap(written_spaces);
     }
 
     template<typename Scalar>
-    void CalculationContinuity<Scalar>::add_record(double time, Mesh* mesh, Space<Scalar>* space, Solution<Scalar>* sln, double time_step, double time_step_n_minus_one, double error)
+    bool CalculationContinuity<Scalar>::write_record(PendingRecord* pending)
     {
-      std::ofstream ofile("onlyTime.h2d", std::ios_base::app);
+      for(typename std::list<PendingFile>::iterator it = pending->files.begin(); it != pending->files.end(); it++)
+      {
+        FILE* file = fopen(it->filename.c_str(), "wb");
+        bool ok = (file != NULL);
+        if(ok && !it->data.empty())
+          ok = (fwrite(&it->data[0], 1, it->data.size(), file) == it->data.size());
+        if(file != NULL)
+          ok = (fclose(file) == 0) && ok;
+        if(!ok)
+        {
+          pthread_mutex_lock(&this->writer_mutex);
+          this->writer_error = "Error writing the file.";
+          this->writer_error_file = it->filename;
+          this->writer_error_type = it->type;
+          pthread_mutex_unlock(&this->writer_mutex);
+          return false;
+        }
+      }
+
+      std::ofstream ofile(pending->index_file.c_str(), std::ios_base::app);
       if(ofile)
       {
-        ofile << ++this->num << ' ' << time << std::endl;
+        ofile << pending->index_line << std::endl;
         ofile.close();
       }
-      else
-        throw IOCalculationContinuityException(CalculationContinuityException::general, IOCalculationContinuityException::output, "onlyTime.h2d");
+      if(!ofile)
+      {
+        pthread_mutex_lock(&this->writer_mutex);
+        this->writer_error = "Error writing the index of records.";
+        this->writer_error_file = pending->index_file;
+        this->writer_error_type = CalculationContinuityException::general;
+        pthread_mutex_unlock(&this->writer_mutex);
+        return false;
+      }
+      return true;
+    }
 
-      CalculationContinuity<Scalar>::Record* record = new CalculationContinuity<Scalar>::Record(time);
-      record->save_mesh(mesh);
+    template<typename Scalar>
+    void* CalculationContinuity<Scalar>::writer_thread_function(void* data)
+    {
+      CalculationContinuity<Scalar>* continuity = (CalculationContinuity<Scalar>*)data;
+      pthread_mutex_lock(&continuity->writer_mutex);
+      while(true)
+      {
+        while(continuity->pending_records.empty() && !continuity->writer_stop)
+          pthread_cond_wait(&continuity->writer_cond, &continuity->writer_mutex);
+        if(continuity->pending_records.empty())
+          break;
+
+        PendingRecord* pending = continuity->pending_records.front();
+        continuity->pending_records.pop_front();
+        continuity->writer_busy = true;
+        bool failed = !continuity->writer_error.empty();
+        pthread_mutex_unlock(&continuity->writer_mutex);
+
+        // After an error, the following records may refer to files that were not written, so none of them is completed.
+        if(!failed)
+          continuity->write_record(pending);
+        delete pending;
+
+        pthread_mutex_lock(&continuity->writer_mutex);
+        continuity->writer_busy = false;
+        pthread_cond_broadcast(&continuity->writer_cond);
+      }
+      pthread_mutex_unlock(&continuity->writer_mutex);
+      return NULL;
+    }
+
+    template<typename Scalar>
+    void CalculationContinuity<Scalar>::flush()
+    {
+      pthread_mutex_lock(&this->writer_mutex);
+      while(!this->pending_records.empty() || this->writer_busy)
+        pthread_cond_wait(&this->writer_cond, &this->writer_mutex);
+      pthread_mutex_unlock(&this->writer_mutex);
+      this->check_writer_error();
+    }
+
+    template<typename Scalar>
+    void CalculationContinuity<Scalar>::check_writer_error(bool reset)
+    {
+      pthread_mutex_lock(&this->writer_mutex);
+      std::string error = this->writer_error;
+      std::string filename = this->writer_error_file;
+      CalculationContinuityException::exceptionEntityType type = this->writer_error_type;
+      if(reset)
+        this->writer_error.clear();
+      pthread_mutex_unlock(&this->writer_mutex);
+      if(!error.empty())
+        throw IOCalculationContinuityException(type, IOCalculationContinuityException::output, filename.c_str(), error.c_str());
+    }
+
+    template<typename Scalar>
+    void CalculationContinuity<Scalar>::add_record(double time, unsigned int number, Mesh* mesh, Space<Scalar>* space, Solution<Scalar>* sln, double time_step, double time_step_n_minus_one, double error)
+    {
+      Hermes::vector<Mesh*> meshes;
+      meshes.push_back(mesh);
+      Hermes::vector<Space<Scalar>*> spaces;
       if(space != NULL)
-        record->save_space(space);
+        spaces.push_back(space);
+      Hermes::vector<Solution<Scalar>*> slns;
       if(sln != NULL)
-        record->save_solution(sln);
-      if(time_step > 0.0)
-        record->save_time_step_length(time_step);
-      if(time_step_n_minus_one > 0.0)
-        record->save_time_step_length_n_minus_one(time_step_n_minus_one);
-      if(error > 0.0)
-        record->save_error(error);
+        slns.push_back(sln);
+      this->add_record(time, number, meshes, spaces, slns, time_step, time_step_n_minus_one, error);
+    }
 
-      this->time_records.insert(std::pair<double, CalculationContinuity<Scalar>::Record*>(time, record));
+    template<typename Scalar>
+    void CalculationContinuity<Scalar>::add_record(double time, unsigned int number, Hermes::vector<Mesh*> meshes, Hermes::vector<Space<Scalar>*> spaces, Hermes::vector<Solution<Scalar>*> slns, double time_step, double time_step_n_minus_one, double error)
+    {
+      std::stringstream index_line;
+      index_line << this->num + 1 << ' ' << time << ' ' << number;
+
+      // The record is registered only once it is saved.
+      CalculationContinuity<Scalar>::Record* record = new CalculationContinuity<Scalar>::Record(time, number);
+      try
+      {
+        this->save_record(record, "timeAndNumber.h2d", index_line.str(), meshes, spaces, slns, time_step, time_step_n_minus_one, error);
+      }
+      catch(...)
+      {
+        delete record;
+        throw;
+      }
+
+      this->num++;
+      this->records.insert(std::pair<std::pair<double, unsigned int>, CalculationContinuity<Scalar>::Record*>(std::pair<double, unsigned int>(time, number), record));
       this->last_record = record;
     }
 
+    template<typename Scalar>
+    void CalculationContinuity<Scalar>::add_record(double time, Mesh* mesh, Space<Scalar>* space, Solution<Scalar>* sln, double time_step, double time_step_n_minus_one, double error)
+    {
+      Hermes::vector<Mesh*> meshes;
+      meshes.push_back(mesh);
+      Hermes::vector<Space<Scalar>*> spaces;
+      if(space != NULL)
+        spaces.push_back(space);
+      Hermes::vector<Solution<Scalar>*> slns;
+      if(sln != NULL)
+        slns.push_back(sln);
+      this->add_record(time, meshes, spaces, slns, time_step, time_step_n_minus_one, error);
+    }
+
     template<typename Scalar>
     void CalculationContinuity<Scalar>::add_record(double time, Hermes::vector<Mesh*> meshes, Hermes::vector<Space<Scalar>*> spaces, Hermes::vector<Solution<Scalar>*> slns, double time_step, double time_step_n_minus_one, double error)
     {
-      std::ofstream ofile("onlyTime.h2d", std::ios_base::app);
-      if(ofile)
+      std::stringstream index_line;
+      index_line << this->num + 1 << ' ' << time;
+
+      // The record is registered only once it is saved.
+      CalculationContinuity<Scalar>::Record* record = new CalculationContinuity<Scalar>::Record(time);
+      try
       {
-        ofile << ++this->num << ' ' << time << std::endl;
-        ofile.close();
+        this->save_record(record, "onlyTime.h2d", index_line.str(), meshes, spaces, slns, time_step, time_step_n_minus_one, error);
       }
-      else
-        throw IOCalculationContinuityException(CalculationContinuityException::general, IOCalculationContinuityException::output, "onlyTime.h2d");
-      CalculationContinuity<Scalar>::Record* record = new CalculationContinuity<Scalar>::Record(time);
-      record->save_meshes(meshes);
-      if(spaces != Hermes::vector<Space<Scalar>*>())
-        record->save_spaces(spaces);
-      if(slns != Hermes::vector<Solution<Scalar>*>())
-        record->save_solutions(slns);
-      if(time_step > 0.0)
-        record->save_time_step_length(time_step);
-      if(time_step_n_minus_one > 0.0)
-        record->save_time_step_length_n_minus_one(time_step_n_minus_one);
-      if(error > 0.0)
-        record->save_error(error);
+      catch(...)
+      {
+        delete record;
+        throw;
+      }
+
+      this->num++;
       this->time_records.insert(std::pair<double, CalculationContinuity<Scalar>::Record*>(time, record));
       this->last_record = record;
     }
@@ -280,72 +523,52 @@ namespace Hermes
     template<typename Scalar>
     void CalculationContinuity<Scalar>::add_record(unsigned int number, Mesh* mesh, Space<Scalar>* space, Solution<Scalar>* sln, double time_step, double time_step_n_minus_one, double error)
     {
-      std::ofstream ofile("onlyNumber.h2d", std::ios_base::app);
-      if(ofile)
-      {
-        ofile << ++this->num << ' ' << number << std::endl;
-        ofile.close();
-      }
-      else
-        throw IOCalculationContinuityException(CalculationContinuityException::general, IOCalculationContinuityException::output, "onlyNumber.h2d");
-
-      CalculationContinuity<Scalar>::Record* record = new CalculationContinuity<Scalar>::Record(number);
-      record->save_mesh(mesh);
+      Hermes::vector<Mesh*> meshes;
+      meshes.push_back(mesh);
+      Hermes::vector<Space<Scalar>*> spaces;
       if(space != NULL)
-        record->save_space(space);
+        spaces.push_back(space);
+      Hermes::vector<Solution<Scalar>*> slns;
       if(sln != NULL)
-        record->save_solution(sln);
-      if(time_step > 0.0)
-        record->save_time_step_length(time_step);
-      if(time_step_n_minus_one > 0.0)
-        record->save_time_step_length_n_minus_one(time_step_n_minus_one);
-      if(error > 0.0)
-        record->save_error(error);
-
-      this->numbered_records.insert(std::pair<unsigned int, CalculationContinuity<Scalar>::Record*>(number, record));
-      this->last_record = record;
+        slns.push_back(sln);
+      this->add_record(number, meshes, spaces, slns, time_step, time_step_n_minus_one, error);
     }
 
     template<typename Scalar>
     void CalculationContinuity<Scalar>::add_record(unsigned int number, Hermes::vector<Mesh*> meshes, Hermes::vector<Space<Scalar>*> spaces, Hermes::vector<Solution<Scalar>*> slns, double time_step, double time_step_n_minus_one, double error)
     {
-      std::ofstream ofile("onlyNumber.h2d", std::ios_base::app);
-      if(ofile)
+      std::stringstream index_line;
+      index_line << this->num + 1 << ' ' << number;
+
+      // The record is registered only once it is saved.
+      CalculationContinuity<Scalar>::Record* record = new CalculationContinuity<Scalar>::Record(number);
+      try
       {
-        ofile << ++this->num << ' ' << number << std::endl;
-        ofile.close();
+        this->save_record(record, "onlyNumber.h2d", index_line.str(), meshes, spaces, slns, time_step, time_step_n_minus_one, error);
+      }
+      catch(...)
+      {
+        delete record;
+        throw;
       }
-      else
-        throw IOCalculationContinuityException(CalculationContinuityException::general, IOCalculationContinuityException::output, "onlyNumber.h2d");
 
-      CalculationContinuity<Scalar>::Record* record = new CalculationContinuity<Scalar>::Record(number);
-      record->save_meshes(meshes);
-      if(spaces != Hermes::vector<Space<Scalar>*>())
-        record->save_spaces(spaces);
-      if(slns != Hermes::vector<Solution<Scalar>*>())
-        record->save_solutions(slns);
-      if(time_step > 0.0)
-        record->save_time_step_length(time_step);
-      if(time_step_n_minus_one > 0.0)
-        record->save_time_step_length_n_minus_one(time_step_n_minus_one);
-      if(error > 0.0)
-        record->save_error(error);
+      this->num++;
       this->numbered_records.insert(std::pair<unsigned int, CalculationContinuity<Scalar>::Record*>(number, record));
       this->last_record = record;
     }
 
     template<typename Scalar>
-    CalculationContinuity<Scalar>::Record::Record(double time, unsigned int number) : time(time), number(number)
+    CalculationContinuity<Scalar>::Record::Record(double time, unsigned int number) : binary(true), time(time), number(number)
     {
     }
 
     template<typename Scalar>
-    CalculationContinuity<Scalar>::Record::Record(double time) : time(time), number(0)
+    CalculationContinuity<Scalar>::Record::Record(double time) : binary(true), time(time), number(0)
     {
     }
 
     template<typename Scalar>
-    CalculationContinuity<Scalar>::Record::Record(unsigned int number) : time(0.0), number(number)
+    CalculationContinuity<Scalar>::Record::Record(unsigned int number) : binary(true), time(0.0), number(number)
     {
     }
 
@@ -370,219 +593,257 @@ namespace Hermes
       return this->num;
     }
 
+    template<typename Scalar>
+    std::string CalculationContinuity<Scalar>::Record::get_file_name(const std::string& prefix, int index) const
+    {
+      std::stringstream filename;
+      filename << prefix;
+      if(index >= 0)
+        filename << index;
+      filename << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number;
+      // Meshes, spaces and solutions of the binary records are distinguished from the XML ones by the extension.
+      if(index >= 0 && this->binary)
+        filename << (std::string)".h2db";
+      else
+        filename << (std::string)".h2d";
+      return filename.str();
+    }
+
+    template<typename Scalar>
+    std::string CalculationContinuity<Scalar>::Record::get_manifest() const
+    {
+      // One file per line, the file names contain spaces.
+      std::stringstream manifest;
+      for(unsigned int i = 0; i < this->meshFiles.size(); i++)
+        manifest << "mesh\t" << this->meshFiles[i] << '\n';
+      for(unsigned int i = 0; i < this->spaceFiles.size(); i++)
+        manifest << "space\t" << this->spaceFiles[i] << '\n';
+      for(unsigned int i = 0; i < this->solutionFiles.size(); i++)
+        manifest << "solution\t" << this->solutionFiles[i] << '\n';
+      return manifest.str();
+    }
+
+    template<typename Scalar>
+    void CalculationContinuity<Scalar>::Record::save_manifest()
+    {
+      std::string filename = this->get_file_name(CalculationContinuity<Scalar>::record_file_name, -1);
+      std::ofstream out(filename.c_str(), std::ios_base::binary);
+      if(out)
+        out << this->get_manifest();
+      out.close();
+      if(!out)
+        throw IOCalculationContinuityException(CalculationContinuityException::general, IOCalculationContinuityException::output, filename.c_str());
+    }
+
+    template<typename Scalar>
+    void CalculationContinuity<Scalar>::Record::load_manifest()
+    {
+      this->meshFiles.clear();
+      this->spaceFiles.clear();
+      this->solutionFiles.clear();
+
+      std::ifstream in(this->get_file_name(CalculationContinuity<Scalar>::record_file_name, -1).c_str());
+      this->binary = (bool)in;
+      std::string line;
+      while(std::getline(in, line))
+      {
+        size_t tab = line.find('\t');
+        if(tab == std::string::npos)
+          continue;
+        std::string type = line.substr(0, tab);
+        if(type == "mesh")
+          this->meshFiles.push_back(line.substr(tab + 1));
+        else if(type == "space")
+          this->spaceFiles.push_back(line.substr(tab + 1));
+        else if(type == "solution")
+          this->solutionFiles.push_back(line.substr(tab + 1));
+      }
+    }
+
     template<typename Scalar>
     void CalculationContinuity<Scalar>::Record::save_meshes(Hermes::vector<Mesh*> meshes)
     {
-      MeshReaderH2DXML reader;
+      MeshReaderH2DBinary writer;
+      this->binary = true;
+      this->meshFiles.clear();
       for(unsigned int i = 0; i < meshes.size(); i++)
       {
-        std::stringstream filename;
-        filename << CalculationContinuity<Scalar>::mesh_file_name << i << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
+        std::string filename = this->get_file_name(CalculationContinuity<Scalar>::mesh_file_name, i);
         try
         {
-          reader.save(filename.str().c_str(), meshes[i]);
+          writer.save(filename.c_str(), meshes[i]);
         }
         catch(std::exception& e)
         {
-          throw IOCalculationContinuityException(CalculationContinuityException::meshes, IOCalculationContinuityException::output, filename.str().c_str(), e.what());
+          throw IOCalculationContinuityException(CalculationContinuityException::meshes, IOCalculationContinuityException::output, filename.c_str(), e.what());
         }
+        this->meshFiles.push_back(filename);
       }
+      this->save_manifest();
     }
+
     template<typename Scalar>
     void CalculationContinuity<Scalar>::Record::save_mesh(Mesh* mesh)
     {
-      MeshReaderH2DXML reader;
-      std::stringstream filename;
-      filename << CalculationContinuity<Scalar>::mesh_file_name << 0 << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
-      try
-      {
-        reader.save(filename.str().c_str(), mesh);
-      }
-      catch(std::exception& e)
-      {
-        throw IOCalculationContinuityException(CalculationContinuityException::meshes, IOCalculationContinuityException::output, filename.str().c_str(), e.what());
-      }
+      Hermes::vector<Mesh*> meshes;
+      meshes.push_back(mesh);
+      this->save_meshes(meshes);
     }
 
     template<typename Scalar>
     void CalculationContinuity<Scalar>::Record::save_spaces(Hermes::vector<Space<Scalar>*> spaces)
     {
+      this->binary = true;
+      this->spaceFiles.clear();
       for(unsigned int i = 0; i < spaces.size(); i++)
       {
-        std::stringstream filename;
-        filename << CalculationContinuity<Scalar>::space_file_name << i << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
+        std::string filename = this->get_file_name(CalculationContinuity<Scalar>::space_file_name, i);
         try
         {
-          spaces[i]->save(filename.str().c_str());
+          if(!spaces[i]->save_binary(filename.c_str()))
+            throw Exceptions::Exception("This type of space can not be saved.");
         }
         catch(std::exception& e)
         {
-          throw IOCalculationContinuityException(CalculationContinuityException::spaces, IOCalculationContinuityException::output, filename.str().c_str(), e.what());
+          throw IOCalculationContinuityException(CalculationContinuityException::spaces, IOCalculationContinuityException::output, filename.c_str(), e.what());
         }
+        this->spaceFiles.push_back(filename);
       }
+      this->save_manifest();
     }
 
     template<typename Scalar>
     void CalculationContinuity<Scalar>::Record::save_space(Space<Scalar>* space)
     {
-      std::stringstream filename;
-      filename << CalculationContinuity<Scalar>::space_file_name << 0 << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
-      try
-      {
-        space->save(filename.str().c_str());
-      }
-      catch(std::exception& e)
-      {
-        throw IOCalculationContinuityException(CalculationContinuityException::spaces, IOCalculationContinuityException::output, filename.str().c_str(), e.what());
-      }
+      Hermes::vector<Space<Scalar>*> spaces;
+      spaces.push_back(space);
+      this->save_spaces(spaces);
     }
 
     template<typename Scalar>
     void CalculationContinuity<Scalar>::Record::save_solutions(Hermes::vector<Solution<Scalar>*> solutions)
     {
+      this->binary = true;
+      this->solutionFiles.clear();
       for(unsigned int i = 0; i < solutions.size(); i++)
       {
-        std::stringstream filename;
-        filename << CalculationContinuity<Scalar>::solution_file_name << i << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
-
+        std::string filename = this->get_file_name(CalculationContinuity<Scalar>::solution_file_name, i);
         try
         {
-          solutions[i]->save(filename.str().c_str());
+          solutions[i]->save_binary(filename.c_str());
         }
-        catch(Hermes::Exceptions::SolutionSaveFailureException& e)
+        catch(std::exception& e)
         {
-          throw IOCalculationContinuityException(CalculationContinuityException::solutions, IOCalculationContinuityException::output, filename.str().c_str(), e.what());
+          throw IOCalculationContinuityException(CalculationContinuityException::solutions, IOCalculationContinuityException::output, filename.c_str(), e.what());
         }
+        this->solutionFiles.push_back(filename);
       }
+      this->save_manifest();
     }
+
     template<typename Scalar>
     void CalculationContinuity<Scalar>::Record::save_solution(Solution<Scalar>* solution)
     {
-      std::stringstream filename;
-      filename << CalculationContinuity<Scalar>::solution_file_name << 0 << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
-      try
-      {
-        solution->save(filename.str().c_str());
-      }
-      catch(Hermes::Exceptions::SolutionSaveFailureException& e)
-      {
-        throw IOCalculationContinuityException(CalculationContinuityException::solutions, IOCalculationContinuityException::output, filename.str().c_str(), e.what());
-      }
+      Hermes::vector<Solution<Scalar>*> solutions;
+      solutions.push_back(solution);
+      this->save_solutions(solutions);
     }
 
     template<typename Scalar>
     void CalculationContinuity<Scalar>::Record::save_time_step_length(double time_step_length_to_save)
     {
-      std::stringstream filename;
-      filename << CalculationContinuity<Scalar>::time_step_file_name << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
+      std::string filename = this->get_file_name(CalculationContinuity<Scalar>::time_step_file_name, -1);
       try
       {
-        std::ofstream out(filename.str().c_str());
+        std::ofstream out(filename.c_str());
         out << time_step_length_to_save;
         out.close();
       }
       catch(std::exception& e)
       {
-        throw IOCalculationContinuityException(CalculationContinuityException::time_steps, IOCalculationContinuityException::output, filename.str().c_str(), e.what());
+        throw IOCalculationContinuityException(CalculationContinuityException::time_steps, IOCalculationContinuityException::output, filename.c_str(), e.what());
       }
     }
 
     template<typename Scalar>
     void CalculationContinuity<Scalar>::Record::save_time_step_length_n_minus_one(double time_step_length_to_save)
     {
-      std::stringstream filename;
-      filename << CalculationContinuity<Scalar>::time_stepNMinusOne_file_name << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
+      std::string filename = this->get_file_name(CalculationContinuity<Scalar>::time_stepNMinusOne_file_name, -1);
       try
       {
-        std::ofstream out(filename.str().c_str());
+        std::ofstream out(filename.c_str());
         out << time_step_length_to_save;
         out.close();
       }
       catch(std::exception& e)
       {
-        throw IOCalculationContinuityException(CalculationContinuityException::time_steps, IOCalculationContinuityException::output, filename.str().c_str(), e.what());
+        throw IOCalculationContinuityException(CalculationContinuityException::time_steps, IOCalculationContinuityException::output, filename.c_str(), e.what());
       }
     }
 
     template<typename Scalar>
     void CalculationContinuity<Scalar>::Record::save_error(double error)
     {
-      std::stringstream filename;
-      filename << CalculationContinuity<Scalar>::error_file_name << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
+      std::string filename = this->get_file_name(CalculationContinuity<Scalar>::error_file_name, -1);
       try
       {
-        std::ofstream out(filename.str().c_str());
+        std::ofstream out(filename.c_str());
         out << error;
         out.close();
       }
       catch(std::exception& e)
       {
-        throw IOCalculationContinuityException(CalculationContinuityException::error, IOCalculationContinuityException::output, filename.str().c_str(), e.what());
+        throw IOCalculationContinuityException(CalculationContinuityException::error, IOCalculationContinuityException::output, filename.c_str(), e.what());
       }
     }
 
     template<typename Scalar>
     void CalculationContinuity<Scalar>::Record::load_meshes(Hermes::vector<Mesh*> meshes)
     {
-      MeshReaderH2DXML reader;
       for(unsigned int i = 0; i < meshes.size(); i++)
       {
-        std::stringstream filename;
-        filename << CalculationContinuity<Scalar>::mesh_file_name << i << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
+        std::string filename = this->binary ? (i < this->meshFiles.size() ? this->meshFiles[i] : "") : this->get_file_name(CalculationContinuity<Scalar>::mesh_file_name, i);
         try
         {
-          reader.load(filename.str().c_str(), meshes[i]);
+          if(!this->binary)
+          {
+            MeshReaderH2DXML reader;
+            reader.load(filename.c_str(), meshes[i]);
+          }
+          else if(i < this->meshFiles.size())
+          {
+            MeshReaderH2DBinary reader;
+            reader.load(filename.c_str(), meshes[i]);
+          }
+          else
+            throw Exceptions::MeshLoadFailureException("The record contains %d meshes only.", (int)this->meshFiles.size());
         }
         catch(Hermes::Exceptions::MeshLoadFailureException& e)
         {
-          throw IOCalculationContinuityException(CalculationContinuityException::meshes, IOCalculationContinuityException::input, filename.str().c_str(), e.what());
+          throw IOCalculationContinuityException(CalculationContinuityException::meshes, IOCalculationContinuityException::input, filename.c_str(), e.what());
         }
       }
     }
+
     template<typename Scalar>
     void CalculationContinuity<Scalar>::Record::load_mesh(Mesh* mesh)
     {
-      MeshReaderH2DXML reader;
-      std::stringstream filename;
-      filename << CalculationContinuity<Scalar>::mesh_file_name << 0 << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
-
-      try
-      {
-        reader.load(filename.str().c_str(), mesh);
-      }
-      catch(Hermes::Exceptions::MeshLoadFailureException& e)
-      {
-        throw IOCalculationContinuityException(CalculationContinuityException::meshes, IOCalculationContinuityException::input, filename.str().c_str(), e.what());
-      }
+      Hermes::vector<Mesh*> meshes;
+      meshes.push_back(mesh);
+      this->load_meshes(meshes);
     }
 
     template<typename Scalar>
     Hermes::vector<Space<Scalar>*> CalculationContinuity<Scalar>::Record::load_spaces(Hermes::vector<Mesh*> meshes, Hermes::vector<EssentialBCs<Scalar>*> essential_bcs, Hermes::vector<Shapeset*> shapesets)
     {
-			Hermes::vector<Space<Scalar>*> spaces;
+      Hermes::vector<Space<Scalar>*> spaces;
 
-			if(shapesets == Hermes::vector<Shapeset*>())
+      if(shapesets == Hermes::vector<Shapeset*>())
         for(unsigned int i = 0; i < meshes.size(); i++)
           shapesets.push_back(NULL);
 
       for(unsigned int i = 0; i < meshes.size(); i++)
-      {
-        std::stringstream filename;
-        filename << CalculationContinuity<Scalar>::space_file_name << i << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
-
-        try
-        {
-          spaces.push_back(Space<Scalar>::load(filename.str().c_str(), meshes[i], false, essential_bcs[i], shapesets[i]));
-        }
-        catch(Hermes::Exceptions::SpaceLoadFailureException& e)
-        {
-          throw IOCalculationContinuityException(CalculationContinuityException::spaces, IOCalculationContinuityException::input, filename.str().c_str(), e.what());
-        }
-        catch(std::exception& e)
-        {
-          throw IOCalculationContinuityException(CalculationContinuityException::spaces, IOCalculationContinuityException::input, filename.str().c_str(), e.what());
-        }
-      }
+        spaces.push_back(this->load_space_index(i, meshes[i], essential_bcs[i], shapesets[i]));
 
       return spaces;
     }
@@ -590,30 +851,14 @@ namespace Hermes
     template<typename Scalar>
     Hermes::vector<Space<Scalar>*> CalculationContinuity<Scalar>::Record::load_spaces(Hermes::vector<Mesh*> meshes, Hermes::vector<Shapeset*> shapesets)
     {
-			Hermes::vector<Space<Scalar>*> spaces;
+      Hermes::vector<Space<Scalar>*> spaces;
 
       if(shapesets == Hermes::vector<Shapeset*>())
         for(unsigned int i = 0; i < meshes.size(); i++)
           shapesets.push_back(NULL);
 
       for(unsigned int i = 0; i < meshes.size(); i++)
-      {
-        std::stringstream filename;
-        filename << CalculationContinuity<Scalar>::space_file_name << i << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
-
-        try
-        {
-          spaces.push_back(Space<Scalar>::load(filename.str().c_str(), meshes[i], false, NULL, shapesets[i]));
-        }
-        catch(Hermes::Exceptions::SpaceLoadFailureException& e)
-        {
-          throw IOCalculationContinuityException(CalculationContinuityException::spaces, IOCalculationContinuityException::input, filename.str().c_str(), e.what());
-        }
-        catch(std::exception& e)
-        {
-          throw IOCalculationContinuityException(CalculationContinuityException::spaces, IOCalculationContinuityException::input, filename.str().c_str(), e.what());
-        }
-      }
+        spaces.push_back(this->load_space_index(i, meshes[i], NULL, shapesets[i]));
 
       return spaces;
     }
@@ -621,20 +866,28 @@ namespace Hermes
     template<typename Scalar>
     Space<Scalar>* CalculationContinuity<Scalar>::Record::load_space(Mesh* mesh, EssentialBCs<Scalar>* essential_bcs, Shapeset* shapeset)
     {
-      std::stringstream filename;
-      filename << CalculationContinuity<Scalar>::space_file_name << 0 << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
+      return this->load_space_index(0, mesh, essential_bcs, shapeset);
+    }
 
+    template<typename Scalar>
+    Space<Scalar>* CalculationContinuity<Scalar>::Record::load_space_index(unsigned int index, Mesh* mesh, EssentialBCs<Scalar>* essential_bcs, Shapeset* shapeset)
+    {
+      std::string filename = this->binary ? (index < this->spaceFiles.size() ? this->spaceFiles[index] : "") : this->get_file_name(CalculationContinuity<Scalar>::space_file_name, index);
       try
       {
-        return Space<Scalar>::load(filename.str().c_str(), mesh, false, essential_bcs, shapeset);
+        if(!this->binary)
+          return Space<Scalar>::load(filename.c_str(), mesh, false, essential_bcs, shapeset);
+        if(index >= this->spaceFiles.size())
+          throw Exceptions::SpaceLoadFailureException("The record contains %d spaces only.", (int)this->spaceFiles.size());
+        return Space<Scalar>::load_binary(filename.c_str(), mesh, essential_bcs, shapeset);
       }
       catch(Hermes::Exceptions::SpaceLoadFailureException& e)
       {
-        throw IOCalculationContinuityException(CalculationContinuityException::spaces, IOCalculationContinuityException::input, filename.str().c_str(), e.what());
+        throw IOCalculationContinuityException(CalculationContinuityException::spaces, IOCalculationContinuityException::input, filename.c_str(), e.what());
       }
       catch(std::exception& e)
       {
-        throw IOCalculationContinuityException(CalculationContinuityException::spaces, IOCalculationContinuityException::input, filename.str().c_str(), e.what());
+        throw IOCalculationContinuityException(CalculationContinuityException::spaces, IOCalculationContinuityException::input, filename.c_str(), e.what());
       }
     }
 
@@ -645,91 +898,83 @@ namespace Hermes
         throw Exceptions::LengthException(1, 2, solutions.size(), spaces.size());
       for(unsigned int i = 0; i < solutions.size(); i++)
       {
-        std::stringstream filename;
-        filename << CalculationContinuity<Scalar>::solution_file_name << i << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
+        std::string filename = this->binary ? (i < this->solutionFiles.size() ? this->solutionFiles[i] : "") : this->get_file_name(CalculationContinuity<Scalar>::solution_file_name, i);
         try
         {
-          solutions[i]->load(filename.str().c_str(), spaces[i]);
+          if(!this->binary)
+            solutions[i]->load(filename.c_str(), spaces[i]);
+          else if(i < this->solutionFiles.size())
+            solutions[i]->load_binary(filename.c_str(), spaces[i]);
+          else
+            throw Exceptions::SolutionLoadFailureException("The record contains %d solutions only.", (int)this->solutionFiles.size());
           solutions[i]->space_type = spaces[i]->get_type();
         }
         catch(Hermes::Exceptions::SolutionLoadFailureException& e)
         {
-          throw IOCalculationContinuityException(CalculationContinuityException::solutions, IOCalculationContinuityException::input, filename.str().c_str(), e.what());
+          throw IOCalculationContinuityException(CalculationContinuityException::solutions, IOCalculationContinuityException::input, filename.c_str(), e.what());
         }
         catch(std::exception& e)
         {
-          throw IOCalculationContinuityException(CalculationContinuityException::solutions, IOCalculationContinuityException::input, filename.str().c_str(), e.what());
+          throw IOCalculationContinuityException(CalculationContinuityException::solutions, IOCalculationContinuityException::input, filename.c_str(), e.what());
         }
       }
     }
+
     template<typename Scalar>
     void CalculationContinuity<Scalar>::Record::load_solution(Solution<Scalar>* solution, Space<Scalar>* space)
     {
-      std::stringstream filename;
-      filename << CalculationContinuity<Scalar>::solution_file_name << 0 << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
-      try
-      {
-        solution->load(filename.str().c_str(), space);
-        solution->space_type = space->get_type();
-      }
-      catch(Hermes::Exceptions::SolutionLoadFailureException& e)
-      {
-        throw IOCalculationContinuityException(CalculationContinuityException::solutions, IOCalculationContinuityException::input, filename.str().c_str(), e.what());
-      }
-      catch(std::exception& e)
-      {
-        throw IOCalculationContinuityException(CalculationContinuityException::solutions, IOCalculationContinuityException::input, filename.str().c_str(), e.what());
-      }
+      Hermes::vector<Solution<Scalar>*> solutions;
+      solutions.push_back(solution);
+      Hermes::vector<Space<Scalar>*> spaces;
+      spaces.push_back(space);
+      this->load_solutions(solutions, spaces);
     }
 
     template<typename Scalar>
     void CalculationContinuity<Scalar>::Record::load_time_step_length(double & time_step_length)
     {
-      std::stringstream filename;
-      filename << CalculationContinuity<Scalar>::time_step_file_name << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
+      std::string filename = this->get_file_name(CalculationContinuity<Scalar>::time_step_file_name, -1);
       try
       {
-        std::ifstream in(filename.str().c_str());
+        std::ifstream in(filename.c_str());
         in >> time_step_length;
         in.close();
       }
       catch(std::exception& e)
       {
-        throw IOCalculationContinuityException(CalculationContinuityException::time_steps, IOCalculationContinuityException::input, filename.str().c_str(), e.what());
+        throw IOCalculationContinuityException(CalculationContinuityException::time_steps, IOCalculationContinuityException::input, filename.c_str(), e.what());
       }
     }
 
     template<typename Scalar>
     void CalculationContinuity<Scalar>::Record::load_time_step_length_n_minus_one(double & time_step_length)
     {
-      std::stringstream filename;
-      filename << CalculationContinuity<Scalar>::time_stepNMinusOne_file_name << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
+      std::string filename = this->get_file_name(CalculationContinuity<Scalar>::time_stepNMinusOne_file_name, -1);
       try
       {
-        std::ifstream in(filename.str().c_str());
+        std::ifstream in(filename.c_str());
         in >> time_step_length;
         in.close();
       }
       catch(std::exception& e)
       {
-        throw IOCalculationContinuityException(CalculationContinuityException::time_steps, IOCalculationContinuityException::input, filename.str().c_str(), e.what());
+        throw IOCalculationContinuityException(CalculationContinuityException::time_steps, IOCalculationContinuityException::input, filename.c_str(), e.what());
       }
     }
 
     template<typename Scalar>
     void CalculationContinuity<Scalar>::Record::load_error(double & error)
     {
-      std::stringstream filename;
-      filename << CalculationContinuity<Scalar>::error_file_name << '_' << (std::string)"t = " << this->time << (std::string)"n = " << this->number << (std::string)".h2d";
+      std::string filename = this->get_file_name(CalculationContinuity<Scalar>::error_file_name, -1);
       try
       {
-        std::ifstream in(filename.str().c_str());
+        std::ifstream in(filename.c_str());
         in >> error;
         in.close();
       }
       catch(std::exception& e)
       {
-        throw IOCalculationContinuityException(CalculationContinuityException::error, IOCalculationContinuityException::input, filename.str().c_str(), e.what());
+        throw IOCalculationContinuityException(CalculationContinuityException::error, IOCalculationContinuityException::input, filename.c_str(), e.what());
       }
     }
 
@@ -762,6 +1007,9 @@ namespace Hermes
     template<typename Scalar>
     std::string CalculationContinuity<Scalar>::error_file_name = "Error_";
 
+    template<typename Scalar>
+    std::string CalculationContinuity<Scalar>::record_file_name = "Record";
+
     template<typename Scalar>
     void CalculationContinuity<Scalar>::set_mesh_file_name(std::string mesh_file_nameToSet)
     {
@@ -787,6 +1035,11 @@ namespace Hermes
     {
       error_file_name = error_file_nameToSet;
     }
+    template<typename Scalar>
+    void CalculationContinuity<Scalar>::set_record_file_name(std::string record_file_nameToSet)
+    {
+      record_file_name = record_file_nameToSet;
+    }
 
     template class HERMES_API CalculationContinuity<double>;
     template class HERMES_API CalculationContinuity<std::complex<double> >;
@@ -86,6 +86,9 @@ namespace Hermes
 
       // Matrix<Scalar> related settings.
       have_matrix = false;
+      structure_col_ptr = structure_row_idx = NULL;
+      structure_sp_seq = structure_first_dofs = structure_sp_ndof = NULL;
+      structure_ndof = 0;
 
       // There is a special function that sets a DiscreteProblem to be FVM.
       // Purpose is that this constructor looks cleaner and is simpler.
@@ -106,6 +109,23 @@ namespace Hermes
       cache_element_stored = NULL;
 
       this->do_not_use_cache = false;
+      this->cache_quad_2d = NULL;
+      this->cache_quad_2d_changed = false;
+
+      this->assembly_profiling = false;
+      this->assembly_profiles = NULL;
+      this->assembly_profiles_count = 0;
+
+      this->DG_first_states = NULL;
+      this->DG_first_states_count = 0;
+
+      this->DG_npss = NULL;
+      this->DG_nspss = NULL;
+      this->DG_nrefmaps = NULL;
+
+      this->order_memo = NULL;
+      this->order_memo_keys = NULL;
+      this->order_memo_count = 0;
 
       this->spaces_size = 0;
 
@@ -122,10 +142,10 @@ namespace Hermes
         return false;
 
       // Initial check of meshes and spaces.
-      for(unsigned int space_i = 0; space_i < this->spaces_size; space_i++)
+      for(int space_i = 0; space_i < this->spaces_size; space_i++)
         this->spaces[space_i]->check();
 
-      for(unsigned int space_i = 0; space_i < this->spaces_size; space_i++)
+      for(int space_i = 0; space_i < this->spaces_size; space_i++)
         if(!this->spaces[space_i]->is_up_to_date())
           throw Exceptions::Exception("Space is out of date, if you manually refine it, you have to call assign_dofs().");
 
@@ -158,6 +178,9 @@ namespace Hermes
 
       // Matrix<Scalar> related settings.
       have_matrix = false;
+      structure_col_ptr = structure_row_idx = NULL;
+      structure_sp_seq = structure_first_dofs = structure_sp_ndof = NULL;
+      structure_ndof = 0;
 
       // There is a special function that sets a DiscreteProblem to be FVM.
       // Purpose is that this constructor looks cleaner and is simpler.
@@ -204,6 +227,23 @@ namespace Hermes
       cache_element_stored = NULL;
 
       this->do_not_use_cache = false;
+      this->cache_quad_2d = NULL;
+      this->cache_quad_2d_changed = false;
+
+      this->assembly_profiling = false;
+      this->assembly_profiles = NULL;
+      this->assembly_profiles_count = 0;
+
+      this->DG_first_states = NULL;
+      this->DG_first_states_count = 0;
+
+      this->DG_npss = NULL;
+      this->DG_nspss = NULL;
+      this->DG_nrefmaps = NULL;
+
+      this->order_memo = NULL;
+      this->order_memo_keys = NULL;
+      this->order_memo_count = 0;
     }
 
     template<typename Scalar>
@@ -231,7 +271,67 @@ namespace Hermes
 
       if(sp_seq != NULL) delete [] sp_seq;
 
+      free_sparse_structure();
+
       this->delete_cache();
+
+      if(this->assembly_profiles != NULL)
+        delete [] this->assembly_profiles;
+
+      this->free_DG_first_states();
+
+      this->free_order_memo();
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::set_assembly_profiling(bool to_set)
+    {
+      this->assembly_profiling = to_set;
+    }
+
+    template<typename Scalar>
+    double DiscreteProblem<Scalar>::get_assembly_time(AssemblyPhase phase) const
+    {
+      if(phase < 0 || phase >= AssemblyPhaseCount)
+        throw Exceptions::ValueException("phase", phase, 0, AssemblyPhaseCount - 1);
+      double time = 0.0;
+      for(int thread_i = 0; thread_i < this->assembly_profiles_count; thread_i++)
+        time += this->assembly_profiles[thread_i].times[phase];
+      return time;
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::init_assembly_profiling()
+    {
+      if(this->assembly_profiling)
+      {
+        if(this->assembly_profiles_count != Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads))
+        {
+          if(this->assembly_profiles != NULL)
+            delete [] this->assembly_profiles;
+          this->assembly_profiles_count = Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads);
+          this->assembly_profiles = new AssemblyProfile[this->assembly_profiles_count];
+        }
+        for(int thread_i = 0; thread_i < this->assembly_profiles_count; thread_i++)
+        {
+          this->assembly_profiles[thread_i].phase = AssemblyPhaseCount;
+          memset(this->assembly_profiles[thread_i].times, 0, sizeof(double) * AssemblyPhaseCount);
+        }
+      }
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::tick_assembly_phase(int phase)
+    {
+      AssemblyProfile& profile = this->assembly_profiles[omp_get_thread_num()];
+      if(profile.phase == AssemblyPhaseCount)
+        profile.timer.tick(Hermes::Mixins::TimeMeasurable::HERMES_SKIP);
+      else
+      {
+        profile.timer.tick();
+        profile.times[profile.phase] += profile.timer.last();
+      }
+      profile.phase = phase;
     }
 
     template<typename Scalar>
@@ -719,7 +819,12 @@ namespace Hermes
         }
       }
 
-      if(current_mat != NULL)
+      if(current_mat != NULL && !is_DG && patch_sparse_structure())
+      {
+        // Spaces have changed only locally: the structure was patched.
+        have_matrix = true;
+      }
+      else if(current_mat != NULL)
       {
         // Spaces have changed: create the matrix from scratch.
         have_matrix = true;
@@ -746,6 +851,10 @@ namespace Hermes
             spaces_first_dofs[i] = 0;
           }
           Space<Scalar>::assign_dofs(mutable_spaces);
+
+          // The neighbors across the edges are searched once per mesh.
+          for (unsigned int i = 0; i < wf->get_neq(); i++)
+            meshes[i]->update_face_connectivity();
         }
 
         Traverse::State* current_state;
@@ -862,7 +971,10 @@ namespace Hermes
         delete [] meshes;
         delete [] blocks;
 
-        current_mat->alloc();
+        if(is_DG)
+          current_mat->alloc();
+        else
+          store_sparse_structure();
       }
 
       // WARNING: unlike Matrix<Scalar>::alloc(), Vector<Scalar>::alloc(ndof) frees the memory occupied
@@ -875,6 +987,227 @@ namespace Hermes
         sp_seq[i] = spaces[i]->get_seq();
     }
 
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::free_sparse_structure()
+    {
+      delete [] structure_col_ptr;
+      delete [] structure_row_idx;
+      delete [] structure_sp_seq;
+      delete [] structure_first_dofs;
+      delete [] structure_sp_ndof;
+      structure_col_ptr = structure_row_idx = NULL;
+      structure_sp_seq = structure_first_dofs = structure_sp_ndof = NULL;
+      structure_ndof = 0;
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::store_sparse_structure()
+    {
+      free_sparse_structure();
+
+      bool incremental = false;
+      for (unsigned int i = 0; i < wf->get_neq(); i++)
+        if(spaces[i]->incremental_dof_assignment)
+          incremental = true;
+      if(!incremental)
+      {
+        current_mat->alloc();
+        return;
+      }
+
+      current_mat->extract_structure(structure_col_ptr, structure_row_idx);
+      current_mat->alloc_with_structure(this->ndof, structure_col_ptr, structure_row_idx);
+
+      structure_ndof = this->ndof;
+      structure_force_diagonal_blocks = current_force_diagonal_blocks;
+      structure_sp_seq = new int[wf->get_neq()];
+      structure_first_dofs = new int[wf->get_neq()];
+      structure_sp_ndof = new int[wf->get_neq()];
+      for (unsigned int i = 0; i < wf->get_neq(); i++)
+      {
+        structure_sp_seq[i] = spaces[i]->get_seq();
+        structure_first_dofs[i] = spaces_first_dofs[i];
+        structure_sp_ndof[i] = spaces[i]->get_num_dofs();
+      }
+    }
+
+    template<typename Scalar>
+    bool DiscreteProblem<Scalar>::patch_sparse_structure()
+    {
+      if(structure_col_ptr == NULL || structure_force_diagonal_blocks != current_force_diagonal_blocks)
+        return false;
+
+      // every space has to be either unchanged, or reassigned incrementally
+      // right from the assignment the stored structure belongs to
+      for (unsigned int i = 0; i < wf->get_neq(); i++)
+      {
+        const Space<Scalar>* space = spaces[i];
+        if(space->first_dof != 0 || space->stride != 1)
+          return false;
+        if(space->get_seq() == structure_sp_seq[i])
+          continue;
+        if(space->dof_map == NULL || space->dof_map_seq != structure_sp_seq[i] || space->dof_map_size != structure_sp_ndof[i])
+          return false;
+      }
+
+      // the new numbering of the system
+      int new_ndof = 0;
+      int* first_dofs = new int[wf->get_neq()];
+      for (unsigned int i = 0; i < wf->get_neq(); i++)
+      {
+        first_dofs[i] = new_ndof;
+        new_ndof += spaces[i]->get_num_dofs();
+      }
+
+      // old-to-new map of the whole system
+      int* old_to_new = new int[structure_ndof + 1];
+      for (unsigned int i = 0; i < wf->get_neq(); i++)
+      {
+        bool unchanged = (spaces[i]->get_seq() == structure_sp_seq[i]);
+        for (int j = 0; j < structure_sp_ndof[i]; j++)
+        {
+          int dof = unchanged ? j : spaces[i]->dof_map[j];
+          old_to_new[structure_first_dofs[i] + j] = (dof < 0) ? -1 : first_dofs[i] + dof;
+        }
+      }
+
+      // gather the entries of the states with a changed element
+      AsmList<Scalar>* al = new AsmList<Scalar>[wf->get_neq()];
+      const Mesh** meshes = new const Mesh*[wf->get_neq()];
+      bool **blocks = wf->get_blocks(current_force_diagonal_blocks);
+      for (unsigned int i = 0; i < wf->get_neq(); i++)
+        meshes[i] = spaces[i]->get_mesh();
+
+      Hermes::vector<int> patch_rows, patch_cols;
+      Traverse trav(true);
+      trav.begin(wf->get_neq(), meshes);
+      Traverse::State* current_state;
+      while ((current_state = trav.get_next_state()) != NULL)
+      {
+        bool changed = false;
+        for (unsigned int i = 0; i < wf->get_neq(); i++)
+        {
+          Element* e = current_state->e[i];
+          if(e == NULL)
+            continue;
+          if(spaces[i]->get_seq() != structure_sp_seq[i] && spaces[i]->changed_elements[e->id])
+            changed = true;
+        }
+        if(!changed)
+          continue;
+
+        for (unsigned int i = 0; i < wf->get_neq(); i++)
+          if(current_state->e[i] != NULL)
+            spaces[i]->get_element_assembly_list(current_state->e[i], &(al[i]), first_dofs[i]);
+
+        for (unsigned int m = 0; m < wf->get_neq(); m++)
+          for (unsigned int n = 0; n < wf->get_neq(); n++)
+            if(blocks[m][n] && current_state->e[m] != NULL && current_state->e[n] != NULL)
+              for (unsigned int i = 0; i < al[m].cnt; i++)
+                if(al[m].dof[i] >= 0)
+                  for (unsigned int j = 0; j < al[n].cnt; j++)
+                    if(al[n].dof[j] >= 0)
+                    {
+                      patch_rows.push_back(al[m].dof[i]);
+                      patch_cols.push_back(al[n].dof[j]);
+                    }
+      }
+      trav.finish();
+      delete [] al;
+      delete [] meshes;
+      delete [] blocks;
+
+      // sort the gathered entries by columns
+      int* patch_ptr = new int[new_ndof + 1];
+      memset(patch_ptr, 0, sizeof(int) * (new_ndof + 1));
+      for (unsigned int i = 0; i < patch_cols.size(); i++)
+        patch_ptr[patch_cols[i] + 1]++;
+      for (int i = 0; i < new_ndof; i++)
+        patch_ptr[i + 1] += patch_ptr[i];
+      int* patch_idx = new int[patch_cols.size() + 1];
+      int* fill = new int[new_ndof + 1];
+      memcpy(fill, patch_ptr, sizeof(int) * (new_ndof + 1));
+      for (unsigned int i = 0; i < patch_cols.size(); i++)
+        patch_idx[fill[patch_cols[i]]++] = patch_rows[i];
+
+      // the new structure: the renumbered old columns plus the gathered entries
+      int* new_to_old = fill;
+      for (int i = 0; i < new_ndof; i++)
+        new_to_old[i] = -1;
+      for (int i = 0; i < structure_ndof; i++)
+        if(old_to_new[i] >= 0)
+          new_to_old[old_to_new[i]] = i;
+
+      int* col_ptr = new int[new_ndof + 1];
+      col_ptr[0] = 0;
+      for (int col = 0; col < new_ndof; col++)
+      {
+        int count = patch_ptr[col + 1] - patch_ptr[col];
+        if(new_to_old[col] >= 0)
+          count += structure_col_ptr[new_to_old[col] + 1] - structure_col_ptr[new_to_old[col]];
+        col_ptr[col + 1] = col_ptr[col] + count;
+      }
+      int* row_idx = new int[col_ptr[new_ndof] + 1];
+      int pos = 0;
+      for (int col = 0; col < new_ndof; col++)
+      {
+        int start = pos;
+        bool sorted = true;
+        int old_col = new_to_old[col];
+        if(old_col >= 0)
+          for (int i = structure_col_ptr[old_col]; i < structure_col_ptr[old_col + 1]; i++)
+          {
+            int row = old_to_new[structure_row_idx[i]];
+            if(row < 0)
+              continue;
+            if(pos > start && row < row_idx[pos - 1])
+              sorted = false;
+            row_idx[pos++] = row;
+          }
+        if(patch_ptr[col + 1] > patch_ptr[col])
+        {
+          memcpy(row_idx + pos, patch_idx + patch_ptr[col], sizeof(int) * (patch_ptr[col + 1] - patch_ptr[col]));
+          pos += patch_ptr[col + 1] - patch_ptr[col];
+          sorted = false;
+        }
+
+        // sort the indices and remove duplicities
+        if(!sorted)
+        {
+          std::sort(row_idx + start, row_idx + pos);
+          pos = start + (std::unique(row_idx + start, row_idx + pos) - (row_idx + start));
+        }
+        col_ptr[col] = start;
+      }
+      col_ptr[new_ndof] = pos;
+
+      delete [] patch_ptr;
+      delete [] patch_idx;
+      delete [] fill;
+      delete [] old_to_new;
+
+      // replace the stored structure, allocate the matrix
+      delete [] structure_col_ptr;
+      delete [] structure_row_idx;
+      structure_col_ptr = col_ptr;
+      structure_row_idx = row_idx;
+      structure_ndof = new_ndof;
+      for (unsigned int i = 0; i < wf->get_neq(); i++)
+      {
+        structure_sp_seq[i] = spaces[i]->get_seq();
+        structure_first_dofs[i] = first_dofs[i];
+        structure_sp_ndof[i] = spaces[i]->get_num_dofs();
+        spaces_first_dofs[i] = first_dofs[i];
+      }
+      delete [] first_dofs;
+      this->ndof = new_ndof;
+
+      current_mat->free();
+      current_mat->alloc_with_structure(new_ndof, structure_col_ptr, structure_row_idx);
+
+      return true;
+    }
+
     template<typename Scalar>
     void DiscreteProblem<Scalar>::assemble(SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs,
       bool force_diagonal_blocks, Table* block_weights)
@@ -893,17 +1226,28 @@ namespace Hermes
     template<typename Scalar>
     void DiscreteProblem<Scalar>::init_assembling(Scalar* coeff_vec, PrecalcShapeset*** pss , PrecalcShapeset*** spss, RefMap*** refmaps, Solution<Scalar>*** u_ext, AsmList<Scalar>*** als, WeakForm<Scalar>** weakforms)
     {
+      this->cache_quad_2d_changed = (this->cache_quad_2d != NULL && this->cache_quad_2d != this->wf->get_quad_2d());
+      this->cache_quad_2d = this->wf->get_quad_2d();
+
+      this->init_assembly_profiling();
+
       for(unsigned int i = 0; i < Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads); i++)
       {
         pss[i] = new PrecalcShapeset*[wf->get_neq()];
         for (unsigned int j = 0; j < wf->get_neq(); j++)
+        {
           pss[i][j] = new PrecalcShapeset(spaces[j]->shapeset);
+          pss[i][j]->set_quad_2d(this->wf->get_quad_2d());
+        }
       }
       for(unsigned int i = 0; i < Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads); i++)
       {
         spss[i] = new PrecalcShapeset*[wf->get_neq()];
         for (unsigned int j = 0; j < wf->get_neq(); j++)
+        {
           spss[i][j] = new PrecalcShapeset(pss[i][j]);
+          spss[i][j]->set_quad_2d(this->wf->get_quad_2d());
+        }
       }
       for(unsigned int i = 0; i < Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads); i++)
       {
@@ -911,7 +1255,7 @@ namespace Hermes
         for (unsigned int j = 0; j < wf->get_neq(); j++)
         {
           refmaps[i][j] = new RefMap();
-          refmaps[i][j]->set_quad_2d(&g_quad_2d_std);
+          refmaps[i][j]->set_quad_2d(this->wf->get_quad_2d());
         }
       }
 
@@ -934,11 +1278,9 @@ namespace Hermes
             }
             else
             {
+              // Each clone has its own element cache, so the threads do not need to synchronize on it.
               for (int j = 0; j < wf->get_neq(); j++)
-              {
-                u_ext[i][j] = new Solution<Scalar>(spaces[j]->get_mesh());
-                u_ext[i][j]->copy(u_ext[0][j]);
-              }
+                u_ext[i][j] = static_cast<Solution<Scalar>*>(u_ext[0][j]->clone());
             }
           }
           else
@@ -968,6 +1310,30 @@ namespace Hermes
           weakforms[i] = this->wf->clone();
           weakforms[i]->cloneMembers(this->wf);
         }
+        this->init_order_memo();
+
+        // Neighbor psss, refmaps for DG forms.
+        if(DG_matrix_forms_present)
+        {
+          DG_npss = new PrecalcShapeset**[Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads)];
+          DG_nspss = new PrecalcShapeset**[Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads)];
+          DG_nrefmaps = new RefMap**[Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads)];
+          for(unsigned int i = 0; i < Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads); i++)
+          {
+            DG_npss[i] = new PrecalcShapeset*[wf->get_neq()];
+            DG_nspss[i] = new PrecalcShapeset*[wf->get_neq()];
+            DG_nrefmaps[i] = new RefMap*[wf->get_neq()];
+            for (unsigned int j = 0; j < wf->get_neq(); j++)
+            {
+              DG_npss[i][j] = new PrecalcShapeset(spaces[j]->shapeset);
+              DG_npss[i][j]->set_quad_2d(this->wf->get_quad_2d());
+              DG_nspss[i][j] = new PrecalcShapeset(DG_npss[i][j]);
+              DG_nspss[i][j]->set_quad_2d(this->wf->get_quad_2d());
+              DG_nrefmaps[i][j] = new RefMap();
+              DG_nrefmaps[i][j]->set_quad_2d(this->wf->get_quad_2d());
+            }
+          }
+        }
 
         assert(cache_element_stored == NULL);
         cache_element_stored = new bool*[this->spaces_size];
@@ -1034,6 +1400,28 @@ namespace Hermes
       }
       delete [] weakforms;
 
+      if(DG_npss != NULL)
+      {
+        for(unsigned int i = 0; i < Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads); i++)
+        {
+          for (unsigned int j = 0; j < wf->get_neq(); j++)
+          {
+            delete DG_nspss[i][j];
+            delete DG_npss[i][j];
+            delete DG_nrefmaps[i][j];
+          }
+          delete [] DG_nspss[i];
+          delete [] DG_npss[i];
+          delete [] DG_nrefmaps[i];
+        }
+        delete [] DG_nspss;
+        delete [] DG_npss;
+        delete [] DG_nrefmaps;
+        DG_npss = NULL;
+        DG_nspss = NULL;
+        DG_nrefmaps = NULL;
+      }
+
       for(unsigned int i = 0; i < this->spaces_size; i++)
         delete [] cache_element_stored[i];
       delete [] cache_element_stored;
@@ -1095,6 +1483,14 @@ namespace Hermes
       for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
         meshes.push_back(spaces[space_i]->get_mesh());
 
+      // Ownership of the DG edges, the neighbors across the edges are searched once for all threads.
+      if(DG_matrix_forms_present || DG_vector_forms_present)
+      {
+        this->init_DG_first_states(meshes);
+        for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
+          spaces[space_i]->get_mesh()->update_face_connectivity();
+      }
+
       Traverse trav_master(true);
       unsigned int num_states = trav_master.get_num_states(meshes);
 
@@ -1109,7 +1505,7 @@ namespace Hermes
         for (unsigned j = 0; j < this->wf->ext.size(); j++)
         {
           fns[i].push_back(weakforms[i]->ext[j]);
-          weakforms[i]->ext[j]->set_quad_2d(&g_quad_2d_std);
+          weakforms[i]->ext[j]->set_quad_2d(this->wf->get_quad_2d());
         }
         for(unsigned int form_i = 0; form_i < this->wf->get_forms().size(); form_i++)
         {
@@ -1117,19 +1513,21 @@ namespace Hermes
             if(this->wf->get_forms()[form_i]->ext[ext_i] != NULL)
             {
               fns[i].push_back(weakforms[i]->get_forms()[form_i]->ext[ext_i]);
-              weakforms[i]->get_forms()[form_i]->ext[ext_i]->set_quad_2d(&g_quad_2d_std);
+              weakforms[i]->get_forms()[form_i]->ext[ext_i]->set_quad_2d(this->wf->get_quad_2d());
             }
         }
         for (unsigned j = 0; j < wf->get_neq(); j++)
         {
           fns[i].push_back(u_ext[i][j]);
-          u_ext[i][j]->set_quad_2d(&g_quad_2d_std);
+          u_ext[i][j]->set_quad_2d(this->wf->get_quad_2d());
         }
         trav[i].begin(meshes.size(), &(meshes.front()), &(fns[i].front()));
         trav[i].stack = trav_master.stack;
       }
 
       int state_i;
+      // The ordinal number of the next state in the traversal (the states are not taken in the order of state_i).
+      int next_state_ordinal = 0;
 
       PrecalcShapeset** current_pss;
       PrecalcShapeset** current_spss;
@@ -1140,21 +1538,24 @@ namespace Hermes
 
 #define CHUNKSIZE 1
       int num_threads_used = Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads);
-#pragma omp parallel shared(trav_master, mat, rhs ) private(state_i, current_pss, current_spss, current_refmaps, current_u_ext, current_als, current_weakform) num_threads(num_threads_used)
+#pragma omp parallel shared(trav_master, mat, rhs, next_state_ordinal) private(state_i, current_pss, current_spss, current_refmaps, current_u_ext, current_als, current_weakform) num_threads(num_threads_used)
       {
 #pragma omp for schedule(static, CHUNKSIZE)
         for(state_i = 0; state_i < num_states; state_i++)
         {
           if(this->caughtException != NULL)
             continue;
+          this->switch_assembly_phase(AssemblyTraversal);
           try
           {
             Traverse::State current_state;
+            int current_state_ordinal;
 #pragma omp critical (get_next_state)
             {
               try
               {
                 current_state = trav[omp_get_thread_num()].get_next_state(&trav_master.top, &trav_master.id);
+                current_state_ordinal = next_state_ordinal++;
               }
               catch(Hermes::Exceptions::Exception& e)
               {
@@ -1184,7 +1585,9 @@ namespace Hermes
             assemble_one_state(current_pss, current_spss, current_refmaps, current_u_ext, current_als, &current_state, current_weakform);
 
             if(DG_matrix_forms_present || DG_vector_forms_present)
-              assemble_one_DG_state(current_pss, current_spss, current_refmaps, current_als, &current_state, current_weakform->mfDG, current_weakform->vfDG, trav[omp_get_thread_num()].fn, current_weakform);
+              assemble_one_DG_state(current_pss, current_spss, current_refmaps,
+                DG_matrix_forms_present ? DG_npss[omp_get_thread_num()] : NULL, DG_matrix_forms_present ? DG_nspss[omp_get_thread_num()] : NULL, DG_matrix_forms_present ? DG_nrefmaps[omp_get_thread_num()] : NULL,
+                current_als, &current_state, current_state_ordinal, current_weakform->mfDG, current_weakform->vfDG, trav[omp_get_thread_num()].fn, current_weakform);
           }
           catch(Hermes::Exceptions::Exception& e)
           {
@@ -1196,6 +1599,7 @@ namespace Hermes
             if(this->caughtException == NULL)
               this->caughtException = new Hermes::Exceptions::Exception(e.what());
           }
+          this->switch_assembly_phase(AssemblyPhaseCount);
         }
       }
 
@@ -1218,14 +1622,6 @@ namespace Hermes
       if(current_rhs != NULL)
         current_rhs->finish();
 
-      if(DG_matrix_forms_present || DG_vector_forms_present)
-      {
-        Element* element_to_set_nonvisited;
-        for(unsigned int mesh_i = 0; mesh_i < meshes.size(); mesh_i++)
-          for_all_elements(element_to_set_nonvisited, meshes[mesh_i])
-          element_to_set_nonvisited->visited = false;
-      }
-
       if(this->caughtException != NULL)
         throw *(this->caughtException);
     }
@@ -1327,7 +1723,9 @@ namespace Hermes
     void DiscreteProblem<Scalar>::calculate_cache_records(PrecalcShapeset** current_pss, PrecalcShapeset** current_spss, RefMap** current_refmaps, Solution<Scalar>** current_u_ext, AsmList<Scalar>** current_als, Traverse::State* current_state,
       AsmList<Scalar>** current_alsSurface, WeakForm<Scalar>* current_wf)
     {
-      for(unsigned int space_i = 0; space_i < this->spaces_size; space_i++)
+      this->switch_assembly_phase(AssemblyBasis);
+
+      for(int space_i = 0; space_i < this->spaces_size; space_i++)
       {
         bool new_cache = false;
         if(current_state->e[space_i] == NULL)
@@ -1371,16 +1769,17 @@ namespace Hermes
           return;
       }
 
-      // Order calculation.
+      // Order calculation, the forms with their own quadrature are integrated without the cache records (assemble_form_own_quad()).
       int order = this->wf->global_integration_order_set ? this->wf->global_integration_order : 0;
       if(order == 0)
       {
+        this->switch_assembly_phase(AssemblyOrder);
         Hermes::vector<MatrixFormVol<Scalar>*> current_mfvol = current_wf->mfvol;
         Hermes::vector<VectorFormVol<Scalar>*> current_vfvol = current_wf->vfvol;
 
         for(int current_mfvol_i = 0; current_mfvol_i < current_mfvol.size(); current_mfvol_i++)
         {
-          if(!form_to_be_assembled(current_mfvol[current_mfvol_i], current_state))
+          if(!form_to_be_assembled(current_mfvol[current_mfvol_i], current_state) || current_mfvol[current_mfvol_i]->quad_2d != NULL)
             continue;
           current_mfvol[current_mfvol_i]->wf = current_wf;
           int orderTemp = calc_order_matrix_form(current_mfvol[current_mfvol_i], current_refmaps, current_u_ext, current_state);
@@ -1390,7 +1789,7 @@ namespace Hermes
 
         for(int current_vfvol_i = 0; current_vfvol_i < current_vfvol.size(); current_vfvol_i++)
         {
-          if(!form_to_be_assembled(current_vfvol[current_vfvol_i], current_state))
+          if(!form_to_be_assembled(current_vfvol[current_vfvol_i], current_state) || current_vfvol[current_vfvol_i]->quad_2d != NULL)
             continue;
           current_vfvol[current_vfvol_i]->wf = current_wf;
           int orderTemp = calc_order_vector_form(current_vfvol[current_vfvol_i], current_refmaps, current_u_ext, current_state);
@@ -1402,7 +1801,7 @@ namespace Hermes
         {
           for(int current_mfvol_i = 0; current_mfvol_i < current_mfvol.size(); current_mfvol_i++)
           {
-            if(!form_to_be_assembled(current_mfvol[current_mfvol_i], current_state))
+            if(!form_to_be_assembled(current_mfvol[current_mfvol_i], current_state) || current_mfvol[current_mfvol_i]->quad_2d != NULL)
               continue;
             current_mfvol[current_mfvol_i]->wf = current_wf;
             int orderTemp = calc_order_matrix_form(current_mfvol[current_mfvol_i], current_refmaps, current_u_ext, current_state);
@@ -1411,7 +1810,7 @@ namespace Hermes
           }
           for(int current_vfvol_i = 0; current_vfvol_i < current_vfvol.size(); current_vfvol_i++)
           {
-            if(!form_to_be_assembled(current_vfvol[current_vfvol_i], current_state))
+            if(!form_to_be_assembled(current_vfvol[current_vfvol_i], current_state) || current_vfvol[current_vfvol_i]->quad_2d != NULL)
               continue;
             current_vfvol[current_vfvol_i]->wf = current_wf;
             int orderTemp = calc_order_vector_form(current_vfvol[current_vfvol_i], current_refmaps, current_u_ext, current_state);
@@ -1455,6 +1854,7 @@ namespace Hermes
 
       // Order is known, we know how many integration points we need and we can proceed.
       // cache record sub idx : new precalcshapeset(spaces->shapeset, element, sub_idx, order, asmlist->idx)
+      this->switch_assembly_phase(AssemblyBasis);
       for(unsigned int i = 0; i < this->spaces_size; i++)
       {
         if(current_state->e[i] == NULL)
@@ -1556,7 +1956,7 @@ namespace Hermes
       int rep_space_i = -1;
 
       // Get necessary (volumetric) assembly lists.
-      for(unsigned int space_i = 0; space_i < this->spaces_size; space_i++)
+      for(int space_i = 0; space_i < this->spaces_size; space_i++)
       {
         if(current_state->e[space_i] != NULL)
         {
@@ -1573,14 +1973,14 @@ namespace Hermes
         (const_cast<WeakForm<Scalar>*>(current_wf))->set_active_state(current_state->e);
 
         // Do we have to recalculate the data for this state even if the cache contains the data?
-        bool changedInLastAdaptation = this->do_not_use_cache ? true : this->state_needs_recalculation(current_als, current_state);
+        bool changedInLastAdaptation = (this->do_not_use_cache || this->cache_quad_2d_changed) ? true : this->state_needs_recalculation(current_als, current_state);
 
         // Assembly lists for surface forms.
         AsmList<Scalar>** current_alsSurface = NULL;
         if(current_state->isBnd && (current_wf->mfsurf.size() > 0 || current_wf->vfsurf.size() > 0 || current_wf->mfDG.size() > 0 || current_wf->vfDG.size() > 0))
         {
           current_alsSurface = new AsmList<Scalar>*[this->spaces_size];
-          for(unsigned int space_i = 0; space_i < this->spaces_size; space_i++)
+          for(int space_i = 0; space_i < this->spaces_size; space_i++)
           {
             if(current_state->e[space_i] == NULL)
               return;
@@ -1614,6 +2014,7 @@ namespace Hermes
         }
 
         // Ext functions.
+        this->switch_assembly_phase(AssemblyBasis);
         // - order
         int order = cacheRecordPerSubIdx[rep_space_i]->order;
 
@@ -1648,9 +2049,10 @@ namespace Hermes
               ext[ext_i] = NULL;
         }
 
+        // The previous time level solution is added to the stage increments of all stages.
         if(RungeKutta)
-          for(int ext_i = 0; ext_i < this->RK_original_spaces_count; ext_i++)
-            u_ext[ext_i]->add(ext[current_extCount - this->RK_original_spaces_count + ext_i]);
+          for(int u_ext_i = 0; u_ext_i < prevNewtonSize; u_ext_i++)
+            u_ext[u_ext_i]->add(ext[current_extCount - this->RK_original_spaces_count + u_ext_i % this->RK_original_spaces_count]);
 
         if(current_mat != NULL)
         {
@@ -1661,6 +2063,12 @@ namespace Hermes
             if(!form_to_be_assembled(mfv, current_state))
               continue;
 
+            if(mfv->quad_2d != NULL)
+            {
+              assemble_form_own_quad(mfv, current_pss, current_spss, current_refmaps, current_u_ext, current_als, current_state, current_wf);
+              continue;
+            }
+
             int form_i = mfv->i;
             int form_j = mfv->j;
             CacheRecordPerSubIdx* CacheRecordPerSubIdxI = cacheRecordPerSubIdx[form_i];
@@ -1689,6 +2097,12 @@ namespace Hermes
             if(!form_to_be_assembled(vfv, current_state))
               continue;
 
+            if(vfv->quad_2d != NULL)
+            {
+              assemble_form_own_quad(vfv, current_pss, current_spss, current_refmaps, current_u_ext, current_als, current_state, current_wf);
+              continue;
+            }
+
             int form_i = vfv->i;
             CacheRecordPerSubIdx* CacheRecordPerSubIdxI = cacheRecordPerSubIdx[form_i];
 
@@ -1740,6 +2154,7 @@ namespace Hermes
               (const_cast<WeakForm<Scalar>*>(current_wf))->set_active_edge_state(current_state->e, current_state->isurf);
 
               // Ext functions.
+              this->switch_assembly_phase(AssemblyBasis);
               // - order
               int orderSurf = cacheRecordPerSubIdx[rep_space_i]->orderSurface[current_state->isurf];
               // - u_ext
@@ -1768,8 +2183,8 @@ namespace Hermes
                   extSurf[ext_surf_i] = NULL;
 
               if(RungeKutta)
-                for(int ext_surf_i = 0; ext_surf_i < this->RK_original_spaces_count; ext_surf_i++)
-                  u_extSurf[ext_surf_i]->add(extSurf[current_extCount - this->RK_original_spaces_count + ext_surf_i]);
+                for(int u_ext_surf_i = 0; u_ext_surf_i < prevNewtonSize; u_ext_surf_i++)
+                  u_extSurf[u_ext_surf_i]->add(extSurf[current_extCount - this->RK_original_spaces_count + u_ext_surf_i % this->RK_original_spaces_count]);
 
               if(current_mat != NULL)
               {
@@ -1852,19 +2267,160 @@ namespace Hermes
             delete [] current_alsSurface;
     }
 
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::set_state_quad_2d(Quad2D* quad_2d, Form<Scalar>* form, PrecalcShapeset** current_pss, PrecalcShapeset** current_spss, RefMap** current_refmaps, Solution<Scalar>** current_u_ext,
+      Traverse::State* current_state, WeakForm<Scalar>* current_wf)
+    {
+      for(int space_i = 0; space_i < this->spaces_size; space_i++)
+      {
+        if(current_state->e[space_i] == NULL)
+          continue;
+        current_spss[space_i]->set_quad_2d(quad_2d);
+
+        // Switching the quadrature frees the tables of the reference mapping, the sub-element has to be set again.
+        current_refmaps[space_i]->set_quad_2d(quad_2d);
+        current_refmaps[space_i]->set_active_element(current_state->e[space_i]);
+        current_refmaps[space_i]->force_transform(current_pss[space_i]->get_transform(), current_pss[space_i]->get_ctm());
+      }
+
+      if(current_u_ext != NULL)
+        for(unsigned int u_ext_i = 0; u_ext_i < this->wf->get_neq(); u_ext_i++)
+          if(current_u_ext[u_ext_i] != NULL)
+            current_u_ext[u_ext_i]->set_quad_2d(quad_2d);
+
+      for(unsigned int ext_i = 0; ext_i < current_wf->ext.size(); ext_i++)
+        if(current_wf->ext[ext_i] != NULL)
+          current_wf->ext[ext_i]->set_quad_2d(quad_2d);
+      for(unsigned int ext_i = 0; ext_i < form->ext.size(); ext_i++)
+        if(form->ext[ext_i] != NULL)
+          form->ext[ext_i]->set_quad_2d(quad_2d);
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::assemble_form_own_quad(Form<Scalar>* form, PrecalcShapeset** current_pss, PrecalcShapeset** current_spss, RefMap** current_refmaps, Solution<Scalar>** current_u_ext,
+      AsmList<Scalar>** current_als, Traverse::State* current_state, WeakForm<Scalar>* current_wf)
+    {
+      MatrixFormVol<Scalar>* mfv = dynamic_cast<MatrixFormVol<Scalar>*>(form);
+      VectorFormVol<Scalar>* vfv = dynamic_cast<VectorFormVol<Scalar>*>(form);
+
+      // Only a Solution keeps its values right when its quadrature is switched on an active element.
+      for(unsigned int ext_i = 0; ext_i < current_wf->ext.size(); ext_i++)
+        if(current_wf->ext[ext_i] != NULL && dynamic_cast<Solution<Scalar>*>(current_wf->ext[ext_i]) == NULL)
+          throw Exceptions::Exception("The external functions of a weak formulation with a form with its own quadrature have to be Solutions.");
+      for(unsigned int ext_i = 0; ext_i < form->ext.size(); ext_i++)
+        if(form->ext[ext_i] != NULL && dynamic_cast<Solution<Scalar>*>(form->ext[ext_i]) == NULL)
+          throw Exceptions::Exception("The external functions of a form with its own quadrature have to be Solutions.");
+
+      this->set_state_quad_2d(form->quad_2d, form, current_pss, current_spss, current_refmaps, current_u_ext, current_state, current_wf);
+
+      // Order.
+      int order = this->wf->global_integration_order_set ? this->wf->global_integration_order : 0;
+      if(order == 0)
+      {
+        this->switch_assembly_phase(AssemblyOrder);
+        form->wf = current_wf;
+        if(mfv != NULL)
+          order = calc_order_matrix_form(mfv, current_refmaps, current_u_ext, current_state);
+        else
+          order = calc_order_vector_form(vfv, current_refmaps, current_u_ext, current_state);
+      }
+
+      // Shape functions and geometry in the points of the quadrature of the form.
+      this->switch_assembly_phase(AssemblyBasis);
+      int form_i = mfv != NULL ? mfv->i : vfv->i;
+      int form_j = mfv != NULL ? mfv->j : vfv->i;
+      int spaces_of_form[2] = { form_i, form_j };
+      Func<double>** fns[2] = { NULL, NULL };
+      for(int k = 0; k < (mfv != NULL && form_i != form_j ? 2 : 1); k++)
+      {
+        int space_i = spaces_of_form[k];
+        current_spss[space_i]->set_active_element(current_state->e[space_i]);
+        current_spss[space_i]->set_master_transform();
+        fns[k] = new Func<double>*[current_als[space_i]->cnt];
+        for (unsigned int j = 0; j < current_als[space_i]->cnt; j++)
+        {
+          current_spss[space_i]->set_active_shape(current_als[space_i]->idx[j]);
+          fns[k][j] = init_fn(current_spss[space_i], current_refmaps[space_i], order);
+        }
+      }
+      Func<double>** fns_j = fns[1] != NULL ? fns[1] : fns[0];
+
+      Geom<double>* geometry;
+      double* jacobian_x_weights;
+      int n_quadrature_points = init_geometry_points(current_refmaps[form_i], order, geometry, jacobian_x_weights);
+
+      // - u_ext
+      Func<Scalar>** u_ext = NULL;
+      int prevNewtonSize = this->wf->get_neq();
+      if(!this->is_linear)
+      {
+        u_ext = new Func<Scalar>*[prevNewtonSize];
+        for(int u_ext_i = 0; u_ext_i < prevNewtonSize; u_ext_i++)
+          u_ext[u_ext_i] = (current_u_ext != NULL && current_u_ext[u_ext_i] != NULL) ? init_fn(current_u_ext[u_ext_i], order) : NULL;
+      }
+
+      // - ext
+      int current_extCount = this->wf->ext.size();
+      Func<Scalar>** ext = NULL;
+      if(current_extCount > 0)
+      {
+        ext = new Func<Scalar>*[current_extCount];
+        for(int ext_i = 0; ext_i < current_extCount; ext_i++)
+          ext[ext_i] = current_wf->ext[ext_i] != NULL ? init_fn(current_wf->ext[ext_i], order) : NULL;
+      }
+
+      // The previous time level solution is added to the stage increments of all stages.
+      if(RungeKutta)
+        for(int u_ext_i = 0; u_ext_i < prevNewtonSize; u_ext_i++)
+          u_ext[u_ext_i]->add(ext[current_extCount - this->RK_original_spaces_count + u_ext_i % this->RK_original_spaces_count]);
+
+      if(mfv != NULL)
+        assemble_matrix_form(mfv, order, fns_j, fns[0], ext, u_ext, current_als[form_i], current_als[form_j], current_state, n_quadrature_points, geometry, jacobian_x_weights);
+      else
+        assemble_vector_form(vfv, order, fns[0], ext, u_ext, current_als[form_i], current_state, n_quadrature_points, geometry, jacobian_x_weights);
+
+      // Cleanup.
+      for(int k = 0; k < 2; k++)
+      {
+        if(fns[k] == NULL)
+          continue;
+        for (unsigned int j = 0; j < current_als[spaces_of_form[k]]->cnt; j++)
+        {
+          fns[k][j]->free_fn();
+          delete fns[k][j];
+        }
+        delete [] fns[k];
+      }
+      delete [] jacobian_x_weights;
+      geometry->free();
+      delete geometry;
+      if(u_ext != NULL)
+      {
+        for(int u_ext_i = 0; u_ext_i < prevNewtonSize; u_ext_i++)
+          if(u_ext[u_ext_i] != NULL)
+          {
+            u_ext[u_ext_i]->free_fn();
+            delete u_ext[u_ext_i];
+          }
+        delete [] u_ext;
+      }
+      for(int ext_i = 0; ext_i < current_extCount; ext_i++)
+        if(ext[ext_i] != NULL)
+        {
+          ext[ext_i]->free_fn();
+          delete ext[ext_i];
+        }
+      delete [] ext;
+
+      // Back to the quadrature of the cache records, for the other forms.
+      this->set_state_quad_2d(this->wf->get_quad_2d(), form, current_pss, current_spss, current_refmaps, current_u_ext, current_state, current_wf);
+    }
+
     template<typename Scalar>
     int DiscreteProblem<Scalar>::calc_order_matrix_form(MatrixForm<Scalar> *form, RefMap** current_refmaps, Solution<Scalar>** current_u_ext, Traverse::State* current_state)
     {
       int order;
 
-      // order of solutions from the previous Newton iteration etc..
-      Func<Hermes::Ord>** u_ext_ord = new Func<Hermes::Ord>*[RungeKutta ? RK_original_spaces_count : this->wf->get_neq() - form->u_ext_offset];
-      Func<Hermes::Ord>** ext_ord = NULL;
-      int ext_size = std::max(form->ext.size(), form->wf->ext.size());
-      if(ext_size > 0)
-        ext_ord = new Func<Hermes::Ord>*[ext_size];
-      init_ext_orders(form, u_ext_ord, ext_ord, current_u_ext, current_state);
-
       // Order of shape functions.
       int max_order_j = this->spaces[form->j]->get_element_order(current_state->e[form->j]->id);
       int max_order_i = this->spaces[form->i]->get_element_order(current_state->e[form->i]->id);
@@ -1886,12 +2442,36 @@ namespace Hermes
         if(eo > max_order_j)
           max_order_j = eo;
       }
+      int order_u = max_order_j + (spaces[form->j]->get_shapeset()->get_num_components() > 1 ? 1 : 0);
+      int order_v = max_order_i + (spaces[form->i]->get_shapeset()->get_num_components() > 1 ? 1 : 0);
 
-      Func<Hermes::Ord>* ou = init_fn_ord(max_order_j + (spaces[form->j]->get_shapeset()->get_num_components() > 1 ? 1 : 0));
-      Func<Hermes::Ord>* ov = init_fn_ord(max_order_i + (spaces[form->i]->get_shapeset()->get_num_components() > 1 ? 1 : 0));
+      // The order of the form may have already been calculated for these orders.
+      std::vector<int>& key = this->get_order_memo_key(form, current_u_ext, current_state);
+      key.push_back(order_u);
+      key.push_back(order_v);
+      std::map<std::vector<int>, int>& memo = this->order_memo[omp_get_thread_num()];
+      std::map<std::vector<int>, int>::const_iterator it = memo.find(key);
+      if(it != memo.end())
+      {
+        Hermes::Ord o(it->second);
+        adjust_order_to_refmaps(form, order, &o, current_refmaps);
+        return order;
+      }
+
+      // order of solutions from the previous Newton iteration etc..
+      Func<Hermes::Ord>** u_ext_ord = new Func<Hermes::Ord>*[RungeKutta ? RK_original_spaces_count : this->wf->get_neq() - form->u_ext_offset];
+      Func<Hermes::Ord>** ext_ord = NULL;
+      int ext_size = std::max(form->ext.size(), form->wf->ext.size());
+      if(ext_size > 0)
+        ext_ord = new Func<Hermes::Ord>*[ext_size];
+      init_ext_orders(form, u_ext_ord, ext_ord, current_u_ext, current_state);
+
+      Func<Hermes::Ord>* ou = init_fn_ord(order_u);
+      Func<Hermes::Ord>* ov = init_fn_ord(order_v);
 
       // Total order of the vector form.
       Hermes::Ord o = form->ord(1, &fake_wt, u_ext_ord, ou, ov, &geom_ord, ext_ord);
+      memo.insert(std::pair<std::vector<int>, int>(key, o.get_order()));
 
       adjust_order_to_refmaps(form, order, &o, current_refmaps);
 
@@ -1910,6 +2490,8 @@ namespace Hermes
     void DiscreteProblem<Scalar>::assemble_matrix_form(MatrixForm<Scalar>* form, int order, Func<double>** base_fns, Func<double>** test_fns, Func<Scalar>** ext, Func<Scalar>** u_ext,
       AsmList<Scalar>* current_als_i, AsmList<Scalar>* current_als_j, Traverse::State* current_state, int n_quadrature_points, Geom<double>* geometry, double* jacobian_x_weights)
     {
+      this->switch_assembly_phase(AssemblyForms);
+
       bool surface_form = (dynamic_cast<MatrixFormVol<Scalar>*>(form) == NULL);
 
       double block_scaling_coefficient = this->block_scaling_coeff(form);
@@ -1992,6 +2574,7 @@ namespace Hermes
       }
 
       // Insert the local stiffness matrix into the global one.
+      this->switch_assembly_phase(AssemblyInsertion);
 
       current_mat->add(current_als_i->cnt, current_als_j->cnt, local_stiffness_matrix, current_als_i->dof, current_als_j->dof);
 
@@ -2004,6 +2587,7 @@ namespace Hermes
 
         current_mat->add(current_als_j->cnt, current_als_i->cnt, local_stiffness_matrix, current_als_j->dof, current_als_i->dof);
       }
+      this->switch_assembly_phase(AssemblyForms);
 
       if(form->ext.size() > 0)
       {
@@ -2028,14 +2612,6 @@ namespace Hermes
     {
       int order;
 
-      // order of solutions from the previous Newton iteration etc..
-      Func<Hermes::Ord>** u_ext_ord = new Func<Hermes::Ord>*[RungeKutta ? RK_original_spaces_count : this->wf->get_neq() - form->u_ext_offset];
-      Func<Hermes::Ord>** ext_ord = NULL;
-      int ext_size = std::max(form->ext.size(), form->wf->ext.size());
-      if(ext_size > 0)
-        ext_ord = new Func<Hermes::Ord>*[ext_size];
-      init_ext_orders(form, u_ext_ord, ext_ord, current_u_ext, current_state);
-
       // Order of shape functions.
       int max_order_i = this->spaces[form->i]->get_element_order(current_state->e[form->i]->id);
       if(H2D_GET_V_ORDER(max_order_i) > H2D_GET_H_ORDER(max_order_i))
@@ -2049,10 +2625,33 @@ namespace Hermes
         if(eo > max_order_i)
           max_order_i = eo;
       }
-      Func<Hermes::Ord>* ov = init_fn_ord(max_order_i + (spaces[form->i]->get_shapeset()->get_num_components() > 1 ? 1 : 0));
+      int order_v = max_order_i + (spaces[form->i]->get_shapeset()->get_num_components() > 1 ? 1 : 0);
+
+      // The order of the form may have already been calculated for these orders.
+      std::vector<int>& key = this->get_order_memo_key(form, current_u_ext, current_state);
+      key.push_back(order_v);
+      std::map<std::vector<int>, int>& memo = this->order_memo[omp_get_thread_num()];
+      std::map<std::vector<int>, int>::const_iterator it = memo.find(key);
+      if(it != memo.end())
+      {
+        Hermes::Ord o(it->second);
+        adjust_order_to_refmaps(form, order, &o, current_refmaps);
+        return order;
+      }
+
+      // order of solutions from the previous Newton iteration etc..
+      Func<Hermes::Ord>** u_ext_ord = new Func<Hermes::Ord>*[RungeKutta ? RK_original_spaces_count : this->wf->get_neq() - form->u_ext_offset];
+      Func<Hermes::Ord>** ext_ord = NULL;
+      int ext_size = std::max(form->ext.size(), form->wf->ext.size());
+      if(ext_size > 0)
+        ext_ord = new Func<Hermes::Ord>*[ext_size];
+      init_ext_orders(form, u_ext_ord, ext_ord, current_u_ext, current_state);
+
+      Func<Hermes::Ord>* ov = init_fn_ord(order_v);
 
       // Total order of the vector form.
       Hermes::Ord o = form->ord(1, &fake_wt, u_ext_ord, ov, &geom_ord, ext_ord);
+      memo.insert(std::pair<std::vector<int>, int>(key, o.get_order()));
 
       adjust_order_to_refmaps(form, order, &o, current_refmaps);
 
@@ -2069,6 +2668,8 @@ namespace Hermes
     void DiscreteProblem<Scalar>::assemble_vector_form(VectorForm<Scalar>* form, int order, Func<double>** test_fns, Func<Scalar>** ext, Func<Scalar>** u_ext, 
       AsmList<Scalar>* current_als_i, Traverse::State* current_state, int n_quadrature_points, Geom<double>* geometry, double* jacobian_x_weights)
     {
+      this->switch_assembly_phase(AssemblyForms);
+
       bool surface_form = (dynamic_cast<VectorFormVol<Scalar>*>(form) == NULL);
 
       Func<Scalar>** local_ext = ext;
@@ -2090,8 +2691,12 @@ namespace Hermes
         u_ext += form->u_ext_offset;
 
       // Actual form-specific calculation.
+      // With the profiling on, the values are inserted only after the calculation, so that the insertion is timed separately.
+      Scalar* local_vector = this->assembly_profiling ? new Scalar[current_als_i->cnt] : NULL;
       for (unsigned int i = 0; i < current_als_i->cnt; i++)
       {
+        if(local_vector != NULL)
+          local_vector[i] = 0.0;
         if(current_als_i->dof[i] < 0)
           continue;
 
@@ -2107,7 +2712,21 @@ namespace Hermes
         else
           val = form->value(n_quadrature_points, jacobian_x_weights, u_ext, v, geometry, local_ext) * form->scaling_factor * current_als_i->coef[i];
 
-        current_rhs->add(current_als_i->dof[i], val);
+        if(local_vector != NULL)
+          local_vector[i] = val;
+        else
+          current_rhs->add(current_als_i->dof[i], val);
+      }
+
+      // Insert the local vector into the global one.
+      if(local_vector != NULL)
+      {
+        this->switch_assembly_phase(AssemblyInsertion);
+        for (unsigned int i = 0; i < current_als_i->cnt; i++)
+          if(current_als_i->dof[i] >= 0 && std::abs(current_als_i->coef[i]) >= 1e-12)
+            current_rhs->add(current_als_i->dof[i], local_vector[i]);
+        this->switch_assembly_phase(AssemblyForms);
+        delete [] local_vector;
       }
 
       if(form->ext.size() > 0)
@@ -2202,6 +2821,87 @@ namespace Hermes
       }
     }
 
+    template<typename Scalar>
+    std::vector<int>& DiscreteProblem<Scalar>::get_order_memo_key(Form<Scalar>* form, Solution<Scalar>** current_u_ext, Traverse::State* current_state)
+    {
+      std::vector<int>& key = this->order_memo_keys[omp_get_thread_num()];
+      key.clear();
+
+      // The forms of the thread's weak formulation are clones of those of this->wf, in the same order.
+      const Hermes::vector<Form<Scalar>*>& forms = form->wf->forms;
+      for(unsigned int form_i = 0; form_i < forms.size(); form_i++)
+        if(forms[form_i] == form)
+        {
+          key.push_back(form_i);
+          break;
+        }
+      if(key.empty())
+        throw Exceptions::Exception("A form being assembled is not among the forms of its weak formulation in DiscreteProblem::get_order_memo_key().");
+
+      // The same orders as in init_ext_orders().
+      unsigned int prev_size = RungeKutta ? RK_original_spaces_count : this->wf->get_neq() - form->u_ext_offset;
+      bool surface_form = (current_state->isurf > -1);
+      for(unsigned int i = 0; i < prev_size; i++)
+      {
+        MeshFunction<Scalar>* fn = current_u_ext == NULL ? NULL : current_u_ext[i + form->u_ext_offset];
+        if(fn == NULL)
+          key.push_back(0);
+        else
+          key.push_back((surface_form ? fn->get_edge_fn_order(current_state->isurf) : fn->get_fn_order()) + (fn->get_num_components() > 1 ? 1 : 0));
+      }
+
+      const Hermes::vector<MeshFunction<Scalar>*>& ext = form->ext.size() > 0 ? form->ext : form->wf->ext;
+      for (unsigned int i = 0; i < ext.size(); i++)
+        key.push_back((surface_form ? ext[i]->get_edge_fn_order(current_state->isurf) : ext[i]->get_fn_order()) + (ext[i]->get_num_components() > 1 ? 1 : 0));
+
+      return key;
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::init_order_memo()
+    {
+      unsigned int num_threads_used = Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads);
+      if(this->order_memo != NULL && this->order_memo_count == num_threads_used && this->order_memo_forms_up_to_date())
+        return;
+
+      this->free_order_memo();
+      this->order_memo = new std::map<std::vector<int>, int>[num_threads_used];
+      this->order_memo_keys = new std::vector<int>[num_threads_used];
+      this->order_memo_count = num_threads_used;
+      this->order_memo_forms = this->wf->forms;
+      for(unsigned int form_i = 0; form_i < this->wf->forms.size(); form_i++)
+        this->order_memo_form_types.push_back(&typeid(*this->wf->forms[form_i]));
+    }
+
+    template<typename Scalar>
+    bool DiscreteProblem<Scalar>::order_memo_forms_up_to_date() const
+    {
+      const Hermes::vector<Form<Scalar>*>& forms = this->wf->forms;
+      if(this->order_memo_forms.size() != forms.size())
+        return false;
+      // The same form objects, in the same order. The type is compared too, as a form deleted
+      // and replaced by another one may get the same address.
+      for(unsigned int form_i = 0; form_i < forms.size(); form_i++)
+        if(this->order_memo_forms[form_i] != forms[form_i] || *this->order_memo_form_types[form_i] != typeid(*forms[form_i]))
+          return false;
+      return true;
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::free_order_memo()
+    {
+      if(this->order_memo != NULL)
+      {
+        delete [] this->order_memo;
+        delete [] this->order_memo_keys;
+        this->order_memo = NULL;
+        this->order_memo_keys = NULL;
+      }
+      this->order_memo_count = 0;
+      this->order_memo_forms.clear();
+      this->order_memo_form_types.clear();
+    }
+
     template<typename Scalar>
     void DiscreteProblem<Scalar>::deinit_ext_orders(Form<Scalar> *form, Func<Hermes::Ord>** oi, Func<Hermes::Ord>** oext)
     {
@@ -2242,50 +2942,29 @@ namespace Hermes
     }
 
     template<typename Scalar>
-    void DiscreteProblem<Scalar>::assemble_one_DG_state(PrecalcShapeset** current_pss, PrecalcShapeset** current_spss, RefMap** current_refmaps, AsmList<Scalar>** current_als,
-      Traverse::State* current_state, Hermes::vector<MatrixFormDG<Scalar>*> current_mfDG, Hermes::vector<VectorFormDG<Scalar>*> current_vfDG, Transformable** fn, WeakForm<Scalar>* current_wf)
+    void DiscreteProblem<Scalar>::assemble_one_DG_state(PrecalcShapeset** current_pss, PrecalcShapeset** current_spss, RefMap** current_refmaps,
+      PrecalcShapeset** current_npss, PrecalcShapeset** current_nspss, RefMap** current_nrefmaps, AsmList<Scalar>** current_als,
+      Traverse::State* current_state, int current_state_ordinal, Hermes::vector<MatrixFormDG<Scalar>*>& current_mfDG, Hermes::vector<VectorFormDG<Scalar>*>& current_vfDG, Transformable** fn, WeakForm<Scalar>* current_wf)
     {
+      // Neighbor searches are a part of the traversal.
+      this->switch_assembly_phase(AssemblyTraversal);
+
       // Determine the minimum mesh seq.
       unsigned int min_dg_mesh_seq = 0;
       for(unsigned int i = 0; i < spaces.size(); i++)
         if(spaces[i]->get_mesh()->get_seq() < min_dg_mesh_seq || i == 0)
           min_dg_mesh_seq = spaces[i]->get_mesh()->get_seq();
 
-      // Create neighbor psss, refmaps.
-      std::map<unsigned int, PrecalcShapeset *> npss;
-      std::map<unsigned int, PrecalcShapeset *> nspss;
-      std::map<unsigned int, RefMap *> nrefmap;
-
-      // Initialize neighbor precalc shapesets and refmaps.
-      // This is only needed when there are matrix DG forms present.
-      if(DG_matrix_forms_present)
-      {
-        for (unsigned int i = 0; i < spaces.size(); i++)
-        {
-          PrecalcShapeset* new_ps = new PrecalcShapeset(spaces[i]->shapeset);
-          npss.insert(std::pair<unsigned int, PrecalcShapeset*>(i, new_ps));
-          PrecalcShapeset* new_pss = new PrecalcShapeset(npss[i]);
-          nspss.insert(std::pair<unsigned int, PrecalcShapeset*>(i, new_pss));
-          RefMap* new_rm = new RefMap();
-          new_rm->set_quad_2d(&g_quad_2d_std);
-          nrefmap.insert(std::pair<unsigned int, RefMap*>(i, new_rm));
-        }
-      }
-
       bool** processed = new bool*[current_state->rep->nvert];
       LightArray<NeighborSearch<Scalar>*>** neighbor_searches = new LightArray<NeighborSearch<Scalar>*>*[current_state->rep->nvert];
-      (5);
       unsigned int* num_neighbors = new unsigned int[current_state->rep->nvert];
 
       bool intra_edge_passed_DG[H2D_MAX_NUMBER_VERTICES];
       for(int a = 0; a < H2D_MAX_NUMBER_VERTICES; a++)
         intra_edge_passed_DG[a] = false;
 
-#pragma omp critical (DG)
+      // The neighbor searches only read the meshes, the states do not share anything here.
       {
-        for(unsigned int i = 0; i < current_state->num; i++)
-          current_state->e[i]->visited = true;
-
         for(current_state->isurf = 0; current_state->isurf < current_state->rep->nvert; current_state->isurf++)
         {
           bool inner_edge_for_dg = false;
@@ -2383,17 +3062,15 @@ namespace Hermes
             {
               // If the active segment has already been processed (when the neighbor element was assembled), it is skipped.
               // We test all neighbor searches, because in the case of intra-element edge, the neighboring (the same as central) element
-              // will be marked as visited, even though the edge was not calculated.
+              // appears in this state too, even though the edge was not calculated.
               processed[current_state->isurf][neighbor_i] = true;
-              for(unsigned int i = 0; i < (*neighbor_searches[current_state->isurf]).get_size(); i++)
+              for(int space_i = 0; space_i < this->spaces_size; space_i++)
               {
-                if((*neighbor_searches[current_state->isurf]).present(i))
+                NeighborSearch<Scalar>* ns = (*neighbor_searches[current_state->isurf]).get(spaces[space_i]->get_mesh()->get_seq() - min_dg_mesh_seq);
+                if(this->DG_first_states[space_i][ns->neighbors.at(neighbor_i)->id] > current_state_ordinal)
                 {
-                  if(!(*neighbor_searches[current_state->isurf]).get(i)->neighbors.at(neighbor_i)->visited)
-                  {
-                    processed[current_state->isurf][neighbor_i] = false;
-                    break;
-                  }
+                  processed[current_state->isurf][neighbor_i] = false;
+                  break;
                 }
               }
             }
@@ -2423,7 +3100,7 @@ namespace Hermes
 
           assemble_DG_one_neighbor(processed[current_state->isurf][neighbor_i], neighbor_i, current_pss, current_spss, current_refmaps, current_als,
             current_state, current_mfDG, current_vfDG, fn,
-            npss, nspss, nrefmap, (*neighbor_searches[current_state->isurf]), min_dg_mesh_seq, current_wf);
+            current_npss, current_nspss, current_nrefmaps, (*neighbor_searches[current_state->isurf]), min_dg_mesh_seq, current_wf);
         }
 
         // Delete the neighbor_searches array.
@@ -2437,24 +3114,13 @@ namespace Hermes
       delete [] processed;
       delete [] neighbor_searches;
       delete [] num_neighbors;
-
-      // Deinitialize neighbor pss's, refmaps.
-      if(DG_matrix_forms_present)
-      {
-        for(std::map<unsigned int, PrecalcShapeset *>::iterator it = nspss.begin(); it != nspss.end(); it++)
-          delete it->second;
-        for(std::map<unsigned int, PrecalcShapeset *>::iterator it = npss.begin(); it != npss.end(); it++)
-          delete it->second;
-        for(std::map<unsigned int, RefMap *>::iterator it = nrefmap.begin(); it != nrefmap.end(); it++)
-          delete it->second;
-      }
     }
 
     template<typename Scalar>
     void DiscreteProblem<Scalar>::assemble_DG_one_neighbor(bool edge_processed, unsigned int neighbor_i,
       PrecalcShapeset** current_pss, PrecalcShapeset** current_spss, RefMap** current_refmaps, AsmList<Scalar>** current_als,
-      Traverse::State* current_state, Hermes::vector<MatrixFormDG<Scalar>*> current_mfDG, Hermes::vector<VectorFormDG<Scalar>*> current_vfDG, Transformable** fn,
-      std::map<unsigned int, PrecalcShapeset *> npss, std::map<unsigned int, PrecalcShapeset *> nspss, std::map<unsigned int, RefMap *> nrefmap,
+      Traverse::State* current_state, Hermes::vector<MatrixFormDG<Scalar>*>& current_mfDG, Hermes::vector<VectorFormDG<Scalar>*>& current_vfDG, Transformable** fn,
+      PrecalcShapeset** npss, PrecalcShapeset** nspss, RefMap** nrefmap,
       LightArray<NeighborSearch<Scalar>*>& neighbor_searches, unsigned int min_dg_mesh_seq, WeakForm<Scalar>* current_wf)
     {
       // Set the active segment in all NeighborSearches
@@ -2483,8 +3149,11 @@ namespace Hermes
           ns->central_transformations.get(neighbor_i)->apply_on(fn[fns_i]);
       }
 
+      // The neighbor psss, refmaps and the extended shapesets are only needed for the matrix forms.
+      bool assemble_matrix = current_mat != NULL && DG_matrix_forms_present && !edge_processed;
+
       // For neighbor psss.
-      if(current_mat != NULL && DG_matrix_forms_present && !edge_processed)
+      if(assemble_matrix)
       {
         for(unsigned int idx_i = 0; idx_i < spaces.size(); idx_i++)
         {
@@ -2502,7 +3171,7 @@ namespace Hermes
         current_refmaps[i]->force_transform(current_pss[i]->get_transform(), current_pss[i]->get_ctm());
 
         // Neighbor.
-        if(current_mat != NULL && DG_matrix_forms_present && !edge_processed)
+        if(assemble_matrix)
         {
           nspss[i]->set_active_element(npss[i]->get_active_element());
           nspss[i]->set_master_transform();
@@ -2522,6 +3191,7 @@ namespace Hermes
       DiscontinuousFunc<double>*** testFunctions = new DiscontinuousFunc<double>**[this->spaces_size];
 
       // Create the extended shapeset on the union of the central element and its current neighbor.
+      this->switch_assembly_phase(AssemblyBasis);
       int order = 20;
       int order_base = 20;
       for (unsigned int i = 0; i < this->spaces_size; i++)
@@ -2530,12 +3200,15 @@ namespace Hermes
           continue;
 
         nbs[i] = neighbor_searches.get(spaces[i]->get_mesh()->get_seq() - min_dg_mesh_seq);
-        ext_asmlist[i] = nbs[i]->create_extended_asmlist(spaces[i], current_als[i]);
         nbs[i]->set_quad_order(order);
         order_base = order;
         n_quadrature_points = init_surface_geometry_points(current_refmaps[i], order_base, current_state, geometry[i], jacobian_x_weights[i]);
         e[i] = new InterfaceGeom<double>(geometry[i], nbs[i]->neighb_el->marker, nbs[i]->neighb_el->id, nbs[i]->neighb_el->get_diameter());
 
+        if(!assemble_matrix)
+          continue;
+
+        ext_asmlist[i] = nbs[i]->create_extended_asmlist(spaces[i], current_als[i]);
         testFunctions[i] = new DiscontinuousFunc<double>*[ext_asmlist[i]->cnt];
         for (int func_i = 0; func_i < ext_asmlist[i]->cnt; func_i++)
         {
@@ -2561,8 +3234,9 @@ namespace Hermes
       }
 
       DiscontinuousFunc<Scalar>** ext = init_ext_fns(current_wf->ext, neighbor_searches, order, min_dg_mesh_seq);
+      this->switch_assembly_phase(AssemblyForms);
 
-      if(current_mat != NULL && DG_matrix_forms_present && !edge_processed)
+      if(assemble_matrix)
       {
         for(int current_mfsurf_i = 0; current_mfsurf_i < wf->mfDG.size(); current_mfsurf_i++)
         {
@@ -2609,7 +3283,9 @@ namespace Hermes
             }
           }
 
+          this->switch_assembly_phase(AssemblyInsertion);
           current_mat->add(ext_asmlist_v->cnt, ext_asmlist_u->cnt, local_stiffness_matrix, ext_asmlist_v->dof, ext_asmlist_u->dof);
+          this->switch_assembly_phase(AssemblyForms);
 
           delete [] local_stiffness_matrix;
         }
@@ -2617,7 +3293,7 @@ namespace Hermes
 
       for(int i = 0; i < this->spaces_size; i++)
       {
-        if(this->spaces[i]->get_type() != HERMES_L2_SPACE)
+        if(this->spaces[i]->get_type() != HERMES_L2_SPACE || !assemble_matrix)
           continue;
         for (int func_i = 0; func_i < ext_asmlist[i]->cnt; func_i++)
         {
@@ -2723,6 +3399,65 @@ namespace Hermes
       return ext_fns;
     }
 
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::init_DG_first_states(Hermes::vector<const Mesh*>& meshes)
+    {
+      // Up to date (a change of a mesh changes its seq).
+      if(this->DG_first_states != NULL && this->DG_first_states_seqs.size() == meshes.size())
+      {
+        bool up_to_date = true;
+        for(unsigned int i = 0; i < meshes.size(); i++)
+          if(this->DG_first_states_seqs[i] != meshes[i]->get_seq())
+            up_to_date = false;
+        if(up_to_date)
+          return;
+      }
+
+      this->free_DG_first_states();
+
+      this->DG_first_states_count = this->spaces_size;
+      this->DG_first_states = new int*[this->DG_first_states_count];
+      for(unsigned int i = 0; i < this->DG_first_states_count; i++)
+      {
+        int max_element_id = meshes[i]->get_max_element_id();
+        this->DG_first_states[i] = new int[max_element_id + 1];
+        for(int element_i = 0; element_i <= max_element_id; element_i++)
+          this->DG_first_states[i][element_i] = -1;
+      }
+
+      // The same traversal as in assemble(), the states are numbered in the order they are handed out there.
+      Traverse trav(true);
+      trav.begin(meshes.size(), &(meshes.front()));
+      Traverse::State* current_state;
+      int state_ordinal = 0;
+      while((current_state = trav.get_next_state()) != NULL)
+      {
+        for(unsigned int i = 0; i < this->DG_first_states_count; i++)
+          if(this->DG_first_states[i][current_state->e[i]->id] == -1)
+            this->DG_first_states[i][current_state->e[i]->id] = state_ordinal;
+        state_ordinal++;
+      }
+      trav.finish();
+
+      this->DG_first_states_seqs.clear();
+      for(unsigned int i = 0; i < meshes.size(); i++)
+        this->DG_first_states_seqs.push_back(meshes[i]->get_seq());
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::free_DG_first_states()
+    {
+      if(this->DG_first_states != NULL)
+      {
+        for(unsigned int i = 0; i < this->DG_first_states_count; i++)
+          delete [] this->DG_first_states[i];
+        delete [] this->DG_first_states;
+        this->DG_first_states = NULL;
+      }
+      this->DG_first_states_count = 0;
+      this->DG_first_states_seqs.clear();
+    }
+
     template<typename Scalar>
     bool DiscreteProblem<Scalar>::init_neighbors(LightArray<NeighborSearch<Scalar>*>& neighbor_searches,
       Traverse::State* current_state, unsigned int min_dg_mesh_seq)
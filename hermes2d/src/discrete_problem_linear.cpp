@@ -111,6 +111,14 @@ namespace Hermes
           if(this->wf->get_forms()[form_i]->ext[ext_i] != NULL)
             meshes.push_back(this->wf->get_forms()[form_i]->ext[ext_i]->get_mesh());
 
+      // Ownership of the DG edges, the neighbors across the edges are searched once for all threads.
+      if(this->DG_matrix_forms_present || this->DG_vector_forms_present)
+      {
+        this->init_DG_first_states(meshes);
+        for(unsigned int space_i = 0; space_i < this->spaces.size(); space_i++)
+          this->spaces[space_i]->get_mesh()->update_face_connectivity();
+      }
+
       Traverse trav_master(true);
       unsigned int num_states = trav_master.get_num_states(meshes);
 
@@ -125,7 +133,7 @@ namespace Hermes
         for (unsigned j = 0; j < this->wf->ext.size(); j++)
         {
           fns[i].push_back(weakforms[i]->ext[j]);
-          weakforms[i]->ext[j]->set_quad_2d(&g_quad_2d_std);
+          weakforms[i]->ext[j]->set_quad_2d(this->wf->get_quad_2d());
         }
         for(unsigned int form_i = 0; form_i < this->wf->get_forms().size(); form_i++)
         {
@@ -133,7 +141,7 @@ namespace Hermes
             if(this->wf->get_forms()[form_i]->ext[ext_i] != NULL)
             {
               fns[i].push_back(weakforms[i]->get_forms()[form_i]->ext[ext_i]);
-              weakforms[i]->get_forms()[form_i]->ext[ext_i]->set_quad_2d(&g_quad_2d_std);
+              weakforms[i]->get_forms()[form_i]->ext[ext_i]->set_quad_2d(this->wf->get_quad_2d());
             }
         }
         trav[i].begin(meshes.size(), &(meshes.front()), &(fns[i].front()));
@@ -141,6 +149,8 @@ namespace Hermes
       }
 
       int state_i;
+      // The ordinal number of the next state in the traversal (the states are not taken in the order of state_i).
+      int next_state_ordinal = 0;
 
       PrecalcShapeset** current_pss;
       PrecalcShapeset** current_spss;
@@ -150,7 +160,7 @@ namespace Hermes
 
 #define CHUNKSIZE 1
       int num_threads_used = Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads);
-#pragma omp parallel shared(trav_master, mat, rhs ) private(state_i, current_pss, current_spss, current_refmaps, current_als, current_weakform) num_threads(num_threads_used)
+#pragma omp parallel shared(trav_master, mat, rhs, next_state_ordinal) private(state_i, current_pss, current_spss, current_refmaps, current_als, current_weakform) num_threads(num_threads_used)
       {
 #pragma omp for schedule(static, CHUNKSIZE)
         for(state_i = 0; state_i < num_states; state_i++)
@@ -161,12 +171,14 @@ namespace Hermes
           try
           {
             Traverse::State current_state;
+            int current_state_ordinal;
 
 #pragma omp critical (get_next_state)
             {
               try
               {
                 current_state = trav[omp_get_thread_num()].get_next_state(&trav_master.top, &trav_master.id);
+                current_state_ordinal = next_state_ordinal++;
               }
               catch(Hermes::Exceptions::Exception& e)
               {
@@ -195,7 +207,9 @@ namespace Hermes
             this->assemble_one_state(current_pss, current_spss, current_refmaps, NULL, current_als, &current_state, current_weakform);
 
             if(this->DG_matrix_forms_present || this->DG_vector_forms_present)
-              this->assemble_one_DG_state(current_pss, current_spss, current_refmaps, current_als, &current_state, current_weakform->mfDG, current_weakform->vfDG, trav[omp_get_thread_num()].fn, current_weakform);
+              this->assemble_one_DG_state(current_pss, current_spss, current_refmaps,
+                this->DG_matrix_forms_present ? this->DG_npss[omp_get_thread_num()] : NULL, this->DG_matrix_forms_present ? this->DG_nspss[omp_get_thread_num()] : NULL, this->DG_matrix_forms_present ? this->DG_nrefmaps[omp_get_thread_num()] : NULL,
+                current_als, &current_state, current_state_ordinal, current_weakform->mfDG, current_weakform->vfDG, trav[omp_get_thread_num()].fn, current_weakform);
           }
           catch(Hermes::Exceptions::Exception& e)
           {
@@ -229,14 +243,6 @@ namespace Hermes
       if(this->current_rhs != NULL)
         this->current_rhs->finish();
 
-      if(this->DG_matrix_forms_present || this->DG_vector_forms_present)
-      {
-        Element* element_to_set_nonvisited;
-        for(unsigned int mesh_i = 0; mesh_i < meshes.size(); mesh_i++)
-          for_all_elements(element_to_set_nonvisited, meshes[mesh_i])
-          element_to_set_nonvisited->visited = false;
-      }
-
       if(this->caughtException != NULL)
         throw *(this->caughtException);
     }
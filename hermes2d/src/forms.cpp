@@ -603,6 +603,7 @@ namespace Hermes
       {
         u->val0 = new double[np];
         u->val1 = new double[np];
+        u->div = new double[np];
 
         double *fn0 = fu->get_fn_values(0);
         double *fn1 = fu->get_fn_values(1);
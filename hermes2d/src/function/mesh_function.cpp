@@ -239,7 +239,10 @@ namespace Hermes
       if(this->overflow_nodes != NULL) {
         for(unsigned int i = 0; i < this->overflow_nodes->get_size(); i++)
           if(this->overflow_nodes->present(i))
+          {
+            this->total_mem -= this->overflow_nodes->get(i)->size;
             ::free(this->overflow_nodes->get(i));
+          }
         delete this->overflow_nodes;
       }
       this->nodes = new LightArray<typename Function<Scalar>::Node *>;
@@ -90,18 +90,15 @@ namespace Hermes
     template<>
     void Solution<double>::init()
     {
-      memset(tables, 0, sizeof(tables));
-      memset(elems,  0, sizeof(elems));
-      memset(oldest, 0, sizeof(oldest));
+      element_cache = new ElementCaches(Hermes2DApi.get_integral_param_value(solutionElementCacheSize),
+        Hermes2DApi.get_integral_param_value(solutionElementCacheMemory) * 1024);
+      active_cache = NULL;
+      active_entry = -1;
       transform = true;
       sln_type = HERMES_UNDEF;
       this->num_components = 0;
       e_last = NULL;
 
-      for(int i = 0; i < 4; i++)
-        for(int j = 0; j < 4; j++)
-          tables[i][j] = new std::map<uint64_t, LightArray<struct Function<double>::Node*>*>;
-
       mono_coeffs = NULL;
       elem_coeffs[0] = elem_coeffs[1] = NULL;
       elem_orders = NULL;
@@ -115,18 +112,15 @@ namespace Hermes
 		template<>
 		void Solution<std::complex<double> >::init()
 		{
-			memset(tables, 0, sizeof(tables));
-			memset(elems,  0, sizeof(elems));
-			memset(oldest, 0, sizeof(oldest));
+			element_cache = new ElementCaches(Hermes2DApi.get_integral_param_value(solutionElementCacheSize),
+			  Hermes2DApi.get_integral_param_value(solutionElementCacheMemory) * 1024);
+			active_cache = NULL;
+			active_entry = -1;
 			transform = true;
 			sln_type = HERMES_UNDEF;
 			this->num_components = 0;
 			e_last = NULL;
 
-			for(int i = 0; i < 4; i++)
-				for(int j = 0; j < 4; j++)
-					tables[i][j] = new std::map<uint64_t, LightArray<struct Function<std::complex<double> >::Node*>*>;
-
 			mono_coeffs = NULL;
 			elem_coeffs[0] = elem_coeffs[1] = NULL;
 			elem_orders = NULL;
@@ -228,7 +222,7 @@ namespace Hermes
       sln_type = sln->sln_type;
       this->num_components = sln->num_components;
 
-      memset(sln->tables, 0, sizeof(sln->tables));
+      sln->free_tables();
     }
 
     template<typename Scalar>
@@ -239,6 +233,9 @@ namespace Hermes
 
       this->mesh = sln->mesh;
 
+      element_cache->max_elements = sln->element_cache->max_elements;
+      element_cache->max_memory = sln->element_cache->max_memory;
+
       sln_type = sln->sln_type;
       space_type = sln->get_space_type();
       this->num_components = sln->num_components;
@@ -274,28 +271,202 @@ namespace Hermes
     {
       Solution<Scalar>* sln = new Solution<Scalar>();
       sln->copy(this);
+
+      // The clone has its own (empty) element cache with the limits of this one, clones used by
+      // different threads thus do not need any locking.
+      sln->transform = transform;
       return sln;
     }
 
     template<typename Scalar>
-    void Solution<Scalar>::free_tables()
+    void Solution<Scalar>::free_entry_tables(ElementCacheEntry& entry)
     {
-      for (int i = 0; i < 4; i++)
-        for (int j = 0; j < 4; j++)
-          if(tables[i][j] != NULL)
+      for(typename std::map<uint64_t, LightArray<struct Function<Scalar>::Node*>*>::iterator it = entry.tables->begin(); it != entry.tables->end(); it++)
+      {
+        for(unsigned int l = 0; l < it->second->get_size(); l++)
+          if(it->second->present(l))
           {
-            for(typename std::map<uint64_t, LightArray<struct Function<Scalar>::Node*>*>::iterator it = tables[i][j]->begin(); it != tables[i][j]->end(); it++)
-            {
-              for(unsigned int l = 0; l < it->second->get_size(); l++)
-                if(it->second->present(l))
-                  ::free(it->second->get(l));
-              delete it->second;
-            }
-            tables[i][j]->clear();
-            delete tables[i][j];
-            tables[i][j] = NULL;
-            elems[i][j] = NULL;
+            element_cache->memory -= it->second->get(l)->size;
+            this->total_mem -= it->second->get(l)->size;
+            ::free(it->second->get(l));
           }
+        delete it->second;
+      }
+      delete entry.tables;
+      entry.tables = NULL;
+    }
+
+    template<typename Scalar>
+    void Solution<Scalar>::reset_element_cache()
+    {
+      element_cache_unpin();
+
+      ElementCaches* old_cache = element_cache;
+      for (int i = 0; i < H2D_MAX_QUADRATURES; i++)
+        for (unsigned int j = 0; j < old_cache->caches[i].entries.size(); j++)
+          if(old_cache->caches[i].entries[j].e != NULL)
+            free_entry_tables(old_cache->caches[i].entries[j]);
+      element_cache = new ElementCaches(old_cache->max_elements, old_cache->max_memory);
+      delete old_cache;
+    }
+
+    template<typename Scalar>
+    void Solution<Scalar>::free_tables()
+    {
+      reset_element_cache();
+
+      // The active element (if any) has lost its tables, it has to be set again.
+      this->sub_tables = NULL;
+      this->nodes = NULL;
+      this->cur_node = NULL;
+      this->element = NULL;
+    }
+
+    template<typename Scalar>
+    void Solution<Scalar>::element_cache_unpin()
+    {
+      if(active_cache != NULL)
+      {
+        active_cache->entries[active_entry].pins--;
+        active_cache = NULL;
+        active_entry = -1;
+      }
+    }
+
+    template<typename Scalar>
+    bool Solution<Scalar>::element_cache_activate(Element* e)
+    {
+      element_cache_unpin();
+
+      // the caches are taken in order and never released, the one of the current quadrature precedes the unused ones
+      Quad2D* quad = this->quads[this->cur_quad];
+      ElementCache* cache = NULL;
+      for (int i = 0; i < H2D_MAX_QUADRATURES && cache == NULL; i++)
+        if(element_cache->caches[i].quad == quad || element_cache->caches[i].quad == NULL)
+        {
+          cache = &element_cache->caches[i];
+          cache->quad = quad;
+        }
+      if(cache == NULL)
+        return false;
+
+      // try finding an existing table for e
+      int cur_entry;
+      std::map<Element*, int>::iterator found = cache->index.find(e);
+      if(found != cache->index.end())
+      {
+        element_cache->hits++;
+        cur_entry = found->second;
+        if(cache->first != cur_entry)
+        {
+          element_cache_unlink(*cache, cur_entry);
+          element_cache_push_front(*cache, cur_entry);
+        }
+      }
+      // if not found, free the least recently used ones to fit in the limits and start a new entry
+      else
+      {
+        element_cache->misses++;
+        while(((int)cache->index.size() >= element_cache->max_elements || element_cache->memory > element_cache->max_memory)
+          && element_cache_evict(*cache))
+          ;
+
+        if(cache->unused.empty())
+        {
+          cur_entry = cache->entries.size();
+          cache->entries.push_back(ElementCacheEntry());
+        }
+        else
+        {
+          cur_entry = cache->unused.back();
+          cache->unused.pop_back();
+        }
+
+        cache->entries[cur_entry].e = e;
+        cache->entries[cur_entry].tables = new std::map<uint64_t, LightArray<struct Function<Scalar>::Node*>*>;
+        cache->entries[cur_entry].pins = 0;
+        cache->index.insert(std::pair<Element*, int>(e, cur_entry));
+        element_cache_push_front(*cache, cur_entry);
+      }
+
+      cache->entries[cur_entry].pins++;
+      active_cache = cache;
+      active_entry = cur_entry;
+      this->sub_tables = cache->entries[cur_entry].tables;
+      return true;
+    }
+
+    template<typename Scalar>
+    void Solution<Scalar>::element_cache_push_front(ElementCache& cache, int i)
+    {
+      cache.entries[i].prev = -1;
+      cache.entries[i].next = cache.first;
+      if(cache.first != -1)
+        cache.entries[cache.first].prev = i;
+      cache.first = i;
+      if(cache.last == -1)
+        cache.last = i;
+    }
+
+    template<typename Scalar>
+    void Solution<Scalar>::element_cache_unlink(ElementCache& cache, int i)
+    {
+      ElementCacheEntry& entry = cache.entries[i];
+      if(entry.prev != -1)
+        cache.entries[entry.prev].next = entry.next;
+      else
+        cache.first = entry.next;
+      if(entry.next != -1)
+        cache.entries[entry.next].prev = entry.prev;
+      else
+        cache.last = entry.prev;
+    }
+
+    template<typename Scalar>
+    bool Solution<Scalar>::element_cache_evict(ElementCache& cache)
+    {
+      int i = cache.last;
+      while(i != -1 && cache.entries[i].pins > 0)
+        i = cache.entries[i].prev;
+      if(i == -1)
+        return false;
+
+      element_cache_unlink(cache, i);
+      cache.index.erase(cache.entries[i].e);
+      free_entry_tables(cache.entries[i]);
+      cache.entries[i].e = NULL;
+      cache.unused.push_back(i);
+      return true;
+    }
+
+    template<typename Scalar>
+    void Solution<Scalar>::set_element_cache_limits(int max_elements, int max_memory)
+    {
+      if(max_elements < 1)
+        throw Hermes::Exceptions::ValueException("max_elements", max_elements, 1);
+      if(max_memory < 0)
+        throw Hermes::Exceptions::ValueException("max_memory", max_memory, 0);
+      free_tables();
+      element_cache->max_elements = max_elements;
+      element_cache->max_memory = max_memory * 1024;
+    }
+
+    template<typename Scalar>
+    unsigned long Solution<Scalar>::get_element_cache_hits() const
+    {
+      return element_cache->hits;
+    }
+
+    template<typename Scalar>
+    unsigned long Solution<Scalar>::get_element_cache_misses() const
+    {
+      return element_cache->misses;
+    }
+
+    template<typename Scalar>
+    void Solution<Scalar>::reset_element_cache_statistics()
+    {
+      element_cache->hits = element_cache->misses = 0;
     }
 
     template<>
@@ -334,6 +505,7 @@ namespace Hermes
     Solution<double>::~Solution()
     {
       free();
+      delete element_cache;
       space_type = HERMES_INVALID_SPACE;
     }
 
@@ -341,6 +513,7 @@ namespace Hermes
     Solution<std::complex<double> >::~Solution()
     {
       free();
+      delete element_cache;
       space_type = HERMES_INVALID_SPACE;
     }
 
@@ -816,6 +989,9 @@ namespace Hermes
         dynamic_cast<ExactSolution<Scalar>*>(this)->exact_multiplicator *= coef;
       else
         throw Hermes::Exceptions::Exception("Uninitialized solution.");
+
+      // The cached values are no longer valid.
+      free_tables();
     }
 
     template<typename Scalar>
@@ -862,6 +1038,19 @@ namespace Hermes
       dxdy_buffer = new Scalar[this->num_components * 5 * 121];
     }
 
+    template<typename Scalar>
+    void Solution<Scalar>::set_quad_2d(Quad2D* quad_2d)
+    {
+      MeshFunction<Scalar>::set_quad_2d(quad_2d);
+      if(this->element == NULL)
+        return;
+
+      if(!element_cache_activate(this->element))
+        throw Hermes::Exceptions::Exception("too many quadratures.");
+      this->update_nodes_ptr();
+      this->cur_node = NULL;
+    }
+
     template<typename Scalar>
     void Solution<Scalar>::set_active_element(Element* e)
     {
@@ -873,36 +1062,8 @@ namespace Hermes
       
       MeshFunction<Scalar>::set_active_element(e);
 
-      // try finding an existing table for e
-      for (cur_elem = 0; cur_elem < 4; cur_elem++)
-        if(elems[this->cur_quad][cur_elem] == e)
-          break;
-
-      // if not found, free the oldest one and use its slot
-      if(cur_elem >= 4)
-      {
-        if(tables[this->cur_quad][oldest[this->cur_quad]] != NULL)
-        {
-          for(typename std::map<uint64_t, LightArray<struct Function<Scalar>::Node*>*>::iterator it = tables[this->cur_quad][oldest[this->cur_quad]]->begin(); it != tables[this->cur_quad][oldest[this->cur_quad]]->end(); it++)
-          {
-            for(unsigned int l = 0; l < it->second->get_size(); l++)
-              if(it->second->present(l))
-                ::free(it->second->get(l));
-            delete it->second;
-          }
-          delete tables[this->cur_quad][oldest[this->cur_quad]];
-          tables[this->cur_quad][oldest[this->cur_quad]] = NULL;
-          elems[this->cur_quad][oldest[this->cur_quad]] = NULL;
-        }
-
-        tables[this->cur_quad][oldest[this->cur_quad]] = new std::map<uint64_t, LightArray<struct Function<Scalar>::Node*>*>;
-
-        cur_elem = oldest[this->cur_quad];
-        if(++oldest[this->cur_quad] >= 4)
-          oldest[this->cur_quad] = 0;
-
-        elems[this->cur_quad][cur_elem] = e;
-      }
+      if(!element_cache_activate(e))
+        throw Hermes::Exceptions::Exception("too many quadratures.");
 
       if(sln_type == HERMES_SLN)
       {
@@ -928,8 +1089,6 @@ namespace Hermes
       else
         throw Hermes::Exceptions::Exception("Uninitialized solution.");
 
-      this->sub_tables = tables[this->cur_quad][cur_elem];
-
       this->update_nodes_ptr();
     }
 
@@ -954,6 +1113,20 @@ namespace Hermes
         y[i] = y[i]*x[i] + z[i];
     }
 
+    /// If the points are the tensor product of n1 coordinates in x and n1 coordinates in y (point a * n1 + b is [x_a, y_b]),
+    /// as the quad tables of Quad2DStd are, returns n1, otherwise 0.
+    static int get_tensor_points_count(double3* pt, int np)
+    {
+      int n1 = (int) (sqrt((double) np) + 0.5);
+      if(n1 < 2 || n1 * n1 != np)
+        return 0;
+      for (int a = 0; a < n1; a++)
+        for (int b = 0; b < n1; b++)
+          if(pt[a * n1 + b][0] != pt[a * n1][0] || pt[a * n1 + b][1] != pt[b][1])
+            return 0;
+      return n1;
+    }
+
     static const int H2D_GRAD = H2D_FN_DX_0 | H2D_FN_DY_0;
     static const int H2D_SECOND = H2D_FN_DXX_0 | H2D_FN_DXY_0 | H2D_FN_DYY_0;
     static const int H2D_CURL = H2D_FN_DX | H2D_FN_DY;
@@ -1059,6 +1232,27 @@ namespace Hermes
 
     template<typename Scalar>
     void Solution<Scalar>::precalculate(int order, int mask)
+    {
+      struct Function<Scalar>::Node* node = calculate_node(order, mask);
+
+      // the overflow nodes are not in the element cache
+      bool cached = (this->nodes != this->overflow_nodes);
+      if(this->nodes->present(order))
+      {
+        assert(this->nodes->get(order) == this->cur_node);
+        if(cached)
+          element_cache->memory -= this->cur_node->size;
+        this->total_mem -= this->cur_node->size;
+        ::free(this->nodes->get(order));
+      }
+      if(cached)
+        element_cache->memory += node->size;
+      this->nodes->add(node, order);
+      this->cur_node = node;
+    }
+
+    template<typename Scalar>
+    typename Function<Scalar>::Node* Solution<Scalar>::calculate_node(int order, int mask)
     {
       int i, j, k, l;
       struct Function<Scalar>::Node* node = NULL;
@@ -1100,6 +1294,17 @@ namespace Hermes
           y[i] = pt[i][1] * this->ctm->m[1] + this->ctm->t[1];
         }
 
+        // On quads, the points are usually a tensor product of n1 x n1 coordinates. Then the polynomials in x are evaluated
+        // only in the n1 distinct x coordinates (sum factorization), in O(o^2 n1 + o n1^2) operations instead of O(o^2 n1^2).
+        int n1 = (this->mode == HERMES_MODE_QUAD) ? get_tensor_points_count(pt, np) : 0;
+        Scalar* tensor_x = NULL;
+        if(n1 > 0)
+        {
+          tensor_x = new Scalar[n1];
+          for (i = 0; i < n1; i++)
+            tensor_x[i] = x[i * n1];
+        }
+
         // obtain the solution values, this is the core of the whole module
         int o = elem_orders[this->element->id];
         for (l = 0; l < this->num_components; l++)
@@ -1114,6 +1319,28 @@ namespace Hermes
                 // copy the old table if we have it already
                 memcpy(result, this->cur_node->values[l][k], np * sizeof(Scalar));
               }
+              else if(n1 > 0)
+              {
+                // The same Horner's scheme as below, with the polynomials in x evaluated once per x coordinate
+                // (y[b] is the y coordinate of the points b, n1 + b, 2 n1 + b, ...).
+                Scalar* mono = dxdy_coeffs[l][k];
+                for (i = 0; i <= o; i++)
+                {
+                  set_vec_num(n1, tx, *mono++);
+                  for (j = 1; j <= o; j++)
+                    vec_x_vec_p_num(n1, tx, tensor_x, *mono++);
+
+                  for (int a = 0; a < n1; a++)
+                  {
+                    Scalar* result_a = result + a * n1;
+                    if(!i)
+                      set_vec_num(n1, result_a, tx[a]);
+                    else
+                      for (int b = 0; b < n1; b++)
+                        result_a[b] = result_a[b] * y[b] + tx[a];
+                  }
+                }
+              }
               else
               {
                 // calculate the solution values using Horner's scheme
@@ -1137,6 +1364,8 @@ namespace Hermes
         delete [] x;
         delete [] y;
         delete [] tx;
+        if(tensor_x != NULL)
+          delete [] tensor_x;
 
         // transform gradient or vector solution, if required
         if(transform)
@@ -1207,13 +1436,7 @@ namespace Hermes
           "the solution on its right-hand side.");
       }
 
-      if(this->nodes->present(order))
-      {
-        assert(this->nodes->get(order) == this->cur_node);
-        ::free(this->nodes->get(order));
-      }
-      this->nodes->add(node, order);
-      this->cur_node = node;
+      return node;
     }
 
     template<>
@@ -1543,6 +1766,103 @@ namespace Hermes
       return;
     }
 
+    template<typename Scalar>
+    void Solution<Scalar>::save_binary(const char* filename) const
+    {
+      this->check_binary_save();
+
+      try
+      {
+        BinaryFileWriter writer(filename, "H2DSLN", binary_format_version);
+        this->write_binary(writer);
+        writer.close();
+      }
+      catch (Hermes::Exceptions::Exception& e)
+      {
+        throw Hermes::Exceptions::SolutionSaveFailureException("%s", e.what());
+      }
+    }
+
+    template<typename Scalar>
+    void Solution<Scalar>::save_binary(std::vector<char>& image) const
+    {
+      this->check_binary_save();
+
+      BinaryFileWriter writer(image, "H2DSLN", binary_format_version);
+      this->write_binary(writer);
+    }
+
+    template<typename Scalar>
+    void Solution<Scalar>::check_binary_save() const
+    {
+      if(sln_type == HERMES_UNDEF)
+        throw Exceptions::Exception("Cannot save -- uninitialized solution.");
+      if(sln_type != HERMES_SLN)
+        throw Exceptions::SolutionSaveFailureException("Only solutions given by coefficients can be saved in the binary format.");
+    }
+
+    template<typename Scalar>
+    void Solution<Scalar>::write_binary(BinaryFileWriter& writer) const
+    {
+      int header[3] = { this->get_space_type(), this->num_components, this->num_elems };
+      writer.write_array(header, 3);
+      writer.write_array(this->mono_coeffs, this->num_coeffs);
+      writer.write_array(this->elem_orders, this->num_elems);
+      for (int component_i = 0; component_i < this->num_components; component_i++)
+        writer.write_array(this->elem_coeffs[component_i], this->num_elems);
+    }
+
+    template<typename Scalar>
+    void Solution<Scalar>::load_binary(const char* filename, Space<Scalar>* space)
+    {
+      free();
+      this->mesh = space->get_mesh();
+      this->space_type = space->get_type();
+
+      try
+      {
+        BinaryFileReader reader(filename, "H2DSLN", binary_format_version);
+
+        int header[3];
+        reader.read_array(header, 3);
+        if(header[0] != this->space_type)
+          throw Exceptions::SolutionLoadFailureException("Space types not compliant in Solution::load_binary().");
+        if(header[1] < 1 || header[1] > H2D_MAX_SOLUTION_COMPONENTS || header[2] < 0)
+          throw Exceptions::SolutionLoadFailureException("Corrupted header in %s.", filename);
+
+        // The item size is checked by the reader, so real and complex solutions are not mixed.
+        uint64_t count;
+        const Scalar* mono_coeffs = reader.read_array<Scalar>(count);
+
+        this->num_coeffs = (int)count;
+        this->num_elems = header[2];
+        this->num_components = header[1];
+
+        this->mono_coeffs = new Scalar[this->num_coeffs];
+        memcpy(this->mono_coeffs, mono_coeffs, this->num_coeffs * sizeof(Scalar));
+
+        this->elem_orders = new int[this->num_elems];
+        reader.read_array(this->elem_orders, this->num_elems);
+
+        for (int component_i = 0; component_i < this->num_components; component_i++)
+        {
+          this->elem_coeffs[component_i] = new int[this->num_elems];
+          reader.read_array(this->elem_coeffs[component_i], this->num_elems);
+        }
+
+        this->sln_type = HERMES_SLN;
+        init_dxdy_buffer();
+      }
+      catch (Hermes::Exceptions::SolutionLoadFailureException&)
+      {
+        throw;
+      }
+      catch (Hermes::Exceptions::Exception& e)
+      {
+        throw Hermes::Exceptions::SolutionLoadFailureException("%s", e.what());
+      }
+    }
+
     template<typename Scalar>
     Scalar Solution<Scalar>::get_ref_value(Element* e, double xi1, double xi2, int component, int item)
     {
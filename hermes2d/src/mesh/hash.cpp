@@ -23,7 +23,9 @@ namespace Hermes
   {
     HashTable::HashTable()
     {
-      v_table = NULL; e_table = NULL;
+      v_table.slots = e_table.slots = NULL;
+      v_table.mask = e_table.mask = -1;
+      v_table.count = e_table.count = 0;
     }
 
     HashTable::~HashTable()
@@ -33,28 +35,113 @@ namespace Hermes
 
     void HashTable::init(int size)
     {
-      v_table = e_table = NULL;
+      if(size < 1 || (size & (size - 1)))
+        throw Hermes::Exceptions::Exception("Parameter 'size' must be a power of two.");
 
-      mask = size-1;
-      if(size & mask) throw Hermes::Exceptions::Exception("Parameter 'size' must be a power of two.");
+      resize_table(v_table, size);
+      resize_table(e_table, size);
+    }
+
+    void HashTable::reserve(int num_vertex_nodes, int num_edge_nodes)
+    {
+      int size = v_table.mask + 1;
+      while (size < 1 || (int64_t)size * H2D_HASH_MAX_LOAD < (int64_t)num_vertex_nodes * 100)
+        size = (size < 1) ? H2D_DEFAULT_HASH_SIZE : size * 2;
+      if(size != v_table.mask + 1)
+        resize_table(v_table, size);
+
+      size = e_table.mask + 1;
+      while (size < 1 || (int64_t)size * H2D_HASH_MAX_LOAD < (int64_t)num_edge_nodes * 100)
+        size = (size < 1) ? H2D_DEFAULT_HASH_SIZE : size * 2;
+      if(size != e_table.mask + 1)
+        resize_table(e_table, size);
+    }
 
-      // allocate and initialize the hash tables
-      v_table = new Node*[size];
-      e_table = new Node*[size];
+    void HashTable::resize_table(Table& table, int size)
+    {
+      Slot* old_slots = table.slots;
+      int old_size = table.mask + 1;
+
+      table.slots = new Slot[size];
+      table.mask = size - 1;
+      table.count = 0;
+      for (int i = 0; i < size; i++)
+        table.slots[i].id = -1;
 
-      memset(v_table, 0, size * sizeof(Node*));
-      memset(e_table, 0, size * sizeof(Node*));
+      if(old_slots != NULL)
+      {
+        for (int i = 0; i < old_size; i++)
+          if(old_slots[i].id != -1)
+            insert_table(table, old_slots[i].p1, old_slots[i].p2, old_slots[i].id);
+        delete [] old_slots;
+      }
     }
 
-    void HashTable::copy_list(Node** ptr, Node* node)
+    inline void HashTable::check_table_load(Table& table)
     {
-      while (node != NULL)
+      if(table.slots == NULL)
+        resize_table(table, H2D_DEFAULT_HASH_SIZE);
+      else if((int64_t)(table.count + 1) * 100 > (int64_t)(table.mask + 1) * H2D_HASH_MAX_LOAD)
+        resize_table(table, 2 * (table.mask + 1));
+    }
+
+    inline HashTable::Slot* HashTable::search_table(const Table& table, int p1, int p2) const
+    {
+      unsigned int i = hash(p1, p2, table.mask);
+      while (true)
       {
-        *ptr = &nodes[node->id];
-        ptr = &((*ptr)->next_hash);
-        node = node->next_hash;
+        Slot* slot = table.slots + i;
+        if(slot->id == -1 || (slot->p1 == p1 && slot->p2 == p2))
+          return slot;
+        i = (i + 1) & table.mask;
       }
-      *ptr = NULL;
+    }
+
+    inline void HashTable::insert_table(Table& table, int p1, int p2, int id)
+    {
+      unsigned int i = hash(p1, p2, table.mask);
+      while (table.slots[i].id != -1)
+        i = (i + 1) & table.mask;
+      table.slots[i].p1 = p1;
+      table.slots[i].p2 = p2;
+      table.slots[i].id = id;
+      table.count++;
+    }
+
+    void HashTable::remove_table(Table& table, int p1, int p2, int id)
+    {
+      if(table.slots == NULL)
+        return;
+
+      // find the slot holding the node
+      unsigned int i = hash(p1, p2, table.mask);
+      while (table.slots[i].id != id)
+      {
+        if(table.slots[i].id == -1)
+          return;
+        i = (i + 1) & table.mask;
+      }
+
+      // backward-shift deletion: move the following items of the probe
+      // sequence into the hole, so that no tombstones are necessary
+      unsigned int j = i;
+      while (true)
+      {
+        j = (j + 1) & table.mask;
+        Slot* slot = table.slots + j;
+        if(slot->id == -1)
+          break;
+        unsigned int k = hash(slot->p1, slot->p2, table.mask);
+        // the item at j can fill the hole at i only if its home slot k does not lie cyclically in (i, j]
+        bool stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if(!stays)
+        {
+          table.slots[i] = *slot;
+          i = j;
+        }
+      }
+      table.slots[i].id = -1;
+      table.count--;
     }
 
     Node* HashTable::get_node(int id) const
@@ -78,76 +165,101 @@ namespace Hermes
     {
       free();
       nodes.copy(ht->nodes);
-      mask = ht->mask;
 
-      v_table = new Node*[mask + 1];
-      e_table = new Node*[mask + 1];
-      for (int i = 0; i <= mask; i++)
+      // node ids are preserved by Array::copy(), so the slots can be copied verbatim
+      const Table* src[2] = { &ht->v_table, &ht->e_table };
+      Table* dest[2] = { &v_table, &e_table };
+      for (int i = 0; i < 2; i++)
       {
-        copy_list(v_table + i, ht->v_table[i]);
-        copy_list(e_table + i, ht->e_table[i]);
+        dest[i]->mask = src[i]->mask;
+        dest[i]->count = src[i]->count;
+        if(src[i]->slots != NULL)
+        {
+          dest[i]->slots = new Slot[src[i]->mask + 1];
+          memcpy(dest[i]->slots, src[i]->slots, (src[i]->mask + 1) * sizeof(Slot));
+        }
       }
     }
 
     void HashTable::rebuild()
     {
-      memset(v_table, 0, (mask + 1) * sizeof(Node*));
-      memset(e_table, 0, (mask + 1) * sizeof(Node*));
-
+      // count the nodes to size the tables once
+      int num_vertex_nodes = 0, num_edge_nodes = 0;
       Node* node;
       for_all_nodes(node, this)
       {
-        int p1 = node->p1, p2 = node->p2;
-        if(p1 > p2) std::swap(p1, p2);
-        int idx = hash(p1, p2);
-
         if(node->type == HERMES_TYPE_VERTEX)
         {
-          node->next_hash = v_table[idx];
-          v_table[idx] = node;
+          // top-level vertex nodes are not hashed
+          if(node->p1 >= 0)
+            num_vertex_nodes++;
         }
         else
+          num_edge_nodes++;
+      }
+
+      delete [] v_table.slots;
+      delete [] e_table.slots;
+      v_table.slots = e_table.slots = NULL;
+      v_table.mask = e_table.mask = -1;
+      v_table.count = e_table.count = 0;
+      reserve(num_vertex_nodes, num_edge_nodes);
+
+      for_all_nodes(node, this)
+      {
+        if(node->p1 > node->p2)
+          std::swap(node->p1, node->p2);
+
+        if(node->type == HERMES_TYPE_VERTEX)
         {
-          node->next_hash = e_table[idx];
-          e_table[idx] = node;
+          if(node->p1 >= 0)
+            insert_table(v_table, node->p1, node->p2, node->id);
         }
+        else
+          insert_table(e_table, node->p1, node->p2, node->id);
       }
     }
 
-    void HashTable::free()
+    void HashTable::insert_nodes(int first_id, int count)
     {
-      nodes.free();
-      if(v_table != NULL)
-      {
-        delete [] v_table;
-        v_table = NULL;
-      }
-      if(e_table != NULL)
+      int num_vertex_nodes = 0;
+      for (int i = first_id; i < first_id + count; i++)
+        if(nodes[i].type == HERMES_TYPE_VERTEX)
+          num_vertex_nodes++;
+      reserve(v_table.count + num_vertex_nodes, e_table.count + count - num_vertex_nodes);
+
+      for (int i = first_id; i < first_id + count; i++)
       {
-        delete [] e_table;
-        e_table = NULL;
+        Node* node = &nodes[i];
+        insert_table(node->type == HERMES_TYPE_VERTEX ? v_table : e_table, node->p1, node->p2, node->id);
       }
     }
 
-    inline Node* HashTable::search_list(Node* node, int p1, int p2) const
+    void HashTable::free()
     {
-      while (node != NULL)
+      nodes.free();
+      if(v_table.slots != NULL)
+      {
+        delete [] v_table.slots;
+        v_table.slots = NULL;
+      }
+      if(e_table.slots != NULL)
       {
-        if(node->p1 == p1 && node->p2 == p2)
-          return node;
-        node = node->next_hash;
+        delete [] e_table.slots;
+        e_table.slots = NULL;
       }
-      return NULL;
+      v_table.mask = e_table.mask = -1;
+      v_table.count = e_table.count = 0;
     }
 
     Node* HashTable::get_vertex_node(int p1, int p2)
     {
       // search for the node in the vertex hashtable
       if(p1 > p2) std::swap(p1, p2);
-      int i = hash(p1, p2);
-      Node* node = search_list(v_table[i], p1, p2);
-      if(node != NULL) 
-        return node;
+      check_table_load(v_table);
+      Slot* slot = search_table(v_table, p1, p2);
+      if(slot->id != -1)
+        return &nodes[slot->id];
 
       // not found - create a new one
       Node* newnode = nodes.add();
@@ -163,8 +275,10 @@ namespace Hermes
       newnode->y = (nodes[p1].y + nodes[p2].y) * 0.5;
 
       // insert into hashtable
-      newnode->next_hash = v_table[i];
-      v_table[i] = newnode;
+      slot->p1 = p1;
+      slot->p2 = p2;
+      slot->id = newnode->id;
+      v_table.count++;
 
       return newnode;
     }
@@ -173,9 +287,10 @@ namespace Hermes
     {
       // search for the node in the edge hashtable
       if(p1 > p2) std::swap(p1, p2);
-      int i = hash(p1, p2);
-      Node* node = search_list(e_table[i], p1, p2);
-      if(node != NULL) return node;
+      check_table_load(e_table);
+      Slot* slot = search_table(e_table, p1, p2);
+      if(slot->id != -1)
+        return &nodes[slot->id];
 
       // not found - create a new one
       Node* newnode = nodes.add();
@@ -190,40 +305,36 @@ namespace Hermes
       newnode->elem[0] = newnode->elem[1] = NULL;
 
       // insert into hashtable
-      newnode->next_hash = e_table[i];
-      e_table[i] = newnode;
+      slot->p1 = p1;
+      slot->p2 = p2;
+      slot->id = newnode->id;
+      e_table.count++;
 
       return newnode;
     }
 
     Node* HashTable::peek_vertex_node(int p1, int p2) const
     {
+      if(v_table.slots == NULL)
+        return NULL;
       if(p1 > p2) std::swap(p1, p2);
-      return search_list(v_table[hash(p1, p2)], p1, p2);
+      Slot* slot = search_table(v_table, p1, p2);
+      return (slot->id == -1) ? NULL : &nodes[slot->id];
     }
 
     Node* HashTable::peek_edge_node(int p1, int p2) const
     {
+      if(e_table.slots == NULL)
+        return NULL;
       if(p1 > p2) std::swap(p1, p2);
-      return search_list(e_table[hash(p1, p2)], p1, p2);
+      Slot* slot = search_table(e_table, p1, p2);
+      return (slot->id == -1) ? NULL : &nodes[slot->id];
     }
 
     void HashTable::remove_vertex_node(int id)
     {
       // remove the node from the hash table
-      int i = hash(nodes[id].p1, nodes[id].p2);
-      Node** ptr = v_table + i;
-      Node* node = *ptr;
-      while (node != NULL)
-      {
-        if(node->id == id)
-        {
-          *ptr = node->next_hash;
-          break;
-        }
-        ptr = &node->next_hash;
-        node = *ptr;
-      }
+      remove_table(v_table, nodes[id].p1, nodes[id].p2, id);
 
       // remove node from the array
       nodes.remove(id);
@@ -232,22 +343,10 @@ namespace Hermes
     void HashTable::remove_edge_node(int id)
     {
       // remove the node from the hash table
-      int i = hash(nodes[id].p1, nodes[id].p2);
-      Node** ptr = e_table + i;
-      Node* node = *ptr;
-      while (node != NULL)
-      {
-        if(node->id == id)
-        {
-          *ptr = node->next_hash;
-          break;
-        }
-        ptr = &node->next_hash;
-        node = *ptr;
-      }
+      remove_table(e_table, nodes[id].p1, nodes[id].p2, id);
 
       // remove node from the array
       nodes.remove(id);
     }
   }
-}
\ No newline at end of file
+}
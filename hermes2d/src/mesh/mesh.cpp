@@ -19,6 +19,7 @@
 #include "global.h"
 #include "api2d.h"
 #include "mesh_reader_h2d.h"
+#include "neighbor.h"
 
 namespace Hermes
 {
@@ -248,7 +249,7 @@ namespace Hermes
 
     unsigned g_mesh_seq = 0;
 
-    Mesh::Mesh() : HashTable()
+    Mesh::Mesh() : HashTable(), face_connectivity(NULL)
     {
       nbase = nactive = ntopvert = ninitial = 0;
       seq = g_mesh_seq++;
@@ -321,67 +322,209 @@ namespace Hermes
     {
     }
 
+    /// One element side in Mesh::create(), the sides are sorted by the smaller vertex id of
+    /// their edge (bucket) and then by the other one, sides sharing an edge are thus adjacent.
+    struct BulkSide
+    {
+      /// The larger vertex id of the edge.
+      int p2;
+      /// Element id * H2D_MAX_NUMBER_EDGES + the side within the element.
+      int side;
+    };
+
     void Mesh::create(int nv, double2* verts, int nt, int3* tris, std::string* tri_markers,
       int nq, int4* quads, std::string* quad_markers, int nm, int2* mark, std::string* boundary_markers)
     {
       free();
+      init();
+
+      int ne = nt + nq;
+      int num_threads_used = Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads);
+      int i;
 
-      // initialize hash table
-      int size = 16;
-      while (size < 2*nv) size *= 2;
-      init(size);
+      // 1. check the elements, count the sides per bucket and the elements per vertex
+      std::vector<int> bucket_start(nv + 1, 0);
+      std::vector<int> vertex_ref(nv, 0);
+      for (i = 0; i < ne; i++)
+      {
+        int nvert = (i < nt) ? 3 : 4;
+        const int* vert = (i < nt) ? tris[i] : quads[i - nt];
+        for (int j = 0; j < nvert; j++)
+        {
+          if(vert[j] < 0 || vert[j] >= nv)
+            throw Hermes::Exceptions::MeshLoadFailureException("Element #%d: vertex #%d does not exist.", i, vert[j]);
+          for (int k = 0; k < j; k++)
+            if(vert[k] == vert[j])
+              throw Hermes::Exceptions::MeshLoadFailureException("Some of the vertices of element #%d are identical which is impossible.", i);
+        }
+        for (int j = 0; j < nvert; j++)
+        {
+          vertex_ref[vert[j]]++;
+          bucket_start[std::min(vert[j], vert[(j + 1) % nvert]) + 1]++;
+        }
+      }
+      for (i = 0; i < nv; i++)
+        bucket_start[i + 1] += bucket_start[i];
 
-      // create vertex nodes
-      for (int i = 0; i < nv; i++)
+      // 2. sorted side list: a counting sort by the smaller vertex, the sides of the elements
+      // are filled in in the order of element ids, which is kept by the (stable) sort of each bucket
+      int num_sides = bucket_start[nv];
+      std::vector<BulkSide> sides(num_sides > 0 ? num_sides : 1);
       {
-        Node* node = nodes.add();
-        assert(node->id == i);
-        node->ref = TOP_LEVEL_REF;
+        std::vector<int> cursor(bucket_start.begin(), bucket_start.end() - 1);
+        for (i = 0; i < ne; i++)
+        {
+          int nvert = (i < nt) ? 3 : 4;
+          const int* vert = (i < nt) ? tris[i] : quads[i - nt];
+          for (int j = 0; j < nvert; j++)
+          {
+            int p1 = vert[j], p2 = vert[(j + 1) % nvert];
+            BulkSide& side = sides[cursor[std::min(p1, p2)]++];
+            side.p2 = std::max(p1, p2);
+            side.side = i * H2D_MAX_NUMBER_EDGES + j;
+          }
+        }
+      }
+
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(num_threads_used)
+      for (i = 0; i < nv; i++)
+      {
+        // buckets hold a few sides, insertion sort it is
+        for (int j = bucket_start[i] + 1; j < bucket_start[i + 1]; j++)
+        {
+          BulkSide side = sides[j];
+          int k = j;
+          for (; k > bucket_start[i] && sides[k - 1].p2 > side.p2; k--)
+            sides[k] = sides[k - 1];
+          sides[k] = side;
+        }
+      }
+
+      // 3. edges = runs of equal keys in the side list
+      std::vector<int> edge_start;
+      edge_start.reserve(num_sides / 2 + nv + 1);
+      std::vector<int> side_edge(ne * H2D_MAX_NUMBER_EDGES, -1);
+      for (int b = 0; b < nv; b++)
+        for (int j = bucket_start[b]; j < bucket_start[b + 1]; j++)
+        {
+          if(j == bucket_start[b] || sides[j].p2 != sides[j - 1].p2)
+            edge_start.push_back(j);
+          else if(j - edge_start.back() >= 2)
+            throw Hermes::Exceptions::MeshLoadFailureException("Edge %d-%d is shared by more than two elements.", b, sides[j].p2);
+          side_edge[sides[j].side] = edge_start.size() - 1;
+        }
+      int num_edges = edge_start.size();
+      edge_start.push_back(num_sides);
+
+      // 4. nodes and elements, all at once
+      int first_vertex = nodes.append(nv);
+      assert(first_vertex == 0);
+      int first_edge = nodes.append(num_edges);
+      int first_element = elements.append(ne);
+      assert(first_element == 0);
+
+#pragma omp parallel for schedule(static) num_threads(num_threads_used)
+      for (i = 0; i < nv; i++)
+      {
+        Node* node = &nodes[i];
+        node->ref = TOP_LEVEL_REF + vertex_ref[i];
         node->type = HERMES_TYPE_VERTEX;
         node->bnd = 0;
         node->p1 = node->p2 = -1;
-        node->next_hash = NULL;
         node->x = verts[i][0];
         node->y = verts[i][1];
       }
       ntopvert = nv;
 
-      // create triangles
-      Element* e;
-      for (int i = 0; i < nt; i++)
+#pragma omp parallel for schedule(static) num_threads(num_threads_used)
+      for (i = 0; i < num_edges; i++)
       {
-        this->element_markers_conversion.insert_marker(this->element_markers_conversion.min_marker_unused, tri_markers[i]);
-
-        e = create_triangle(this->element_markers_conversion.get_internal_marker(tri_markers[i]).marker, &nodes[tris[i][0]], &nodes[tris[i][1]],
-          &nodes[tris[i][2]], NULL);
+        Node* node = &nodes[first_edge + i];
+        int first_side = sides[edge_start[i]].side;
+        int e = first_side / H2D_MAX_NUMBER_EDGES, j = first_side % H2D_MAX_NUMBER_EDGES;
+        int nvert = (e < nt) ? 3 : 4;
+        const int* vert = (e < nt) ? tris[e] : quads[e - nt];
+        node->type = HERMES_TYPE_EDGE;
+        node->ref = edge_start[i + 1] - edge_start[i];
+        node->bnd = 0;
+        node->p1 = std::min(vert[j], vert[(j + 1) % nvert]);
+        node->p2 = std::max(vert[j], vert[(j + 1) % nvert]);
+        node->marker = 0;
+        // the same order as Node::ref_element() gives when the elements are created one by one
+        node->elem[0] = &elements[e];
+        node->elem[1] = (node->ref == 2) ? &elements[sides[edge_start[i] + 1].side / H2D_MAX_NUMBER_EDGES] : NULL;
+      }
+
+      // element markers are converted only when they change, elements of one block mostly share them
+      std::vector<int> element_markers(ne);
+      const std::string* last_marker = NULL;
+      int last_internal_marker = 0;
+      for (i = 0; i < ne; i++)
+      {
+        const std::string& marker = (i < nt) ? tri_markers[i] : quad_markers[i - nt];
+        if(last_marker == NULL || *last_marker != marker)
+        {
+          last_marker = &marker;
+          this->element_markers_conversion.insert_marker(this->element_markers_conversion.min_marker_unused, marker);
+          last_internal_marker = this->element_markers_conversion.get_internal_marker(marker).marker;
+        }
+        element_markers[i] = last_internal_marker;
+      }
+
+#pragma omp parallel for schedule(static) num_threads(num_threads_used)
+      for (i = 0; i < ne; i++)
+      {
+        Element* e = &elements[i];
+        int nvert = (i < nt) ? 3 : 4;
+        const int* vert = (i < nt) ? tris[i] : quads[i - nt];
+        e->active = 1;
+        e->marker = element_markers[i];
+        e->nvert = nvert;
+        e->iro_cache = -1;
+        e->cm = NULL;
+        e->parent = NULL;
+        e->visited = false;
+        e->areaCalculated = false;
+        e->diameterCalculated = false;
+        for (int j = 0; j < nvert; j++)
+        {
+          e->vn[j] = &nodes[vert[j]];
+          e->en[j] = &nodes[first_edge + side_edge[i * H2D_MAX_NUMBER_EDGES + j]];
+        }
       }
 
-      // create quads
-      for (int i = 0; i < nq; i++)
-      {
-        this->element_markers_conversion.insert_marker(this->element_markers_conversion.min_marker_unused, quad_markers[i]);
-
-        e = create_quad(this->element_markers_conversion.get_internal_marker(quad_markers[i]).marker, &nodes[quads[i][0]], &nodes[quads[i][1]],
-          &nodes[quads[i][2]], &nodes[quads[i][3]], NULL);
-      }
+      insert_nodes(first_edge, num_edges);
 
-      // set boundary markers
-      for (int i = 0; i < nm; i++)
+      // 5. boundary markers, the edges are found in the sorted side list
+      last_marker = NULL;
+      for (i = 0; i < nm; i++)
       {
-        Node* en = peek_edge_node(mark[i][0], mark[i][1]);
+        int p1 = std::min(mark[i][0], mark[i][1]), p2 = std::max(mark[i][0], mark[i][1]);
+        Node* en = NULL;
+        if(p1 >= 0 && p2 < nv)
+          for (int j = bucket_start[p1]; j < bucket_start[p1 + 1]; j++)
+            if(sides[j].p2 == p2)
+            {
+              en = &nodes[first_edge + side_edge[sides[j].side]];
+              break;
+            }
         if(en == NULL)
           throw Hermes::Exceptions::Exception("Boundary data error (edge does not exist)");
 
-        this->boundary_markers_conversion.insert_marker(this->boundary_markers_conversion.min_marker_unused, boundary_markers[i]);
-
-        en->marker = this->boundary_markers_conversion.get_internal_marker(boundary_markers[i]).marker;
+        if(last_marker == NULL || *last_marker != boundary_markers[i])
+        {
+          last_marker = &boundary_markers[i];
+          this->boundary_markers_conversion.insert_marker(this->boundary_markers_conversion.min_marker_unused, *last_marker);
+          last_internal_marker = this->boundary_markers_conversion.get_internal_marker(*last_marker).marker;
+        }
+        en->marker = last_internal_marker;
 
-        nodes[mark[i][0]].bnd = 1;
-        nodes[mark[i][1]].bnd = 1;
+        nodes[p1].bnd = 1;
+        nodes[p2].bnd = 1;
         en->bnd = 1;
       }
 
-      nbase = nactive = ninitial = nt + nq;
+      nbase = nactive = ninitial = ne;
       seq = g_mesh_seq++;
     }
 
@@ -498,6 +641,22 @@ namespace Hermes
       this->seq = seq;
     }
 
+    const MeshFaceConnectivity* Mesh::get_face_connectivity() const
+    {
+      if(this->face_connectivity != NULL && this->face_connectivity->seq == this->seq)
+        return this->face_connectivity;
+      return NULL;
+    }
+
+    void Mesh::update_face_connectivity() const
+    {
+      if(this->get_face_connectivity() != NULL)
+        return;
+      if(this->face_connectivity == NULL)
+        this->face_connectivity = new MeshFaceConnectivity;
+      NeighborSearch<double>::calculate_face_connectivity(this, this->face_connectivity);
+    }
+
     Element* Mesh::get_element_fast(int id) const
     {
       return &(elements[id]);
@@ -980,17 +1139,365 @@ namespace Hermes
       if(refinement == -1)
         return;
 
-      elements.set_append_only(true);
+      if(refinement == 0)
+        this->refine_all_elements_bulk();
+      else
+      {
+        // a uniform refinement roughly quadruples the number of nodes,
+        // size the node tables at once instead of growing them on the way
+        int num_nodes = this->get_num_nodes();
+        this->reserve(4 * num_nodes, 4 * num_nodes);
 
-      for_all_active_elements(e, this)
-        refine_element_id(e->id, refinement);
+        elements.set_append_only(true);
 
-      elements.set_append_only(false);
+        for_all_active_elements(e, this)
+          refine_element_id(e->id, refinement);
+
+        elements.set_append_only(false);
+      }
 
       if(mark_as_initial)
         ninitial = this->get_max_element_id();
     }
 
+    /// Per-element data of Mesh::refine_all_elements_bulk().
+    /// Node ids equal to -1 are not known yet.
+    struct BulkRefinementData
+    {
+      /// Mid-edge vertex nodes.
+      int mid[H2D_MAX_NUMBER_EDGES];
+      /// Halves of the edges, half[i][0] is adjacent to vn[i], half[i][1] to vn[i + 1].
+      int half[H2D_MAX_NUMBER_EDGES][2];
+      /// Edge nodes inside the element.
+      int inner[H2D_MAX_NUMBER_EDGES];
+      /// Mid-element vertex node (quads only).
+      int center;
+      /// True if this element creates the new nodes on the edge, i.e. it has
+      /// the lower id of the two elements sharing it.
+      bool owner[H2D_MAX_NUMBER_EDGES];
+      /// Range of the new nodes created by this element (relative to the first new node).
+      int first_node, num_nodes;
+    };
+
+    /// Son vertices, in terms of the local numbering: vn[0..3] = 0..3, mid[0..3] = 4..7, center = 8.
+    static const int bulk_tri_sons[H2D_MAX_ELEMENT_SONS][3] = { { 0, 4, 6 }, { 4, 1, 5 }, { 6, 5, 2 }, { 5, 6, 4 } };
+    static const int bulk_quad_sons[H2D_MAX_ELEMENT_SONS][4] = { { 0, 4, 8, 7 }, { 4, 1, 5, 8 }, { 8, 5, 2, 6 }, { 7, 8, 6, 3 } };
+
+    void Mesh::refine_all_elements_bulk()
+    {
+      // active elements in the order of their ids, and the inverse map
+      Hermes::vector<Element*> active;
+      int* active_index = new int[this->get_max_element_id()];
+      for (int i = 0; i < this->get_max_element_id(); i++)
+        active_index[i] = -1;
+      Element* e;
+      for_all_active_elements(e, this)
+      {
+        active_index[e->id] = active.size();
+        active.push_back(e);
+      }
+      int num_active = active.size();
+
+      BulkRefinementData* data = new BulkRefinementData[num_active];
+      int num_threads_used = Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads);
+      int k;
+
+      // 1. classify the edges and count the nodes each element creates
+#pragma omp parallel for schedule(static) num_threads(num_threads_used)
+      for (k = 0; k < num_active; k++)
+      {
+        Element* e = active[k];
+        BulkRefinementData& d = data[k];
+        d.num_nodes = 0;
+        for (int i = 0; i < e->get_nvert(); i++)
+        {
+          Element* neighbor = (e->en[i]->elem[0] == e) ? e->en[i]->elem[1] : e->en[i]->elem[0];
+          d.owner[i] = (neighbor == NULL || e->id < neighbor->id);
+          d.mid[i] = d.half[i][0] = d.half[i][1] = -1;
+
+          // the mid-edge vertex exists only if the other side of the edge is finer,
+          // this element is then the only one on the edge (and the owner)
+          int p1 = e->vn[i]->id, p2 = e->vn[e->next_vert(i)]->id;
+          Node* mid = peek_vertex_node(p1, p2);
+          if(mid != NULL)
+          {
+            assert(d.owner[i]);
+            d.mid[i] = mid->id;
+            Node* half = peek_edge_node(p1, mid->id);
+            if(half != NULL)
+              d.half[i][0] = half->id;
+            half = peek_edge_node(mid->id, p2);
+            if(half != NULL)
+              d.half[i][1] = half->id;
+          }
+          else if(d.owner[i])
+            d.num_nodes++;
+
+          if(d.owner[i])
+            d.num_nodes += (d.half[i][0] == -1 ? 1 : 0) + (d.half[i][1] == -1 ? 1 : 0);
+        }
+
+        // inner edges, plus the mid-element vertex for quads
+        d.num_nodes += e->is_triangle() ? 3 : 5;
+      }
+
+      // 2. allocate all nodes and sons at once, the ids follow the order of the active elements
+      int num_new_nodes = 0;
+      for (k = 0; k < num_active; k++)
+      {
+        data[k].first_node = num_new_nodes;
+        num_new_nodes += data[k].num_nodes;
+      }
+      int first_node = nodes.append(num_new_nodes);
+      int first_son = elements.append(H2D_MAX_ELEMENT_SONS * num_active);
+
+      // 3. the owners assign the ids of the nodes they create
+#pragma omp parallel for schedule(static) num_threads(num_threads_used)
+      for (k = 0; k < num_active; k++)
+      {
+        Element* e = active[k];
+        BulkRefinementData& d = data[k];
+        int id = first_node + d.first_node;
+        for (int i = 0; i < e->get_nvert(); i++)
+        {
+          if(!d.owner[i])
+            continue;
+          if(d.mid[i] == -1)
+            d.mid[i] = id++;
+          for (int j = 0; j < 2; j++)
+            if(d.half[i][j] == -1)
+              d.half[i][j] = id++;
+        }
+        for (unsigned int i = 0; i < (e->is_triangle() ? 3 : 4); i++)
+          d.inner[i] = id++;
+        d.center = e->is_triangle() ? -1 : id++;
+        assert(id == first_node + d.first_node + d.num_nodes);
+      }
+
+      // 4. the other elements take the shared nodes over from the owners
+#pragma omp parallel for schedule(static) num_threads(num_threads_used)
+      for (k = 0; k < num_active; k++)
+      {
+        Element* e = active[k];
+        BulkRefinementData& d = data[k];
+        for (int i = 0; i < e->get_nvert(); i++)
+        {
+          if(d.owner[i])
+            continue;
+          Element* neighbor = (e->en[i]->elem[0] == e) ? e->en[i]->elem[1] : e->en[i]->elem[0];
+          BulkRefinementData& neighbor_d = data[active_index[neighbor->id]];
+          int j = 0;
+          while (neighbor->en[j] != e->en[i])
+            j++;
+          bool same_orientation = (neighbor->vn[j] == e->vn[i]);
+          d.mid[i] = neighbor_d.mid[j];
+          d.half[i][0] = neighbor_d.half[j][same_orientation ? 0 : 1];
+          d.half[i][1] = neighbor_d.half[j][same_orientation ? 1 : 0];
+        }
+      }
+
+      // 5. initialize the new nodes and the sons
+#pragma omp parallel for schedule(static) num_threads(num_threads_used)
+      for (k = 0; k < num_active; k++)
+      {
+        Element* e = active[k];
+        BulkRefinementData& d = data[k];
+        int nv = e->get_nvert();
+        int own_first = first_node + d.first_node, own_last = own_first + d.num_nodes;
+
+        // local numbering of the vertices of the sons
+        int pts[9];
+        for (int i = 0; i < nv; i++)
+        {
+          pts[i] = e->vn[i]->id;
+          pts[4 + i] = d.mid[i];
+        }
+        pts[8] = d.center;
+
+        // edges of the sons, in terms of the local numbering
+        int edge_pts[3 * H2D_MAX_NUMBER_EDGES][2], edge_ids[3 * H2D_MAX_NUMBER_EDGES];
+        int num_edges = 0;
+        for (int i = 0; i < nv; i++)
+        {
+          edge_pts[num_edges][0] = i; edge_pts[num_edges][1] = 4 + i; edge_ids[num_edges++] = d.half[i][0];
+          edge_pts[num_edges][0] = 4 + i; edge_pts[num_edges][1] = e->next_vert(i); edge_ids[num_edges++] = d.half[i][1];
+        }
+        if(e->is_triangle())
+        {
+          edge_pts[num_edges][0] = 5; edge_pts[num_edges][1] = 6; edge_ids[num_edges++] = d.inner[0];
+          edge_pts[num_edges][0] = 6; edge_pts[num_edges][1] = 4; edge_ids[num_edges++] = d.inner[1];
+          edge_pts[num_edges][0] = 4; edge_pts[num_edges][1] = 5; edge_ids[num_edges++] = d.inner[2];
+        }
+        else
+          for (int i = 0; i < nv; i++)
+          {
+            edge_pts[num_edges][0] = 4 + i; edge_pts[num_edges][1] = 8; edge_ids[num_edges++] = d.inner[i];
+          }
+
+        // mid-edge and mid-element vertex nodes created by this element
+        for (int i = 0; i < nv; i++)
+        {
+          if(d.mid[i] < own_first || d.mid[i] >= own_last)
+            continue;
+          Node* node = &nodes[d.mid[i]];
+          node->type = HERMES_TYPE_VERTEX;
+          node->ref = 0;
+          node->bnd = 0;
+          node->p1 = std::min(pts[i], pts[e->next_vert(i)]);
+          node->p2 = std::max(pts[i], pts[e->next_vert(i)]);
+          node->x = (nodes[node->p1].x + nodes[node->p2].x) * 0.5;
+          node->y = (nodes[node->p1].y + nodes[node->p2].y) * 0.5;
+        }
+        if(e->is_quad())
+        {
+          // the mid-edge nodes may be initialized by another thread, use the element vertices
+          Node* node = &nodes[d.center];
+          node->type = HERMES_TYPE_VERTEX;
+          node->ref = 0;
+          node->bnd = 0;
+          node->p1 = std::min(d.mid[0], d.mid[2]);
+          node->p2 = std::max(d.mid[0], d.mid[2]);
+          node->x = ((e->vn[0]->x + e->vn[1]->x) * 0.5 + (e->vn[2]->x + e->vn[3]->x) * 0.5) * 0.5;
+          node->y = ((e->vn[0]->y + e->vn[1]->y) * 0.5 + (e->vn[2]->y + e->vn[3]->y) * 0.5) * 0.5;
+        }
+
+        // edge nodes created by this element
+        for (int i = 0; i < num_edges; i++)
+        {
+          if(edge_ids[i] < own_first || edge_ids[i] >= own_last)
+            continue;
+          Node* node = &nodes[edge_ids[i]];
+          node->type = HERMES_TYPE_EDGE;
+          node->ref = 0;
+          node->bnd = 0;
+          node->p1 = std::min(pts[edge_pts[i][0]], pts[edge_pts[i][1]]);
+          node->p2 = std::max(pts[edge_pts[i][0]], pts[edge_pts[i][1]]);
+          node->marker = 0;
+          node->elem[0] = node->elem[1] = NULL;
+        }
+
+        // the sons
+        for (int s = 0; s < H2D_MAX_ELEMENT_SONS; s++)
+        {
+          const int* son_pts = e->is_triangle() ? bulk_tri_sons[s] : bulk_quad_sons[s];
+          Element* son = &elements[first_son + H2D_MAX_ELEMENT_SONS * k + s];
+          son->active = 1;
+          son->marker = e->marker;
+          son->nvert = nv;
+          // optimization: iro never gets worse
+          son->iro_cache = (e->is_quad() && e->iro_cache == 0) ? 0 : -1;
+          son->cm = NULL;
+          son->parent = e;
+          son->visited = false;
+          for (int j = 0; j < nv; j++)
+          {
+            son->vn[j] = &nodes[pts[son_pts[j]]];
+            int a = son_pts[j], b = son_pts[(j + 1) % nv];
+            int i = 0;
+            while (!((edge_pts[i][0] == a && edge_pts[i][1] == b) || (edge_pts[i][0] == b && edge_pts[i][1] == a)))
+              i++;
+            son->en[j] = &nodes[edge_ids[i]];
+          }
+        }
+      }
+
+      // 6. curved elements: mid-edge points on the curves, son CurvMaps
+      // (serial, the CurvMap projection data are shared; the parents must still be active)
+      for (k = 0; k < num_active; k++)
+      {
+        Element* e = active[k];
+        if(!e->is_curved())
+          continue;
+        BulkRefinementData& d = data[k];
+        if(e->is_triangle())
+        {
+          double2 pt[3] = { { 0.0, -1.0 }, { 0.0, 0.0 }, { -1.0, 0.0 } };
+          e->cm->get_mid_edge_points(e, pt, 3);
+          for (int i = 0; i < 3; i++)
+          {
+            nodes[d.mid[i]].x = pt[i][0];
+            nodes[d.mid[i]].y = pt[i][1];
+          }
+        }
+        else
+        {
+          double2 pt[5] = { { 0.0, -1.0 }, { 1.0, 0.0 }, { 0.0, 1.0 }, { -1.0, 0.0 }, { 0.0, 0.0 } };
+          e->cm->get_mid_edge_points(e, pt, 5);
+          for (int i = 0; i < 4; i++)
+          {
+            nodes[d.mid[i]].x = pt[i][0];
+            nodes[d.mid[i]].y = pt[i][1];
+          }
+          nodes[d.center].x = pt[4][0];
+          nodes[d.center].y = pt[4][1];
+        }
+        for (int s = 0; s < H2D_MAX_ELEMENT_SONS; s++)
+          elements[first_son + H2D_MAX_ELEMENT_SONS * k + s].cm = create_son_curv_map(e, s);
+      }
+      for (k = 0; k < num_active; k++)
+      {
+        Element* e = active[k];
+        if(!e->is_curved())
+          continue;
+        for (int s = 0; s < H2D_MAX_ELEMENT_SONS; s++)
+        {
+          Element* son = &elements[first_son + H2D_MAX_ELEMENT_SONS * k + s];
+          if(son->cm != NULL)
+            son->cm->update_refmap_coeffs(son);
+        }
+      }
+
+      // 7. register the new nodes, hand the nodes over from the parents to the sons
+      // (this pass is serial: it modifies the reference counts and the hash table)
+      this->insert_nodes(first_node, num_new_nodes);
+      for (k = 0; k < num_active; k++)
+      {
+        Element* e = active[k];
+        BulkRefinementData& d = data[k];
+
+        // remember the markers of the edge nodes
+        int bnd[H2D_MAX_NUMBER_EDGES], mrk[H2D_MAX_NUMBER_EDGES];
+        for (int i = 0; i < e->get_nvert(); i++)
+        {
+          bnd[i] = e->en[i]->bnd;
+          mrk[i] = e->en[i]->marker;
+        }
+
+        Element* sons[H2D_MAX_ELEMENT_SONS];
+        for (int s = 0; s < H2D_MAX_ELEMENT_SONS; s++)
+        {
+          sons[s] = &elements[first_son + H2D_MAX_ELEMENT_SONS * k + s];
+          sons[s]->ref_all_nodes();
+        }
+
+        // deactivate this element and unregister from its nodes
+        e->active = 0;
+        e->unref_all_nodes(this);
+
+        // set correct boundary status and markers for the new nodes
+        for (int i = 0; i < e->get_nvert(); i++)
+        {
+          for (int j = 0; j < 2; j++)
+          {
+            nodes[d.half[i][j]].bnd = bnd[i];
+            nodes[d.half[i][j]].marker = mrk[i];
+          }
+          nodes[d.mid[i]].bnd = bnd[i];
+        }
+
+        // copy son pointers (could not have been done earlier because of the union)
+        memcpy(e->sons, sons, sizeof(sons));
+
+        this->refinements.push_back(std::pair<unsigned int, int>(e->id, 0));
+      }
+      this->nactive += (H2D_MAX_ELEMENT_SONS - 1) * num_active;
+
+      delete [] data;
+      delete [] active_index;
+
+      this->seq = g_mesh_seq++;
+    }
+
     static int rtb_marker;
     static bool rtb_aniso;
     static char* rtb_vert;
@@ -1489,6 +1996,9 @@ namespace Hermes
       this->element_markers_conversion.conversion_table_inverse.clear();
       this->refinements.clear();
       this->seq = -1;
+
+      delete this->face_connectivity;
+      this->face_connectivity = NULL;
     }
 
     void Mesh::copy_converted(Mesh* mesh)
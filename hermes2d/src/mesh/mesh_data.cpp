@@ -14,6 +14,8 @@
 // along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
 
 # include "mesh_data.h"
+# include "binary_file.h"
+# include <cstring>
 
 namespace Hermes
 {
@@ -82,412 +84,370 @@ namespace Hermes
       return *this;
     }
 
-    void MeshData::strip(std::string& str)
+
+    /// Powers of ten exactly representable in a double.
+    static const double exact_powers_of_ten[23] =
+    {
+      1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    static inline bool is_digit(char c)
+    {
+      return c >= '0' && c <= '9';
+    }
+
+    bool MeshData::is_number(const char* begin, const char* end, bool allow_point)
     {
-      std::string temp;
+      // The same test the parser used to do by reading the token into an int / double from a stream.
+      const char* p = begin;
+      if(p < end && (*p == '+' || *p == '-'))
+        p++;
+      if(p < end && is_digit(*p))
+        return true;
+      return allow_point && p + 1 < end && *p == '.' && is_digit(p[1]);
+    }
 
-      // Remove comments
-      if(str.find('#') != str.npos)
-        str.erase(str.find('#'));
+    int MeshData::parse_int(const char* begin, const char* end)
+    {
+      // Same as atoi() on the token: an optional sign and the leading digits.
+      const char* p = begin;
+      bool negative = false;
+      if(p < end && (*p == '+' || *p == '-'))
+        negative = (*p++ == '-');
+      long value = 0;
+      for(; p < end && is_digit(*p); p++)
+        value = 10 * value + (*p - '0');
+      return (int)(negative ? -value : value);
+    }
 
-      // Remove brackets, commas and unnecessary tab spaces
-      for (size_t i = 0; i < str.length(); i++)
+    double MeshData::parse_double(const char* begin, const char* end)
+    {
+      // Same as atof() on the token. Up to 19 significant digits with a small exponent, the mantissa is an exact integer
+      // and one multiplication or division by an exact power of ten gives the correctly rounded result,
+      // anything else (rare in mesh files) is left to strtod().
+      const char* p = begin;
+      bool negative = false;
+      if(p < end && (*p == '+' || *p == '-'))
+        negative = (*p++ == '-');
+
+      unsigned long long mantissa = 0;
+      int significant_digits = 0, exponent = 0;
+      for(; p < end && is_digit(*p); p++)
       {
-        //if(str[i] != ' ' && str[i] != '\t' && str[i] != '[' && str[i] != ']' && str[i] != '{' && str[i] != '}' && str[i] != '"')
-        if(str[i] != '\t' && str[i] != '[' && str[i] != ']' && str[i] != '{' && str[i] != '}')
+        if(mantissa > 0 || *p != '0')
+          significant_digits++;
+        mantissa = 10 * mantissa + (*p - '0');
+      }
+      if(p < end && *p == '.')
+      {
+        for(p++; p < end && is_digit(*p); p++)
         {
-          if(str[i] == ',' || str[i] == ';')
-            temp.append("\t");
-          else if(str[i] == '=')
-            temp.append("=\t");
-          else
-            temp.append(1,str[i]);
+          if(mantissa > 0 || *p != '0')
+            significant_digits++;
+          mantissa = 10 * mantissa + (*p - '0');
+          exponent--;
         }
       }
-
-      str.assign(temp);
-      temp.clear();
-
-      // Remove leading whitespaces
-      str.erase(0,str.find_first_not_of("\t "));
-
-      // Remove trailing whitespaces
-      if(str.find_last_of("\t ") == (str.size() - 1))
-        str.erase(str.find_last_not_of("\t ") + 1);
-
-      // Remove unnecessary blank spaces
-      for (size_t i = 0; i < str.length(); i++)
+      if(p + 1 < end && (*p == 'e' || *p == 'E'))
       {
-        if(str[i] == ' ')
+        const char* q = p + 1;
+        bool negative_exponent = false;
+        if(*q == '+' || *q == '-')
+          negative_exponent = (*q++ == '-');
+        if(q < end && is_digit(*q))
         {
-          if(str[i + 1] != ' ' && str[i + 1] != '\t' && str[i + 1] != '=' && str[i - 1] != ' ' && str[i - 1] != '\t')
-            temp.append(1,';'); // Meaningful blank spaces are temporarily replaced with ';'
+          int exponent_value = 0;
+          for(; q < end && is_digit(*q); q++)
+            if(exponent_value < 10000)
+              exponent_value = 10 * exponent_value + (*q - '0');
+          exponent += negative_exponent ? -exponent_value : exponent_value;
         }
-        else
-          temp.append(1,str[i]);
       }
 
-      str.assign(temp);
+      if(significant_digits <= 19 && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+      {
+        double value = (double)mantissa;
+        value = exponent < 0 ? value / exact_powers_of_ten[-exponent] : value * exact_powers_of_ten[exponent];
+        return negative ? -value : value;
+      }
+      return atof(std::string(begin, end).c_str());
     }
 
-    std::string MeshData::restore(std::string &str)
+    std::string MeshData::to_string(const char* begin, const char* end)
     {
-      std::string temp;
-
-      for (size_t i = 0; i < str.length(); i++)
-      {
-        if(str[i] != '"')
-        {
-          if(str[i] == ';')
-            temp.append(1,' ');
-          else
-            temp.append(1,str[i]);
-        }
-      }
+      // Quotes are not part of the names.
+      std::string str;
+      str.reserve(end - begin);
+      for(const char* p = begin; p < end; p++)
+        if(*p != '"')
+          str.push_back(*p);
+      return str;
+    }
 
-      str.assign(temp);
-      return temp;
+    const std::string& MeshData::variable_value(const char* begin, const char* end)
+    {
+      std::string name = to_string(begin, end);
+      std::map<std::string, std::vector<std::string> >::const_iterator it = vars_.find(name);
+      if(it == vars_.end() || it->second.empty())
+        throw Hermes::Exceptions::MeshLoadFailureException("File %s: '%s' is neither a number nor a defined variable.", mesh_file_.c_str(), name.c_str());
+      return it->second[0];
     }
 
-    void MeshData::parse_mesh(void)
+    int MeshData::token_to_int(const Token& token)
     {
-      std::vector<std::string> varlist;
+      if(is_number(token.begin, token.end, false))
+        return parse_int(token.begin, token.end);
+      const std::string& value = variable_value(token.begin, token.end);
+      return parse_int(value.c_str(), value.c_str() + value.length());
+    }
 
-      int dummy_int;
-      double dummy_dbl;
+    double MeshData::token_to_double(const Token& token)
+    {
+      if(is_number(token.begin, token.end, true))
+        return parse_double(token.begin, token.end);
+      const std::string& value = variable_value(token.begin, token.end);
+      return parse_double(value.c_str(), value.c_str() + value.length());
+    }
 
-      std::ifstream inFile(mesh_file_.c_str());
-      std::string line, word, temp_word, next_word;
+    void MeshData::split_line(const char* begin, const char* end)
+    {
+      tokens_.clear();
 
-      int counter(0);
-      bool isVert(false), isElt(false), isBdy(false), isCurv(false), isRef(false), isVar(false);
+      // Comments.
+      const char* comment = (const char*)memchr(begin, '#', end - begin);
+      if(comment != NULL)
+        end = comment;
 
-      while (std::getline(inFile,line))
+      // Brackets and tabs are left out, commas and semicolons separate the tokens, '=' ends a token.
+      line_.clear();
+      for(const char* p = begin; p < end; p++)
       {
-        // Remove all comments, unnecessary blank spaces, commas and paranthesis
-        strip(line);
+        switch(*p)
+        {
+        case '\t': case '[': case ']': case '{': case '}': case '\r':
+          break;
+        case ',': case ';':
+          line_.push_back('\t');
+          break;
+        case '=':
+          line_.push_back('=');
+          line_.push_back('\t');
+          break;
+        default:
+          line_.push_back(*p);
+        }
+      }
 
-        if(line.find_first_not_of("\t ") != line.npos)
+      size_t first = line_.find_first_not_of("\t ");
+      if(first == std::string::npos)
+        return;
+      size_t last = line_.find_last_not_of("\t ") + 1;
+
+      // A single blank between two characters belongs to the token (e.g. a marker "Outer boundary"), other blanks are
+      // left out. The line is compacted in place, the tokens point into line_.
+      char* data = &line_[0];
+      size_t written = first;
+      char prev = '\t';
+      bool in_token = false;
+      for(size_t i = first; i < last; i++)
+      {
+        char c = data[i];
+        if(c == ' ')
         {
-          std::istringstream stream(line);
-          stream >> word;
+          char next = data[i + 1];
+          bool keep = (next != ' ' && next != '\t' && next != '=' && prev != ' ' && prev != '\t');
+          prev = c;
+          if(!keep)
+            continue;
+        }
+        else
+          prev = c;
 
-          if(*word.rbegin() == '=')
-          {
-            word.erase(word.size() - 1);
+        if(c == '\t')
+        {
+          if(in_token)
+            tokens_.back().end = data + written;
+          in_token = false;
+        }
+        else if(!in_token)
+        {
+          Token token = { data + written, NULL };
+          tokens_.push_back(token);
+          in_token = true;
+        }
+        data[written++] = c;
+      }
+      if(in_token)
+        tokens_.back().end = data + written;
+    }
 
-            if(word == "vertices")
-            {
-              isVert = true;
-              isElt = false; isBdy = false; isCurv = false; isRef = false; isVar = false;
-              counter = -1;
-            }
-            else if(word == "elements")
-            {
-              isElt = true;
-              isVert = false; isBdy = false; isCurv = false; isRef = false; isVar = false;
-              counter = -1;
-            }
-            else if(word == "boundaries")
-            {
-              isBdy = true;
-              isVert = false; isElt = false; isCurv = false; isRef = false; isVar = false;
-              counter = -1;
-            }
-            else if(word == "curves")
-            {
-              isCurv = true;
-              isVert = false; isElt = false; isBdy = false; isRef = false; isVar = false;
-              counter = -1;
-            }
-            else if(word == "refinements")
-            {
-              isRef = true;
-              isVert = false; isElt = false; isBdy = false; isCurv = false; isVar = false;
-              counter = -1;
-            }
-            else
-            {
-              isVar = true;
-              isVert = false; isElt = false; isBdy = false; isCurv = false; isRef = false;
-              counter = -1;
+    void MeshData::parse_mesh(void)
+    {
+      enum Section { none, vertices, elements, boundaries, curves, refinements, variable };
+      Section section = none;
+      std::string variable_name;
+      int counter = 0;
+      Token inner_points = { NULL, NULL };
 
-              temp_word = restore(word);
-            }
-          }
+      Hermes::MappedFile file(mesh_file_.c_str());
+      const char* data = file.get_data();
+      const char* file_end = data + file.get_size();
 
-          if(counter == -1)
-            counter = 0;
+      for(const char* line_begin = data; line_begin < file_end; )
+      {
+        const char* line_end = (const char*)memchr(line_begin, '\n', file_end - line_begin);
+        if(line_end == NULL)
+          line_end = file_end;
+        split_line(line_begin, line_end);
+        line_begin = line_end + 1;
+
+        if(tokens_.empty())
+          continue;
+
+        // A section or a variable starts by "name =" at the beginning of a line.
+        size_t first_token = 0;
+        if(*(tokens_[0].end - 1) == '=')
+        {
+          std::string name = to_string(tokens_[0].begin, tokens_[0].end - 1);
+          if(name == "vertices")
+            section = vertices;
+          else if(name == "elements")
+            section = elements;
+          else if(name == "boundaries")
+            section = boundaries;
+          else if(name == "curves")
+            section = curves;
+          else if(name == "refinements")
+            section = refinements;
           else
           {
-            if(isVert)
-            {
-              std::istringstream istr(word);
-
-              if(!(istr >> dummy_dbl))
-                x_vertex.push_back(atof(vars_[restore(word)][0].c_str()));
-              else
-                x_vertex.push_back(atof(word.c_str()));
-
-              ++counter;
-            }
-            if(isElt)
-            {
-              std::istringstream istr(word);
-
-              if(!(istr >> dummy_int))
-                en1.push_back(atoi(vars_[restore(word)][0].c_str()));
-              else
-                en1.push_back(atoi(word.c_str()));
-
-              ++counter;
-            }
-            else if(isBdy)
-            {
-              std::istringstream istr(word);
-
-              if(!(istr >> dummy_dbl))
-                bdy_first.push_back(atof(vars_[restore(word)][0].c_str()));
-              else
-                bdy_first.push_back(atof(word.c_str()));
-
-              ++counter;
-            }
-            else if(isCurv)
-            {
-              std::istringstream istr(word);
-
-              if(!(istr >> dummy_int))
-                curv_first.push_back(atoi(vars_[restore(word)][0].c_str()));
-              else
-                curv_first.push_back(atoi(word.c_str()));
-
-              ++counter;
-            }
-            else if(isRef)
-            {
-              std::istringstream istr(word);
-
-              if(!(istr >> dummy_int))
-                ref_elt.push_back(atoi(vars_[restore(word)][0].c_str()));
-              else
-                ref_elt.push_back(atoi(word.c_str()));
-
-              ++counter;
-            }
-            else if(isVar)
-            {
-              vars_[temp_word].push_back(restore(word));
-              ++counter;
-            }
+            section = variable;
+            variable_name = name;
           }
+          counter = 0;
+          first_token = 1;
+        }
 
-          if(isVert)
+        for(size_t token_i = first_token; token_i < tokens_.size(); token_i++, counter++)
+        {
+          const Token& token = tokens_[token_i];
+          switch(section)
           {
-            while (stream >> word)
-            {
-              std::istringstream istr(word);
+          case vertices:
+            if(counter % 2 == 0)
+              x_vertex.push_back(token_to_double(token));
+            else
+              y_vertex.push_back(token_to_double(token));
+            break;
 
-              if(counter%2 == 0)
-              {
-                if(!(istr >> dummy_dbl))
-                  x_vertex.push_back(atof(vars_[restore(word)][0].c_str()));
-                else
-                  x_vertex.push_back(atof(word.c_str()));
-              }
+          case elements:
+            switch(counter % 5)
+            {
+            case 0:
+              en1.push_back(token_to_int(token));
+              break;
+            case 1:
+              en2.push_back(token_to_int(token));
+              break;
+            case 2:
+              en3.push_back(token_to_int(token));
+              break;
+            case 3:
+              // Triangles have the marker in place of the fourth vertex.
+              if(is_number(token.begin, token.end, false))
+                en4.push_back(parse_int(token.begin, token.end));
               else
               {
-                if(!(istr >> dummy_dbl))
-                  y_vertex.push_back(atof(vars_[restore(word)][0].c_str()));
-                else
-                  y_vertex.push_back(atof(word.c_str()));
+                en4.push_back(-1);
+                e_mtl.push_back(to_string(token.begin, token.end));
+                counter++;
               }
-
-              ++counter;
+              break;
+            case 4:
+              e_mtl.push_back(to_string(token.begin, token.end));
+              break;
             }
-          }
-          else if(isElt)
-          {
-            while (stream >> word)
-            {
-              std::istringstream istr(word);
+            break;
 
-              if(counter%5 == 0)
-              {
-                if(!(istr >> dummy_int))
-                  en1.push_back(atoi(vars_[restore(word)][0].c_str()));
-                else
-                  en1.push_back(atoi(word.c_str()));
-              }
-              else if(counter%5 == 1)
-              {
-                if(!(istr >> dummy_int))
-                  en2.push_back(atoi(vars_[restore(word)][0].c_str()));
-                else
-                  en2.push_back(atoi(word.c_str()));
-              }
-              else if(counter%5 == 2)
-              {
-                if(!(istr >> dummy_int))
-                  en3.push_back(atoi(vars_[restore(word)][0].c_str()));
-                else
-                  en3.push_back(atoi(word.c_str()));
-              }
-              else if(counter%5 == 3)
-              {
-                if(!(istr >> dummy_int))
-                {
-                  en4.push_back(-1);
-                  e_mtl.push_back(restore(word));
-
-                  ++counter;
-                }
-                else
-                  en4.push_back(atoi(word.c_str()));
-              }
-              else
-                e_mtl.push_back(restore(word));
+          case boundaries:
+            if(counter % 3 == 0)
+              bdy_first.push_back(token_to_int(token));
+            else if(counter % 3 == 1)
+              bdy_second.push_back(token_to_int(token));
+            else
+              bdy_type.push_back(to_string(token.begin, token.end));
+            break;
 
-              ++counter;
-            }
-          }
-          else if(isBdy)
-          {
-            while (stream >> word)
+          case curves:
+            switch(counter % 5)
             {
-              std::istringstream istr(word);
-
-              if(counter%3 == 0)
+            case 0:
+              curv_first.push_back(token_to_int(token));
+              break;
+            case 1:
+              curv_second.push_back(token_to_int(token));
+              break;
+            case 2:
+              curv_third.push_back(token_to_double(token));
+              // A circular arc ends the line, a NURBS curve continues by the names of the lists of control points and knots.
+              if(token_i + 1 == tokens_.size())
               {
-                if(!(istr >> dummy_int))
-                  bdy_first.push_back(atoi(vars_[restore(word)][0].c_str()));
-                else
-                  bdy_first.push_back(atoi(word.c_str()));
-              }
-              else if(counter%3 == 1)
-              {
-                if(!(istr >> dummy_int))
-                  bdy_second.push_back(atoi(vars_[restore(word)][0].c_str()));
-                else
-                  bdy_second.push_back(atoi(word.c_str()));
+                curv_nurbs.push_back(false);
+                curv_inner_pts.push_back("none");
+                curv_knots.push_back("none");
+                counter += 2;
               }
               else
-                bdy_type.push_back(restore(word));
-
-              ++counter;
-            }
-          }
-          else if(isCurv)
-          {
-            while (stream >> word)
-            {
-              std::istringstream istr(word);
-
-              if(counter%5 == 0)
-              {
-                if(!(istr >> dummy_int))
-                  curv_first.push_back(atoi(vars_[restore(word)][0].c_str()));
-                else
-                  curv_first.push_back(atoi(word.c_str()));
-              }
-              else if(counter%5 == 1)
-              {
-                if(!(istr >> dummy_int))
-                  curv_second.push_back(atoi(vars_[restore(word)][0].c_str()));
-                else
-                  curv_second.push_back(atoi(word.c_str()));
-              }
-              else if(counter%5 == 2)
-              {
-                if(istr >> dummy_dbl)
-                {
-                  curv_third.push_back(atof(word.c_str()));
-                }
-                else
-                {
-                  curv_third.push_back(atof(vars_[restore(word)][0].c_str()));
-                }
-
-                stream >> next_word;
-
-                if(next_word == "")
-                {
-                  curv_nurbs.push_back(false);
-
-                  curv_inner_pts.push_back("none");
-                  curv_knots.push_back("none");
-
-                  counter += 2;
-                }
-                else
-                {
-                  curv_nurbs.push_back(true);
-                }
-              }
-              else if(counter%5 == 3)
               {
-                curv_inner_pts.push_back(restore(next_word));
-                curv_knots.push_back(restore(word));
-                ++counter;
+                curv_nurbs.push_back(true);
+                inner_points = tokens_[++token_i];
               }
-
-              ++counter;
+              break;
+            case 3:
+              curv_inner_pts.push_back(to_string(inner_points.begin, inner_points.end));
+              curv_knots.push_back(to_string(token.begin, token.end));
+              counter++;
+              break;
             }
-          }
-          else if(isRef)
-          {
-            while (stream >> word)
-            {
-              std::istringstream istr(word);
+            break;
 
-              if(counter%2 == 0)
-              {
-                if(!(istr >> dummy_int))
-                  ref_elt.push_back(atoi(vars_[restore(word)][0].c_str()));
-                else
-                  ref_elt.push_back(atoi(word.c_str()));
-              }
-              else
-              {
-                if(!(istr >> dummy_int))
-                  ref_type.push_back(atoi(vars_[restore(word)][0].c_str()));
-                else
-                  ref_type.push_back(atoi(word.c_str()));
-              }
+          case refinements:
+            if(counter % 2 == 0)
+              ref_elt.push_back(token_to_int(token));
+            else
+              ref_type.push_back(token_to_int(token));
+            break;
 
-              ++counter;
-            }
-          }
-          else if(isVar)
-          {
-            while (stream >> word)
-            {
-              vars_[temp_word].push_back(restore(word));
-              ++counter;
-            }
+          case variable:
+            vars_[variable_name].push_back(to_string(token.begin, token.end));
+            break;
+
+          case none:
+            break;
           }
         }
       }
 
-      assert(x_vertex.size() == y_vertex.size());
+      if(x_vertex.size() != y_vertex.size())
+        throw Hermes::Exceptions::MeshLoadFailureException("File %s: incomplete vertex.", mesh_file_.c_str());
       n_vert = x_vertex.size();
 
-      assert(en1.size() == en2.size());
-      assert(en2.size() == en3.size());
-      assert(en3.size() == en4.size());
-      assert(en4.size() == e_mtl.size());
+      if(en1.size() != en2.size() || en2.size() != en3.size() || en3.size() != en4.size() || en4.size() != e_mtl.size())
+        throw Hermes::Exceptions::MeshLoadFailureException("File %s: incomplete element.", mesh_file_.c_str());
       n_el = en1.size();
 
-      assert(bdy_first.size() == bdy_second.size());
-      assert(bdy_first.size() == bdy_type.size());
+      if(bdy_first.size() != bdy_second.size() || bdy_first.size() != bdy_type.size())
+        throw Hermes::Exceptions::MeshLoadFailureException("File %s: incomplete boundary edge.", mesh_file_.c_str());
       n_bdy = bdy_first.size();
 
-      assert(curv_first.size() == curv_second.size());
-
+      if(curv_first.size() != curv_second.size() || curv_first.size() != curv_third.size() || curv_first.size() != curv_knots.size())
+        throw Hermes::Exceptions::MeshLoadFailureException("File %s: incomplete curve.", mesh_file_.c_str());
       n_curv = curv_first.size();
 
-      assert(ref_elt.size() == ref_type.size());
+      if(ref_elt.size() != ref_type.size())
+        throw Hermes::Exceptions::MeshLoadFailureException("File %s: incomplete refinement.", mesh_file_.c_str());
       n_ref = ref_elt.size();
     }
   }
-}
\ No newline at end of file
+}
@@ -177,21 +177,21 @@ namespace Hermes
       if(n < 0) throw Hermes::Exceptions::MeshLoadFailureException("File %s: 'vertices' must be a list.", filename);
       if(n < 2) throw Hermes::Exceptions::MeshLoadFailureException("File %s: invalid number of vertices.", filename);
 
-      // create a hash table large enough
-      int size = HashTable::H2D_DEFAULT_HASH_SIZE;
-      while (size < 8*n) size *= 2;
-      mesh->init(size);
-
-      // create top-level vertex nodes
+      // create a hash table large enough for all the base edges
+      // (by Euler's formula there are at most n_vert + n_el of them)
+      mesh->init();
+      mesh->reserve(0, n + m.n_el);
+
+      // create top-level vertex nodes, all at once
+      int first_vertex = mesh->nodes.append(n);
+      assert(first_vertex == 0);
       for (i = 0; i < n; i++)
       {
-        Node* node = mesh->nodes.add();
-        assert(node->id == i);
+        Node* node = &mesh->nodes[i];
         node->ref = TOP_LEVEL_REF;
         node->type = HERMES_TYPE_VERTEX;
         node->bnd = 0;
         node->p1 = node->p2 = -1;
-        node->next_hash = NULL;
         node->x = m.x_vertex[i];
         node->y = m.y_vertex[i];
       }
@@ -204,59 +204,33 @@ namespace Hermes
       if(n < 1) throw Hermes::Exceptions::MeshLoadFailureException("File %s: no elements defined.", filename);
 
       // create elements
+      // neighbouring elements mostly share the marker, the conversion is only looked up when it changes
+      const std::string* last_marker = NULL;
+      int last_internal_marker = 0;
       mesh->nactive = 0;
       for (i = 0; i < n; i++)
       {
         // read and check vertex indices
-        int nv;
-        if(m.en4[i] == -1)  nv = 4;
-        else nv = 5;
-
-        int* idx = new int[nv-1];
-        std::string el_marker;
-        if(!nv) {
-          mesh->elements.skip_slot();
-          continue;
-        }
-
-        if(nv < 4 || nv > 5)
-        {
-          delete [] idx;
-          throw Hermes::Exceptions::MeshLoadFailureException("File %s: element #%d: wrong number of vertex indices.", filename, i);
-        }
+        int nv = (m.en4[i] == -1) ? 3 : 4;
+        int idx[4] = { m.en1[i], m.en2[i], m.en3[i], m.en4[i] };
 
-        if(nv == 4) {
-          idx[0] = m.en1[i];
-          idx[1] = m.en2[i];
-          idx[2] = m.en3[i];
-
-          el_marker = m.e_mtl[i];
-        }
-        else {
-          idx[0] = m.en1[i];
-          idx[1] = m.en2[i];
-          idx[2] = m.en3[i];
-          idx[3] = m.en4[i];
-
-          el_marker = m.e_mtl[i];
-        }
-        for (j = 0; j < nv-1; j++)
+        for (j = 0; j < nv; j++)
           if(idx[j] < 0 || idx[j] >= mesh->ntopvert)
-          {
-            delete [] idx;
             throw Hermes::Exceptions::MeshLoadFailureException("File %s: error creating element #%d: vertex #%d does not exist.", filename, i, idx[j]);
-          }
 
         Node *v0 = &mesh->nodes[idx[0]], *v1 = &mesh->nodes[idx[1]], *v2 = &mesh->nodes[idx[2]];
 
-        int marker;
-
         // This functions check if the user-supplied marker on this element has been
         // already used, and if not, inserts it in the appropriate structure.
-        mesh->element_markers_conversion.insert_marker(mesh->element_markers_conversion.min_marker_unused, el_marker);
-        marker = mesh->element_markers_conversion.get_internal_marker(el_marker).marker;
+        if(last_marker == NULL || *last_marker != m.e_mtl[i])
+        {
+          last_marker = &m.e_mtl[i];
+          mesh->element_markers_conversion.insert_marker(mesh->element_markers_conversion.min_marker_unused, *last_marker);
+          last_internal_marker = mesh->element_markers_conversion.get_internal_marker(*last_marker).marker;
+        }
+        int marker = last_internal_marker;
 
-        if(nv == 4) {
+        if(nv == 3) {
           Mesh::check_triangle(i, v0, v1, v2);
           mesh->create_triangle(marker, v0, v1, v2, NULL);
         }
@@ -267,8 +241,6 @@ namespace Hermes
         }
 
         mesh->nactive++;
-
-        delete [] idx;
       }
       mesh->nbase = n;
 
@@ -278,6 +250,8 @@ namespace Hermes
         n = m.n_bdy;
 
         // read boundary data
+        const std::string* last_marker = NULL;
+        int last_internal_marker = 0;
         for (i = 0; i < n; i++)
         {
           int v1, v2, marker;
@@ -288,13 +262,15 @@ namespace Hermes
           if(en == NULL)
             throw Hermes::Exceptions::MeshLoadFailureException("File %s: boundary data #%d: edge %d-%d does not exist", filename, i, v1, v2);
 
-          std::string bnd_marker;
-          bnd_marker = m.bdy_type[i];
-
           // This functions check if the user-supplied marker on this element has been
           // already used, and if not, inserts it in the appropriate structure.
-          mesh->boundary_markers_conversion.insert_marker(mesh->boundary_markers_conversion.min_marker_unused, bnd_marker);
-          marker = mesh->boundary_markers_conversion.get_internal_marker(bnd_marker).marker;
+          if(last_marker == NULL || *last_marker != m.bdy_type[i])
+          {
+            last_marker = &m.bdy_type[i];
+            mesh->boundary_markers_conversion.insert_marker(mesh->boundary_markers_conversion.min_marker_unused, *last_marker);
+            last_internal_marker = mesh->boundary_markers_conversion.get_internal_marker(*last_marker).marker;
+          }
+          marker = last_internal_marker;
 
           en->marker = marker;
 
@@ -0,0 +1,417 @@
+// This file is part of Hermes2D
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, see <http://www.gnu.prg/licenses/>.
+
+#include "mesh.h"
+#include "mesh_reader_h2d_binary.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// Layout of the file (version 1), all arrays are written by BinaryFileWriter:
+    /// - int[5]: number of vertices, elements, boundary edges, curves and refinements,
+    /// - double[2 * vertices]: vertex coordinates,
+    /// - element marker names, boundary marker names: chars of all names, int[names + 1] offsets of the names,
+    /// - int[5 * elements]: vertices (the fourth one is -1 for triangles) and the index of the marker name,
+    /// - int[3 * boundary edges]: vertices and the index of the marker name,
+    /// - int[5 * curves]: end vertices, degree, number of control points and the arc flag,
+    /// - double[curves]: arc angles, double[]: inner control points (x, y, weight) of all curves, double[]: knot vectors of all curves,
+    /// - int[2 * refinements]: element id and refinement type (Mesh::refinements).
+    static const char* mesh_binary_type = "H2DMESH";
+
+    /// Marker names in the order of their first use, this is the order in which internal markers are assigned on loading.
+    class MarkerNames
+    {
+    public:
+      int index(const std::string& name)
+      {
+        std::map<std::string, int>::iterator it = this->indices.find(name);
+        if(it != this->indices.end())
+          return it->second;
+        int index = this->offsets.size();
+        this->indices.insert(std::pair<std::string, int>(name, index));
+        this->chars.append(name);
+        this->offsets.push_back(this->chars.length());
+        return index;
+      }
+
+      void write(BinaryFileWriter& writer)
+      {
+        std::vector<int> all_offsets(1, 0);
+        all_offsets.insert(all_offsets.end(), this->offsets.begin(), this->offsets.end());
+        writer.write_string(this->chars);
+        writer.write_array(&all_offsets[0], all_offsets.size());
+      }
+
+    protected:
+      std::map<std::string, int> indices;
+      std::string chars;
+      std::vector<int> offsets;
+    };
+
+    std::vector<int> MeshReaderH2DBinary::read_marker_names(BinaryFileReader& reader, Mesh::MarkersConversion& conversion)
+    {
+      uint64_t chars_count, offsets_count;
+      const char* chars = reader.read_array<char>(chars_count);
+      const int* offsets = reader.read_array<int>(offsets_count);
+
+      std::vector<int> internal_markers;
+      for(uint64_t i = 0; i + 1 < offsets_count; i++)
+      {
+        if(offsets[i] < 0 || offsets[i] > offsets[i + 1] || offsets[i + 1] > (int)chars_count)
+          throw Hermes::Exceptions::MeshLoadFailureException("Corrupted marker names.");
+        std::string name(chars + offsets[i], offsets[i + 1] - offsets[i]);
+        conversion.insert_marker(conversion.min_marker_unused, name);
+        internal_markers.push_back(conversion.get_internal_marker(name).marker);
+      }
+      return internal_markers;
+    }
+
+    MeshReaderH2DBinary::MeshReaderH2DBinary()
+    {
+    }
+
+    MeshReaderH2DBinary::~MeshReaderH2DBinary()
+    {
+    }
+
+    Nurbs* MeshReaderH2DBinary::create_nurbs(Mesh *mesh, int p1, int p2, int degree, int np, bool arc, double angle, const double* inner_points, const double* knots)
+    {
+      Nurbs* nurbs = new Nurbs;
+      nurbs->arc = arc;
+      nurbs->angle = angle;
+      nurbs->degree = degree;
+      nurbs->np = np;
+      nurbs->nk = degree + np + 1;
+
+      // edge endpoints are also control points, with weight 1.0
+      nurbs->pt = new double3[np];
+      nurbs->pt[0][0] = mesh->nodes[p1].x;
+      nurbs->pt[0][1] = mesh->nodes[p1].y;
+      nurbs->pt[0][2] = 1.0;
+      memcpy(nurbs->pt + 1, inner_points, (np - 2) * sizeof(double3));
+      nurbs->pt[np - 1][0] = mesh->nodes[p2].x;
+      nurbs->pt[np - 1][1] = mesh->nodes[p2].y;
+      nurbs->pt[np - 1][2] = 1.0;
+
+      nurbs->kv = new double[nurbs->nk];
+      memcpy(nurbs->kv, knots, nurbs->nk * sizeof(double));
+
+      nurbs->ref = 0;
+      return nurbs;
+    }
+
+    bool MeshReaderH2DBinary::load(const char *filename, Mesh *mesh)
+    {
+      mesh->free();
+
+      try
+      {
+        BinaryFileReader reader(filename, mesh_binary_type, format_version);
+
+        int counts[5];
+        reader.read_array(counts, 5);
+        int vertices_count = counts[0], elements_count = counts[1], edges_count = counts[2], curves_count = counts[3], refinements_count = counts[4];
+
+        // Vertices //
+        int size = HashTable::H2D_DEFAULT_HASH_SIZE;
+        while (size < 8 * vertices_count)
+          size *= 2;
+        mesh->init(size);
+
+        uint64_t count;
+        const double* coords = reader.read_array<double>(count);
+        if(count != 2 * (uint64_t)vertices_count)
+          throw Hermes::Exceptions::MeshLoadFailureException("Corrupted vertices in %s.", filename);
+        for (int vertex_i = 0; vertex_i < vertices_count; vertex_i++)
+        {
+          Node* node = mesh->nodes.add();
+          assert(node->id == vertex_i);
+          node->ref = TOP_LEVEL_REF;
+          node->type = HERMES_TYPE_VERTEX;
+          node->bnd = 0;
+          node->p1 = node->p2 = -1;
+          node->x = coords[2 * vertex_i];
+          node->y = coords[2 * vertex_i + 1];
+        }
+        mesh->ntopvert = vertices_count;
+
+        std::vector<int> element_markers = read_marker_names(reader, mesh->element_markers_conversion);
+        std::vector<int> boundary_markers = read_marker_names(reader, mesh->boundary_markers_conversion);
+
+        // Elements //
+        const int* elements = reader.read_array<int>(count);
+        if(count != 5 * (uint64_t)elements_count)
+          throw Hermes::Exceptions::MeshLoadFailureException("Corrupted elements in %s.", filename);
+        mesh->nbase = mesh->nactive = mesh->ninitial = elements_count;
+        for (int element_i = 0; element_i < elements_count; element_i++)
+        {
+          const int* element = elements + 5 * element_i;
+          int nv = element[3] < 0 ? 3 : 4;
+          for(int j = 0; j < nv; j++)
+            if(element[j] < 0 || element[j] >= vertices_count)
+              throw Hermes::Exceptions::MeshLoadFailureException("Element #%d: vertex %d does not exist.", element_i, element[j]);
+          if(element[4] < 0 || element[4] >= (int)element_markers.size())
+            throw Hermes::Exceptions::MeshLoadFailureException("Element #%d: wrong marker.", element_i);
+
+          if(nv == 4)
+            mesh->create_quad(element_markers[element[4]], &mesh->nodes[element[0]], &mesh->nodes[element[1]], &mesh->nodes[element[2]], &mesh->nodes[element[3]], NULL);
+          else
+            mesh->create_triangle(element_markers[element[4]], &mesh->nodes[element[0]], &mesh->nodes[element[1]], &mesh->nodes[element[2]], NULL);
+        }
+
+        // Boundaries //
+        const int* edges = reader.read_array<int>(count);
+        if(count != 3 * (uint64_t)edges_count)
+          throw Hermes::Exceptions::MeshLoadFailureException("Corrupted boundary edges in %s.", filename);
+        Node* en;
+        for (int edge_i = 0; edge_i < edges_count; edge_i++)
+        {
+          int v1 = edges[3 * edge_i], v2 = edges[3 * edge_i + 1];
+          if(v1 < 0 || v1 >= vertices_count || v2 < 0 || v2 >= vertices_count || (en = mesh->peek_edge_node(v1, v2)) == NULL)
+            throw Hermes::Exceptions::MeshLoadFailureException("Boundary data #%d: edge %d-%d does not exist.", edge_i, v1, v2);
+          if(edges[3 * edge_i + 2] < 0 || edges[3 * edge_i + 2] >= (int)boundary_markers.size())
+            throw Hermes::Exceptions::MeshLoadFailureException("Boundary data #%d: wrong marker.", edge_i);
+
+          int marker = boundary_markers[edges[3 * edge_i + 2]];
+          en->marker = marker;
+
+          // Negative boundary markers are reserved for the inner edges in DG.
+          if(marker > 0)
+          {
+            mesh->nodes[v1].bnd = 1;
+            mesh->nodes[v2].bnd = 1;
+            en->bnd = 1;
+          }
+        }
+
+        // check that all boundary edges have a marker assigned
+        for_all_edge_nodes(en, mesh)
+          if(en->ref < 2 && en->marker == 0)
+            this->warn("Boundary edge node does not have a boundary marker.");
+
+        // Curves //
+        const int* curves = reader.read_array<int>(count);
+        if(count != 5 * (uint64_t)curves_count)
+          throw Hermes::Exceptions::MeshLoadFailureException("Corrupted curves in %s.", filename);
+        uint64_t inner_points_count, knots_count;
+        const double* angles = reader.read_array<double>(count);
+        const double* inner_points = reader.read_array<double>(inner_points_count);
+        const double* knots = reader.read_array<double>(knots_count);
+        if(count != (uint64_t)curves_count)
+          throw Hermes::Exceptions::MeshLoadFailureException("Corrupted curves in %s.", filename);
+
+        uint64_t inner_points_used = 0, knots_used = 0;
+        for (int curves_i = 0; curves_i < curves_count; curves_i++)
+        {
+          const int* curve = curves + 5 * curves_i;
+          int p1 = curve[0], p2 = curve[1], degree = curve[2], np = curve[3];
+          if(p1 < 0 || p1 >= vertices_count || p2 < 0 || p2 >= vertices_count || (en = mesh->peek_edge_node(p1, p2)) == NULL)
+            throw Hermes::Exceptions::MeshLoadFailureException("Curve #%d: edge %d-%d does not exist.", curves_i, p1, p2);
+          if(degree < 1 || np < 2 || inner_points_used + 3 * (np - 2) > inner_points_count || knots_used + degree + np + 1 > knots_count)
+            throw Hermes::Exceptions::MeshLoadFailureException("Curve #%d: corrupted control points or knots.", curves_i);
+
+          Nurbs* nurbs = create_nurbs(mesh, p1, p2, degree, np, curve[4] != 0, angles[curves_i], inner_points + inner_points_used, knots + knots_used);
+          inner_points_used += 3 * (np - 2);
+          knots_used += degree + np + 1;
+
+          // assign the curve to the elements sharing the edge node
+          for (unsigned int node_i = 0; node_i < 2; node_i++)
+          {
+            Element* e = en->elem[node_i];
+            if(e == NULL) continue;
+
+            if(e->cm == NULL)
+            {
+              e->cm = new CurvMap;
+              e->cm->toplevel = true;
+              for (int k = 0; k < H2D_MAX_NUMBER_EDGES; k++)
+                e->cm->nurbs[k] = NULL;
+              e->cm->order = 4;
+              e->cm->nc = 0;
+            }
+
+            int idx = -1;
+            for (int j = 0; j < e->get_nvert(); j++)
+              if(e->en[j] == en) { idx = j; break; }
+            assert(idx >= 0);
+
+            if(e->vn[idx]->id == p1)
+            {
+              e->cm->nurbs[idx] = nurbs;
+              nurbs->ref++;
+            }
+            else
+            {
+              Nurbs* nurbs_rev = mesh->reverse_nurbs(nurbs);
+              e->cm->nurbs[idx] = nurbs_rev;
+              nurbs_rev->ref++;
+            }
+          }
+          if(!nurbs->ref) delete nurbs;
+        }
+
+        // update refmap coeffs of curvilinear elements
+        Element* e;
+        for_all_elements(e, mesh)
+          if(e->cm != NULL)
+            e->cm->update_refmap_coeffs(e);
+
+        // Refinements //
+        const int* refinements = reader.read_array<int>(count);
+        if(count != 2 * (uint64_t)refinements_count)
+          throw Hermes::Exceptions::MeshLoadFailureException("Corrupted refinements in %s.", filename);
+        for (int refinement_i = 0; refinement_i < refinements_count; refinement_i++)
+        {
+          int element_id = refinements[2 * refinement_i];
+          int refinement_type = refinements[2 * refinement_i + 1];
+          if(refinement_type == -1)
+            mesh->unrefine_element_id(element_id);
+          else
+            mesh->refine_element_id(element_id, refinement_type);
+        }
+        mesh->initial_single_check();
+      }
+      catch (Hermes::Exceptions::MeshLoadFailureException&)
+      {
+        throw;
+      }
+      catch (Hermes::Exceptions::Exception& e)
+      {
+        throw Hermes::Exceptions::MeshLoadFailureException("%s", e.what());
+      }
+
+      return true;
+    }
+
+    bool MeshReaderH2DBinary::save(const char *filename, Mesh *mesh)
+    {
+      // Write errors are reported by BinaryFileWriter.
+      BinaryFileWriter writer(filename, mesh_binary_type, format_version);
+      this->write(writer, mesh);
+      writer.close();
+
+      return true;
+    }
+
+    void MeshReaderH2DBinary::save(std::vector<char>& image, Mesh *mesh)
+    {
+      BinaryFileWriter writer(image, mesh_binary_type, format_version);
+      this->write(writer, mesh);
+    }
+
+    void MeshReaderH2DBinary::write(BinaryFileWriter& writer, Mesh *mesh)
+    {
+      // Utility pointer.
+      Element* e;
+
+      // vertices
+      std::vector<double> coords(2 * mesh->ntopvert);
+      for (int i = 0; i < mesh->ntopvert; i++)
+      {
+        coords[2 * i] = mesh->nodes[i].x;
+        coords[2 * i + 1] = mesh->nodes[i].y;
+      }
+
+      // elements
+      MarkerNames element_names;
+      std::vector<int> elements;
+      for (int i = 0; i < mesh->get_num_base_elements(); i++)
+      {
+        e = mesh->get_element_fast(i);
+        if(!e->used)
+          continue;
+        for (int j = 0; j < 4; j++)
+          elements.push_back(j < e->get_nvert() ? e->vn[j]->id : -1);
+        elements.push_back(element_names.index(mesh->get_element_markers_conversion().get_user_marker(e->marker).marker));
+      }
+
+      // boundary markers
+      MarkerNames boundary_names;
+      std::vector<int> edges;
+      for_all_base_elements(e, mesh)
+        for (int i = 0; i < e->get_nvert(); i++)
+          if(mesh->get_base_edge_node(e, i)->marker)
+          {
+            edges.push_back(e->vn[i]->id);
+            edges.push_back(e->vn[e->next_vert(i)]->id);
+            edges.push_back(boundary_names.index(mesh->boundary_markers_conversion.get_user_marker(mesh->get_base_edge_node(e, i)->marker).marker));
+          }
+
+      // curved edges, each edge is saved once: the edge nodes of refined base elements are not available,
+      // so instead of is_twin_nurbs() the curves are matched by their end vertices, preferring the original
+      // curve to its reversed twin
+      std::vector<std::pair<int, int> > curve_vertices;
+      std::vector<Nurbs*> curve_nurbs;
+      std::map<std::pair<int, int>, int> curve_indices;
+      for_all_base_elements(e, mesh)
+        if(e->is_curved())
+          for (int i = 0; i < e->get_nvert(); i++)
+            if(e->cm->nurbs[i] != NULL)
+            {
+              int p1 = e->vn[i]->id, p2 = e->vn[e->next_vert(i)]->id;
+              std::pair<int, int> key(std::min(p1, p2), std::max(p1, p2));
+              std::map<std::pair<int, int>, int>::iterator it = curve_indices.find(key);
+              if(it == curve_indices.end())
+              {
+                curve_indices.insert(std::pair<std::pair<int, int>, int>(key, curve_nurbs.size()));
+                curve_vertices.push_back(std::pair<int, int>(p1, p2));
+                curve_nurbs.push_back(e->cm->nurbs[i]);
+              }
+              else if(curve_nurbs[it->second]->twin && !e->cm->nurbs[i]->twin)
+              {
+                curve_vertices[it->second] = std::pair<int, int>(p1, p2);
+                curve_nurbs[it->second] = e->cm->nurbs[i];
+              }
+            }
+
+      std::vector<int> curves;
+      std::vector<double> angles, inner_points, knots;
+      for (unsigned int curve_i = 0; curve_i < curve_nurbs.size(); curve_i++)
+      {
+        Nurbs* nurbs = curve_nurbs[curve_i];
+        curves.push_back(curve_vertices[curve_i].first);
+        curves.push_back(curve_vertices[curve_i].second);
+        curves.push_back(nurbs->degree);
+        curves.push_back(nurbs->np);
+        curves.push_back(nurbs->arc ? 1 : 0);
+        angles.push_back(nurbs->angle);
+        inner_points.insert(inner_points.end(), &nurbs->pt[1][0], &nurbs->pt[nurbs->np - 1][0]);
+        knots.insert(knots.end(), nurbs->kv, nurbs->kv + nurbs->nk);
+      }
+
+      // refinements
+      std::vector<int> refinements;
+      for(unsigned int refinement_i = 0; refinement_i < mesh->refinements.size(); refinement_i++)
+      {
+        refinements.push_back(mesh->refinements[refinement_i].first);
+        refinements.push_back(mesh->refinements[refinement_i].second);
+      }
+
+      int counts[5] = { mesh->ntopvert, (int)elements.size() / 5, (int)edges.size() / 3, (int)curves.size() / 5, (int)refinements.size() / 2 };
+      writer.write_array(counts, 5);
+      writer.write_array(coords.empty() ? NULL : &coords[0], coords.size());
+      element_names.write(writer);
+      boundary_names.write(writer);
+      writer.write_array(elements.empty() ? NULL : &elements[0], elements.size());
+      writer.write_array(edges.empty() ? NULL : &edges[0], edges.size());
+      writer.write_array(curves.empty() ? NULL : &curves[0], curves.size());
+      writer.write_array(angles.empty() ? NULL : &angles[0], angles.size());
+      writer.write_array(inner_points.empty() ? NULL : &inner_points[0], inner_points.size());
+      writer.write_array(knots.empty() ? NULL : &knots[0], knots.size());
+      writer.write_array(refinements.empty() ? NULL : &refinements[0], refinements.size());
+    }
+  }
+}
@@ -291,7 +291,6 @@ namespace Hermes
               node->type = HERMES_TYPE_VERTEX;
               node->bnd = 0;
               node->p1 = node->p2 = -1;
-              node->next_hash = NULL;
 
               // variables matching.
               std::string x = parsed_xml_domain->vertices().v().at(vertex_number).x();
@@ -819,7 +818,6 @@ namespace Hermes
           node->type = HERMES_TYPE_VERTEX;
           node->bnd = 0;
           node->p1 = node->p2 = -1;
-          node->next_hash = NULL;
 
           // variables matching.
           std::string x = parsed_xml_mesh->vertices().v().at(vertex_i).x();
@@ -1070,7 +1068,6 @@ namespace Hermes
           node->type = HERMES_TYPE_VERTEX;
           node->bnd = 0;
           node->p1 = node->p2 = -1;
-          node->next_hash = NULL;
 
           // variables matching.
           std::string x = parsed_xml_domain->vertices().v().at(vertex_i).x();
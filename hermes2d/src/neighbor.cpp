@@ -160,83 +160,225 @@ namespace Hermes
       //std::cout << std::endl << "central element: " << central_el->id << std::endl;
       if(central_el->en[active_edge]->bnd == 0)
       {
-        neighb_el = central_el->get_neighbor(active_edge);
+        // The neighbors may have already been found for the current state of the mesh.
+        const MeshFaceConnectivity* face_connectivity = mesh->get_face_connectivity();
+        if(face_connectivity == NULL || !load_neighbors(face_connectivity))
+          find_neighbors();
+      }
+      else
+        if(!ignore_errors)
+          throw Hermes::Exceptions::Exception("The given edge isn't inner");
+    }
 
-        // First case : The neighboring element is of the same size as the central one.
-        if(neighb_el != NULL)
-        {
-          //std::cout << "\t active neighbor el: " << neighb_el->id << std::endl;
+    template<typename Scalar>
+    void NeighborSearch<Scalar>::find_neighbors()
+    {
+      neighb_el = central_el->get_neighbor(active_edge);
 
-          // Get local number of the edge used by the neighbor.
-          for (unsigned int j = 0; j < neighb_el->get_nvert(); j++)
-            if(central_el->en[active_edge] == neighb_el->en[j])
-            {
-              neighbor_edge.local_num_of_edge = j;
-              break;
-            }
+      // First case : The neighboring element is of the same size as the central one.
+      if(neighb_el != NULL)
+      {
+        //std::cout << "\t active neighbor el: " << neighb_el->id << std::endl;
 
-            NeighborEdgeInfo local_edge_info;
-            local_edge_info.local_num_of_edge = neighbor_edge.local_num_of_edge;
+        // Get local number of the edge used by the neighbor.
+        for (int j = 0; j < neighb_el->get_nvert(); j++)
+          if(central_el->en[active_edge] == neighb_el->en[j])
+          {
+            neighbor_edge.local_num_of_edge = j;
+            break;
+          }
 
-            // Query the orientation of the neighbor edge relative to the central el.
-            int p1 = central_el->vn[active_edge]->id;
-            int p2 = central_el->vn[(active_edge + 1) % central_el->get_nvert()]->id;
-            local_edge_info.orientation = neighbor_edge_orientation(p1, p2, false);
+        NeighborEdgeInfo local_edge_info;
+        local_edge_info.local_num_of_edge = neighbor_edge.local_num_of_edge;
 
-            neighbor_edges.push_back(local_edge_info);
+        // Query the orientation of the neighbor edge relative to the central el.
+        int p1 = central_el->vn[active_edge]->id;
+        int p2 = central_el->vn[(active_edge + 1) % central_el->get_nvert()]->id;
+        local_edge_info.orientation = neighbor_edge_orientation(p1, p2, false);
 
-            // There is only one neighbor in this case.
-            n_neighbors = 1;
-            neighbors.push_back(neighb_el);
+        neighbor_edges.push_back(local_edge_info);
 
-            // No need for transformation, since the neighboring element is of the same size.
-            neighborhood_type = H2D_DG_NO_TRANSF;
+        // There is only one neighbor in this case.
+        n_neighbors = 1;
+        neighbors.push_back(neighb_el);
+
+        // No need for transformation, since the neighboring element is of the same size.
+        neighborhood_type = H2D_DG_NO_TRANSF;
+      }
+      else
+      {
+        // Peek the vertex in the middle of the active edge (if there is none, vertex will be NULL).
+        Node* vertex = mesh->peek_vertex_node(central_el->en[active_edge]->p1,  central_el->en[active_edge]->p2);
+
+        // Endpoints of the active edge.
+        int orig_vertex_id[2];
+        orig_vertex_id[0] = central_el->vn[active_edge]->id;
+        orig_vertex_id[1]  = central_el->vn[(active_edge + 1) % central_el->get_nvert()]->id;
+
+        if(vertex == NULL)
+        {
+          neighborhood_type = H2D_DG_GO_UP;
+
+          Element* parent = central_el->parent;
+
+          // Array of middle-point vertices of the intermediate parent edges that we climb up to the correct parent element.
+          Node** par_mid_vertices = new Node*[Transformations::max_level];
+          // Number of visited intermediate parents.
+          int n_parents = 0;
+
+          for (unsigned int j = 0; j < (unsigned) Transformations::max_level; j++)
+            par_mid_vertices[j] = NULL;
+
+          find_act_elem_up(parent, orig_vertex_id, par_mid_vertices, n_parents);
+
+          delete [] par_mid_vertices;
         }
         else
         {
-          // Peek the vertex in the middle of the active edge (if there is none, vertex will be NULL).
-          Node* vertex = mesh->peek_vertex_node(central_el->en[active_edge]->p1,  central_el->en[active_edge]->p2);
+          neighborhood_type = H2D_DG_GO_DOWN;
 
-          // Endpoints of the active edge.
-          int orig_vertex_id[2];
-          orig_vertex_id[0] = central_el->vn[active_edge]->id;
-          orig_vertex_id[1]  = central_el->vn[(active_edge + 1) % central_el->get_nvert()]->id;
+          int sons[Transformations::max_level]; // array of virtual sons of the central el. visited on the way down to the neighbor
+          int n_sons = 0; // number of used transformations
 
-          if(vertex == NULL)
-          {
-            neighborhood_type = H2D_DG_GO_UP;
+          // Start the search by going down to the first son.
+          find_act_elem_down( vertex, orig_vertex_id, sons, n_sons + 1);
+
+          //debug_log("number of neighbors on the way down: %d ", n_neighbors);
+        }
+      }
+    }
 
-            Element* parent = central_el->parent;
+    template<typename Scalar>
+    bool NeighborSearch<Scalar>::load_neighbors(const MeshFaceConnectivity* face_connectivity)
+    {
+      // The central element has to be the one of the mesh (the search itself goes by the element).
+      if(central_el->id >= mesh->get_max_element_id() || mesh->get_element_fast(central_el->id) != central_el
+        || (unsigned int)((central_el->id + 1) * H2D_MAX_NUMBER_EDGES) > face_connectivity->edges.size())
+        return false;
+      const MeshFaceConnectivity::Edge* stored_edge = face_connectivity->get_edge(central_el->id, active_edge);
+      if(stored_edge == NULL)
+        return false;
 
-            // Array of middle-point vertices of the intermediate parent edges that we climb up to the correct parent element.
-            Node** par_mid_vertices = new Node*[Transformations::max_level];
-            // Number of visited intermediate parents.
-            int n_parents = 0;
+      neighborhood_type = (NeighborhoodType)stored_edge->neighborhood_type;
+      for(unsigned int i = 0; i < stored_edge->n_neighbors; i++)
+      {
+        const MeshFaceConnectivity::Neighbor& stored_neighbor = face_connectivity->neighbors[stored_edge->first_neighbor + i];
+        neighbors.push_back(stored_neighbor.element);
 
-            for (unsigned int j = 0; j < (unsigned) Transformations::max_level; j++)
-              par_mid_vertices[j] = NULL;
+        NeighborEdgeInfo local_edge_info;
+        local_edge_info.local_num_of_edge = stored_neighbor.local_num_of_edge;
+        local_edge_info.orientation = stored_neighbor.orientation;
+        neighbor_edges.push_back(local_edge_info);
 
-            find_act_elem_up(parent, orig_vertex_id, par_mid_vertices, n_parents);
+        // The search adds the transformations of the central element for every neighbor on the way down
+        // and the one of the (only) neighbor on the way up.
+        Transformations* transformations = NULL;
+        unsigned int offset = 0, num_levels = 0;
+        if(neighborhood_type == H2D_DG_GO_DOWN)
+        {
+          if(!central_transformations.present(i))
+            central_transformations.add(new Transformations, i);
+          transformations = central_transformations.get(i);
+          offset = stored_neighbor.central_transformations;
+          num_levels = stored_neighbor.central_num_levels;
+        }
+        else if(neighborhood_type == H2D_DG_GO_UP && i == 0)
+        {
+          if(!neighbor_transformations.present(i))
+            neighbor_transformations.add(new Transformations, i);
+          transformations = neighbor_transformations.get(i);
+          offset = stored_neighbor.neighbor_transformations;
+          num_levels = stored_neighbor.neighbor_num_levels;
+        }
+        if(transformations != NULL)
+        {
+          transformations->reset();
+          for(unsigned int level = 0; level < num_levels; level++)
+            transformations->transf[level] = face_connectivity->transformations[offset + level];
+          transformations->num_levels = num_levels;
+        }
+      }
+      n_neighbors = stored_edge->n_neighbors;
+      neighb_el = stored_edge->neighb_el;
+      neighbor_edge.local_num_of_edge = stored_edge->local_num_of_edge;
+      return true;
+    }
 
-            delete [] par_mid_vertices;
+    template<typename Scalar>
+    void NeighborSearch<Scalar>::calculate_face_connectivity(const Mesh* mesh, MeshFaceConnectivity* face_connectivity)
+    {
+      // Not valid while being calculated.
+      face_connectivity->seq = (unsigned)-1;
+
+      MeshFaceConnectivity::Edge not_stored;
+      not_stored.neighborhood_type = H2D_DG_NOT_INITIALIZED;
+      not_stored.first_neighbor = not_stored.n_neighbors = 0;
+      not_stored.neighb_el = NULL;
+      not_stored.local_num_of_edge = -1;
+      face_connectivity->edges.assign(mesh->get_max_element_id() * H2D_MAX_NUMBER_EDGES, not_stored);
+      face_connectivity->neighbors.clear();
+      face_connectivity->transformations.clear();
+
+      Element* e;
+      for_all_active_elements(e, mesh)
+      {
+        NeighborSearch<Scalar> ns(e, mesh);
+        for(int edge = 0; edge < e->get_nvert(); edge++)
+        {
+          if(e->en[edge]->bnd)
+            continue;
+
+          ns.reset_neighb_info();
+          ns.active_edge = edge;
+          try
+          {
+            ns.find_neighbors();
           }
-          else
+          catch(Hermes::Exceptions::Exception&)
           {
-            neighborhood_type = H2D_DG_GO_DOWN;
-
-            int sons[Transformations::max_level]; // array of virtual sons of the central el. visited on the way down to the neighbor
-            int n_sons = 0; // number of used transformations
+            // Not stored, the search repeats (and reports) the failure whenever this edge is set as active.
+            continue;
+          }
 
-            // Start the search by going down to the first son.
-            find_act_elem_down( vertex, orig_vertex_id, sons, n_sons + 1);
+          MeshFaceConnectivity::Edge& stored_edge = face_connectivity->edges[e->id * H2D_MAX_NUMBER_EDGES + edge];
+          stored_edge.neighborhood_type = ns.neighborhood_type;
+          stored_edge.first_neighbor = face_connectivity->neighbors.size();
+          stored_edge.n_neighbors = ns.n_neighbors;
+          stored_edge.neighb_el = ns.neighb_el;
+          stored_edge.local_num_of_edge = ns.neighbor_edge.local_num_of_edge;
 
-            //debug_log("number of neighbors on the way down: %d ", n_neighbors);
+          for(unsigned int i = 0; i < ns.n_neighbors; i++)
+          {
+            MeshFaceConnectivity::Neighbor stored_neighbor;
+            stored_neighbor.element = ns.neighbors[i];
+            stored_neighbor.local_num_of_edge = ns.neighbor_edges[i].local_num_of_edge;
+            stored_neighbor.orientation = ns.neighbor_edges[i].orientation;
+            stored_neighbor.central_transformations = stored_neighbor.central_num_levels = 0;
+            stored_neighbor.neighbor_transformations = stored_neighbor.neighbor_num_levels = 0;
+
+            if(ns.neighborhood_type == H2D_DG_GO_DOWN && ns.central_transformations.present(i))
+            {
+              Transformations* transformations = ns.central_transformations.get(i);
+              stored_neighbor.central_transformations = face_connectivity->transformations.size();
+              stored_neighbor.central_num_levels = transformations->num_levels;
+              for(unsigned int level = 0; level < transformations->num_levels; level++)
+                face_connectivity->transformations.push_back(transformations->transf[level]);
+            }
+            if(ns.neighborhood_type == H2D_DG_GO_UP && i == 0 && ns.neighbor_transformations.present(i))
+            {
+              Transformations* transformations = ns.neighbor_transformations.get(i);
+              stored_neighbor.neighbor_transformations = face_connectivity->transformations.size();
+              stored_neighbor.neighbor_num_levels = transformations->num_levels;
+              for(unsigned int level = 0; level < transformations->num_levels; level++)
+                face_connectivity->transformations.push_back(transformations->transf[level]);
+            }
+            face_connectivity->neighbors.push_back(stored_neighbor);
           }
         }
       }
-      else
-        if(!ignore_errors)
-          throw Hermes::Exceptions::Exception("The given edge isn't inner");
+
+      // Only now the face connectivity is valid (and used by NeighborSearch).
+      face_connectivity->seq = mesh->get_seq();
     }
 
     template<typename Scalar>
@@ -356,7 +498,7 @@ namespace Hermes
       Hermes::vector<unsigned int> neighbors_not_to_be_deleted;
 
       Hermes::vector<unsigned int> updated_transformations;
-      for(int i = 0; i < transformations.size(); i++)
+      for(unsigned int i = 0; i < transformations.size(); i++)
       {
         if(! ((active_edge == 0 && transformations[i] == 4) || (active_edge == 1 && transformations[i] == 7) || (active_edge == 2 && transformations[i] == 5) || (active_edge == 3 && transformations[i] == 6)) )
         {
@@ -477,7 +619,7 @@ namespace Hermes
       Hermes::vector<unsigned int> transformations = get_transforms(original_central_el_transform);
 
       Hermes::vector<unsigned int> updated_transformations;
-      for(int i = 0; i < transformations.size(); i++)
+      for(unsigned int i = 0; i < transformations.size(); i++)
       {
         if(! ((active_edge == 0 && transformations[i] == 4) || (active_edge == 1 && transformations[i] == 7) || (active_edge == 2 && transformations[i] == 5) || (active_edge == 3 && transformations[i] == 6)) )
         {
@@ -644,7 +786,7 @@ namespace Hermes
 
             // Get local number of the edge used by the neighbor.
             neighbor_edge.local_num_of_edge = -1;
-            for(unsigned int j = 0; j < neighb_el->get_nvert(); j++)
+            for(int j = 0; j < neighb_el->get_nvert(); j++)
               if(neighb_el->en[j] == edge)
               {
                 neighbor_edge.local_num_of_edge = j;
@@ -760,7 +902,7 @@ namespace Hermes
 
               // Get local number of the edge used by the neighbor.
               neighbor_edge.local_num_of_edge = -1;
-              for(unsigned int k = 0; k < neighb_el->get_nvert(); k++)
+              for(int k = 0; k < neighb_el->get_nvert(); k++)
                 if(neighb_el->en[k] == edge)
                 {
                   neighbor_edge.local_num_of_edge = k;
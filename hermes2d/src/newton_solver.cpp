@@ -76,6 +76,9 @@ namespace Hermes
       this->initial_auto_damping_ratio = 1.0;
       this->sufficient_improvement_factor = 0.95;
       this->necessary_successful_steps_to_increase = 1;
+      this->sufficient_improvement_factor_jacobian = -1.0;
+      this->max_steps_with_reused_jacobian = 0;
+      this->kept_jacobian_age = 0;
     }
 
     template<typename Scalar>
@@ -239,6 +242,20 @@ namespace Hermes
       this->necessary_successful_steps_to_increase = steps;
     }
 
+    template<typename Scalar>
+    void NewtonSolver<Scalar>::set_sufficient_improvement_factor_jacobian(double ratio)
+    {
+      if(ratio <= 0.0)
+        throw Exceptions::ValueException("ratio", ratio, 0.0);
+      this->sufficient_improvement_factor_jacobian = ratio;
+    }
+
+    template<typename Scalar>
+    void NewtonSolver<Scalar>::set_max_steps_with_reused_jacobian(unsigned int steps)
+    {
+      this->max_steps_with_reused_jacobian = steps;
+    }
+
     template<typename Scalar>
     void NewtonSolver<Scalar>::solve(Solution<Scalar>* initial_guess)
     {
@@ -334,6 +351,7 @@ namespace Hermes
           Solution<Scalar>::vector_to_solutions(residual, static_cast<DiscreteProblem<Scalar>*>(this->dp)->get_spaces(), solutions, dir_lift_false);
 
           // Calculate the norm.
+          last_residual_norm = residual_norm;
           residual_norm = Global<Scalar>::calc_norms(solutions);
 
           // Clean up.
@@ -439,18 +457,7 @@ namespace Hermes
         // Assemble just the jacobian.
         this->dp->assemble(coeff_vec, jacobian);
         if(this->output_matrixOn && (this->output_matrixIterations == -1 || this->output_matrixIterations >= it))
-        {
-          char* fileName = new char[this->matrixFilename.length() + 5];
-          if(this->matrixFormat == Hermes::Algebra::DF_MATLAB_SPARSE)
-            sprintf(fileName, "%s%i.m", this->matrixFilename.c_str(), it);
-          else
-            sprintf(fileName, "%s%i", this->matrixFilename.c_str(), it);
-          FILE* matrix_file = fopen(fileName, "w+");
-
-          jacobian->dump(matrix_file, this->matrixVarname.c_str(), this->matrixFormat, this->matrix_number_format);
-          fclose(matrix_file);
-          delete [] fileName;
-        }
+          this->output_jacobian(jacobian, it);
 
         this->on_step_end();
 
@@ -520,6 +527,39 @@ namespace Hermes
       this->solve_keep_jacobian(coeff_vec);
     }
 
+    template<typename Scalar>
+    void NewtonSolver<Scalar>::output_jacobian(SparseMatrix<Scalar>* jacobian, int it)
+    {
+      char* fileName = new char[this->matrixFilename.length() + 15];
+      if(this->matrixFormat == Hermes::Algebra::DF_MATLAB_SPARSE)
+        sprintf(fileName, "%s%i.m", this->matrixFilename.c_str(), it);
+      else
+        sprintf(fileName, "%s%i", this->matrixFilename.c_str(), it);
+
+      if(this->matrixFormat == Hermes::Algebra::DF_HERMES_CSC)
+      {
+#ifdef WITH_UMFPACK
+        // The system solved is J(Y^n) \deltaY^{n + 1} = -F(Y^n), the residual is F(Y^n) at this point.
+        CSCMatrix<Scalar>* csc_jacobian = dynamic_cast<CSCMatrix<Scalar>*>(jacobian);
+        if(csc_jacobian != NULL)
+        {
+          residual->change_sign();
+          csc_jacobian->save_binary(fileName, residual);
+          residual->change_sign();
+          delete [] fileName;
+          return;
+        }
+#endif
+        delete [] fileName;
+        throw Exceptions::Exception("The Jacobian can be output in DF_HERMES_CSC only if it is a CSCMatrix.");
+      }
+
+      FILE* matrix_file = fopen(fileName, "w+");
+      jacobian->dump(matrix_file, this->matrixVarname.c_str(), this->matrixFormat, this->matrix_number_format);
+      fclose(matrix_file);
+      delete [] fileName;
+    }
+
     template<typename Scalar>
     void NewtonSolver<Scalar>::solve_keep_jacobian(Scalar* coeff_vec)
     {
@@ -568,6 +608,7 @@ namespace Hermes
           FILE* rhs_file = fopen(fileName, "w+");
           residual->dump(rhs_file, this->RhsVarname.c_str(), this->RhsFormat, this->rhs_number_format);
           fclose(rhs_file);
+          delete [] fileName;
         }
 
         Element* e;
@@ -589,6 +630,7 @@ namespace Hermes
             static_cast<DiscreteProblem<Scalar>*>(this->dp)->get_spaces(), solutions, dir_lift_false);
 
           // Calculate the norm.
+          last_residual_norm = residual_norm;
           residual_norm = Global<Scalar>::calc_norms(solutions);
 
           // Clean up.
@@ -692,6 +734,11 @@ namespace Hermes
           return;
         }
 
+        // The kept jacobian is recalculated if it is too old, or if the residual norm did not decrease enough in the last step
+        // (see set_max_steps_with_reused_jacobian(), set_sufficient_improvement_factor_jacobian()).
+        bool jacobian_outdated = (this->max_steps_with_reused_jacobian > 0 && this->kept_jacobian_age >= this->max_steps_with_reused_jacobian)
+          || (this->sufficient_improvement_factor_jacobian > 0.0 && it > 1 && residual_norm > last_residual_norm * this->sufficient_improvement_factor_jacobian);
+
         // Assemble and keep the jacobian if this has not been done before.
         // Also declare that LU-factorization in case of a direct solver will be done only once and reused afterwards.
         if(kept_jacobian == NULL || !(static_cast<DiscreteProblem<Scalar>*>(this->dp))->have_matrix) 
@@ -712,19 +759,23 @@ namespace Hermes
           this->dp->assemble(coeff_vec, kept_jacobian);
 
           if(this->output_matrixOn && (this->output_matrixIterations == -1 || this->output_matrixIterations >= it))
-          {
-            char* fileName = new char[this->matrixFilename.length() + 5];
-            if(this->matrixFormat == Hermes::Algebra::DF_MATLAB_SPARSE)
-              sprintf(fileName, "%s%i.m", this->matrixFilename.c_str(), it);
-            else
-              sprintf(fileName, "%s%i", this->matrixFilename.c_str(), it);
-            FILE* matrix_file = fopen(fileName, "w+");
+            this->output_jacobian(kept_jacobian, it);
 
-            kept_jacobian->dump(matrix_file, this->matrixVarname.c_str(), this->matrixFormat, this->matrix_number_format);
-            fclose(matrix_file);
-          }
+          linear_solver->set_factorization_scheme(HERMES_FACTORIZE_FROM_SCRATCH);
+          this->kept_jacobian_age = 0;
+        }
+        else if(jacobian_outdated)
+        {
+          this->info("\tNewton: recalculating the kept jacobian (used in %u steps).", this->kept_jacobian_age);
 
-          linear_solver->set_factorization_scheme(HERMES_REUSE_FACTORIZATION_COMPLETELY);
+          // The sparsity structure is the same, only the numerical factorization is done again.
+          this->dp->assemble(coeff_vec, kept_jacobian);
+
+          if(this->output_matrixOn && (this->output_matrixIterations == -1 || this->output_matrixIterations >= it))
+            this->output_jacobian(kept_jacobian, it);
+
+          linear_solver->set_factorization_scheme(HERMES_REUSE_MATRIX_REORDERING);
+          this->kept_jacobian_age = 0;
         }
 
         this->on_step_end();
@@ -739,6 +790,10 @@ namespace Hermes
           throw Exceptions::LinearMatrixSolverException();
         }
 
+        // The factorization is reused until the jacobian is recalculated.
+        linear_solver->set_factorization_scheme(HERMES_REUSE_FACTORIZATION_COMPLETELY);
+        this->kept_jacobian_age++;
+
          // Add \deltaY^{n + 1} to Y^n.
         // The good case.
         if(residual_norm < last_residual_norm * this->sufficient_improvement_factor || this->manual_damping || it == 1)
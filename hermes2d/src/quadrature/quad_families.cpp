@@ -0,0 +1,205 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "global.h"
+#include "quad_all.h"
+#include <map>
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    Quad2DFamily::Quad2DFamily()
+    {
+      for (int mode = 0; mode < H2D_NUM_MODES; mode++)
+      {
+        ElementMode2D element_mode = (ElementMode2D) mode;
+        max_order[mode] = g_quad_2d_std.get_max_order(element_mode);
+        safe_max_order[mode] = g_quad_2d_std.get_safe_max_order(element_mode);
+        num_tables[mode] = g_quad_2d_std.get_num_tables(element_mode);
+
+        mode_tables[mode] = new double3*[num_tables[mode]];
+        mode_np[mode] = new int[num_tables[mode]];
+        for (int i = 0; i < num_tables[mode]; i++)
+        {
+          mode_tables[mode][i] = g_quad_2d_std.get_points(i, element_mode);
+          mode_np[mode][i] = g_quad_2d_std.get_num_points(i, element_mode);
+        }
+
+        for (int i = 0; i < (element_mode == HERMES_MODE_TRIANGLE ? 3 : 4); i++)
+        {
+          ref_vert[mode][i][0] = (*g_quad_2d_std.get_ref_vertex(i, element_mode))[0];
+          ref_vert[mode][i][1] = (*g_quad_2d_std.get_ref_vertex(i, element_mode))[1];
+        }
+      }
+      max_edge_order = 0;
+
+      tables = mode_tables;
+      np = mode_np;
+    }
+
+    Quad2DFamily::~Quad2DFamily()
+    {
+      for (unsigned int i = 0; i < own_tables.size(); i++)
+        delete [] own_tables[i];
+      for (int mode = 0; mode < H2D_NUM_MODES; mode++)
+      {
+        delete [] mode_tables[mode];
+        delete [] mode_np[mode];
+      }
+    }
+
+    void Quad2DFamily::set_table(ElementMode2D mode, int order, double3* table, int np)
+    {
+      own_tables.push_back(table);
+      mode_tables[mode][order] = table;
+      mode_np[mode][order] = np;
+    }
+
+    void Quad2DFamily::set_edge_tables(ElementMode2D mode, int order, double2* rule_1d, int np_1d)
+    {
+      int nv = (mode == HERMES_MODE_TRIANGLE) ? 3 : 4;
+      for (int edge = 0; edge < nv; edge++)
+      {
+        // The same as the edge tables of Quad2DStd, see Quad2D::get_edge_points().
+        double2& v1 = ref_vert[mode][edge];
+        double2& v2 = ref_vert[mode][(edge + 1) % nv];
+        double3* table = new double3[np_1d];
+        for (int i = 0; i < np_1d; i++)
+        {
+          double s = (rule_1d[i][0] + 1.0) * 0.5;
+          double t = 1.0 - s;
+          table[i][0] = v1[0] * t + v2[0] * s;
+          table[i][1] = v1[1] * t + v2[1] * s;
+          table[i][2] = rule_1d[i][1];
+        }
+        set_table(mode, max_order[mode] + 1 + nv * order + edge, table, np_1d);
+      }
+    }
+
+    Quad2DLobatto::Quad2DLobatto()
+    {
+      for (int order = 0; order <= max_order[HERMES_MODE_QUAD]; order++)
+      {
+        // The smallest rule exact for the order, 2 n - 3 >= order.
+        int n1 = std::max(2, (order + 4) / 2);
+        double2* rule = new double2[n1];
+        calculate_rule_1d(n1, rule);
+
+        // The same layout as the quad tables of Quad2DStd: point i * n1 + j is [x_i, x_j].
+        double3* table = new double3[n1 * n1];
+        for (int i = 0, n = 0; i < n1; i++)
+          for (int j = 0; j < n1; j++, n++)
+          {
+            table[n][0] = rule[i][0];
+            table[n][1] = rule[j][0];
+            table[n][2] = rule[i][1] * rule[j][1];
+          }
+        set_table(HERMES_MODE_QUAD, order, table, n1 * n1);
+        set_edge_tables(HERMES_MODE_QUAD, order, rule, n1);
+
+        delete [] rule;
+      }
+    }
+
+    void Quad2DLobatto::calculate_rule_1d(int np, double2* rule)
+    {
+      // The inner points are the roots of P'_{np - 1}, found by Newton's iteration from the Chebyshev-Gauss-Lobatto points,
+      // the weights are 2 / (np (np - 1) P_{np - 1}(x)^2).
+      int n = np - 1;
+      for (int i = 0; i < np; i++)
+      {
+        double x = cos(M_PI * i / n), p_n = 1.0;
+        for (int iteration = 0; iteration < 100; iteration++)
+        {
+          double p_prev = 1.0;
+          p_n = x;
+          for (int k = 2; k <= n; k++)
+          {
+            double p_next = ((2 * k - 1) * x * p_n - (k - 1) * p_prev) / k;
+            p_prev = p_n;
+            p_n = p_next;
+          }
+
+          double dx = (x * p_n - p_prev) / (np * p_n);
+          x -= dx;
+          if(fabs(dx) < 1e-15)
+            break;
+        }
+
+        // Ascending order of the points.
+        rule[n - i][0] = x;
+        rule[n - i][1] = 2.0 / (n * np * p_n * p_n);
+      }
+    }
+
+    Quad2DCollapsed::Quad2DCollapsed()
+    {
+      for (int order = 0; order <= max_order[HERMES_MODE_TRIANGLE]; order++)
+      {
+        // The square [xi, eta] is mapped onto the reference triangle by x = (1 + xi)(1 - eta) / 2 - 1, y = eta,
+        // a polynomial of degree order in x, y has the degree order in xi and order + 1 in eta (with the Jacobian (1 - eta) / 2).
+        double2* rule_xi = g_quad_1d_std.get_points(order);
+        int np_xi = g_quad_1d_std.get_num_points(order);
+        double2* rule_eta = g_quad_1d_std.get_points(order + 1);
+        int np_eta = g_quad_1d_std.get_num_points(order + 1);
+
+        double3* table = new double3[np_xi * np_eta];
+        for (int i = 0, n = 0; i < np_xi; i++)
+          for (int j = 0; j < np_eta; j++, n++)
+          {
+            double xi = rule_xi[i][0], eta = rule_eta[j][0];
+            table[n][0] = (1.0 + xi) * (1.0 - eta) * 0.5 - 1.0;
+            table[n][1] = eta;
+            table[n][2] = rule_xi[i][1] * rule_eta[j][1] * (1.0 - eta) * 0.5;
+          }
+        set_table(HERMES_MODE_TRIANGLE, order, table, np_xi * np_eta);
+      }
+
+      // All points are inside.
+      safe_max_order[HERMES_MODE_TRIANGLE] = max_order[HERMES_MODE_TRIANGLE];
+    }
+
+    static std::map<std::string, Quad2D*>& get_quad_2d_registry()
+    {
+      static std::map<std::string, Quad2D*> registry;
+      if(registry.empty())
+      {
+        static Quad2DLobatto quad_2d_lobatto;
+        static Quad2DCollapsed quad_2d_collapsed;
+        registry["std"] = &g_quad_2d_std;
+        registry["lobatto"] = &quad_2d_lobatto;
+        registry["collapsed"] = &quad_2d_collapsed;
+      }
+      return registry;
+    }
+
+    HERMES_API void register_quad_2d(const std::string& name, Quad2D* quad_2d)
+    {
+      if(quad_2d == NULL)
+        throw Hermes::Exceptions::NullException(1);
+      get_quad_2d_registry()[name] = quad_2d;
+    }
+
+    HERMES_API Quad2D* get_quad_2d(const std::string& name)
+    {
+      std::map<std::string, Quad2D*>& registry = get_quad_2d_registry();
+      std::map<std::string, Quad2D*>::const_iterator it = registry.find(name);
+      if(it == registry.end())
+        throw Hermes::Exceptions::Exception("No quadrature registered as %s.", name.c_str());
+      return it->second;
+    }
+  }
+}
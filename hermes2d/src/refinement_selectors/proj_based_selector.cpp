@@ -31,6 +31,7 @@ namespace Hermes
         std::fill(cached_shape_vals_valid, cached_shape_vals_valid + H2D_NUM_MODES, false);
 
         //clear matrix cache
+        proj_matrix_cache = new ProjMatrixCache[H2D_NUM_MODES];
         for(int m = 0; m < H2D_NUM_MODES; m++)
           for(int i = 0; i < H2DRS_MAX_ORDER + 2; i++)
             for(int k = 0; k < H2DRS_MAX_ORDER + 2; k++)
@@ -47,19 +48,24 @@ namespace Hermes
       template<typename Scalar>
       ProjBasedSelector<Scalar>::~ProjBasedSelector()
       {
-        //delete matrix cache
-        for(int m = 0; m < H2D_NUM_MODES; m++)
-        {
-          for(int i = 0; i < H2DRS_MAX_ORDER + 2; i++)
-            for(int k = 0; k < H2DRS_MAX_ORDER + 2; k++)
-            {
-              if(proj_matrix_cache[m][i][k] != NULL)
-                delete [] proj_matrix_cache[m][i][k];
-            }
-        }
-
         if(!this->isAClone)
         {
+          //delete matrix cache
+          for(int m = 0; m < H2D_NUM_MODES; m++)
+          {
+            for(int i = 0; i < H2DRS_MAX_ORDER + 2; i++)
+              for(int k = 0; k < H2DRS_MAX_ORDER + 2; k++)
+              {
+                if(proj_matrix_cache[m][i][k] != NULL)
+                {
+                  delete [] proj_matrix_cache[m][i][k]->lu;
+                  delete [] proj_matrix_cache[m][i][k]->indx;
+                  delete proj_matrix_cache[m][i][k];
+                }
+              }
+          }
+          delete [] proj_matrix_cache;
+
           delete [] cached_shape_vals_valid;
           delete [] cached_shape_ortho_vals;
           delete [] cached_shape_vals;
@@ -318,6 +324,10 @@ namespace Hermes
           }
         }
 
+        //factorize projection matrices of all orders of candidates
+        const typename OptimumSelector<Scalar>::CandsInfo* infos[3] = { &info_h, &info_p, &info_aniso };
+        precalc_proj_matrices(mode, gip_points, num_gip_points, infos, 3);
+
         TrfShape& svals = cached_shape_vals[mode];
         TrfShape& ortho_svals = cached_shape_ortho_vals[mode];
 
@@ -437,11 +447,7 @@ namespace Hermes
         int max_num_shapes = this->next_order_shape[mode][this->current_max_order];
         Scalar* right_side = new Scalar[max_num_shapes];
         int* shape_inxs = new int[max_num_shapes];
-        int* indx = new int[max_num_shapes]; //solver data
-        double* d = new double[max_num_shapes]; //solver data
-        double** proj_matrix = new_matrix<double>(max_num_shapes, max_num_shapes);
         ProjMatrixCache& proj_matrices = proj_matrix_cache[mode];
-        Hermes::vector<typename OptimumSelector<Scalar>::ShapeInx>& full_shape_indices = this->shape_indices[mode];
 
         //check whether ortho-svals are available
         bool ortho_svals_available = true;
@@ -464,20 +470,7 @@ namespace Hermes
           int order_h = H2D_GET_H_ORDER(quad_order), order_v = H2D_GET_V_ORDER(quad_order);
 
           //build a list of shape indices from the full list
-          int num_shapes = 0;
-          unsigned int inx_shape = 0;
-          while (inx_shape < full_shape_indices.size())
-          {
-            typename OptimumSelector<Scalar>::ShapeInx& shape = full_shape_indices[inx_shape];
-            if(order_h >= shape.order_h && order_v >= shape.order_v)
-            {
-              if(num_shapes >= max_num_shapes)
-                throw Exceptions::Exception("more shapes than predicted, possible incosistency");
-              shape_inxs[num_shapes] = shape.inx;
-              num_shapes++;
-            }
-            inx_shape++;
-          }
+          int num_shapes = build_shape_inxs(mode, order_h, order_v, shape_inxs, max_num_shapes);
 
           //continue only if there are shapes to process
           if(num_shapes == 0)
@@ -489,14 +482,6 @@ namespace Hermes
           Hermes::vector< ValueCacheItem<Scalar> >& rhs_cache = use_ortho ? ortho_rhs_cache : nonortho_rhs_cache;
           Hermes::vector<TrfShapeExp>** sub_svals = use_ortho ? sub_ortho_svals : sub_nonortho_svals;
 
-          //calculate projection matrix iff no ortho is used
-          if(!use_ortho)
-          {
-            if(proj_matrices[order_h][order_v] == NULL)
-              proj_matrices[order_h][order_v] = build_projection_matrix(gip_points, num_gip_points, shape_inxs, num_shapes, mode);
-            copy_matrix(proj_matrix, proj_matrices[order_h][order_v], num_shapes, num_shapes); //copy projection matrix because original matrix will be modified
-          }
-
           //build right side (fill cache values that are missing)
           for(int inx_sub = 0; inx_sub < num_sub; inx_sub++)
           {
@@ -526,11 +511,13 @@ namespace Hermes
             rhs_cache_value.mark();
           }
 
-          //solve iff no ortho is used
+          //solve iff no ortho is used, the factorized projection matrix was precalculated in calc_projection_errors()
           if(!use_ortho)
           {
-            ludcmp(proj_matrix, num_shapes, indx, d);
-            lubksb<Scalar>(proj_matrix, num_shapes, indx, right_side);
+            FactorizedProjMatrix* proj_matrix = proj_matrices[order_h][order_v];
+            if(proj_matrix == NULL)
+              throw Exceptions::Exception("Projection matrix of orders (%d, %d) was not precalculated.", order_h, order_v);
+            lubksb<Scalar>(proj_matrix->lu, num_shapes, proj_matrix->indx, right_side);
           }
 
           //calculate error
@@ -548,11 +535,110 @@ namespace Hermes
         }
         while (order_perm.next());
 
-        delete [] proj_matrix;
         delete [] right_side;
         delete [] shape_inxs;
-        delete [] indx;
-        delete [] d;
+      }
+
+      template<typename Scalar>
+      void ProjBasedSelector<Scalar>::precalc_proj_matrices(const ElementMode2D mode, double3* gip_points, int num_gip_points, const typename OptimumSelector<Scalar>::CandsInfo** infos, int num_infos)
+      {
+        //collect the orders of calc_error_cand_element()
+        Hermes::vector<std::pair<int, int> > orders;
+        for(int i = 0; i < num_infos; i++)
+        {
+          if(infos[i]->is_empty())
+            continue;
+          OrderPermutator order_perm(infos[i]->min_quad_order, infos[i]->max_quad_order, mode == HERMES_MODE_TRIANGLE || infos[i]->uniform_orders);
+          do
+          {
+            int order_h = order_perm.get_order_h(), order_v = order_perm.get_order_v();
+            if(order_h > H2DRS_MAX_ORDER + 1 || order_v > H2DRS_MAX_ORDER + 1)
+              throw Exceptions::Exception("Order (%d, %d) of a candidate exceeds the maximum order of the projection matrix cache.", order_h, order_v);
+            orders.push_back(std::pair<int, int>(order_h, order_v));
+          }
+          while (order_perm.next());
+        }
+
+        //the cache is shared by the clones used by other threads, so it is only accessed in the critical section;
+        //a matrix seen there is never changed again, calc_error_cand_element() reads it without locking
+        ProjMatrixCache& proj_matrices = proj_matrix_cache[mode];
+        Hermes::vector<std::pair<int, int> > missing;
+#pragma omp critical (proj_matrix_cache)
+        for(unsigned int i = 0; i < orders.size(); i++)
+          if(proj_matrices[orders[i].first][orders[i].second] == NULL)
+            missing.push_back(orders[i]);
+        if(missing.empty())
+          return;
+
+        //the matrices are calculated outside of the critical section, so that exceptions leave it unchanged
+        int max_num_shapes = this->shape_indices[mode].size();
+        int* shape_inxs = new int[max_num_shapes];
+        Hermes::vector<FactorizedProjMatrix*> calculated;
+        calculated.resize(missing.size(), NULL);
+        try
+        {
+          double d;
+          for(unsigned int i = 0; i < missing.size(); i++)
+          {
+            int num_shapes = build_shape_inxs(mode, missing[i].first, missing[i].second, shape_inxs, max_num_shapes);
+            if(num_shapes == 0)
+              continue;
+
+            calculated[i] = new FactorizedProjMatrix;
+            calculated[i]->lu = build_projection_matrix(gip_points, num_gip_points, shape_inxs, num_shapes, mode);
+            calculated[i]->indx = new int[num_shapes];
+            ludcmp(calculated[i]->lu, num_shapes, calculated[i]->indx, &d);
+          }
+        }
+        catch(...)
+        {
+          delete [] shape_inxs;
+          for(unsigned int i = 0; i < calculated.size(); i++)
+            if(calculated[i] != NULL)
+            {
+              delete [] calculated[i]->lu;
+              delete [] calculated[i]->indx;
+              delete calculated[i];
+            }
+          throw;
+        }
+        delete [] shape_inxs;
+
+        //publish the matrices, another thread may have published some of them meanwhile
+#pragma omp critical (proj_matrix_cache)
+        for(unsigned int i = 0; i < missing.size(); i++)
+          if(calculated[i] != NULL && proj_matrices[missing[i].first][missing[i].second] == NULL)
+          {
+            proj_matrices[missing[i].first][missing[i].second] = calculated[i];
+            calculated[i] = NULL;
+          }
+
+        for(unsigned int i = 0; i < calculated.size(); i++)
+          if(calculated[i] != NULL)
+          {
+            delete [] calculated[i]->lu;
+            delete [] calculated[i]->indx;
+            delete calculated[i];
+          }
+      }
+
+      template<typename Scalar>
+      int ProjBasedSelector<Scalar>::build_shape_inxs(const ElementMode2D mode, int order_h, int order_v, int* shape_inxs, int max_num_shapes)
+      {
+        Hermes::vector<typename OptimumSelector<Scalar>::ShapeInx>& full_shape_indices = this->shape_indices[mode];
+        int num_shapes = 0;
+        for(unsigned int inx_shape = 0; inx_shape < full_shape_indices.size(); inx_shape++)
+        {
+          typename OptimumSelector<Scalar>::ShapeInx& shape = full_shape_indices[inx_shape];
+          if(order_h >= shape.order_h && order_v >= shape.order_v)
+          {
+            if(num_shapes >= max_num_shapes)
+              throw Exceptions::Exception("more shapes than predicted, possible incosistency");
+            shape_inxs[num_shapes] = shape.inx;
+            num_shapes++;
+          }
+        }
+        return num_shapes;
       }
 
       template class HERMES_API ProjBasedSelector<double>;
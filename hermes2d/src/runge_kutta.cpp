@@ -15,9 +15,12 @@
 
 #include "runge_kutta.h"
 #include "discrete_problem.h"
+#include "api2d.h"
 #include "projections/ogprojection.h"
 #include "projections/localprojection.h"
+#include "weakform_library/weakforms_h1.h"
 #include "weakform_library/weakforms_hcurl.h"
+#include <algorithm>
 namespace Hermes
 {
   namespace Hermes2D
@@ -25,8 +28,11 @@ namespace Hermes
     template<typename Scalar>
     RungeKutta<Scalar>::RungeKutta(const WeakForm<Scalar>* wf, Hermes::vector<const Space<Scalar> *> spaces, ButcherTable* bt)
       : wf(wf), bt(bt), num_stages(bt->get_size()), stage_wf_right(bt->get_size() * spaces.size()),
-      stage_wf_left(spaces.size()), start_from_zero_K_vector(false), block_diagonal_jacobian(false), residual_as_vector(true), iteration(0),
-      freeze_jacobian(false), newton_tol(1e-6), newton_max_iter(20), newton_damping_coeff(1.0), newton_max_allowed_residual_norm(1e10)
+      stage_wf_left(spaces.size()), stage_wf_single(spaces.size()), lumped_mass(false), lumped_mass_vector(NULL), start_from_zero_K_vector(false), block_diagonal_jacobian(false), residual_as_vector(true), iteration(0),
+      freeze_jacobian(false), newton_tol(1e-6), newton_max_iter(20), newton_damping_coeff(1.0), newton_max_allowed_residual_norm(1e10),
+      factorized_stage_coeff(0.0), sufficient_improvement_factor_jacobian(-1.0), max_steps_with_reused_jacobian(0), jacobian_age(0),
+      time_step_rel_tol(0.0), time_step_abs_tol(0.0), time_step_error_order(0),
+      accepted_steps(0), rejected_steps(0), accepted_steps_time(0.0), rejected_steps_time(0.0)
     {
       for(unsigned int i = 0; i < spaces.size(); i++)
       {
@@ -46,6 +52,8 @@ namespace Hermes
       vector_right = create_vector<Scalar>();
       // Create matrix solver.
       solver = create_linear_solver(matrix_right, vector_right);
+      vector_single = create_vector<Scalar>();
+      mass_solver = create_linear_solver(matrix_left, vector_single);
 
       // Vector K_vector of length num_stages * ndof. will represent
       // the 'K_i' vectors in the usual R-K notation.
@@ -59,13 +67,17 @@ namespace Hermes
 
       this->stage_dp_left = NULL;
       this->stage_dp_right = NULL;
+      this->stage_dp_single = NULL;
     }
 
     template<typename Scalar>
     RungeKutta<Scalar>::RungeKutta(const WeakForm<Scalar>* wf, const Space<Scalar>* space, ButcherTable* bt)
       : wf(wf), bt(bt), num_stages(bt->get_size()), stage_wf_right(bt->get_size() * 1),
-      stage_wf_left(1), start_from_zero_K_vector(false), block_diagonal_jacobian(false), residual_as_vector(true), iteration(0),
-      freeze_jacobian(false), newton_tol(1e-6), newton_max_iter(20), newton_damping_coeff(1.0), newton_max_allowed_residual_norm(1e10)
+      stage_wf_left(1), stage_wf_single(1), lumped_mass(false), lumped_mass_vector(NULL), start_from_zero_K_vector(false), block_diagonal_jacobian(false), residual_as_vector(true), iteration(0),
+      freeze_jacobian(false), newton_tol(1e-6), newton_max_iter(20), newton_damping_coeff(1.0), newton_max_allowed_residual_norm(1e10),
+      factorized_stage_coeff(0.0), sufficient_improvement_factor_jacobian(-1.0), max_steps_with_reused_jacobian(0), jacobian_age(0),
+      time_step_rel_tol(0.0), time_step_abs_tol(0.0), time_step_error_order(0),
+      accepted_steps(0), rejected_steps(0), accepted_steps_time(0.0), rejected_steps_time(0.0)
     {
       this->spaces.push_back(space);
       this->spaces_seqs.push_back(space->get_seq());
@@ -80,6 +92,8 @@ namespace Hermes
       vector_right = create_vector<Scalar>();
       // Create matrix solver.
       solver = create_linear_solver(matrix_right, vector_right);
+      vector_single = create_vector<Scalar>();
+      mass_solver = create_linear_solver(matrix_left, vector_single);
 
       // Vector K_vector of length num_stages * ndof. will represent
       // the 'K_i' vectors in the usual R-K notation.
@@ -93,6 +107,7 @@ namespace Hermes
 
       this->stage_dp_left = NULL;
       this->stage_dp_right = NULL;
+      this->stage_dp_single = NULL;
     }
 
     template<typename Scalar>
@@ -127,6 +142,8 @@ namespace Hermes
 
       if(this->stage_dp_left != NULL)
         static_cast<DiscreteProblem<Scalar>*>(this->stage_dp_left)->set_spaces(this->spaces);
+      if(this->stage_dp_single != NULL)
+        this->stage_dp_single->set_spaces(this->spaces);
     }
 
     template<typename Scalar>
@@ -157,6 +174,8 @@ namespace Hermes
 
       if(this->stage_dp_left != NULL)
         static_cast<DiscreteProblem<Scalar>*>(this->stage_dp_left)->set_space(space);
+      if(this->stage_dp_single != NULL)
+        this->stage_dp_single->set_space(space);
     }
 
     template<typename Scalar>
@@ -174,11 +193,13 @@ namespace Hermes
       {
         this->stage_wf_left.set_verbose_output(true);
         this->stage_wf_right.set_verbose_output(true);
+        this->stage_wf_single.set_verbose_output(true);
       }
       else
       {
         this->stage_wf_left.set_verbose_output(false);
         this->stage_wf_right.set_verbose_output(false);
+        this->stage_wf_single.set_verbose_output(false);
       }
 
       // The tensor discrete problem is created in two parts. First, matrix_left is the Jacobian
@@ -203,6 +224,14 @@ namespace Hermes
 
       stage_dp_right->set_RK(spaces.size());
 
+      // The explicit and diagonally implicit methods assemble the stationary residual (and its Jacobian) of one stage
+      // at a time, the previous time level solution is added to u_ext in the same way as in stage_dp_right.
+      if(bt->is_diagonally_implicit())
+      {
+        this->stage_dp_single = new DiscreteProblem<Scalar>(&stage_wf_single, spaces);
+        stage_dp_single->set_RK(spaces.size());
+      }
+
       // Prepare residuals of stage solutions.
       if(!residual_as_vector)
         for (unsigned int i = 0; i < num_stages; i++)
@@ -228,11 +257,80 @@ namespace Hermes
       this->block_diagonal_jacobian = true;
     }
 
+    template<typename Scalar>
+    void RungeKutta<Scalar>::set_lumped_mass()
+    {
+      this->lumped_mass = true;
+      this->mass_spaces_seqs.clear();
+    }
+
     template<typename Scalar>
     void RungeKutta<Scalar>::set_freeze_jacobian()
     {
       this->freeze_jacobian = true;
     }
+
+    template<typename Scalar>
+    void RungeKutta<Scalar>::set_sufficient_improvement_factor_jacobian(double ratio)
+    {
+      if(ratio <= 0.0)
+        throw Exceptions::ValueException("ratio", ratio, 0.0);
+      this->sufficient_improvement_factor_jacobian = ratio;
+    }
+
+    template<typename Scalar>
+    void RungeKutta<Scalar>::set_max_steps_with_reused_jacobian(unsigned int steps)
+    {
+      this->max_steps_with_reused_jacobian = steps;
+    }
+
+    template<typename Scalar>
+    bool RungeKutta<Scalar>::jacobian_outdated(int it, double residual_norm, double last_residual_norm) const
+    {
+      if(this->max_steps_with_reused_jacobian > 0 && this->jacobian_age >= this->max_steps_with_reused_jacobian)
+        return true;
+      return this->sufficient_improvement_factor_jacobian > 0.0 && it > 1 && residual_norm > last_residual_norm * this->sufficient_improvement_factor_jacobian;
+    }
+
+    template<typename Scalar>
+    void RungeKutta<Scalar>::set_time_step_control(double rel_tol, double abs_tol, int error_order)
+    {
+      if(rel_tol < 0.0)
+        throw Exceptions::ValueException("rel_tol", rel_tol, 0.0);
+      if(abs_tol < 0.0)
+        throw Exceptions::ValueException("abs_tol", abs_tol, 0.0);
+      if(rel_tol == 0.0 && abs_tol == 0.0)
+        throw Exceptions::Exception("RungeKutta::set_time_step_control(): at least one of the tolerances must be positive.");
+      if(error_order < 1)
+        throw Exceptions::ValueException("error_order", error_order, 1);
+      this->time_step_rel_tol = rel_tol;
+      this->time_step_abs_tol = abs_tol;
+      this->time_step_error_order = error_order;
+    }
+
+    template<typename Scalar>
+    int RungeKutta<Scalar>::get_accepted_steps() const
+    {
+      return this->accepted_steps;
+    }
+
+    template<typename Scalar>
+    int RungeKutta<Scalar>::get_rejected_steps() const
+    {
+      return this->rejected_steps;
+    }
+
+    template<typename Scalar>
+    double RungeKutta<Scalar>::get_accepted_steps_time() const
+    {
+      return this->accepted_steps_time;
+    }
+
+    template<typename Scalar>
+    double RungeKutta<Scalar>::get_rejected_steps_time() const
+    {
+      return this->rejected_steps_time;
+    }
     template<typename Scalar>
     void RungeKutta<Scalar>::set_newton_tol(double newton_tol)
     {
@@ -261,7 +359,13 @@ namespace Hermes
         delete stage_dp_left;
       if(stage_dp_right != NULL)
         delete stage_dp_right;
+      if(stage_dp_single != NULL)
+        delete stage_dp_single;
       delete solver;
+      delete mass_solver;
+      delete vector_single;
+      if(lumped_mass_vector != NULL)
+        delete [] lumped_mass_vector;
       delete matrix_right;
       delete matrix_left;
       delete vector_right;
@@ -281,12 +385,214 @@ namespace Hermes
       Scalar* source_vec, Scalar* target_vec)
     {
       int size = matrix->get_size();
+      // The blocks are independent, the matrix is only read.
+      int num_threads_used = Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads);
+#pragma omp parallel for schedule(static) num_threads(num_threads_used)
       for (int i = 0; i < num_blocks; i++)
       {
         matrix->multiply_with_vector(source_vec + i*size, target_vec + i*size);
       }
     }
 
+    template<typename Scalar>
+    void RungeKutta<Scalar>::calculate_stages(Hermes::vector<Solution<Scalar>*> slns_time_prev, Hermes::vector<Solution<Scalar>*> slns_time_new)
+    {
+      if(this->stage_dp_left == NULL)
+        this->init();
+
+      // Creates the stage weak formulation.
+      update_stage_wf(slns_time_prev);
+
+      info("\tRunge-Kutta: time step, time: %f, time step: %f", this->time, this->time_step);
+
+      // Set the correct time to the essential boundary conditions.
+      for (unsigned int stage_i = 0; stage_i < num_stages; stage_i++)
+        Space<Scalar>::update_essential_bc_values(spaces_mutable, this->time + bt->get_C(stage_i)*this->time_step);
+
+      // Explicit and diagonally implicit methods solve for the stages one after another,
+      // fully implicit ones for all stages at once.
+      if(bt->is_diagonally_implicit())
+        this->calculate_stages_serial(slns_time_new);
+      else
+        this->calculate_stages_newton(slns_time_new);
+    }
+
+    template<typename Scalar>
+    void RungeKutta<Scalar>::rk_integrate_adaptive(Solution<Scalar>* sln_time_prev, Solution<Scalar>* sln_time_new, double end_time)
+    {
+      Hermes::vector<Solution<Scalar>*> slns_time_prev = Hermes::vector<Solution<Scalar>*>();
+      slns_time_prev.push_back(sln_time_prev);
+      Hermes::vector<Solution<Scalar>*> slns_time_new  = Hermes::vector<Solution<Scalar>*>();
+      slns_time_new.push_back(sln_time_new);
+      rk_integrate_adaptive(slns_time_prev, slns_time_new, end_time);
+    }
+
+    template<typename Scalar>
+    void RungeKutta<Scalar>::rk_integrate_adaptive(Hermes::vector<Solution<Scalar>*> slns_time_prev,
+      Hermes::vector<Solution<Scalar>*> slns_time_new, double end_time)
+    {
+      if(bt->is_embedded() == false)
+        throw Hermes::Exceptions::Exception("rk_integrate_adaptive(): R-K method must be embedded.");
+      if(this->time_step_error_order < 1)
+        throw Hermes::Exceptions::Exception("rk_integrate_adaptive(): set_time_step_control() has to be called first.");
+      if(this->time_step <= 0.0)
+        throw Exceptions::ValueException("time step", this->time_step, 0.0);
+
+      // The controller: the safety factor, the limits of the change of the time step, and the exponents
+      // of the PI controller (Gustafsson) h_new = h safety err^{-0.7 / k} err_prev^{0.4 / k}, k = error_order + 1.
+      const double safety = 0.9, min_factor = 0.2, max_factor = 5.0;
+      double k = this->time_step_error_order + 1.0;
+
+      this->accepted_steps = 0;
+      this->rejected_steps = 0;
+      this->accepted_steps_time = 0.0;
+      this->rejected_steps_time = 0.0;
+
+      int ndof = Space<Scalar>::get_num_dofs(spaces);
+
+      // The time level solution is projected only once, then it is kept as the coefficient vector.
+      Scalar* coeff_vec = new Scalar[ndof];
+      if(do_global_projections)
+      {
+        OGProjection<Scalar> ogProjection;
+        ogProjection.project_global(spaces, slns_time_prev, coeff_vec);
+      }
+      else
+      {
+        LocalProjection<Scalar> ogProjection;
+        ogProjection.project_local(spaces, slns_time_prev, coeff_vec);
+      }
+      Scalar* coeff_vec_new = new Scalar[ndof];
+
+      // The accepted time level solution used by the forms (slns_time_new is overwritten by the filters
+      // in the stages), the initial condition before the first accepted step.
+      Hermes::vector<Solution<Scalar>*> slns_time_accepted;
+      for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
+        slns_time_accepted.push_back(new Solution<Scalar>(spaces[space_i]->get_mesh()));
+      Hermes::vector<Solution<Scalar>*> slns_time_level = slns_time_prev;
+
+      Hermes::Mixins::TimeMeasurable step_timer;
+      double error_prev = 1.0;
+      bool previous_rejected = false;
+      double min_time_step = 1e-12 * std::max(1.0, std::abs(end_time));
+      while(end_time - this->time > min_time_step)
+      {
+        // The last step ends exactly at end_time.
+        bool last_step = (this->time + this->time_step >= end_time);
+        if(last_step)
+          this->time_step = end_time - this->time;
+
+        step_timer.tick(Hermes::Mixins::TimeMeasurable::HERMES_SKIP);
+
+        // The step is rejected also if the Newton's method (or the linear solver in it) fails, i.e. it diverges
+        // or reaches the maximum number of iterations (ValueException) or the matrix can not be factorized
+        // (LinearMatrixSolverException). Any other exception is not caused by a long time step and is passed on.
+        bool newton_failed = false;
+        try
+        {
+          this->calculate_stages(slns_time_level, slns_time_new);
+        }
+        catch(Exceptions::ValueException&)
+        {
+          newton_failed = true;
+        }
+        catch(Exceptions::LinearMatrixSolverException&)
+        {
+          newton_failed = true;
+        }
+
+        // The new solution u_{n + 1} = u_n + h \sum_{j = 1}^s b_j k_j, and the error estimate
+        // h \sum_{j = 1}^s (b_j - b2_j) k_j relative to abs_tol + rel_tol |u_{n + 1}| (root mean squares of the coefficients).
+        double error = 0.0;
+        if(!newton_failed)
+        {
+          double error_norm = 0.0, sln_norm = 0.0;
+          for (int i = 0; i < ndof; i++)
+          {
+            Scalar increment = 0, error_increment = 0;
+            for (unsigned int j = 0; j < num_stages; j++)
+            {
+              increment += bt->get_B(j) * K_vector[j * ndof + i];
+              error_increment += (bt->get_B(j) - bt->get_B2(j)) * K_vector[j * ndof + i];
+            }
+            coeff_vec_new[i] = coeff_vec[i] + this->time_step * increment;
+            error_norm += std::abs(error_increment) * std::abs(error_increment);
+            sln_norm += std::abs(coeff_vec_new[i]) * std::abs(coeff_vec_new[i]);
+          }
+          error = this->time_step * std::sqrt(error_norm / ndof) / (this->time_step_abs_tol + this->time_step_rel_tol * std::sqrt(sln_norm / ndof));
+        }
+
+        step_timer.tick();
+
+        if(!newton_failed && error <= 1.0)
+        {
+          this->accepted_steps++;
+          this->accepted_steps_time += step_timer.last();
+          this->info("\tRunge-Kutta: time step accepted, time: %f, time step: %f, error estimate: %g.", this->time, this->time_step, error);
+
+          this->time += this->time_step;
+          iteration++;
+          memcpy(coeff_vec, coeff_vec_new, ndof * sizeof(Scalar));
+          Solution<Scalar>::vector_to_solutions(coeff_vec, spaces, slns_time_accepted);
+          slns_time_level = slns_time_accepted;
+
+          // The PI controller, the time step does not grow right after a rejection.
+          error = std::max(error, 1e-10);
+          double factor = safety * std::pow(error, -0.7 / k) * std::pow(error_prev, 0.4 / k);
+          if(previous_rejected)
+            factor = std::min(factor, 1.0);
+          factor = std::max(min_factor, std::min(max_factor, factor));
+
+          // Small changes are not made, the Jacobian factorized with set_freeze_jacobian() is then reused.
+          if(factor >= 1.0 && factor <= 1.2)
+            factor = 1.0;
+
+          error_prev = error;
+          previous_rejected = false;
+          this->time_step *= factor;
+        }
+        else
+        {
+          this->rejected_steps++;
+          this->rejected_steps_time += step_timer.last();
+          if(newton_failed)
+          {
+            this->info("\tRunge-Kutta: time step rejected (Newton's method failed), time: %f, time step: %f.", this->time, this->time_step);
+            this->time_step *= 0.5;
+            // The Newton's method may have failed because of a frozen Jacobian.
+            this->factorized_stage_coeff = 0.0;
+          }
+          else
+          {
+            this->info("\tRunge-Kutta: time step rejected, time: %f, time step: %f, error estimate: %g.", this->time, this->time_step, error);
+            this->time_step *= std::max(min_factor, safety * std::pow(error, -1.0 / k));
+          }
+          previous_rejected = true;
+
+          if(this->time_step < min_time_step)
+          {
+            delete [] coeff_vec;
+            delete [] coeff_vec_new;
+            for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
+              delete slns_time_accepted[space_i];
+            throw Hermes::Exceptions::Exception("rk_integrate_adaptive(): the time step %g is too small at time %g.", this->time_step, this->time);
+          }
+        }
+      }
+
+      this->time = end_time;
+      Solution<Scalar>::vector_to_solutions(coeff_vec, spaces, slns_time_new);
+
+      this->info("\tRunge-Kutta: %d accepted time steps (%f s), %d rejected time steps (%f s).",
+        this->accepted_steps, this->accepted_steps_time, this->rejected_steps, this->rejected_steps_time);
+
+      // Clean up.
+      delete [] coeff_vec;
+      delete [] coeff_vec_new;
+      for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
+        delete slns_time_accepted[space_i];
+    }
+
     template<typename Scalar>
     void RungeKutta<Scalar>::rk_time_step_newton(Solution<Scalar>* sln_time_prev,
                                           Solution<Scalar>* sln_time_new, Solution<Scalar>* error_fn)
@@ -310,21 +616,62 @@ namespace Hermes
 
       int ndof = Space<Scalar>::get_num_dofs(spaces);
 
-      if(this->stage_dp_left == NULL)
-        this->init();
-
-      // Creates the stage weak formulation.
-      update_stage_wf(slns_time_prev);
-
       // Check whether the user provided a nonzero B2-row if he wants temporal error estimation.
       if(error_fns != Hermes::vector<Solution<Scalar>*>() && bt->is_embedded() == false)
         throw Hermes::Exceptions::Exception("rk_time_step_newton(): R-K method must be embedded if temporal error estimate is requested.");
 
-      info("\tRunge-Kutta: time step, time: %f, time step: %f", this->time, this->time_step);
+      this->calculate_stages(slns_time_prev, slns_time_new);
 
-      // Set the correct time to the essential boundary conditions.
-      for (unsigned int stage_i = 0; stage_i < num_stages; stage_i++)
-        Space<Scalar>::update_essential_bc_values(spaces_mutable, this->time + bt->get_C(stage_i)*this->time_step);
+      // Project previous time level solution on the stage space,
+      // to be able to add them together. The result of the projection
+      // will be stored in the vector coeff_vec.
+      // FIXME - this projection is not needed when the
+      //         spaces are the same (if spatial adaptivity is not used).
+      Scalar* coeff_vec = new Scalar[ndof];
+      if(do_global_projections)
+      {
+        OGProjection<Scalar> ogProjection;
+        ogProjection.project_global(spaces, slns_time_prev, coeff_vec);
+      }
+      else
+      {
+        LocalProjection<Scalar> ogProjection;
+        ogProjection.project_local(spaces, slns_time_prev, coeff_vec);
+      }
+
+      // Calculate new time level solution in the stage space (u_{n + 1} = u_n + h \sum_{j = 1}^s b_j k_j).
+      for (int i = 0; i < ndof; i++)
+        for (unsigned int j = 0; j < num_stages; j++)
+          coeff_vec[i] += this->time_step * bt->get_B(j) * K_vector[j * ndof + i];
+
+      Solution<Scalar>::vector_to_solutions(coeff_vec, spaces, slns_time_new);
+
+      // If error_fn is not NULL, use the B2-row in the Butcher's
+      // table to calculate the temporal error estimate.
+      if(error_fns != Hermes::vector<Solution<Scalar>*>())
+      {
+        for (int i = 0; i < ndof; i++)
+        {
+          coeff_vec[i] = 0.;
+          for (unsigned int j = 0; j < num_stages; j++)
+            coeff_vec[i] += (bt->get_B(j) - bt->get_B2(j)) * K_vector[j * ndof + i];
+          coeff_vec[i] *= this->time_step;
+        }
+        Solution<Scalar>::vector_to_solutions_common_dir_lift(coeff_vec, spaces, error_fns);
+      }
+
+      // Clean up.
+      delete [] coeff_vec;
+
+      iteration++;
+      this->tick();
+      this->info("\tRunge-Kutta: time step duration: %f s.\n", this->last());
+    }
+
+    template<typename Scalar>
+    void RungeKutta<Scalar>::calculate_stages_newton(Hermes::vector<Solution<Scalar>*> slns_time_new)
+    {
+      int ndof = Space<Scalar>::get_num_dofs(spaces);
 
       // All Spaces of the problem.
       Hermes::vector<const Space<Scalar>*> stage_spaces_vector;
@@ -349,11 +696,10 @@ namespace Hermes
       // Assemble the block-diagonal mass matrix M of size ndof times ndof.
       // The corresponding part of the global residual vector is obtained
       // just by multiplication with the stage vector K.
-      // FIXME: This should not be repeated if spaces have not changed.
-      stage_dp_left->assemble(matrix_left, NULL);
+      this->update_mass_matrix(false);
 
       // The Newton's loop.
-      double residual_norm;
+      double residual_norm = 0.0, last_residual_norm;
       int it = 1;
       while (true)
       {
@@ -383,19 +729,10 @@ namespace Hermes
         // Multiply the residual vector with -1 since the matrix
         // equation reads J(Y^n) \deltaY^{n + 1} = -F(Y^n).
         vector_right->change_sign();
-        if(this->output_rhsOn && (this->output_rhsIterations == -1 || this->output_rhsIterations >= it))
-        {
-          char* fileName = new char[this->RhsFilename.length() + 5];
-          if(this->RhsFormat == Hermes::Algebra::DF_MATLAB_SPARSE)
-            sprintf(fileName, "%s%i.m", this->RhsFilename.c_str(), it);
-          else
-            sprintf(fileName, "%s%i", this->RhsFilename.c_str(), it);
-          FILE* rhs_file = fopen(fileName, "w+");
-          vector_right->dump(rhs_file, this->RhsVarname.c_str(), this->RhsFormat, this->rhs_number_format);
-          fclose(rhs_file);
-        }
+        this->dump_rhs(it);
 
         // Measure the residual norm.
+        last_residual_norm = residual_norm;
         if(residual_as_vector)
           // Calculate the l2-norm of residual vector.
           residual_norm = Global<Scalar>::get_l2_norm(vector_right);
@@ -427,7 +764,9 @@ namespace Hermes
         if((residual_norm < newton_tol || it > newton_max_iter) && it > 1)
           break;
 
-        bool rhs_only = (freeze_jacobian && it > 1);
+        // With set_freeze_jacobian(), the factorization is reused (also in the next time steps with the same h) until
+        // it is outdated, see set_sufficient_improvement_factor_jacobian(), set_max_steps_with_reused_jacobian().
+        bool rhs_only = (freeze_jacobian && factorized_stage_coeff == this->time_step && !this->jacobian_outdated(it, residual_norm, last_residual_norm));
         if(!rhs_only)
         {
           // Assemble the block Jacobian matrix of the stationary residual F
@@ -439,20 +778,12 @@ namespace Hermes
           // resulting tensor Jacobian.
           matrix_right->add_sparse_to_diagonal_blocks(num_stages, matrix_left);
 
-          if(this->output_matrixOn && (this->output_matrixIterations == -1 || this->output_matrixIterations >= it))
-          {
-            char* fileName = new char[this->matrixFilename.length() + 5];
-            if(this->matrixFormat == Hermes::Algebra::DF_MATLAB_SPARSE)
-              sprintf(fileName, "%s%i.m", this->matrixFilename.c_str(), it);
-            else
-              sprintf(fileName, "%s%i", this->matrixFilename.c_str(), it);
-            FILE* matrix_file = fopen(fileName, "w+");
-
-            matrix_right->dump(matrix_file, this->matrixVarname.c_str(), this->matrixFormat, this->matrix_number_format);
-            fclose(matrix_file);
-          }
+          this->dump_matrix(it);
 
           matrix_right->finish();
+          solver->set_factorization_scheme(HERMES_FACTORIZE_FROM_SCRATCH);
+          factorized_stage_coeff = this->time_step;
+          jacobian_age = 0;
         }
         else
           solver->set_factorization_scheme(HERMES_REUSE_FACTORIZATION_COMPLETELY);
@@ -460,6 +791,7 @@ namespace Hermes
         // Solve the linear system.
         if(!solver->solve())
           throw Exceptions::LinearMatrixSolverException();
+        jacobian_age++;
 
         // Add \deltaK^{n + 1} to K^n.
         for (unsigned int i = 0; i < num_stages*ndof; i++)
@@ -477,70 +809,297 @@ namespace Hermes
         throw Exceptions::ValueException("Newton iterations", it, newton_max_iter);
       }
 
-      // Project previous time level solution on the stage space,
-      // to be able to add them together. The result of the projection
-      // will be stored in the vector coeff_vec.
-      // FIXME - this projection is not needed when the
-      //         spaces are the same (if spatial adaptivity is not used).
-      Scalar* coeff_vec = new Scalar[ndof];
-      if(do_global_projections)
-      {
-        OGProjection<Scalar> ogProjection;
-        ogProjection.project_global(spaces, slns_time_prev, coeff_vec);
-      }
-      else
+      // Delete stage spaces.
+      for (unsigned int i = 0; i < num_stages * spaces.size(); i++)
+          delete stage_spaces_vector[i];
+
+      // Delete all residuals.
+      if(!residual_as_vector)
+        for (unsigned int i = 0; i < num_stages; i++)
+          delete residuals_vector[i];
+    }
+
+    template<typename Scalar>
+    void RungeKutta<Scalar>::update_mass_matrix(bool lumped)
+    {
+      int ndof = Space<Scalar>::get_num_dofs(spaces);
+
+      // The mass matrix M (only one block ndof times ndof) is assembled (and factorized), or lumped,
+      // only if the spaces have changed.
+      bool spaces_changed = (mass_spaces_seqs.size() != spaces.size() || lumped != (lumped_mass_vector != NULL));
+      for(unsigned int space_i = 0; space_i < spaces.size() && !spaces_changed; space_i++)
+        if(spaces[space_i]->get_seq() != mass_spaces_seqs[space_i])
+          spaces_changed = true;
+      if(!spaces_changed)
+        return;
+
+      // The stage Jacobian has to be assembled again as well.
+      factorized_stage_coeff = 0.0;
+
+      if(lumped_mass_vector != NULL)
       {
-        LocalProjection<Scalar> ogProjection;
-        ogProjection.project_local(spaces, slns_time_prev, coeff_vec);
+        delete [] lumped_mass_vector;
+        lumped_mass_vector = NULL;
       }
 
-      if(do_global_projections)
+      if(lumped)
       {
-        OGProjection<Scalar> ogProjection;
-        ogProjection.project_global(spaces, slns_time_prev, coeff_vec);
+        for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
+          if(spaces[space_i]->get_type() != HERMES_H1_SPACE && spaces[space_i]->get_type() != HERMES_L2_SPACE)
+            throw Exceptions::Exception("Runge-Kutta: the lumped mass matrix is available only for H1 and L2 spaces.");
+
+        // Only the vector forms of stage_wf_left are assembled, the integrals of the basis functions.
+        stage_dp_left->assemble(vector_single);
+        lumped_mass_vector = new Scalar[ndof];
+        vector_single->extract(lumped_mass_vector);
+
+        double max_abs = 0.0;
+        for (int i = 0; i < ndof; i++)
+          max_abs = std::max(max_abs, std::abs(lumped_mass_vector[i]));
+        for (int i = 0; i < ndof; i++)
+          if(std::abs(lumped_mass_vector[i]) <= 1e-12 * max_abs)
+            throw Exceptions::Exception("Runge-Kutta: the lumped mass matrix is singular (higher-order shape functions), use the consistent one.");
       }
       else
       {
-        LocalProjection<Scalar> ogProjection;
-        ogProjection.project_local(spaces, slns_time_prev, coeff_vec);
+        stage_dp_left->assemble(matrix_left, NULL);
+        matrix_left->finish();
+        mass_solver->set_factorization_scheme(HERMES_FACTORIZE_FROM_SCRATCH);
       }
 
-      // Calculate new time level solution in the stage space (u_{n + 1} = u_n + h \sum_{j = 1}^s b_j k_j).
-      for (int i = 0; i < ndof; i++)
-        for (unsigned int j = 0; j < num_stages; j++)
-          coeff_vec[i] += this->time_step * bt->get_B(j) * K_vector[j * ndof + i];
+      mass_spaces_seqs.clear();
+      for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
+        mass_spaces_seqs.push_back(spaces[space_i]->get_seq());
+    }
 
-      Solution<Scalar>::vector_to_solutions(coeff_vec, spaces, slns_time_new);
+    template<typename Scalar>
+    void RungeKutta<Scalar>::calculate_stages_serial(Hermes::vector<Solution<Scalar>*> slns_time_new)
+    {
+      int ndof = Space<Scalar>::get_num_dofs(spaces);
 
-      // If error_fn is not NULL, use the B2-row in the Butcher's
-      // table to calculate the temporal error estimate.
-      if(error_fns != Hermes::vector<Solution<Scalar>*>())
+      // The lumped mass matrix only with explicit methods.
+      bool lumped = lumped_mass && bt->is_explicit();
+      this->update_mass_matrix(lumped);
+
+      // The previous K_vector is the initial guess for the Newton's method in the implicit stages.
+      if(start_from_zero_K_vector || !iteration)
+        std::fill(K_vector, K_vector + num_stages * ndof, Scalar(0));
+
+      // Residuals of the stage as functions (set_residual_as_solutions()).
+      Hermes::vector<Solution<Scalar>*> stage_residuals;
+      if(!residual_as_vector)
+        for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
+          stage_residuals.push_back(residuals_vector[space_i]);
+
+      Scalar* mass_times_K = new Scalar[ndof];
+
+      // The stages one after another, K_i depends only on K_j, j <= i.
+      for (unsigned int stage_i = 0; stage_i < num_stages; stage_i++)
       {
-        for (int i = 0; i < ndof; i++)
+        Scalar* stage_K = K_vector + stage_i * ndof;
+        Scalar* stage_u_ext = u_ext_vec + stage_i * ndof;
+        double a_ii = bt->get_A(stage_i, stage_i);
+
+        // Prepare vector h\sum_{j < i} a_{ij} K_j.
+        Scalar* stage_known = vector_left + stage_i * ndof;
+        for (int idx = 0; idx < ndof; idx++)
         {
-          coeff_vec[i] = 0.;
-          for (unsigned int j = 0; j < num_stages; j++)
-            coeff_vec[i] += (bt->get_B(j) - bt->get_B2(j)) * K_vector[j * ndof + i];
-          coeff_vec[i] *= this->time_step;
+          Scalar increment = 0;
+          for (unsigned int stage_j = 0; stage_j < stage_i; stage_j++)
+            increment += bt->get_A(stage_i, stage_j) * K_vector[stage_j * ndof + idx];
+          stage_known[idx] = this->time_step * increment;
+        }
+
+        // The stationary residual F and its Jacobian (scaled by -h a_ii) at the stage time.
+        double stage_time = this->time + bt->get_C(stage_i) * this->time_step;
+        for (unsigned int m = 0; m < stage_wf_single.mfvol.size(); m++)
+        {
+          stage_wf_single.mfvol[m]->scaling_factor = -this->time_step * a_ii;
+          stage_wf_single.mfvol[m]->set_current_stage_time(stage_time);
+        }
+        for (unsigned int m = 0; m < stage_wf_single.mfsurf.size(); m++)
+        {
+          stage_wf_single.mfsurf[m]->scaling_factor = -this->time_step * a_ii;
+          stage_wf_single.mfsurf[m]->set_current_stage_time(stage_time);
+        }
+        for (unsigned int m = 0; m < stage_wf_single.vfvol.size(); m++)
+          stage_wf_single.vfvol[m]->set_current_stage_time(stage_time);
+        for (unsigned int m = 0; m < stage_wf_single.vfsurf.size(); m++)
+          stage_wf_single.vfsurf[m]->set_current_stage_time(stage_time);
+
+        // Explicit stage, M K_i = F(t_i, Y + h\sum_{j < i} a_{ij} K_j).
+        if(fabs(a_ii) < 1e-12)
+        {
+          memcpy(stage_u_ext, stage_known, ndof * sizeof(Scalar));
+
+          // Reinitialize filters.
+          if(this->filters_to_reinit.size() > 0)
+          {
+            Solution<Scalar>::vector_to_solutions(stage_u_ext, spaces, slns_time_new);
+
+            for(unsigned int filters_i = 0; filters_i < this->filters_to_reinit.size(); filters_i++)
+              filters_to_reinit.at(filters_i)->reinit();
+          }
+
+          stage_dp_single->assemble(stage_u_ext, NULL, vector_single);
+
+          if(lumped)
+          {
+            vector_single->extract(stage_K);
+            for (int idx = 0; idx < ndof; idx++)
+              stage_K[idx] /= lumped_mass_vector[idx];
+          }
+          else
+          {
+            // The factorization of M is reused in all stages and time steps until the spaces change.
+            if(!mass_solver->solve())
+              throw Exceptions::LinearMatrixSolverException();
+            mass_solver->set_factorization_scheme(HERMES_REUSE_FACTORIZATION_COMPLETELY);
+            memcpy(stage_K, mass_solver->get_sln_vector(), ndof * sizeof(Scalar));
+          }
+          continue;
+        }
+
+        // Implicit stage, the Newton's method for M K_i - F(t_i, Y + h\sum_{j < i} a_{ij} K_j + h a_{ii} K_i) = 0
+        // with the Jacobian M - h a_{ii} J of size ndof times ndof.
+        double residual_norm = 0.0, last_residual_norm;
+        int it = 1;
+        bool converged = false;
+        while (true)
+        {
+          for (int idx = 0; idx < ndof; idx++)
+            stage_u_ext[idx] = stage_known[idx] + this->time_step * a_ii * stage_K[idx];
+
+          // Reinitialize filters.
+          if(this->filters_to_reinit.size() > 0)
+          {
+            Solution<Scalar>::vector_to_solutions(stage_u_ext, spaces, slns_time_new);
+
+            for(unsigned int filters_i = 0; filters_i < this->filters_to_reinit.size(); filters_i++)
+              filters_to_reinit.at(filters_i)->reinit();
+          }
+
+          // The negative residual F - M K_i, the matrix equation reads J \deltaK_i = -R(K_i).
+          stage_dp_single->assemble(stage_u_ext, NULL, vector_right);
+          matrix_left->multiply_with_vector(stage_K, mass_times_K);
+          for (int idx = 0; idx < ndof; idx++)
+            mass_times_K[idx] = -mass_times_K[idx];
+          vector_right->add_vector(mass_times_K);
+          this->dump_rhs(it);
+
+          // Measure the residual norm.
+          last_residual_norm = residual_norm;
+          if(residual_as_vector)
+            residual_norm = Global<Scalar>::get_l2_norm(vector_right);
+          else
+          {
+            Solution<Scalar>::vector_to_solutions(vector_right, spaces, stage_residuals, false);
+            residual_norm = Global<Scalar>::calc_norms(stage_residuals);
+          }
+
+          // Info for the user.
+          if(it == 1)
+            this->info("\tRunge-Kutta: stage %d, Newton initial residual norm: %g", stage_i + 1, residual_norm);
+          else
+            this->info("\tRunge-Kutta: stage %d, Newton iteration %d, residual norm: %g", stage_i + 1, it-1, residual_norm);
+
+          // If maximum allowed residual norm is exceeded, fail.
+          if(residual_norm > newton_max_allowed_residual_norm)
+          {
+            delete [] mass_times_K;
+            throw Exceptions::ValueException("residual norm", residual_norm, newton_max_allowed_residual_norm);
+          }
+
+          // If residual norm is within tolerance, or the maximum number
+          // of iteration has been reached, then quit.
+          if(residual_norm < newton_tol && it > 1)
+          {
+            converged = true;
+            break;
+          }
+          if(it > newton_max_iter)
+            break;
+
+          // With set_freeze_jacobian(), the factorization is reused by all stages (and time steps) with the same h a_ii
+          // until it is outdated, see set_sufficient_improvement_factor_jacobian(), set_max_steps_with_reused_jacobian().
+          bool rhs_only = (freeze_jacobian && factorized_stage_coeff == this->time_step * a_ii
+            && !this->jacobian_outdated(it, residual_norm, last_residual_norm));
+          if(!rhs_only)
+          {
+            // Diagonal blocks are created even if empty, so that matrix_left can be added.
+            stage_dp_single->assemble(stage_u_ext, matrix_right, NULL, true);
+            matrix_right->add_sparse_to_diagonal_blocks(1, matrix_left);
+            this->dump_matrix(it);
+            matrix_right->finish();
+            solver->set_factorization_scheme(HERMES_FACTORIZE_FROM_SCRATCH);
+            factorized_stage_coeff = this->time_step * a_ii;
+            jacobian_age = 0;
+          }
+          else
+            solver->set_factorization_scheme(HERMES_REUSE_FACTORIZATION_COMPLETELY);
+
+          // Solve the linear system.
+          if(!solver->solve())
+          {
+            delete [] mass_times_K;
+            throw Exceptions::LinearMatrixSolverException();
+          }
+          jacobian_age++;
+
+          // Add \deltaK_i^{n + 1} to K_i^n.
+          for (int idx = 0; idx < ndof; idx++)
+            stage_K[idx] += newton_damping_coeff * solver->get_sln_vector()[idx];
+
+          // Increase iteration counter.
+          it++;
+        }
+
+        // If max number of iterations was exceeded, fail.
+        if(!converged)
+        {
+          delete [] mass_times_K;
+          this->tick();
+          this->info("\tRunge-Kutta: time step duration: %f s.\n", this->last());
+          throw Exceptions::ValueException("Newton iterations", it, newton_max_iter);
         }
-        Solution<Scalar>::vector_to_solutions_common_dir_lift(coeff_vec, spaces, error_fns);
       }
 
-      // Delete stage spaces.
-      for (unsigned int i = 0; i < num_stages * spaces.size(); i++)
-          delete stage_spaces_vector[i];
+      delete [] mass_times_K;
+    }
 
-      // Delete all residuals.
-      if(!residual_as_vector)
-        for (unsigned int i = 0; i < num_stages; i++)
-          delete residuals_vector[i];
+    template<typename Scalar>
+    void RungeKutta<Scalar>::dump_rhs(int it)
+    {
+      if(this->output_rhsOn && (this->output_rhsIterations == -1 || this->output_rhsIterations >= it))
+      {
+        char* fileName = new char[this->RhsFilename.length() + 5];
+        if(this->RhsFormat == Hermes::Algebra::DF_MATLAB_SPARSE)
+          sprintf(fileName, "%s%i.m", this->RhsFilename.c_str(), it);
+        else
+          sprintf(fileName, "%s%i", this->RhsFilename.c_str(), it);
+        FILE* rhs_file = fopen(fileName, "w+");
+        vector_right->dump(rhs_file, this->RhsVarname.c_str(), this->RhsFormat, this->rhs_number_format);
+        fclose(rhs_file);
+        delete [] fileName;
+      }
+    }
 
-      // Clean up.
-      delete [] coeff_vec;
+    template<typename Scalar>
+    void RungeKutta<Scalar>::dump_matrix(int it)
+    {
+      if(this->output_matrixOn && (this->output_matrixIterations == -1 || this->output_matrixIterations >= it))
+      {
+        char* fileName = new char[this->matrixFilename.length() + 5];
+        if(this->matrixFormat == Hermes::Algebra::DF_MATLAB_SPARSE)
+          sprintf(fileName, "%s%i.m", this->matrixFilename.c_str(), it);
+        else
+          sprintf(fileName, "%s%i", this->matrixFilename.c_str(), it);
+        FILE* matrix_file = fopen(fileName, "w+");
 
-      iteration++;
-      this->tick();
-      this->info("\tRunge-Kutta: time step duration: %f s.\n", this->last());
+        matrix_right->dump(matrix_file, this->matrixVarname.c_str(), this->matrixFormat, this->matrix_number_format);
+        fclose(matrix_file);
+        delete [] fileName;
+      }
     }
 
     template<typename Scalar>
@@ -576,6 +1135,12 @@ namespace Hermes
       // Clear the WeakForms.
       stage_wf_left.delete_all();
       stage_wf_right.delete_all();
+      stage_wf_single.delete_all();
+
+      // The same quadrature as the original one.
+      stage_wf_left.set_quad_2d(wf->get_quad_2d());
+      stage_wf_right.set_quad_2d(wf->get_quad_2d());
+      stage_wf_single.set_quad_2d(wf->get_quad_2d());
 
       // First let's do the mass matrix (only one block ndof times ndof).
       for(unsigned int component_i = 0; component_i < size; component_i++)
@@ -588,6 +1153,9 @@ namespace Hermes
           proj_form->scaling_factor = 1.0;
           proj_form->u_ext_offset = 0;
           stage_wf_left.add_matrix_form(proj_form);
+
+          // The diagonal of the lumped mass matrix, assembled only with set_lumped_mass().
+          stage_wf_left.add_vector_form(new WeakFormsH1::DefaultVectorFormVol<Scalar>(component_i));
         }
         if(spaces[component_i]->get_type() == HERMES_HDIV_SPACE
            || spaces[component_i]->get_type() == HERMES_HCURL_SPACE)
@@ -703,6 +1271,41 @@ namespace Hermes
           stage_wf_right.add_vector_form_surf(vfs_i);
         }
       }
+
+      // The explicit and diagonally implicit methods need the forms of one stage only,
+      // the scaling of the matrix forms (-h a_ii) is set stage by stage.
+      if(bt->is_diagonally_implicit())
+      {
+        if(!bt->is_explicit())
+        {
+          for (unsigned int m = 0; m < mfvol_base.size(); m++)
+          {
+            MatrixFormVol<Scalar>* mfv = mfvol_base[m]->clone();
+            mfv->u_ext_offset = 0;
+            stage_wf_single.add_matrix_form(mfv);
+          }
+          for (unsigned int m = 0; m < mfsurf_base.size(); m++)
+          {
+            MatrixFormSurf<Scalar>* mfs = mfsurf_base[m]->clone();
+            mfs->u_ext_offset = 0;
+            stage_wf_single.add_matrix_form_surf(mfs);
+          }
+        }
+        for (unsigned int m = 0; m < vfvol_base.size(); m++)
+        {
+          VectorFormVol<Scalar>* vfv = vfvol_base[m]->clone();
+          vfv->scaling_factor = 1.0;
+          vfv->u_ext_offset = 0;
+          stage_wf_single.add_vector_form(vfv);
+        }
+        for (unsigned int m = 0; m < vfsurf_base.size(); m++)
+        {
+          VectorFormSurf<Scalar>* vfs = vfsurf_base[m]->clone();
+          vfs->scaling_factor = 1.0;
+          vfs->u_ext_offset = 0;
+          stage_wf_single.add_vector_form_surf(vfs);
+        }
+      }
     }
 
     template<typename Scalar>
@@ -712,6 +1315,7 @@ namespace Hermes
       {
         this->stage_wf_left.set_global_integration_order(this->wf->global_integration_order);
         this->stage_wf_right.set_global_integration_order(this->wf->global_integration_order);
+        this->stage_wf_single.set_global_integration_order(this->wf->global_integration_order);
       }
 
       // Extracting volume and surface matrix and vector forms from the
@@ -721,8 +1325,15 @@ namespace Hermes
       Hermes::vector<VectorFormVol<Scalar> *> vfvol = stage_wf_right.vfvol;
       Hermes::vector<VectorFormSurf<Scalar> *> vfsurf = stage_wf_right.vfsurf;
 
+      // The previous time level solutions are the last external functions (see DiscreteProblem::set_RK()),
+      // the ones of the previous time steps are not kept.
+      stage_wf_right.ext.clear();
+      stage_wf_single.ext.clear();
       for(unsigned int slns_time_prev_i = 0; slns_time_prev_i < slns_time_prev.size(); slns_time_prev_i++)
-          stage_wf_right.ext.push_back(slns_time_prev[slns_time_prev_i]);
+      {
+        stage_wf_right.ext.push_back(slns_time_prev[slns_time_prev_i]);
+        stage_wf_single.ext.push_back(slns_time_prev[slns_time_prev_i]);
+      }
 
       // Duplicate matrix volume forms, scale them according
       // to the Butcher's table, enhance them with additional
@@ -769,7 +1380,9 @@ namespace Hermes
     void RungeKutta<Scalar>::prepare_u_ext_vec()
     {
       unsigned int ndof = Space<Scalar>::get_num_dofs(spaces);
-      for (unsigned int stage_i = 0; stage_i < num_stages; stage_i++)
+      int num_threads_used = Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads);
+#pragma omp parallel for schedule(static) num_threads(num_threads_used)
+      for (int stage_i = 0; stage_i < (int)num_stages; stage_i++)
       {
         unsigned int running_space_ndofs = 0;
         for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
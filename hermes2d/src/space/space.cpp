@@ -24,6 +24,7 @@
 #include "space_h2d_xml.h"
 #include "api2d.h"
 #include <iostream>
+#include <algorithm>
 
 namespace Hermes
 {
@@ -47,6 +48,18 @@ namespace Hermes
       this->proj_mat = NULL;
       this->chol_p = NULL;
       this->vertex_functions_count = this->edge_functions_count = this->bubble_functions_count = 0;
+      this->incremental_dof_assignment = false;
+      this->node_dof_history = NULL;
+      this->element_dof_history = NULL;
+      this->element_al_dof_history = NULL;
+      this->node_dof_history_size = this->element_dof_history_size = 0;
+      this->dof_history_ndof = 0;
+      this->dof_history_stride = 1;
+      this->dof_map = NULL;
+      this->dof_map_size = 0;
+      this->dof_map_seq = -1;
+      this->changed_elements = NULL;
+      this->changed_elements_size = 0;
 
 			if(essential_bcs != NULL)
 				for(Hermes::vector<EssentialBoundaryCondition<double>*>::const_iterator it = essential_bcs->begin(); it != essential_bcs->end(); it++)
@@ -75,6 +88,18 @@ namespace Hermes
       this->proj_mat = NULL;
       this->chol_p = NULL;
       this->vertex_functions_count = this->edge_functions_count = this->bubble_functions_count = 0;
+      this->incremental_dof_assignment = false;
+      this->node_dof_history = NULL;
+      this->element_dof_history = NULL;
+      this->element_al_dof_history = NULL;
+      this->node_dof_history_size = this->element_dof_history_size = 0;
+      this->dof_history_ndof = 0;
+      this->dof_history_stride = 1;
+      this->dof_map = NULL;
+      this->dof_map_size = 0;
+      this->dof_map_seq = -1;
+      this->changed_elements = NULL;
+      this->changed_elements_size = 0;
 
 			if(essential_bcs != NULL)
 				for(Hermes::vector<EssentialBoundaryCondition<std::complex<double> >*>::const_iterator it = essential_bcs->begin(); it != essential_bcs->end(); it++)
@@ -93,6 +118,7 @@ namespace Hermes
 			free_bc_data();
 			if(nsize) { ::free(ndata); nsize = 0; ndata = NULL; }
 			if(esize) { ::free(edata); edata = 0; edata = NULL; }
+			free_dof_history();
 			this->seq = -1;
 		}
 
@@ -102,6 +128,7 @@ namespace Hermes
 			free_bc_data();
 			if(nsize) { ::free(ndata); nsize = 0; ndata = NULL; }
 			if(esize) { ::free(edata); edata = 0; edata = NULL; }
+			free_dof_history();
 			this->seq = -1;
 		}
 
@@ -920,6 +947,14 @@ namespace Hermes
       assign_edge_dofs();
       assign_bubble_dofs();
 
+      if(this->incremental_dof_assignment)
+      {
+        // the numbering may change even if the orders and the mesh did not
+        this->seq = g_space_seq++;
+        renumber_dofs_incremental();
+        store_dof_history();
+      }
+
       free_bc_data();
       update_essential_bc_values();
       update_constraints();
@@ -929,10 +964,387 @@ namespace Hermes
       was_assigned = this->seq;
       this->ndof = (next_dof - first_dof) / stride;
 
+      if(this->incremental_dof_assignment)
+        find_changed_elements();
+
       return this->ndof;
       check();
     }
 
+    template<typename Scalar>
+    void Space<Scalar>::set_incremental_dof_assignment(bool incremental)
+    {
+      this->incremental_dof_assignment = incremental;
+      if(!incremental)
+        free_dof_history();
+    }
+
+    template<typename Scalar>
+    const int* Space<Scalar>::get_dof_map() const
+    {
+      return this->dof_map;
+    }
+
+    template<typename Scalar>
+    int Space<Scalar>::get_dof_map_size() const
+    {
+      return this->dof_map_size;
+    }
+
+    template<typename Scalar>
+    void Space<Scalar>::free_dof_history()
+    {
+      if(this->node_dof_history != NULL)
+      {
+        ::free(this->node_dof_history);
+        this->node_dof_history = NULL;
+      }
+      if(this->element_dof_history != NULL)
+      {
+        ::free(this->element_dof_history);
+        this->element_dof_history = NULL;
+      }
+      if(this->element_al_dof_history != NULL)
+      {
+        delete [] this->element_al_dof_history;
+        this->element_al_dof_history = NULL;
+      }
+      this->node_dof_history_size = this->element_dof_history_size = 0;
+      this->dof_history_ndof = 0;
+
+      if(this->dof_map != NULL)
+      {
+        delete [] this->dof_map;
+        this->dof_map = NULL;
+      }
+      this->dof_map_size = 0;
+      this->dof_map_seq = -1;
+
+      if(this->changed_elements != NULL)
+      {
+        delete [] this->changed_elements;
+        this->changed_elements = NULL;
+      }
+      this->changed_elements_size = 0;
+    }
+
+    /// One block of consecutive DOFs (of a node or of the bubble functions of an element).
+    struct DofBlock
+    {
+      int* dof; ///< where the first DOF of the block is stored (NodeData::dof or ElementData::bdof)
+      int n;
+      int old;  ///< position in the previous assignment, -1 for a new block
+      int pos;  ///< position in the new assignment
+    };
+
+    /// Larger blocks first, keeping the order of the original numbering otherwise.
+    static bool dof_block_compare(const DofBlock* a, const DofBlock* b)
+    {
+      if(a->n != b->n)
+        return a->n > b->n;
+      return a->pos < b->pos;
+    }
+
+    template<typename Scalar>
+    void Space<Scalar>::renumber_dofs_incremental()
+    {
+      if(this->dof_map != NULL)
+      {
+        delete [] this->dof_map;
+        this->dof_map = NULL;
+      }
+      this->dof_map_size = 0;
+      this->dof_map_seq = -1;
+
+      // nothing to compare to
+      if(this->node_dof_history == NULL || this->dof_history_stride != this->stride)
+        return;
+
+      int new_ndof = (this->next_dof - this->first_dof) / this->stride;
+      int old_ndof = this->dof_history_ndof;
+
+      // collect the blocks of the nodes and match them with the previous assignment
+      Hermes::vector<DofBlock> blocks;
+      for (int i = 0; i < mesh->get_max_node_id(); i++)
+      {
+        Node* node = mesh->get_node(i);
+        if(!node->used || ndata[i].dof < 0 || ndata[i].n <= 0)
+          continue;
+
+        NodeDofHistory* h = (i < this->node_dof_history_size) ? this->node_dof_history + i : NULL;
+        bool same_node = (h != NULL && h->type == (int)node->type && h->p1 == node->p1 && h->p2 == node->p2);
+
+        DofBlock block;
+        block.dof = &ndata[i].dof;
+        block.n = ndata[i].n;
+        block.pos = (ndata[i].dof - this->first_dof) / this->stride;
+        block.old = (same_node && h->dof >= 0 && h->n == block.n) ? h->dof : -1;
+        blocks.push_back(block);
+      }
+
+      // the same for the bubble functions of the elements
+      Element* e;
+      for_all_active_elements(e, mesh)
+      {
+        ElementData* ed = edata + e->id;
+        if(ed->n <= 0 || ed->bdof < 0)
+          continue;
+
+        bool same_element = false;
+        if(e->id < this->element_dof_history_size)
+        {
+          ElementDofHistory* h = this->element_dof_history + e->id;
+          same_element = (h->nvert == (int)e->get_nvert() && h->order == ed->order);
+          for (unsigned int j = 0; same_element && j < e->get_nvert(); j++)
+            same_element = (h->vn[j] == e->vn[j]->id);
+        }
+
+        DofBlock block;
+        block.dof = &ed->bdof;
+        block.n = ed->n;
+        block.pos = (ed->bdof - this->first_dof) / this->stride;
+        block.old = -1;
+        if(same_element && this->element_dof_history[e->id].dof >= 0 && this->element_dof_history[e->id].n == block.n)
+          block.old = this->element_dof_history[e->id].dof;
+        blocks.push_back(block);
+      }
+
+      // the matched blocks keep their numbers, if these still fit in
+      bool* occupied = new bool[new_ndof + 1];
+      memset(occupied, 0, sizeof(bool) * (new_ndof + 1));
+      Hermes::vector<DofBlock*> unplaced;
+      for (unsigned int i = 0; i < blocks.size(); i++)
+      {
+        DofBlock* block = &blocks[i];
+        if(block->old >= 0 && block->old + block->n <= new_ndof)
+        {
+          block->pos = block->old;
+          for (int j = 0; j < block->n; j++)
+            occupied[block->old + j] = true;
+        }
+        else
+          unplaced.push_back(block);
+      }
+
+      // the other blocks go to the holes (first fit, larger blocks first)
+      std::sort(unplaced.begin(), unplaced.end(), dof_block_compare);
+      Hermes::vector<std::pair<int, int> > holes;
+      for (int i = 0; i < new_ndof; )
+      {
+        if(occupied[i])
+        {
+          i++;
+          continue;
+        }
+        int start = i;
+        while (i < new_ndof && !occupied[i])
+          i++;
+        holes.push_back(std::pair<int, int>(start, i - start));
+      }
+      delete [] occupied;
+
+      bool placed_all = true;
+      for (unsigned int i = 0; i < unplaced.size() && placed_all; i++)
+      {
+        unsigned int j = 0;
+        while (j < holes.size() && holes[j].second < unplaced[i]->n)
+          j++;
+        if(j == holes.size())
+          placed_all = false;
+        else
+        {
+          unplaced[i]->pos = holes[j].first;
+          holes[j].first += unplaced[i]->n;
+          holes[j].second -= unplaced[i]->n;
+        }
+      }
+
+      // the holes are too fragmented: keep the fresh numbering, the map is still exact
+      if(!placed_all)
+        for (unsigned int i = 0; i < blocks.size(); i++)
+          blocks[i].pos = (*blocks[i].dof - this->first_dof) / this->stride;
+
+      this->dof_map = new int[old_ndof + 1];
+      this->dof_map_size = old_ndof;
+      for (int i = 0; i < old_ndof; i++)
+        this->dof_map[i] = -1;
+      for (unsigned int i = 0; i < blocks.size(); i++)
+      {
+        *blocks[i].dof = this->first_dof + blocks[i].pos * this->stride;
+        if(blocks[i].old >= 0)
+          for (int j = 0; j < blocks[i].n; j++)
+            this->dof_map[blocks[i].old + j] = blocks[i].pos + j;
+      }
+      this->dof_map_seq = this->was_assigned;
+    }
+
+    template<typename Scalar>
+    void Space<Scalar>::store_dof_history()
+    {
+      int num_nodes = mesh->get_max_node_id();
+      if(num_nodes > this->node_dof_history_size || this->node_dof_history == NULL)
+      {
+        this->node_dof_history = (NodeDofHistory*)realloc(this->node_dof_history, std::max(num_nodes, 1) * sizeof(NodeDofHistory));
+        this->node_dof_history_size = num_nodes;
+      }
+      for (int i = 0; i < this->node_dof_history_size; i++)
+      {
+        NodeDofHistory* h = this->node_dof_history + i;
+        h->type = -1;
+        h->dof = -1;
+        if(i >= num_nodes || !mesh->get_node(i)->used)
+          continue;
+        Node* node = mesh->get_node(i);
+        h->type = node->type;
+        h->p1 = node->p1;
+        h->p2 = node->p2;
+        h->n = ndata[i].n;
+        if(ndata[i].dof >= 0 && ndata[i].n > 0)
+          h->dof = (ndata[i].dof - this->first_dof) / this->stride;
+      }
+
+      int num_elements = mesh->get_max_element_id();
+      if(num_elements > this->element_dof_history_size || this->element_dof_history == NULL)
+      {
+        this->element_dof_history = (ElementDofHistory*)realloc(this->element_dof_history, std::max(num_elements, 1) * sizeof(ElementDofHistory));
+        for (int i = this->element_dof_history_size; i < num_elements; i++)
+          this->element_dof_history[i].al_cnt = -1;
+        this->element_dof_history_size = num_elements;
+      }
+      // the signatures of the assembly lists are kept, find_changed_elements() still needs them
+      for (int i = 0; i < this->element_dof_history_size; i++)
+      {
+        this->element_dof_history[i].nvert = 0;
+        this->element_dof_history[i].dof = -1;
+      }
+      Element* e;
+      for_all_active_elements(e, mesh)
+      {
+        ElementDofHistory* h = this->element_dof_history + e->id;
+        h->nvert = e->get_nvert();
+        for (unsigned int j = 0; j < e->get_nvert(); j++)
+          h->vn[j] = e->vn[j]->id;
+        h->order = edata[e->id].order;
+        h->n = edata[e->id].n;
+        if(edata[e->id].bdof >= 0 && edata[e->id].n > 0)
+          h->dof = (edata[e->id].bdof - this->first_dof) / this->stride;
+      }
+
+      this->dof_history_ndof = (this->next_dof - this->first_dof) / this->stride;
+      this->dof_history_stride = this->stride;
+    }
+
+    /// Contribution of one DOF to the signature of an assembly list; the signature is the sum
+    /// of these, so that it does not depend on the order of the list. Different lists may have
+    /// the same signature, it only rejects most of the changed lists before they are compared.
+    static inline unsigned int dof_signature(int dof)
+    {
+      unsigned int x = (unsigned int)dof + 0x9e3779b9u;
+      x ^= x >> 16;
+      x *= 0x85ebca6bu;
+      x ^= x >> 13;
+      x *= 0xc2b2ae35u;
+      x ^= x >> 16;
+      return x;
+    }
+
+    template<typename Scalar>
+    void Space<Scalar>::find_changed_elements()
+    {
+      if(this->changed_elements != NULL)
+      {
+        delete [] this->changed_elements;
+        this->changed_elements = NULL;
+      }
+      this->changed_elements_size = mesh->get_max_element_id();
+      this->changed_elements = new bool[this->changed_elements_size + 1];
+      for (int i = 0; i < this->changed_elements_size; i++)
+        this->changed_elements[i] = true;
+
+      // inverse of dof_map, -1 for the new DOFs
+      int ndof = (this->next_dof - this->first_dof) / this->stride;
+      int* new_to_old = new int[ndof + 1];
+      for (int i = 0; i < ndof; i++)
+        new_to_old[i] = -1;
+      if(this->dof_map != NULL)
+        for (int i = 0; i < this->dof_map_size; i++)
+          if(this->dof_map[i] >= 0)
+            new_to_old[this->dof_map[i]] = i;
+
+      unsigned int* al_hash = new unsigned int[this->element_dof_history_size + 1];
+      int* al_cnt = new int[this->element_dof_history_size + 1];
+      int* al_start = new int[this->element_dof_history_size + 1];
+      for (int i = 0; i < this->element_dof_history_size; i++)
+      {
+        al_cnt[i] = -1;
+        al_start[i] = 0;
+      }
+
+      // the sorted lists in the new numbering (stored for the next assignment) and the list of an element in the old one
+      std::vector<int> al_dofs;
+      std::vector<int> old_dofs;
+
+      AsmList<Scalar> al;
+      Element* e;
+      for_all_active_elements(e, mesh)
+      {
+        get_element_assembly_list(e, &al);
+
+        // the list in the new and in the old numbering
+        unsigned int hash = 0, old_hash = 0;
+        int cnt = 0;
+        int start = al_dofs.size();
+        bool has_new_dof = false;
+        old_dofs.clear();
+        for (unsigned int i = 0; i < al.cnt; i++)
+        {
+          if(al.dof[i] < 0)
+            continue;
+          int dof = (al.dof[i] - this->first_dof) / this->stride;
+          al_dofs.push_back(dof);
+          hash += dof_signature(dof);
+          if(new_to_old[dof] < 0)
+            has_new_dof = true;
+          else
+          {
+            old_dofs.push_back(new_to_old[dof]);
+            old_hash += dof_signature(new_to_old[dof]);
+          }
+          cnt++;
+        }
+        std::sort(al_dofs.begin() + start, al_dofs.end());
+
+        // the signatures only reject the changed lists quickly, equal ones are compared exactly
+        ElementDofHistory* h = this->element_dof_history + e->id;
+        if(this->dof_map != NULL && !has_new_dof && h->al_cnt == cnt && h->al_hash == old_hash)
+        {
+          std::sort(old_dofs.begin(), old_dofs.end());
+          if(std::equal(old_dofs.begin(), old_dofs.end(), this->element_al_dof_history + h->al_start))
+            this->changed_elements[e->id] = false;
+        }
+
+        al_hash[e->id] = hash;
+        al_cnt[e->id] = cnt;
+        al_start[e->id] = start;
+      }
+
+      for (int i = 0; i < this->element_dof_history_size; i++)
+      {
+        this->element_dof_history[i].al_hash = al_hash[i];
+        this->element_dof_history[i].al_cnt = al_cnt[i];
+        this->element_dof_history[i].al_start = al_start[i];
+      }
+      if(this->element_al_dof_history != NULL)
+        delete [] this->element_al_dof_history;
+      this->element_al_dof_history = new int[al_dofs.size() + 1];
+      std::copy(al_dofs.begin(), al_dofs.end(), this->element_al_dof_history);
+
+      delete [] new_to_old;
+      delete [] al_hash;
+      delete [] al_cnt;
+      delete [] al_start;
+    }
+
     template<typename Scalar>
     void Space<Scalar>::reset_dof_assignment()
     {
@@ -1183,120 +1595,109 @@ namespace Hermes
     }
 
     template<typename Scalar>
-    Space<Scalar>* Space<Scalar>::load(const char *filename, Mesh* mesh, bool validate, EssentialBCs<Scalar>* essential_bcs, Shapeset* shapeset)
+    Space<Scalar>* Space<Scalar>::create_for_loading(SpaceType type, const char *filename, Mesh* mesh, EssentialBCs<Scalar>* essential_bcs, Shapeset* shapeset)
     {
-      try
+      Space<Scalar>* space;
+      switch(type)
       {
-				Space<Scalar>* space;
-
-        ::xml_schema::flags parsing_flags = 0;
-
-        if(!validate)
-          parsing_flags = xml_schema::flags::dont_validate;
-
-        std::auto_ptr<XMLSpace::space> parsed_xml_space (XMLSpace::space_(filename, parsing_flags));
-
-				if(!strcmp(parsed_xml_space->spaceType().get().c_str(),"h1"))
-				{
-					space = new H1Space<Scalar>();
-					space->mesh = mesh;
+      case HERMES_H1_SPACE:
+        space = new H1Space<Scalar>();
+        if(shapeset == NULL)
+        {
+          space->shapeset = new H1Shapeset;
+          space->own_shapeset = true;
+        }
+        break;
+      case HERMES_HCURL_SPACE:
+        if(shapeset != NULL && shapeset->get_num_components() < 2)
+          throw Hermes::Exceptions::Exception("HcurlSpace requires a vector shapeset in Space::load.");
+        space = new HcurlSpace<Scalar>();
+        if(shapeset == NULL)
+        {
+          space->shapeset = new HcurlShapeset;
+          space->own_shapeset = true;
+        }
+        break;
+      case HERMES_HDIV_SPACE:
+        if(shapeset != NULL && shapeset->get_num_components() < 2)
+          throw Hermes::Exceptions::Exception("HdivSpace requires a vector shapeset in Space::load.");
+        space = new HdivSpace<Scalar>();
+        if(shapeset == NULL)
+        {
+          space->shapeset = new HdivShapeset;
+          space->own_shapeset = true;
+        }
+        break;
+      case HERMES_L2_SPACE:
+        space = new L2Space<Scalar>();
+        if(shapeset == NULL)
+        {
+          space->shapeset = new L2Shapeset;
+          space->own_shapeset = true;
+        }
+        static_cast<L2Space<Scalar>*>(space)->ldata = NULL;
+        static_cast<L2Space<Scalar>*>(space)->lsize = 0;
+        break;
+      default:
+        throw Exceptions::SpaceLoadFailureException("Wrong spaceType in the file %s in Space::load.", filename);
+      }
 
-					if(shapeset == NULL)
-					{
-						space->shapeset = new H1Shapeset;
-						space->own_shapeset = true;
-					}
-					else
-					{
-						if(shapeset->get_space_type() != HERMES_H1_SPACE)
-							throw Hermes::Exceptions::SpaceLoadFailureException("Wrong shapeset / Wrong spaceType in the Solution XML file %s in Space::load.", filename);
-						else
-							space->shapeset = shapeset;
-					}
+      space->mesh = mesh;
+      if(shapeset != NULL)
+      {
+        if(shapeset->get_space_type() != type)
+        {
+          delete space;
+          throw Hermes::Exceptions::SpaceLoadFailureException("Wrong shapeset / Wrong spaceType in the file %s in Space::load.", filename);
+        }
+        space->shapeset = shapeset;
+      }
 
-					space->precalculate_projection_matrix(2, space->proj_mat, space->chol_p);
-				}
-				else if (!strcmp(parsed_xml_space->spaceType().get().c_str(),"hcurl"))
-				{
-					space = new HcurlSpace<Scalar>();
-					space->mesh = mesh;
+      if(type == HERMES_H1_SPACE)
+        space->precalculate_projection_matrix(2, space->proj_mat, space->chol_p);
+      else if(type != HERMES_L2_SPACE)
+        space->precalculate_projection_matrix(0, space->proj_mat, space->chol_p);
 
-					if(shapeset == NULL)
-					{
-						space->shapeset = new HcurlShapeset;
-						space->own_shapeset = true;
-					}
-				else
-					{
-						if(shapeset->get_num_components() < 2)
-							throw Hermes::Exceptions::Exception("HcurlSpace requires a vector shapeset in Space::load.");
-						if(shapeset->get_space_type() != HERMES_HCURL_SPACE)
-							throw Hermes::Exceptions::SpaceLoadFailureException("Wrong shapeset / Wrong spaceType in the Solution XML file %s in Space::load.", filename);
-						else
-							space->shapeset = shapeset;
-					}
+      space->essential_bcs = essential_bcs;
+      space->mesh_seq = space->mesh->get_seq();
 
-					space->precalculate_projection_matrix(0, space->proj_mat, space->chol_p);
-				}
-				else if(!!strcmp(parsed_xml_space->spaceType().get().c_str(),"hdiv"))
-				{
-					space = new HdivSpace<Scalar>();
-					space->mesh = mesh;
+      // L2 space does not have any (strong) essential BCs.
+      if(essential_bcs != NULL && type != HERMES_L2_SPACE)
+        for(typename Hermes::vector<EssentialBoundaryCondition<Scalar>*>::const_iterator it = essential_bcs->begin(); it != essential_bcs->end(); it++)
+          for(unsigned int i = 0; i < (*it)->markers.size(); i++)
+            if(space->get_mesh()->boundary_markers_conversion.conversion_table_inverse.find((*it)->markers.at(i)) == space->get_mesh()->boundary_markers_conversion.conversion_table_inverse.end())
+              throw Hermes::Exceptions::Exception("A boundary condition defined on a non-existent marker.");
 
-					if(shapeset == NULL)
-					{
-						space->shapeset = new HdivShapeset;
-						space->own_shapeset = true;
-					}
-					else
-					{
-						if(shapeset->get_num_components() < 2)
-							throw Hermes::Exceptions::Exception("HdivSpace requires a vector shapeset in Space::load.");
-						if(shapeset->get_space_type() != HERMES_HDIV_SPACE)
-							throw Hermes::Exceptions::SpaceLoadFailureException("Wrong shapeset / Wrong spaceType in the Solution XML file %s in Space::load.", filename);
-						else
-							space->shapeset = shapeset;
-					}
+      space->resize_tables();
 
-					space->precalculate_projection_matrix(0, space->proj_mat, space->chol_p);
-				}
-				else if(strcmp(parsed_xml_space->spaceType().get().c_str(),"l2"))
-				{
-					space = new L2Space<Scalar>();
-					space->mesh = mesh;
+      return space;
+    }
 
-					if(shapeset == NULL)
-					{
-						space->shapeset = new L2Shapeset;
-						space->own_shapeset = true;
-					}
-					{
-						if(shapeset->get_space_type() != HERMES_L2_SPACE)
-							throw Hermes::Exceptions::SpaceLoadFailureException("Wrong shapeset / Wrong spaceType in the Solution XML file %s in Space::load.", filename);
-						else
-							space->shapeset = shapeset;
-					}
+    template<typename Scalar>
+    Space<Scalar>* Space<Scalar>::load(const char *filename, Mesh* mesh, bool validate, EssentialBCs<Scalar>* essential_bcs, Shapeset* shapeset)
+    {
+      try
+      {
+        ::xml_schema::flags parsing_flags = 0;
 
-					static_cast<L2Space<Scalar>*>(space)->ldata = NULL;
-					static_cast<L2Space<Scalar>*>(space)->lsize = 0;
-				}
-				else
-				{
-					throw Exceptions::SpaceLoadFailureException("Wrong spaceType in the Solution XML file %s in Space::load.", filename);
-					return NULL;
-				}
+        if(!validate)
+          parsing_flags = xml_schema::flags::dont_validate;
 
-				space->essential_bcs = essential_bcs;
-				space->mesh_seq = space->mesh->get_seq();
+        std::auto_ptr<XMLSpace::space> parsed_xml_space (XMLSpace::space_(filename, parsing_flags));
 
-				// L2 space does not have any (strong) essential BCs.
-				if(essential_bcs != NULL && parsed_xml_space->spaceType().get().c_str() != "l2")
-					for(typename Hermes::vector<EssentialBoundaryCondition<Scalar>*>::const_iterator it = essential_bcs->begin(); it != essential_bcs->end(); it++)
-						for(unsigned int i = 0; i < (*it)->markers.size(); i++)
-							if(space->get_mesh()->boundary_markers_conversion.conversion_table_inverse.find((*it)->markers.at(i)) == space->get_mesh()->boundary_markers_conversion.conversion_table_inverse.end())
-								throw Hermes::Exceptions::Exception("A boundary condition defined on a non-existent marker.");
+        SpaceType type;
+        if(!strcmp(parsed_xml_space->spaceType().get().c_str(), "h1"))
+          type = HERMES_H1_SPACE;
+        else if(!strcmp(parsed_xml_space->spaceType().get().c_str(), "hcurl"))
+          type = HERMES_HCURL_SPACE;
+        else if(!strcmp(parsed_xml_space->spaceType().get().c_str(), "hdiv"))
+          type = HERMES_HDIV_SPACE;
+        else if(!strcmp(parsed_xml_space->spaceType().get().c_str(), "l2"))
+          type = HERMES_L2_SPACE;
+        else
+          throw Exceptions::SpaceLoadFailureException("Wrong spaceType in the Space XML file %s in Space::load.", filename);
 
-				space->resize_tables();
+        Space<Scalar>* space = create_for_loading(type, filename, mesh, essential_bcs, shapeset);
 
         // Element data //
         unsigned int elem_data_count = parsed_xml_space->element_data().size();
@@ -1320,6 +1721,108 @@ namespace Hermes
       }
     }
 
+    template<typename Scalar>
+    bool Space<Scalar>::get_binary_data(int header[2], std::vector<int>& element_data) const
+    {
+      this->check();
+
+      SpaceType type = this->get_type();
+      if(type != HERMES_H1_SPACE && type != HERMES_HCURL_SPACE && type != HERMES_HDIV_SPACE && type != HERMES_L2_SPACE)
+        return false;
+
+      // Utility pointer.
+      Element *e;
+      for_all_elements(e, this->get_mesh())
+      {
+        element_data.push_back(e->id);
+        element_data.push_back(this->edata[e->id].order);
+        element_data.push_back(this->edata[e->id].bdof);
+        element_data.push_back(this->edata[e->id].n);
+        element_data.push_back(this->edata[e->id].changed_in_last_adaptation ? 1 : 0);
+      }
+      header[0] = type;
+      header[1] = (int)element_data.size() / 5;
+
+      return true;
+    }
+
+    template<typename Scalar>
+    bool Space<Scalar>::save_binary(const char *filename) const
+    {
+      int header[2];
+      std::vector<int> element_data;
+      if(!this->get_binary_data(header, element_data))
+        return false;
+
+      BinaryFileWriter writer(filename, "H2DSPACE", binary_format_version);
+      writer.write_array(header, 2);
+      writer.write_array(element_data.empty() ? NULL : &element_data[0], element_data.size());
+      writer.close();
+
+      return true;
+    }
+
+    template<typename Scalar>
+    bool Space<Scalar>::save_binary(std::vector<char>& image) const
+    {
+      int header[2];
+      std::vector<int> element_data;
+      if(!this->get_binary_data(header, element_data))
+        return false;
+
+      BinaryFileWriter writer(image, "H2DSPACE", binary_format_version);
+      writer.write_array(header, 2);
+      writer.write_array(element_data.empty() ? NULL : &element_data[0], element_data.size());
+
+      return true;
+    }
+
+    template<typename Scalar>
+    Space<Scalar>* Space<Scalar>::load_binary(const char *filename, Mesh* mesh, EssentialBCs<Scalar>* essential_bcs, Shapeset* shapeset)
+    {
+      Space<Scalar>* space = NULL;
+      try
+      {
+        BinaryFileReader reader(filename, "H2DSPACE", binary_format_version);
+
+        int header[2];
+        reader.read_array(header, 2);
+        uint64_t count;
+        const int* element_data = reader.read_array<int>(count);
+        if(count != 5 * (uint64_t)header[1])
+          throw Hermes::Exceptions::SpaceLoadFailureException("Corrupted element data in %s.", filename);
+
+        space = create_for_loading((SpaceType)header[0], filename, mesh, essential_bcs, shapeset);
+
+        for (int elem_data_i = 0; elem_data_i < header[1]; elem_data_i++)
+        {
+          const int* data = element_data + 5 * elem_data_i;
+          if(data[0] < 0 || data[0] >= mesh->get_max_element_id())
+            throw Hermes::Exceptions::SpaceLoadFailureException("Element data #%d: element %d does not exist in the mesh.", elem_data_i, data[0]);
+          space->edata[data[0]].order = data[1];
+          space->edata[data[0]].bdof = data[2];
+          space->edata[data[0]].n = data[3];
+          space->edata[data[0]].changed_in_last_adaptation = (data[4] != 0);
+        }
+
+        space->seq = g_space_seq++;
+
+        space->assign_dofs();
+
+        return space;
+      }
+      catch (Hermes::Exceptions::SpaceLoadFailureException&)
+      {
+        delete space;
+        throw;
+      }
+      catch (Hermes::Exceptions::Exception& e)
+      {
+        delete space;
+        throw Hermes::Exceptions::SpaceLoadFailureException("%s", e.what());
+      }
+    }
+
     template class HERMES_API Space<double>;
     template class HERMES_API Space<std::complex<double> >;
   }
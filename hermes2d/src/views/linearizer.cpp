@@ -18,6 +18,12 @@
 #include "traverse.h"
 #include "exact_solution.h"
 #include "api2d.h"
+#include <algorithm>
+
+/// Size of the hash table of the vertices of one element.
+#define H2D_LIN_LOCAL_HASH_SIZE 4096
+/// Length of an element edge in the positions of the boundary vertices (2^max. linearization level).
+#define H2D_LIN_EDGE_SCALE (1 << 20)
 
 namespace Hermes
 {
@@ -113,10 +119,12 @@ namespace Hermes
         tris_contours = NULL;
       }
 
-      void Linearizer::process_triangle(MeshFunction<double>** fns, int iv0, int iv1, int iv2, int level,
+      void Linearizer::process_triangle(MeshFunction<double>** fns, ThreadData& data, int iv0, int iv1, int iv2, int level,
         double* val, double* phx, double* phy, int* idx, bool curved)
       {
         double midval[3][3];
+        // The vertices of the element, valid until a new vertex is added.
+        LocalVertex* elem_verts = &data.verts[data.first_vert];
 
         if(level < LIN_MAX_LEVEL)
         {
@@ -126,14 +134,6 @@ namespace Hermes
             // obtain solution values
             fns[0]->set_quad_order(1, item);
             val = fns[0]->get_values(component, value_type);
-            if(auto_max)
-              for (i = 0; i < lin_np_tri[1]; i++)
-              {
-                double v = val[i];
-#pragma omp critical(max)
-                if(finite(v) && fabs(v) > max)
-                  max = fabs(v);
-              }
               idx = tri_indices[0];
 
               if(curved)
@@ -168,9 +168,9 @@ namespace Hermes
           // obtain linearized values and coordinates at the midpoints
           for (i = 0; i < 3; i++)
           {
-            midval[i][0] = (verts[iv0][i] + verts[iv1][i])*0.5;
-            midval[i][1] = (verts[iv1][i] + verts[iv2][i])*0.5;
-            midval[i][2] = (verts[iv2][i] + verts[iv0][i])*0.5;
+            midval[i][0] = (elem_verts[iv0].coords[i] + elem_verts[iv1].coords[i])*0.5;
+            midval[i][1] = (elem_verts[iv1].coords[i] + elem_verts[iv2].coords[i])*0.5;
+            midval[i][2] = (elem_verts[iv2].coords[i] + elem_verts[iv0].coords[i])*0.5;
           };
 
           // determine whether or not to split the element
@@ -182,7 +182,7 @@ namespace Hermes
           }
           else
           {
-            if(!auto_max && fabs(verts[iv0][2]) > max && fabs(verts[iv1][2]) > max && fabs(verts[iv2][2]) > max)
+            if(!auto_max && fabs(elem_verts[iv0].coords[2]) > max && fabs(elem_verts[iv1].coords[2]) > max && fabs(elem_verts[iv2].coords[2]) > max)
             {
               // do not split if the whole triangle is above the specified maximum value
               split = false;
@@ -227,35 +227,32 @@ namespace Hermes
               }
 
               // obtain mid-edge vertices
-              int mid0 = get_vertex(iv0, iv1, midval[0][0], midval[1][0], val[idx[0]]);
-              int mid1 = get_vertex(iv1, iv2, midval[0][1], midval[1][1], val[idx[1]]);
-              int mid2 = get_vertex(iv2, iv0, midval[0][2], midval[1][2], val[idx[2]]);
-
-              if(this->caughtException != NULL)
-                return;
+              int mid0 = get_vertex(data, iv0, iv1, midval[0][0], midval[1][0], val[idx[0]]);
+              int mid1 = get_vertex(data, iv1, iv2, midval[0][1], midval[1][1], val[idx[1]]);
+              int mid2 = get_vertex(data, iv2, iv0, midval[0][2], midval[1][2], val[idx[2]]);
 
               // recur to sub-elements
               this->push_transforms(fns, 0);
-              process_triangle(fns, iv0, mid0, mid2,  level + 1, val, phx, phy, tri_indices[1], curved);
+              process_triangle(fns, data, iv0, mid0, mid2,  level + 1, val, phx, phy, tri_indices[1], curved);
               this->pop_transforms(fns);
 
               this->push_transforms(fns, 1);
-              process_triangle(fns, mid0, iv1, mid1,  level + 1, val, phx, phy, tri_indices[2], curved);
+              process_triangle(fns, data, mid0, iv1, mid1,  level + 1, val, phx, phy, tri_indices[2], curved);
               this->pop_transforms(fns);
 
               this->push_transforms(fns, 2);
-              process_triangle(fns, mid2, mid1, iv2,  level + 1, val, phx, phy, tri_indices[3], curved);
+              process_triangle(fns, data, mid2, mid1, iv2,  level + 1, val, phx, phy, tri_indices[3], curved);
               this->pop_transforms(fns);
 
               this->push_transforms(fns, 3);
-              process_triangle(fns, mid1, mid2, mid0, level + 1, val, phx, phy, tri_indices[4], curved);
+              process_triangle(fns, data, mid1, mid2, mid0, level + 1, val, phx, phy, tri_indices[4], curved);
               this->pop_transforms(fns);
               return;
           }
         }
 
         // no splitting: output a linear triangle
-        add_triangle(iv0, iv1, iv2, fns[0]->get_active_element()->marker);
+        add_local_triangle(data, iv0, iv1, iv2, fns[0]->get_active_element()->marker);
       }
 
       void Linearizer::set_curvature_epsilon(double curvature_epsilon)
@@ -304,15 +301,17 @@ namespace Hermes
         }
       }
 
-      void Linearizer::process_quad(MeshFunction<double>** fns, int iv0, int iv1, int iv2, int iv3, int level,
+      void Linearizer::process_quad(MeshFunction<double>** fns, ThreadData& data, int iv0, int iv1, int iv2, int iv3, int level,
         double* val, double* phx, double* phy, int* idx, bool curved)
       {
         double midval[3][5];
+        // The vertices of the element, valid until a new vertex is added.
+        LocalVertex* elem_verts = &data.verts[data.first_vert];
 
         // try not to split through the vertex with the largest value
-        int a = (verts[iv0][2] > verts[iv1][2]) ? iv0 : iv1;
-        int b = (verts[iv2][2] > verts[iv3][2]) ? iv2 : iv3;
-        a = (verts[a][2] > verts[b][2]) ? a : b;
+        int a = (elem_verts[iv0].coords[2] > elem_verts[iv1].coords[2]) ? iv0 : iv1;
+        int b = (elem_verts[iv2].coords[2] > elem_verts[iv3].coords[2]) ? iv2 : iv3;
+        a = (elem_verts[a].coords[2] > elem_verts[b].coords[2]) ? a : b;
         int flip = (a == iv1 || a == iv3) ? 1 : 0;
 
         if(level < LIN_MAX_LEVEL)
@@ -323,20 +322,6 @@ namespace Hermes
             // obtain solution values
             fns[0]->set_quad_order(1, item);
             val = fns[0]->get_values(component, value_type);
-            if(auto_max)
-              for (i = 0; i < lin_np_quad[1]; i++)
-              {
-                double v = val[i];
-                if(finite(v) && fabs(v) > max)
-#pragma omp critical(max)
-                  if(finite(v) && fabs(v) > max)
-                    max = fabs(v);
-              }
-
-              // This is just to make some sense.
-              if(fabs(max) < 1E-10)
-                max = 1E-10;
-
               idx = quad_indices[0];
 
               if(curved)
@@ -369,15 +354,15 @@ namespace Hermes
           // obtain linearized values and coordinates at the midpoints
           for (i = 0; i < 3; i++)
           {
-            midval[i][0] = (verts[iv0][i] + verts[iv1][i]) * 0.5;
-            midval[i][1] = (verts[iv1][i] + verts[iv2][i]) * 0.5;
-            midval[i][2] = (verts[iv2][i] + verts[iv3][i]) * 0.5;
-            midval[i][3] = (verts[iv3][i] + verts[iv0][i]) * 0.5;
+            midval[i][0] = (elem_verts[iv0].coords[i] + elem_verts[iv1].coords[i]) * 0.5;
+            midval[i][1] = (elem_verts[iv1].coords[i] + elem_verts[iv2].coords[i]) * 0.5;
+            midval[i][2] = (elem_verts[iv2].coords[i] + elem_verts[iv3].coords[i]) * 0.5;
+            midval[i][3] = (elem_verts[iv3].coords[i] + elem_verts[iv0].coords[i]) * 0.5;
             midval[i][4] = (midval[i][0]  + midval[i][2])  * 0.5;
           };
 
           // the value of the middle point is not the average of the four vertex values, since quad == 2 triangles
-          midval[2][4] = flip ? (verts[iv0][2] + verts[iv2][2]) * 0.5 : (verts[iv1][2] + verts[iv3][2]) * 0.5;
+          midval[2][4] = flip ? (elem_verts[iv0].coords[2] + elem_verts[iv2].coords[2]) * 0.5 : (elem_verts[iv1].coords[2] + elem_verts[iv3].coords[2]) * 0.5;
 
           // determine whether or not to split the element
           int split;
@@ -388,8 +373,8 @@ namespace Hermes
           }
           else
           {
-            if(!auto_max && fabs(verts[iv0][2]) > max && fabs(verts[iv1][2]) > max
-              && fabs(verts[iv2][2]) > max && fabs(verts[iv3][2]) > max)
+            if(!auto_max && fabs(elem_verts[iv0].coords[2]) > max && fabs(elem_verts[iv1].coords[2]) > max
+              && fabs(elem_verts[iv2].coords[2]) > max && fabs(elem_verts[iv3].coords[2]) > max)
             {
               // do not split if the whole quad is above the specified maximum value
               split = 0;
@@ -444,53 +429,50 @@ namespace Hermes
 
               // obtain mid-edge and mid-element vertices
               int mid0, mid1, mid2, mid3, mid4;
-              if(split != 1) mid0 = get_vertex(iv0,  iv1,  midval[0][0], midval[1][0], val[idx[0]]);
-              if(split != 2) mid1 = get_vertex(iv1,  iv2,  midval[0][1], midval[1][1], val[idx[1]]);
-              if(split != 1) mid2 = get_vertex(iv2,  iv3,  midval[0][2], midval[1][2], val[idx[2]]);
-              if(split != 2) mid3 = get_vertex(iv3,  iv0,  midval[0][3], midval[1][3], val[idx[3]]);
-              if(split == 3) mid4 = get_vertex(mid0, mid2, midval[0][4], midval[1][4], val[idx[4]]);
-
-              if(this->caughtException != NULL)
-                return;
+              if(split != 1) mid0 = get_vertex(data, iv0,  iv1,  midval[0][0], midval[1][0], val[idx[0]]);
+              if(split != 2) mid1 = get_vertex(data, iv1,  iv2,  midval[0][1], midval[1][1], val[idx[1]]);
+              if(split != 1) mid2 = get_vertex(data, iv2,  iv3,  midval[0][2], midval[1][2], val[idx[2]]);
+              if(split != 2) mid3 = get_vertex(data, iv3,  iv0,  midval[0][3], midval[1][3], val[idx[3]]);
+              if(split == 3) mid4 = get_vertex(data, mid0, mid2, midval[0][4], midval[1][4], val[idx[4]]);
 
               // recur to sub-elements
               if(split == 3)
               {
                 this->push_transforms(fns, 0);
-                process_quad(fns, iv0, mid0, mid4, mid3, level + 1, val, phx, phy, quad_indices[1], curved);
+                process_quad(fns, data, iv0, mid0, mid4, mid3, level + 1, val, phx, phy, quad_indices[1], curved);
                 this->pop_transforms(fns);
 
                 this->push_transforms(fns, 1);
-                process_quad(fns, mid0, iv1, mid1, mid4, level + 1, val, phx, phy, quad_indices[2], curved);
+                process_quad(fns, data, mid0, iv1, mid1, mid4, level + 1, val, phx, phy, quad_indices[2], curved);
                 this->pop_transforms(fns);
 
                 this->push_transforms(fns, 2);
-                process_quad(fns, mid4, mid1, iv2, mid2, level + 1, val, phx, phy, quad_indices[3], curved);
+                process_quad(fns, data, mid4, mid1, iv2, mid2, level + 1, val, phx, phy, quad_indices[3], curved);
                 this->pop_transforms(fns);
 
                 this->push_transforms(fns, 3);
-                process_quad(fns, mid3, mid4, mid2, iv3, level + 1, val, phx, phy, quad_indices[4], curved);
+                process_quad(fns, data, mid3, mid4, mid2, iv3, level + 1, val, phx, phy, quad_indices[4], curved);
                 this->pop_transforms(fns);
               }
               else
                 if(split == 1) // h-split
                 {
                   this->push_transforms(fns, 4);
-                  process_quad(fns, iv0, iv1, mid1, mid3, level + 1, val, phx, phy, quad_indices[5], curved);
+                  process_quad(fns, data, iv0, iv1, mid1, mid3, level + 1, val, phx, phy, quad_indices[5], curved);
                   this->pop_transforms(fns);
 
                   this->push_transforms(fns, 5);
-                  process_quad(fns, mid3, mid1, iv2, iv3, level + 1, val, phx, phy, quad_indices[6], curved);
+                  process_quad(fns, data, mid3, mid1, iv2, iv3, level + 1, val, phx, phy, quad_indices[6], curved);
                   this->pop_transforms(fns);
                 }
                 else // v-split
                 {
                   this->push_transforms(fns, 6);
-                  process_quad(fns, iv0, mid0, mid2, iv3, level + 1, val, phx, phy, quad_indices[7], curved);
+                  process_quad(fns, data, iv0, mid0, mid2, iv3, level + 1, val, phx, phy, quad_indices[7], curved);
                   this->pop_transforms(fns);
 
                   this->push_transforms(fns, 7);
-                  process_quad(fns, mid0, iv1, iv2, mid2, level + 1, val, phx, phy, quad_indices[8], curved);
+                  process_quad(fns, data, mid0, iv1, iv2, mid2, level + 1, val, phx, phy, quad_indices[8], curved);
                   this->pop_transforms(fns);
                 }
                 return;
@@ -500,13 +482,13 @@ namespace Hermes
         // output two linear triangles,
         if(!flip)
         {
-          add_triangle(iv3, iv0, iv1, fns[0]->get_active_element()->marker);
-          add_triangle(iv1, iv2, iv3, fns[0]->get_active_element()->marker);
+          add_local_triangle(data, iv3, iv0, iv1, fns[0]->get_active_element()->marker);
+          add_local_triangle(data, iv1, iv2, iv3, fns[0]->get_active_element()->marker);
         }
         else
         {
-          add_triangle(iv0, iv1, iv2, fns[0]->get_active_element()->marker);
-          add_triangle(iv2, iv3, iv0, fns[0]->get_active_element()->marker);
+          add_local_triangle(data, iv0, iv1, iv2, fns[0]->get_active_element()->marker);
+          add_local_triangle(data, iv2, iv3, iv0, fns[0]->get_active_element()->marker);
         }
       }
 
@@ -519,15 +501,13 @@ namespace Hermes
         this->dmult = dmult;
       }
 
-      void Linearizer::process_solution(MeshFunction<double>* sln, int item_, double eps)
+      static inline int local_hash(int p1, int p2)
       {
-        // Important, sets the current caughtException to NULL.
-        this->caughtException = NULL;
-
-        lock_data();
-        this->tick();
+        return (984120265*p1 + 125965121*p2) & (H2D_LIN_LOCAL_HASH_SIZE - 1);
+      }
 
-        // Initialization of 'global' stuff.
+      void Linearizer::set_item(int item_, double eps)
+      {
         this->item = item_;
         this->eps = eps;
         //   get the component and desired value from item.
@@ -543,48 +523,18 @@ namespace Hermes
         }
         //   reset the item to the value before the circus with component, value_type.
         this->item = item_;
+      }
 
-        // Initialization of computation stuff.
-        //    sizes.
-        this->vertex_size = std::max(100 * sln->get_mesh()->get_num_elements(), std::max(this->vertex_size, 50000));
-        this->triangle_size = std::max(150 * sln->get_mesh()->get_num_elements(), std::max(this->triangle_size, 75000));
-        this->edges_size = std::max(100 * sln->get_mesh()->get_num_elements(), std::max(this->edges_size, 50000));
-        //    counts.
-        this->vertex_count = 0;
-        this->triangle_count = 0;
-        this->edges_count = 0;
-        //    reuse or allocate vertex, triangle and edge arrays.
-        this->verts = (double3*) realloc(this->verts, sizeof(double3) * this->vertex_size);
-        this->tris = (int3*) realloc(this->tris, sizeof(int3) * this->triangle_size);
-        this->tri_markers = (int*) realloc(this->tri_markers, sizeof(int) * this->triangle_size);
-        this->edges = (int2*) realloc(this->edges, sizeof(int2) * this->edges_size);
-        this->edge_markers = (int*) realloc(this->edge_markers, sizeof(int) * this->edges_size);
-        this->info = (int4*) malloc(sizeof(int4) * this->vertex_size);
-        this->empty = false;
-        //    initialize the hash table
-        this->hash_table = (int*) malloc(sizeof(int) * this->vertex_size);
-        memset(this->hash_table, 0xff, sizeof(int) * this->vertex_size);
-
-        // select the linearization quadratures
-        Quad2D *old_quad, *old_quad_x = NULL, *old_quad_y = NULL;
-        old_quad = sln->get_quad_2d();
-        if(xdisp != NULL)
-          old_quad_x = xdisp->get_quad_2d();
-        if(ydisp != NULL)
-          old_quad_y = ydisp->get_quad_2d();
-
-        // obtain the solution in vertices, estimate the maximum solution value
-        // meshes.
-        Hermes::vector<const Mesh*> meshes;
+      MeshFunction<double>*** Linearizer::create_functions(MeshFunction<double>* sln, Hermes::vector<const Mesh*>& meshes, int num_threads_used)
+      {
         meshes.push_back(sln->get_mesh());
         if(xdisp != NULL)
           meshes.push_back(xdisp->get_mesh());
         if(ydisp != NULL)
           meshes.push_back(ydisp->get_mesh());
 
-        // Parallelization
-        MeshFunction<double>*** fns = new MeshFunction<double>**[Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads)];
-        for(unsigned int i = 0; i < Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads); i++)
+        MeshFunction<double>*** fns = new MeshFunction<double>**[num_threads_used];
+        for(int i = 0; i < num_threads_used; i++)
         {
           fns[i] = new MeshFunction<double>*[3];
           fns[i][0] = sln->clone();
@@ -601,204 +551,456 @@ namespace Hermes
             fns[i][xdisp == NULL ? 1 : 2]->set_quad_2d(&g_quad_lin);
           }
         }
+        return fns;
+      }
 
-        Transformable*** trfs = new Transformable**[Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads)];
-        for(unsigned int i = 0; i < Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads); i++)
+      void Linearizer::delete_functions(MeshFunction<double>*** fns, int num_threads_used)
+      {
+        for(int i = 0; i < num_threads_used; i++)
         {
-          trfs[i] = new Transformable*[3];
-          trfs[i][0] = fns[i][0];
-          if(xdisp != NULL)
-            trfs[i][1] = fns[i][1];
-          if(ydisp != NULL)
-            trfs[i][xdisp == NULL ? 1 : 2] = fns[i][xdisp == NULL ? 1 : 2];
+          for(int j = 0; j < 1 + (xdisp != NULL ? 1 : 0) + (ydisp != NULL ? 1 : 0); j++)
+            delete fns[i][j];
+          delete [] fns[i];
         }
+        delete [] fns;
+      }
 
-        Traverse trav_masterMax(true);
-        unsigned int num_states = trav_masterMax.get_num_states(meshes);
-
-        trav_masterMax.begin(meshes.size(), &(meshes.front()));
-
-        Traverse* trav = new Traverse[Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads)];
-
-        for(unsigned int i = 0; i < Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads); i++)
+      void Linearizer::set_state(MeshFunction<double>** fns, Traverse::State* state)
+      {
+        for(int j = 0; j < 1 + (xdisp != NULL ? 1 : 0) + (ydisp != NULL ? 1 : 0); j++)
         {
-          trav[i].begin(meshes.size(), &(meshes.front()), trfs[i]);
-          trav[i].stack = trav_masterMax.stack;
+          if(state->e[j] != NULL)
+          {
+            fns[j]->set_active_element(state->e[j]);
+            fns[j]->set_transform(state->sub_idx[j]);
+          }
         }
+      }
 
-        int state_i;
+      bool Linearizer::next_states(Traverse& trav, std::vector<Traverse::State*>& states, int max_states)
+      {
+        Traverse::State* next_state = NULL;
+        while((max_states <= 0 || (int) states.size() < max_states) && (next_state = trav.get_next_state()) != NULL)
+        {
+          Traverse::State* state = new Traverse::State();
+          *state = next_state;
+          states.push_back(state);
+        }
+        return next_state != NULL;
+      }
 
 #define CHUNKSIZE 1
-        int num_threads_used = Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads);
-#pragma omp parallel shared(trav_masterMax) private(state_i) num_threads(num_threads_used)
+
+      void Linearizer::estimate_max(MeshFunction<double>*** fns, std::vector<Traverse::State*>& states, int num_threads_used)
+      {
+        double* thread_max = new double[num_threads_used];
+        for(int i = 0; i < num_threads_used; i++)
+          thread_max[i] = this->max;
+
+        int num_states = states.size();
+        int state_i;
+#pragma omp parallel for private(state_i) schedule(dynamic, CHUNKSIZE) num_threads(num_threads_used)
+        for(state_i = 0; state_i < num_states; state_i++)
         {
-#pragma omp for schedule(static, CHUNKSIZE)
-          for(state_i = 0; state_i < num_states; state_i++)
-          {
-            try
-            {
-              Traverse::State current_state;
-#pragma omp critical(get_next_state)
-              current_state = trav[omp_get_thread_num()].get_next_state(&trav_masterMax.top, &trav_masterMax.id);
+          if(this->caughtException != NULL)
+            continue;
 
-              fns[omp_get_thread_num()][0]->set_quad_order(0, this->item);
-              double* val = fns[omp_get_thread_num()][0]->get_values(component, value_type);
+          try
+          {
+            int tid = omp_get_thread_num();
+            Traverse::State* state = states[state_i];
+            set_state(fns[tid], state);
 
-              for (unsigned int i = 0; i < current_state.e[0]->get_nvert(); i++)
-              {
-                double f = val[i];
-#pragma omp critical (max)
-                if(this->auto_max && finite(f) && fabs(f) > this->max)
-                  this->max = fabs(f);
-              }
-            }
-            catch(Hermes::Exceptions::Exception& e)
+            for(int table = 0; table < 2; table++)
             {
-              if(this->caughtException == NULL)
-                this->caughtException = e.clone();
-            }
-            catch(std::exception& e)
-            {
-              if(this->caughtException == NULL)
-                this->caughtException = new Hermes::Exceptions::Exception(e.what());
+              fns[tid][0]->set_quad_order(table, this->item);
+              double* val = fns[tid][0]->get_values(component, value_type);
+              if(val == NULL)
+                throw Hermes::Exceptions::Exception("Item not defined in the solution in Linearizer::process_solution.");
+              int np = (table == 0) ? state->e[0]->get_nvert() : (state->e[0]->is_triangle() ? lin_np_tri[1] : lin_np_quad[1]);
+              for (int i = 0; i < np; i++)
+                if(finite(val[i]) && fabs(val[i]) > thread_max[tid])
+                  thread_max[tid] = fabs(val[i]);
             }
           }
+          catch(Hermes::Exceptions::Exception& e)
+          {
+            if(this->caughtException == NULL)
+              this->caughtException = e.clone();
+          }
+          catch(std::exception& e)
+          {
+            if(this->caughtException == NULL)
+              this->caughtException = new Hermes::Exceptions::Exception(e.what());
+          }
         }
 
-        trav_masterMax.finish();
-        for(unsigned int i = 0; i < Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads); i++)
-          trav[i].finish();
-        delete [] trav;
+        for(int i = 0; i < num_threads_used; i++)
+          this->max = std::max(this->max, thread_max[i]);
+        delete [] thread_max;
+      }
 
-        Traverse trav_master(true);
-        num_states = trav_master.get_num_states(meshes);
+      void Linearizer::linearize_states(MeshFunction<double>*** fns, std::vector<Traverse::State*>& states, ThreadData* thread_data,
+        std::vector<ElementRecord>& records, int num_threads_used)
+      {
+        for(int i = 0; i < num_threads_used; i++)
+        {
+          thread_data[i].verts.clear();
+          thread_data[i].tris.clear();
+          thread_data[i].tri_markers.clear();
+          thread_data[i].hash_table.assign(H2D_LIN_LOCAL_HASH_SIZE, -1);
+        }
+        records.resize(states.size());
 
-        trav_master.begin(meshes.size(), &(meshes.front()));
+        int num_states = states.size();
+        int state_i;
+#pragma omp parallel for private(state_i) schedule(dynamic, CHUNKSIZE) num_threads(num_threads_used)
+        for(state_i = 0; state_i < num_states; state_i++)
+        {
+          if(this->caughtException != NULL)
+            continue;
+
+          try
+          {
+            int tid = omp_get_thread_num();
+            ThreadData& data = thread_data[tid];
+            Traverse::State* state = states[state_i];
+            set_state(fns[tid], state);
+
+            Element* e = state->e[0];
+            ElementRecord& record = records[state_i];
+            record.thread = tid;
+            record.first_vert = data.verts.size();
+            record.first_tri = data.tri_markers.size();
+            data.first_vert = record.first_vert;
+            data.nvert = e->get_nvert();
+            for (int i = 0; i < data.nvert; i++)
+              data.vertex_ids[i] = e->vn[i]->id;
+
+            fns[tid][0]->set_quad_order(0, this->item);
+            double* val = fns[tid][0]->get_values(component, value_type);
+            if(val == NULL)
+              throw Hermes::Exceptions::Exception("Item not defined in the solution in Linearizer::process_solution.");
+
+            if(xdisp != NULL)
+              fns[tid][1]->set_quad_order(0, H2D_FN_VAL);
+            if(ydisp != NULL)
+              fns[tid][xdisp == NULL ? 1 : 2]->set_quad_order(0, H2D_FN_VAL);
+
+            double *dx = NULL;
+            double *dy = NULL;
+            if(xdisp != NULL)
+              dx = fns[tid][1]->get_fn_values();
+            if(ydisp != NULL)
+              dy = fns[tid][xdisp == NULL ? 1 : 2]->get_fn_values();
+
+            int iv[H2D_MAX_NUMBER_VERTICES];
+            for (int i = 0; i < data.nvert; i++)
+            {
+              double f = val[i];
+              double x_disp = fns[tid][0]->get_refmap()->get_phys_x(0)[i];
+              double y_disp = fns[tid][0]->get_refmap()->get_phys_y(0)[i];
+              if(this->xdisp != NULL)
+                x_disp += dmult * dx[i];
+              if(this->ydisp != NULL)
+                y_disp += dmult * dy[i];
+
+              iv[i] = add_corner_vertex(data, e->vn[i]->id, x_disp, y_disp, f);
+            }
+
+            // recur to sub-elements
+            if(e->is_triangle())
+              process_triangle(fns[tid], data, iv[0], iv[1], iv[2], 0, NULL, NULL, NULL, NULL, e->is_curved());
+            else
+              process_quad(fns[tid], data, iv[0], iv[1], iv[2], iv[3], 0, NULL, NULL, NULL, NULL, e->is_curved());
 
-        trav = new Traverse[Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads)];
+            record.num_verts = data.verts.size() - record.first_vert;
+            record.num_tris = data.tri_markers.size() - record.first_tri;
+
+            // clear the local hash table for the next element
+            for (int i = data.nvert; i < record.num_verts; i++)
+            {
+              const LocalVertex& v = data.verts[record.first_vert + i];
+              data.hash_table[local_hash(v.p1, v.p2)] = -1;
+            }
+          }
+          catch(Hermes::Exceptions::Exception& e)
+          {
+            if(this->caughtException == NULL)
+              this->caughtException = e.clone();
+          }
+          catch(std::exception& e)
+          {
+            if(this->caughtException == NULL)
+              this->caughtException = new Hermes::Exceptions::Exception(e.what());
+          }
+        }
+      }
 
-        for(unsigned int i = 0; i < Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads); i++)
+      void Linearizer::add_element_edges(std::vector<Traverse::State*>& states, ThreadData* thread_data, std::vector<ElementRecord>& records)
+      {
+        for(unsigned int state_i = 0; state_i < states.size(); state_i++)
         {
-          trav[i].begin(meshes.size(), &(meshes.front()), trfs[i]);
-          trav[i].stack = trav_master.stack;
+          Element* e = states[state_i]->e[0];
+          const ElementRecord& record = records[state_i];
+          const std::vector<LocalVertex>& verts_local = thread_data[record.thread].verts;
+          for (int i = 0; i < e->get_nvert(); i++)
+            process_edge(verts_local[record.first_vert + i].global, verts_local[record.first_vert + e->next_vert(i)].global, e->en[i]->marker);
         }
+      }
 
-#pragma omp parallel shared(trav_master) private(state_i) num_threads(num_threads_used)
+      void Linearizer::regularize()
+      {
+        for (int i = 0; i < this->triangle_count; i++)
         {
-#pragma omp for schedule(static, CHUNKSIZE)
-          for(state_i = 0; state_i < num_states; state_i++)
+          int iv0 = tris[i][0], iv1 = tris[i][1], iv2 = tris[i][2];
+
+          int mid0 = peek_vertex(iv0, iv1);
+          int mid1 = peek_vertex(iv1, iv2);
+          int mid2 = peek_vertex(iv2, iv0);
+          if(mid0 >= 0 || mid1 >= 0 || mid2 >= 0)
           {
-            if(this->caughtException != NULL)
-              continue;
+            this->del_slot = i;
+            regularize_triangle(iv0, iv1, iv2, mid0, mid1, mid2, tri_markers[i]);
+          }
+        }
+      }
 
-            try
-            {
-              Traverse::State current_state;
+      void Linearizer::process_solution(MeshFunction<double>* sln, int item_, double eps)
+      {
+        // Important, sets the current caughtException to NULL.
+        this->caughtException = NULL;
 
-#pragma omp critical (get_next_state)
-              current_state = trav[omp_get_thread_num()].get_next_state(&trav_master.top, &trav_master.id);
+        lock_data();
+        this->tick();
 
-              fns[omp_get_thread_num()][0]->set_quad_order(0, this->item);
-              double* val = fns[omp_get_thread_num()][0]->get_values(component, value_type);
-              if(val == NULL)
-              {
-                delete [] trav;
-                throw Hermes::Exceptions::Exception("Item not defined in the solution in Linearizer::process_solution.");
-              }
+        // Initialization of 'global' stuff.
+        set_item(item_, eps);
 
-              if(xdisp != NULL)
-                fns[omp_get_thread_num()][1]->set_quad_order(0, H2D_FN_VAL);
-              if(ydisp != NULL)
-                fns[omp_get_thread_num()][xdisp == NULL ? 1 : 2]->set_quad_order(0, H2D_FN_VAL);
+        // Initialization of computation stuff.
+        //    sizes (vertex and triangle arrays are allocated when the elements are merged).
+        this->edges_size = std::max(100 * sln->get_mesh()->get_num_elements(), std::max(this->edges_size, 50000));
+        //    counts.
+        this->vertex_count = 0;
+        this->triangle_count = 0;
+        this->edges_count = 0;
+        //    reuse or allocate edge arrays.
+        this->edges = (int2*) realloc(this->edges, sizeof(int2) * this->edges_size);
+        this->edge_markers = (int*) realloc(this->edge_markers, sizeof(int) * this->edges_size);
+        this->empty = false;
 
-              double *dx = NULL;
-              double *dy = NULL;
-              if(xdisp != NULL)
-                dx = fns[omp_get_thread_num()][1]->get_fn_values();
-              if(ydisp != NULL)
-                dy = fns[omp_get_thread_num()][xdisp == NULL ? 1 : 2]->get_fn_values();
+        // select the linearization quadratures
+        Quad2D *old_quad, *old_quad_x = NULL, *old_quad_y = NULL;
+        old_quad = sln->get_quad_2d();
+        if(xdisp != NULL)
+          old_quad_x = xdisp->get_quad_2d();
+        if(ydisp != NULL)
+          old_quad_y = ydisp->get_quad_2d();
 
-              int iv[H2D_MAX_NUMBER_VERTICES];
-              for (unsigned int i = 0; i < current_state.e[0]->get_nvert(); i++)
-              {
-                double f = val[i];
-                double x_disp = fns[omp_get_thread_num()][0]->get_refmap()->get_phys_x(0)[i];
-                double y_disp = fns[omp_get_thread_num()][0]->get_refmap()->get_phys_y(0)[i];
-                if(this->xdisp != NULL)
-                  x_disp += dmult * dx[i];
-                if(this->ydisp != NULL)
-                  y_disp += dmult * dy[i];
+        // Parallelization
+        int num_threads_used = Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads);
+        Hermes::vector<const Mesh*> meshes;
+        MeshFunction<double>*** fns = create_functions(sln, meshes, num_threads_used);
 
-                iv[i] = this->get_vertex(-fns[omp_get_thread_num()][0]->get_active_element()->vn[i]->id, -fns[omp_get_thread_num()][0]->get_active_element()->vn[i]->id, x_disp, y_disp, f);
+        // The traversal states are collected first, so that the threads do not have to synchronize
+        // on the traversal and the elements can be merged in the traversal order afterwards.
+        std::vector<Traverse::State*> states;
+        Traverse trav_master(true);
+        trav_master.begin(meshes.size(), &(meshes.front()));
+        next_states(trav_master, states, 0);
+        trav_master.finish();
 
-                if(this->caughtException != NULL)
-                  continue;
-              }
+        // Estimate the maximum solution value from the element vertices and the first refinement level.
+        // The maximum is fixed from now on, it is used in the refinement criterion and in the vertex comparison.
+        if(this->auto_max)
+        {
+          estimate_max(fns, states, num_threads_used);
+          if(fabs(this->max) < 1E-10)
+            this->max = 1E-10;
+        }
 
-              // recur to sub-elements
-              if(current_state.e[0]->is_triangle())
-                process_triangle(fns[omp_get_thread_num()], iv[0], iv[1], iv[2], 0, NULL, NULL, NULL, NULL, current_state.e[0]->is_curved());
-              else
-                process_quad(fns[omp_get_thread_num()], iv[0], iv[1], iv[2], iv[3], 0, NULL, NULL, NULL, NULL, current_state.e[0]->is_curved());
+        // Linearize the elements, every thread into its own buffers.
+        ThreadData* thread_data = new ThreadData[num_threads_used];
+        std::vector<ElementRecord> records;
+        if(this->caughtException == NULL)
+          linearize_states(fns, states, thread_data, records, num_threads_used);
+        delete_functions(fns, num_threads_used);
 
-              for (unsigned int i = 0; i < current_state.e[0]->get_nvert(); i++)
-                process_edge(iv[i], iv[current_state.e[0]->next_vert(i)], current_state.e[0]->en[i]->marker);
-            }
-            catch(Hermes::Exceptions::Exception& e)
-            {
-              if(this->caughtException == NULL)
-                this->caughtException = e.clone();
-            }
-            catch(std::exception& e)
-            {
-              if(this->caughtException == NULL)
-                this->caughtException = new Hermes::Exceptions::Exception(e.what());
-            }
-          }
+        if(this->caughtException == NULL)
+        {
+          merge_elements(thread_data, records, num_threads_used);
+          add_element_edges(states, thread_data, records);
         }
 
-        trav_master.finish();
-        for(unsigned int i = 0; i < Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads); i++)
+        for(unsigned int i = 0; i < states.size(); i++)
+          delete states[i];
+        delete [] thread_data;
+
+        if(this->caughtException != NULL)
         {
-          trav[i].finish();
-          for(unsigned int j = 0; j < (1 + (xdisp != NULL? 1 : 0) + (ydisp != NULL ? 1 : 0)); j++)
-            delete fns[i][j];
-          delete [] fns[i];
-          delete [] trfs[i];
+          this->unlock_data();
+          throw *(this->caughtException);
         }
-        delete [] fns;
-        delete [] trfs;
-        delete [] trav;
 
         // for contours, without regularization.
         this->tris_contours = (int3*) realloc(this->tris_contours, sizeof(int3) * this->triangle_count);
         memcpy(this->tris_contours, this->tris, this->triangle_count * sizeof(int3));
         triangle_contours_count = this->triangle_count;
 
-        if(this->caughtException != NULL)
+        // regularize the linear mesh
+        regularize();
+
+        find_min_max();
+
+        this->unlock_data();
+
+        // select old quadratrues
+        sln->set_quad_2d(old_quad);
+        if(user_xdisp)
+          xdisp->set_quad_2d(old_quad_x);
+        else
+          delete xdisp;
+        if(user_ydisp)
+          ydisp->set_quad_2d(old_quad_y);
+        else
+          delete ydisp;
+
+        // clean up
+        ::free(hash_table);
+        ::free(info);
+      }
+
+      void Linearizer::process_solution_streamed(MeshFunction<double>* sln, LinearizerOutput* output, int item_, double eps, int chunk_size)
+      {
+        if(chunk_size < 1)
+          throw Hermes::Exceptions::ValueException("chunk_size", chunk_size, 1);
+
+        // Important, sets the current caughtException to NULL.
+        this->caughtException = NULL;
+
+        lock_data();
+        this->tick();
+
+        // The previous linearization is not kept.
+        this->free();
+        this->vertex_size = this->triangle_size = this->edges_size = 0;
+        this->triangle_contours_count = 0;
+
+        set_item(item_, eps);
+
+        // select the linearization quadratures
+        Quad2D *old_quad, *old_quad_x = NULL, *old_quad_y = NULL;
+        old_quad = sln->get_quad_2d();
+        if(xdisp != NULL)
+          old_quad_x = xdisp->get_quad_2d();
+        if(ydisp != NULL)
+          old_quad_y = ydisp->get_quad_2d();
+
+        int num_threads_used = Hermes2DApi.get_integral_param_value(Hermes::Hermes2D::numThreads);
+        Hermes::vector<const Mesh*> meshes;
+        MeshFunction<double>*** fns = create_functions(sln, meshes, num_threads_used);
+        ThreadData* thread_data = new ThreadData[num_threads_used];
+        std::vector<ElementRecord> records;
+        std::vector<Traverse::State*> states;
+
+        double min_value = 1e100, max_value = -1e100;
+        ChunkEdges chunk_edges;
+
+        // The maximum has to be known before the first chunk is linearized.
+        if(this->auto_max)
         {
-          this->unlock_data();
-          ::free(hash_table);
-          ::free(info);
-          throw *(this->caughtException);
+          Traverse trav_max(true);
+          trav_max.begin(meshes.size(), &(meshes.front()));
+          bool more = true;
+          while(more && this->caughtException == NULL)
+          {
+            more = next_states(trav_max, states, chunk_size);
+            estimate_max(fns, states, num_threads_used);
+            for(unsigned int i = 0; i < states.size(); i++)
+              delete states[i];
+            states.clear();
+          }
+          trav_max.finish();
+          if(fabs(this->max) < 1E-10)
+            this->max = 1E-10;
         }
 
-        // regularize the linear mesh
-        for (int i = 0; i < this->triangle_count; i++)
+        if(this->caughtException == NULL)
         {
-          int iv0 = tris[i][0], iv1 = tris[i][1], iv2 = tris[i][2];
+          Traverse trav_master(true);
+          trav_master.begin(meshes.size(), &(meshes.front()));
+          try
+          {
+            output->begin();
 
-          int mid0 = peek_vertex(iv0, iv1);
-          int mid1 = peek_vertex(iv1, iv2);
-          int mid2 = peek_vertex(iv2, iv0);
-          if(mid0 >= 0 || mid1 >= 0 || mid2 >= 0)
+            bool more = true;
+            while(more)
+            {
+              more = next_states(trav_master, states, chunk_size);
+
+              linearize_states(fns, states, thread_data, records, num_threads_used);
+              if(this->caughtException != NULL)
+                break;
+
+              this->edges_count = 0;
+              this->edges_size = std::max(this->edges_size, std::max(4 * (int) states.size(), 100));
+              this->edges = (int2*) realloc(this->edges, sizeof(int2) * this->edges_size);
+              this->edge_markers = (int*) realloc(this->edge_markers, sizeof(int) * this->edges_size);
+              merge_elements(thread_data, records, num_threads_used);
+              conform_chunk_edges(states, thread_data, records, chunk_edges, !more);
+              add_element_edges(states, thread_data, records);
+              for(unsigned int i = 0; i < states.size(); i++)
+                delete states[i];
+              states.clear();
+
+              regularize();
+              hold_chunk_edge_triangles(chunk_edges);
+              ::free(hash_table);
+              ::free(info);
+              hash_table = NULL;
+              info = NULL;
+
+              if(this->triangle_count == 0)
+                continue;
+
+              find_min_max();
+              min_value = std::min(min_value, this->min_val);
+              max_value = std::max(max_value, this->max_val);
+
+              output->write_piece(this->verts, this->vertex_count, this->tris, this->tri_markers, this->triangle_count);
+            }
+
+            if(this->caughtException == NULL)
+              output->end();
+          }
+          catch(Hermes::Exceptions::Exception& e)
           {
-            this->del_slot = i;
-            regularize_triangle(iv0, iv1, iv2, mid0, mid1, mid2, tri_markers[i]);
+            if(this->caughtException == NULL)
+              this->caughtException = e.clone();
           }
+          catch(std::exception& e)
+          {
+            if(this->caughtException == NULL)
+              this->caughtException = new Hermes::Exceptions::Exception(e.what());
+          }
+          trav_master.finish();
         }
 
-        find_min_max();
+        for(unsigned int i = 0; i < states.size(); i++)
+          delete states[i];
+        delete [] thread_data;
+        delete_functions(fns, num_threads_used);
+        ::free(hash_table);
+        ::free(info);
+        hash_table = NULL;
+        info = NULL;
+
+        // Only the range of the values is kept.
+        this->free();
+        this->vertex_count = this->triangle_count = this->edges_count = 0;
+        this->vertex_size = this->triangle_size = this->edges_size = 0;
+        this->min_val = min_value;
+        this->max_val = max_value;
 
         this->unlock_data();
 
@@ -813,9 +1015,8 @@ namespace Hermes
         else
           delete ydisp;
 
-        // clean up
-        ::free(hash_table);
-        ::free(info);
+        if(this->caughtException != NULL)
+          throw *(this->caughtException);
       }
 
       void Linearizer::find_min_max()
@@ -830,67 +1031,548 @@ namespace Hermes
         }
       }
 
-      int Linearizer::get_vertex(int p1, int p2, double x, double y, double value)
+      int Linearizer::add_corner_vertex(ThreadData& data, int id, double x, double y, double value)
       {
-        // search for an existing vertex
+        LocalVertex v;
+        v.coords[0] = x;
+        v.coords[1] = y;
+        v.coords[2] = value;
+        v.p1 = v.p2 = -1 - id;
+        v.next = -1;
+        v.key[0] = v.key[1] = id;
+        v.key[2] = 0;
+        data.verts.push_back(v);
+        return data.verts.size() - 1 - data.first_vert;
+      }
+
+      int Linearizer::get_vertex(ThreadData& data, int p1, int p2, double x, double y, double value)
+      {
+        // search for an existing vertex of the element
         if(p1 > p2) std::swap(p1, p2);
-        int index = this->hash(p1, p2);
-        int i = 0;
-        if(index < this->vertex_count)
+        int index = local_hash(p1, p2);
+        for(int i = data.hash_table[index]; i >= 0; i = data.verts[data.first_vert + i].next)
+        {
+          const LocalVertex& v = data.verts[data.first_vert + i];
+          if(
+            v.p1 == p1 && v.p2 == p2 &&
+            (value == v.coords[2] || fabs(value - v.coords[2]) < this->max*1e-8) &&
+            (fabs(x - v.coords[0]) < 1e-8) &&
+            (fabs(y - v.coords[1]) < 1e-8)
+            )
+            return i;
+          // note that we won't return a vertex with a different value than the required one;
+          // this takes care for discontinuities in the solution, where more vertices
+          // with different values will be created
+        }
+
+        // if not found, create a new one
+        LocalVertex v;
+        v.coords[0] = x;
+        v.coords[1] = y;
+        v.coords[2] = value;
+        v.p1 = p1;
+        v.p2 = p2;
+        v.next = data.hash_table[index];
+        mid_key(data, data.verts[data.first_vert + p1], data.verts[data.first_vert + p2], v.key);
+        data.verts.push_back(v);
+
+        int i = data.verts.size() - 1 - data.first_vert;
+        data.hash_table[index] = i;
+        return i;
+      }
+
+      void Linearizer::add_local_triangle(ThreadData& data, int iv0, int iv1, int iv2, int marker)
+      {
+        data.tris.push_back(iv0);
+        data.tris.push_back(iv1);
+        data.tris.push_back(iv2);
+        data.tri_markers.push_back(marker);
+      }
+
+      /// Position of a vertex given by its boundary key on the edge given by the key edge,
+      /// -1 if the vertex does not lie on the edge.
+      static int edge_position(const int* key, const int* edge)
+      {
+        if(key[0] == key[1])
+        {
+          if(key[0] == edge[0])
+            return 0;
+          if(key[0] == edge[1])
+            return H2D_LIN_EDGE_SCALE;
+          return -1;
+        }
+        if(key[0] == edge[0] && key[1] == edge[1])
+          return key[2];
+        return -1;
+      }
+
+      void Linearizer::mid_key(ThreadData& data, const LocalVertex& v1, const LocalVertex& v2, int* key) const
+      {
+        key[0] = key[1] = key[2] = -1;
+        if(v1.key[0] < 0 || v2.key[0] < 0)
+          return;
+
+        // two element vertices, the midpoint lies on the boundary if they form an edge
+        if(v1.key[0] == v1.key[1] && v2.key[0] == v2.key[1])
         {
-          i = this->hash_table[index];
-          while (i >= 0 && i < this->vertex_count)
+          int a = std::min(v1.key[0], v2.key[0]), b = std::max(v1.key[0], v2.key[0]);
+          for (int i = 0; i < data.nvert; i++)
           {
-            if(
-              this->info[i][0] == p1 && this->info[i][1] == p2 &&
-              (value == verts[i][2] || fabs(value - verts[i][2]) < this->max*1e-8) &&
-              (fabs(x - verts[i][0]) < 1e-8) &&
-              (fabs(y - verts[i][1]) < 1e-8)
-              )
-              return i;
-            // note that we won't return a vertex with a different value than the required one;
-            // this takes care for discontinuities in the solution, where more vertices
-            // with different values will be created
-            i = info[i][2];
+            int id1 = data.vertex_ids[i], id2 = data.vertex_ids[(i + 1) % data.nvert];
+            if(std::min(id1, id2) == a && std::max(id1, id2) == b)
+            {
+              key[0] = a;
+              key[1] = b;
+              key[2] = H2D_LIN_EDGE_SCALE / 2;
+              return;
+            }
           }
+          return;
         }
 
-        // if not found, create a new one
-#pragma omp critical(realloc_vertices)
-        try
+        // otherwise both have to lie on the same edge
+        const int* edge = (v1.key[0] != v1.key[1]) ? v1.key : v2.key;
+        int t1 = edge_position(v1.key, edge), t2 = edge_position(v2.key, edge);
+        if(t1 < 0 || t2 < 0)
+          return;
+        key[0] = edge[0];
+        key[1] = edge[1];
+        key[2] = (t1 + t2) / 2;
+      }
+
+      /// A vertex on the element boundary, identified by its key, see Linearizer::LocalVertex.
+      struct BoundaryVertexKey
+      {
+        int key[3];
+        /// Index in the list of boundary vertices (in the traversal order).
+        int index;
+
+        bool operator<(const BoundaryVertexKey& other) const
         {
-          i = add_vertex();
+          for(int i = 0; i < 3; i++)
+            if(key[i] != other.key[i])
+              return key[i] < other.key[i];
+          return index < other.index;
         }
-        catch(std::exception& e)
+      };
+
+      void Linearizer::merge_elements(ThreadData* thread_data, std::vector<ElementRecord>& records, int num_threads_used)
+      {
+        int num_records = records.size();
+        int r;
+
+        // list the boundary vertices of all elements in the traversal order
+        std::vector<int> first_boundary(num_records + 1, 0);
+#pragma omp parallel for private(r) num_threads(num_threads_used)
+        for(r = 0; r < num_records; r++)
         {
-          if(this->caughtException == NULL)
-            this->caughtException = new Hermes::Exceptions::Exception(e.what());
+          const ElementRecord& record = records[r];
+          const LocalVertex* v = &thread_data[record.thread].verts[record.first_vert];
+          int count = 0;
+          for (int i = 0; i < record.num_verts; i++)
+            if(v[i].key[0] >= 0)
+              count++;
+          first_boundary[r + 1] = count;
         }
-        if(this->caughtException != NULL)
+        for(r = 0; r < num_records; r++)
+          first_boundary[r + 1] += first_boundary[r];
+        int num_boundary = first_boundary[num_records];
+
+        // (record, local index) pairs
+        std::vector<int> boundary(2 * num_boundary);
+#pragma omp parallel for private(r) num_threads(num_threads_used)
+        for(r = 0; r < num_records; r++)
         {
-          return -1;
+          const ElementRecord& record = records[r];
+          LocalVertex* v = &thread_data[record.thread].verts[record.first_vert];
+          int index = first_boundary[r];
+          for (int i = 0; i < record.num_verts; i++)
+          {
+            if(v[i].key[0] >= 0)
+            {
+              boundary[2 * index] = r;
+              boundary[2 * index + 1] = i;
+              v[i].boundary_index = v[i].global = index++;
+            }
+            else
+              v[i].boundary_index = v[i].global = -1;
+          }
+        }
+
+        // identify the boundary vertices with the same key and value, the first one (in the traversal order) is the representative;
+        // the keys are distributed into buckets by a hash in one pass, then every thread sorts and compares the keys of its buckets
+        int num_buckets = num_threads_used;
+        std::vector<std::vector<BoundaryVertexKey> > buckets(num_buckets);
+        for (int i = 0; i < num_boundary; i++)
+        {
+          const ElementRecord& record = records[boundary[2 * i]];
+          const LocalVertex& v = thread_data[record.thread].verts[record.first_vert + boundary[2 * i + 1]];
+          unsigned int h = (unsigned int) v.key[0] * 73856093u ^ (unsigned int) v.key[1] * 19349663u ^ (unsigned int) v.key[2] * 83492791u;
+          BoundaryVertexKey key;
+          memcpy(key.key, v.key, sizeof(key.key));
+          key.index = i;
+          buckets[h % num_buckets].push_back(key);
+        }
+
+        int bucket;
+#pragma omp parallel for private(bucket) schedule(dynamic, 1) num_threads(num_threads_used)
+        for(bucket = 0; bucket < num_buckets; bucket++)
+        {
+          std::vector<BoundaryVertexKey>& keys = buckets[bucket];
+          std::sort(keys.begin(), keys.end());
+
+          for (unsigned int group = 0, group_end; group < keys.size(); group = group_end)
+          {
+            for(group_end = group + 1; group_end < keys.size() && !memcmp(keys[group].key, keys[group_end].key, sizeof(keys[group].key)); group_end++);
+
+            for (unsigned int i = group + 1; i < group_end; i++)
+            {
+              const ElementRecord& record = records[boundary[2 * keys[i].index]];
+              LocalVertex& v = thread_data[record.thread].verts[record.first_vert + boundary[2 * keys[i].index + 1]];
+              for (unsigned int j = group; j < i; j++)
+              {
+                const ElementRecord& rep_record = records[boundary[2 * keys[j].index]];
+                const LocalVertex& rep = thread_data[rep_record.thread].verts[rep_record.first_vert + boundary[2 * keys[j].index + 1]];
+                if(rep.boundary_index == keys[j].index &&
+                  (v.coords[2] == rep.coords[2] || fabs(v.coords[2] - rep.coords[2]) < this->max*1e-8) &&
+                  (fabs(v.coords[0] - rep.coords[0]) < 1e-8) &&
+                  (fabs(v.coords[1] - rep.coords[1]) < 1e-8))
+                {
+                  v.boundary_index = keys[j].index;
+                  break;
+                }
+              }
+            }
+          }
+          std::vector<BoundaryVertexKey>().swap(keys);
+        }
+
+        // number the vertices owned by the elements (the interior ones and the boundary representatives)
+        std::vector<int> first_owned(num_records + 1, 0);
+#pragma omp parallel for private(r) num_threads(num_threads_used)
+        for(r = 0; r < num_records; r++)
+        {
+          const ElementRecord& record = records[r];
+          const LocalVertex* v = &thread_data[record.thread].verts[record.first_vert];
+          int count = 0;
+          for (int i = 0; i < record.num_verts; i++)
+            if(v[i].boundary_index == v[i].global)
+              count++;
+          first_owned[r + 1] = count;
+        }
+        for(r = 0; r < num_records; r++)
+        {
+          first_owned[r + 1] += first_owned[r];
+          records[r].first_global = first_owned[r];
+        }
+
+        this->vertex_count = first_owned[num_records];
+        this->vertex_size = 2;
+        while(this->vertex_size < this->vertex_count)
+          this->vertex_size *= 2;
+        this->verts = (double3*) realloc(this->verts, sizeof(double3) * this->vertex_size);
+        this->info = (int4*) malloc(sizeof(int4) * this->vertex_size);
+        this->hash_table = (int*) malloc(sizeof(int) * this->vertex_size);
+        memset(this->hash_table, 0xff, sizeof(int) * this->vertex_size);
+
+#pragma omp parallel for private(r) num_threads(num_threads_used)
+        for(r = 0; r < num_records; r++)
+        {
+          const ElementRecord& record = records[r];
+          LocalVertex* v = &thread_data[record.thread].verts[record.first_vert];
+          int index = record.first_global;
+          for (int i = 0; i < record.num_verts; i++)
+          {
+            if(v[i].boundary_index == v[i].global)
+            {
+              v[i].global = index++;
+              memcpy(this->verts[v[i].global], v[i].coords, sizeof(double3));
+            }
+            else
+              v[i].global = -1;
+          }
+        }
+
+        // the shared vertices take the index of their representative
+#pragma omp parallel for private(r) num_threads(num_threads_used)
+        for(r = 0; r < num_records; r++)
+        {
+          const ElementRecord& record = records[r];
+          LocalVertex* v = &thread_data[record.thread].verts[record.first_vert];
+          for (int i = 0; i < record.num_verts; i++)
+          {
+            if(v[i].global < 0)
+            {
+              const ElementRecord& rep_record = records[boundary[2 * v[i].boundary_index]];
+              v[i].global = thread_data[rep_record.thread].verts[rep_record.first_vert + boundary[2 * v[i].boundary_index + 1]].global;
+            }
+          }
+        }
+
+// parents of the owned vertices in the resulting indices
+#pragma omp parallel for private(r) num_threads(num_threads_used)
+        for(r = 0; r < num_records; r++)
+        {
+          const ElementRecord& record = records[r];
+          const LocalVertex* v = &thread_data[record.thread].verts[record.first_vert];
+          for (int i = 0; i < record.num_verts; i++)
+          {
+            if(v[i].boundary_index >= 0 && (boundary[2 * v[i].boundary_index] != r || boundary[2 * v[i].boundary_index + 1] != i))
+              continue;
+            int4& vertex_info = this->info[v[i].global];
+            if(v[i].p1 < 0)
+            {
+              // element vertex
+              vertex_info[0] = vertex_info[1] = v[i].p1 + 1;
+            }
+            else
+            {
+              vertex_info[0] = std::min(v[v[i].p1].global, v[v[i].p2].global);
+              vertex_info[1] = std::max(v[v[i].p1].global, v[v[i].p2].global);
+            }
+          }
+        }
+
+        for (int i = 0; i < this->vertex_count; i++)
+        {
+          int index = this->hash(this->info[i][0], this->info[i][1]);
+          this->info[i][2] = this->hash_table[index];
+          this->hash_table[index] = i;
+        }
+
+        // triangles
+        std::vector<int> first_tri(num_records + 1, 0);
+        for(r = 0; r < num_records; r++)
+          first_tri[r + 1] = first_tri[r] + records[r].num_tris;
+        this->triangle_count = first_tri[num_records];
+        this->triangle_size = std::max(this->triangle_count + this->triangle_count / 2, 1000);
+        this->tris = (int3*) realloc(this->tris, sizeof(int3) * this->triangle_size);
+        this->tri_markers = (int*) realloc(this->tri_markers, sizeof(int) * this->triangle_size);
+
+#pragma omp parallel for private(r) num_threads(num_threads_used)
+        for(r = 0; r < num_records; r++)
+        {
+          const ElementRecord& record = records[r];
+          const ThreadData& data = thread_data[record.thread];
+          for (int i = 0; i < record.num_tris; i++)
+          {
+            for (int j = 0; j < 3; j++)
+              this->tris[first_tri[r] + i][j] = data.verts[record.first_vert + data.tris[3 * (record.first_tri + i) + j]].global;
+            this->tri_markers[first_tri[r] + i] = data.tri_markers[record.first_tri + i];
+          }
         }
-        verts[i][0] = x;
-        verts[i][1] = y;
-        verts[i][2] = value;
-        this->info[i][0] = p1;
-        this->info[i][1] = p2;
-        this->info[i][2] = hash_table[index];
-        this->hash_table[index] = i;
-        return i;
       }
 
-      int Linearizer::add_vertex()
+      /// Whether two vertices at the same position are identified, the same test as in merge_elements().
+      static bool same_vertex(const double* v1, const double* v2, double max)
+      {
+        return (v1[2] == v2[2] || fabs(v1[2] - v2[2]) < max*1e-8) && fabs(v1[0] - v2[0]) < 1e-8 && fabs(v1[1] - v2[1]) < 1e-8;
+      }
+
+      void Linearizer::conform_chunk_edges(std::vector<Traverse::State*>& states, ThreadData* thread_data, std::vector<ElementRecord>& records,
+        ChunkEdges& chunk_edges, bool last_chunk)
+      {
+        chunk_edges.keys.clear();
+
+        // the inner element edges of the chunk with the state having them, -1 if both sides are in the chunk
+        // (merge_elements() does not identify the vertices on the edges with a hanging node either)
+        std::map<std::pair<int, int>, int> chunk_boundary;
+        for(unsigned int state_i = 0; state_i < states.size(); state_i++)
+        {
+          Element* e = states[state_i]->e[0];
+          for (int i = 0; i < e->get_nvert(); i++)
+          {
+            if(e->en[i]->bnd || e->en[i]->elem[0] == NULL || e->en[i]->elem[1] == NULL)
+              continue;
+            int id1 = e->vn[i]->id, id2 = e->vn[e->next_vert(i)]->id;
+            std::pair<int, int> edge(std::min(id1, id2), std::max(id1, id2));
+            std::map<std::pair<int, int>, int>::iterator it = chunk_boundary.find(edge);
+            if(it == chunk_boundary.end())
+              chunk_boundary.insert(std::pair<std::pair<int, int>, int>(edge, state_i));
+            else
+              it->second = -1;
+          }
+        }
+
+        // the vertices of the closed edges by their position
+        std::map<std::pair<int, int>, std::map<int, int> > closed;
+        for(std::map<std::pair<int, int>, int>::iterator it = chunk_boundary.begin(); it != chunk_boundary.end(); it++)
+        {
+          if(it->second < 0)
+            continue;
+
+          // the vertices of this chunk on the edge, sorted by the position
+          const ElementRecord& record = records[it->second];
+          const LocalVertex* v = &thread_data[record.thread].verts[record.first_vert];
+          int edge[2] = { it->first.first, it->first.second };
+          std::vector<std::pair<ChunkEdgeVertex, int> > here;
+          for (int i = 0; i < record.num_verts; i++)
+          {
+            int position = v[i].key[0] < 0 ? -1 : edge_position(v[i].key, edge);
+            if(position < 0)
+              continue;
+            ChunkEdgeVertex vertex;
+            vertex.position = position;
+            memcpy(vertex.coords, this->verts[v[i].global], sizeof(double3));
+            here.push_back(std::pair<ChunkEdgeVertex, int>(vertex, v[i].global));
+          }
+          std::sort(here.begin(), here.end());
+
+          std::map<std::pair<int, int>, std::vector<ChunkEdgeVertex> >::iterator other_it = chunk_edges.edges.find(it->first);
+          if(other_it == chunk_edges.edges.end())
+          {
+            std::vector<ChunkEdgeVertex>& opened = chunk_edges.edges[it->first];
+            for (unsigned int i = 0; i < here.size(); i++)
+            {
+              opened.push_back(here[i].first);
+              chunk_edges.keys.insert(std::pair<int, ChunkEdgeKey>(here[i].second, ChunkEdgeKey(it->first, here[i].first.position)));
+            }
+            continue;
+          }
+
+          const std::vector<ChunkEdgeVertex>& other = other_it->second;
+          if(here.size() >= 2 && other.size() >= 2
+            && same_vertex(here.front().first.coords, other.front().coords, this->max)
+            && same_vertex(here.back().first.coords, other.back().coords, this->max))
+          {
+            std::map<int, int>& vertices = closed[it->first];
+            for (unsigned int i = 0; i < here.size(); i++)
+              vertices[here[i].first.position] = here[i].second;
+            for (unsigned int i = 0; i + 1 < here.size(); i++)
+              add_chunk_edge_vertices(here[i].second, here[i].first.position, here[i + 1].second, here[i + 1].first.position, other, vertices);
+          }
+          chunk_edges.edges.erase(other_it);
+        }
+
+        // no edge can be closed after the last chunk
+        if(last_chunk)
+        {
+          chunk_edges.edges.clear();
+          chunk_edges.keys.clear();
+        }
+
+        // the held triangles on the edges that are not open any more
+        std::vector<ChunkEdgeTriangle> held;
+        for (unsigned int i = 0; i < chunk_edges.triangles.size(); i++)
+        {
+          const ChunkEdgeTriangle& triangle = chunk_edges.triangles[i];
+          bool open = true;
+          for (int j = 0; j < 3; j++)
+            for (unsigned int k = 0; k < triangle.keys[j].size(); k++)
+              if(chunk_edges.edges.find(triangle.keys[j][k].first) == chunk_edges.edges.end())
+                open = false;
+          if(open)
+          {
+            held.push_back(triangle);
+            continue;
+          }
+
+          int iv[3];
+          for (int j = 0; j < 3; j++)
+          {
+            iv[j] = -1;
+            for (unsigned int k = 0; k < triangle.keys[j].size() && iv[j] < 0; k++)
+            {
+              std::map<std::pair<int, int>, std::map<int, int> >::iterator closed_it = closed.find(triangle.keys[j][k].first);
+              if(closed_it == closed.end())
+                continue;
+              std::map<int, int>::iterator vertex_it = closed_it->second.find(triangle.keys[j][k].second);
+              if(vertex_it != closed_it->second.end())
+                iv[j] = vertex_it->second;
+            }
+            // the vertices inside the previous chunk are not shared, they have no parents
+            if(iv[j] < 0)
+              iv[j] = add_merged_vertex(-1, -1, triangle.coords[j]);
+            for (unsigned int k = 0; k < triangle.keys[j].size(); k++)
+              if(chunk_edges.edges.find(triangle.keys[j][k].first) != chunk_edges.edges.end())
+                chunk_edges.keys.insert(std::pair<int, ChunkEdgeKey>(iv[j], triangle.keys[j][k]));
+          }
+          add_triangle(iv[0], iv[1], iv[2], triangle.marker);
+        }
+        chunk_edges.triangles.swap(held);
+      }
+
+      void Linearizer::add_chunk_edge_vertices(int iv1, int t1, int iv2, int t2, const std::vector<ChunkEdgeVertex>& other, std::map<int, int>& vertices)
+      {
+        if(t2 - t1 < 2)
+          return;
+        ChunkEdgeVertex mid;
+        mid.position = (t1 + t2) / 2;
+        std::vector<ChunkEdgeVertex>::const_iterator found = std::lower_bound(other.begin(), other.end(), mid);
+        if(found == other.end() || found->position != mid.position)
+          return;
+
+        int iv = vertices[mid.position] = add_merged_vertex(iv1, iv2, found->coords);
+        add_chunk_edge_vertices(iv1, t1, iv, mid.position, other, vertices);
+        add_chunk_edge_vertices(iv, mid.position, iv2, t2, other, vertices);
+      }
+
+      void Linearizer::hold_chunk_edge_triangles(ChunkEdges& chunk_edges)
+      {
+        if(chunk_edges.keys.empty())
+          return;
+
+        int count = 0;
+        for (int i = 0; i < this->triangle_count; i++)
+        {
+          // a triangle is held if two of its vertices are on the same open edge
+          std::vector<ChunkEdgeKey> keys[3];
+          for (int j = 0; j < 3; j++)
+          {
+            std::pair<std::multimap<int, ChunkEdgeKey>::iterator, std::multimap<int, ChunkEdgeKey>::iterator> range = chunk_edges.keys.equal_range(this->tris[i][j]);
+            for (std::multimap<int, ChunkEdgeKey>::iterator it = range.first; it != range.second; it++)
+              keys[j].push_back(it->second);
+          }
+          bool on_edge = false;
+          for (int j = 0; j < 3 && !on_edge; j++)
+            for (unsigned int k = 0; k < keys[j].size() && !on_edge; k++)
+              for (unsigned int l = 0; l < keys[(j + 1) % 3].size() && !on_edge; l++)
+                on_edge = keys[j][k].first == keys[(j + 1) % 3][l].first;
+
+          if(!on_edge)
+          {
+            memcpy(this->tris[count], this->tris[i], sizeof(int3));
+            this->tri_markers[count++] = this->tri_markers[i];
+            continue;
+          }
+          ChunkEdgeTriangle triangle;
+          for (int j = 0; j < 3; j++)
+          {
+            memcpy(triangle.coords[j], this->verts[this->tris[i][j]], sizeof(double3));
+            triangle.keys[j].swap(keys[j]);
+          }
+          triangle.marker = this->tri_markers[i];
+          chunk_edges.triangles.push_back(triangle);
+        }
+        this->triangle_count = count;
+      }
+
+      int Linearizer::add_merged_vertex(int p1, int p2, const double* coords)
       {
         if(this->vertex_count >= this->vertex_size)
         {
+          // the hash depends on the size, so the table is built again
           this->vertex_size *= 2;
-          verts = (double3*) realloc(verts, sizeof(double3) * vertex_size);
-          this->info = (int4*) realloc(info, sizeof(int4) * vertex_size);
-          this->hash_table = (int*) realloc(hash_table, sizeof(int) * vertex_size);
-          memset(this->hash_table + this->vertex_size / 2, 0xff, sizeof(int) * this->vertex_size / 2);
+          this->verts = (double3*) realloc(this->verts, sizeof(double3) * this->vertex_size);
+          this->info = (int4*) realloc(this->info, sizeof(int4) * this->vertex_size);
+          this->hash_table = (int*) realloc(this->hash_table, sizeof(int) * this->vertex_size);
+          memset(this->hash_table, 0xff, sizeof(int) * this->vertex_size);
+          for (int i = 0; i < this->vertex_count; i++)
+          {
+            int index = this->hash(this->info[i][0], this->info[i][1]);
+            this->info[i][2] = this->hash_table[index];
+            this->hash_table[index] = i;
+          }
         }
-        return this->vertex_count++;
+
+        int i = this->vertex_count++;
+        memcpy(this->verts[i], coords, sizeof(double3));
+        this->info[i][0] = std::min(p1, p2);
+        this->info[i][1] = std::max(p1, p2);
+        int index = this->hash(this->info[i][0], this->info[i][1]);
+        this->info[i][2] = this->hash_table[index];
+        this->hash_table[index] = i;
+        return i;
       }
 
       void Linearizer::free()
@@ -967,6 +1649,54 @@ namespace Hermes
         fclose(f);
       }
 
+      void Linearizer::save_solution_vtu(MeshFunction<double>* sln, const char* filename, const char *quantity_name,
+        bool mode_3D, int item, double eps, const VtuWriter& writer)
+      {
+        process_solution(sln, item, eps);
+
+        VtuWriter vtu(writer);
+        vtu.clear();
+        LinearizerDataLock lock(this);
+        vtu.set_points(this->vertex_count, &this->verts[0][0], 3, mode_3D ? 3 : 2);
+        vtu.set_cells(this->triangle_count, &this->tris[0][0], 3, 3);
+        vtu.add_point_data(quantity_name, &this->verts[0][2], 3);
+        vtu.add_cell_data("marker", this->tri_markers);
+        vtu.write(filename);
+      }
+
+      void Linearizer::save_solution_vtu_streamed(MeshFunction<double>* sln, const char* filename, const char *quantity_name,
+        bool mode_3D, int item, double eps, const VtuWriter& writer, int chunk_size)
+      {
+        LinearizerVtuOutput output(filename, quantity_name, mode_3D, writer);
+        process_solution_streamed(sln, &output, item, eps, chunk_size);
+      }
+
+      LinearizerVtuOutput::LinearizerVtuOutput(const char* filename, const char* quantity_name, bool mode_3D, const VtuWriter& writer)
+        : filename(filename), quantity_name(quantity_name), mode_3D(mode_3D), writer(writer)
+      {
+        this->writer.clear();
+      }
+
+      void LinearizerVtuOutput::begin()
+      {
+        writer.begin_pieces(filename.c_str());
+      }
+
+      void LinearizerVtuOutput::write_piece(const double3* verts, int vertex_count, const int3* tris, const int* tri_markers, int triangle_count)
+      {
+        writer.clear();
+        writer.set_points(vertex_count, &verts[0][0], 3, mode_3D ? 3 : 2);
+        writer.set_cells(triangle_count, &tris[0][0], 3, 3);
+        writer.add_point_data(quantity_name.c_str(), &verts[0][2], 3);
+        writer.add_cell_data("marker", tri_markers);
+        writer.write_piece();
+      }
+
+      void LinearizerVtuOutput::end()
+      {
+        writer.end_pieces();
+      }
+
       void Linearizer::calc_vertices_aabb(double* min_x, double* max_x, double* min_y, double* max_y) const
       {
         if(verts == NULL)
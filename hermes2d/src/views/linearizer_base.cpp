@@ -94,6 +94,16 @@ namespace Hermes
         pthread_mutex_unlock(&data_mutex);
       }
 
+      LinearizerDataLock::LinearizerDataLock(const LinearizerBase* linearizer) : linearizer(linearizer)
+      {
+        linearizer->lock_data();
+      }
+
+      LinearizerDataLock::~LinearizerDataLock()
+      {
+        linearizer->unlock_data();
+      }
+
       void LinearizerBase::process_edge(int iv1, int iv2, int marker)
       {
         int mid = peek_vertex(iv1, iv2);
@@ -208,6 +218,7 @@ namespace Hermes
             index = this->del_slot;
             del_slot = -1;
           }
+          else
           {
             if(triangle_count >= triangle_size)
 						{
@@ -215,12 +226,12 @@ namespace Hermes
               tri_markers = (int*) realloc(tri_markers, sizeof(int) * (triangle_size = triangle_size * 2));
 						}
             index = triangle_count++;
-
-            tris[index][0] = iv0;
-            tris[index][1] = iv1;
-            tris[index][2] = iv2;
-						tri_markers[index] = marker;
           }
+
+          tris[index][0] = iv0;
+          tris[index][1] = iv1;
+          tris[index][2] = iv2;
+          tri_markers[index] = marker;
         }
       }
 
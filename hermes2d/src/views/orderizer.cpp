@@ -367,6 +367,35 @@ namespace Hermes
         fclose(f);
       }
 
+      template<typename Scalar>
+      void Orderizer::save_orders_vtu(const Space<Scalar>* space, const char* file_name, const VtuWriter& writer)
+      {
+        process_space(space);
+
+        VtuWriter vtu(writer);
+        vtu.clear();
+        LinearizerDataLock lock(this);
+        vtu.set_points(this->vertex_count, &this->verts[0][0], 3, 2);
+        vtu.set_cells(this->triangle_count, &this->tris[0][0], 3, 3);
+        vtu.add_cell_data("order", this->tris_orders);
+        vtu.add_cell_data("marker", this->tri_markers);
+        vtu.write(file_name);
+      }
+
+      template<typename Scalar>
+      void Orderizer::save_mesh_vtu(const Space<Scalar>* space, const char* file_name, const VtuWriter& writer)
+      {
+        process_space(space);
+
+        VtuWriter vtu(writer);
+        vtu.clear();
+        LinearizerDataLock lock(this);
+        vtu.set_points(this->vertex_count, &this->verts[0][0], 3, 2);
+        vtu.set_cells(this->edges_count, &this->edges[0][0], 2, 2);
+        vtu.add_cell_data("marker", this->edge_markers);
+        vtu.write(file_name);
+      }
+
       int Orderizer::get_labels(int*& lvert, char**& ltext, double2*& lbox) const
       {
         lvert = this->lvert;
@@ -395,6 +424,10 @@ namespace Hermes
       template HERMES_API void Orderizer::save_orders_vtk<std::complex<double> >(const Space<std::complex<double> >* space, const char* file_name);
       template HERMES_API void Orderizer::save_mesh_vtk<double>(const Space<double>* space, const char* file_name);
       template HERMES_API void Orderizer::save_mesh_vtk<std::complex<double> >(const Space<std::complex<double> >* space, const char* file_name);
+      template HERMES_API void Orderizer::save_orders_vtu<double>(const Space<double>* space, const char* file_name, const VtuWriter& writer);
+      template HERMES_API void Orderizer::save_orders_vtu<std::complex<double> >(const Space<std::complex<double> >* space, const char* file_name, const VtuWriter& writer);
+      template HERMES_API void Orderizer::save_mesh_vtu<double>(const Space<double>* space, const char* file_name, const VtuWriter& writer);
+      template HERMES_API void Orderizer::save_mesh_vtu<std::complex<double> >(const Space<std::complex<double> >* space, const char* file_name, const VtuWriter& writer);
       template HERMES_API void Orderizer::process_space<double>(const Space<double>* space);
       template HERMES_API void Orderizer::process_space<std::complex<double> >(const Space<std::complex<double> >* space);
     }
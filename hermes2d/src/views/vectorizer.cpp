@@ -824,6 +824,21 @@ namespace Hermes
         free();
       }
 
+      void Vectorizer::save_solution_vtu(MeshFunction<double>* xsln, MeshFunction<double>* ysln, const char* filename, const char* quantity_name,
+        int xitem, int yitem, double eps, const VtuWriter& writer)
+      {
+        process_solution(xsln, ysln, xitem, yitem, eps);
+
+        VtuWriter vtu(writer);
+        vtu.clear();
+        LinearizerDataLock lock(this);
+        vtu.set_points(this->vertex_count, &this->verts[0][0], 4, 2);
+        vtu.set_cells(this->triangle_count, &this->tris[0][0], 3, 3);
+        vtu.add_point_data(quantity_name, &this->verts[0][2], 4, 2);
+        vtu.add_cell_data("marker", this->tri_markers);
+        vtu.write(filename);
+      }
+
       void Vectorizer::calc_vertices_aabb(double* min_x, double* max_x, double* min_y, double* max_y) const
       {
         if(verts == NULL)
@@ -0,0 +1,599 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "vtu_writer.h"
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    namespace Views
+    {
+      /// Number of tuples converted at once.
+      static const int VTU_CHUNK_TUPLES = 1 << 14;
+      /// Uncompressed size of a compressed block.
+      static const int VTU_BLOCK_SIZE = 1 << 20;
+
+      static const char base64_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+      static inline uint64_t base64_size(uint64_t n)
+      {
+        return 4 * ((n + 2) / 3);
+      }
+
+      /// Buffered output, encodes the data in base64 if requested. Each part (header, data) of an array
+      /// is encoded separately, as the readers of the format expect.
+      class VtuWriter::Output
+      {
+      public:
+        Output(FILE* f, bool base64) : f(f), base64(base64), pending(0), used(0) {}
+
+        void put(const char* data, size_t n)
+        {
+          if(!base64)
+          {
+            raw(data, n);
+            return;
+          }
+
+          const unsigned char* p = (const unsigned char*) data;
+          while(n > 0 && pending > 0 && pending < 3)
+          {
+            carry[pending++] = *p++;
+            n--;
+          }
+          if(pending == 3)
+          {
+            encode(carry, 3);
+            pending = 0;
+          }
+          for(; n >= 3; n -= 3, p += 3)
+            encode(p, 3);
+          while(n > 0)
+          {
+            carry[pending++] = *p++;
+            n--;
+          }
+        }
+
+        /// Ends the current base64-encoded part.
+        void end_part()
+        {
+          if(base64 && pending > 0)
+            encode(carry, pending);
+          pending = 0;
+        }
+
+        void flush()
+        {
+          if(used > 0 && fwrite(buffer, 1, used, f) != used)
+            throw Hermes::Exceptions::Exception("Error writing a VTU file.");
+          used = 0;
+        }
+
+      protected:
+        void raw(const char* data, size_t n)
+        {
+          if(used + n > sizeof(buffer))
+          {
+            flush();
+            if(n > sizeof(buffer))
+            {
+              if(fwrite(data, 1, n, f) != n)
+                throw Hermes::Exceptions::Exception("Error writing a VTU file.");
+              return;
+            }
+          }
+          memcpy(buffer + used, data, n);
+          used += n;
+        }
+
+        void encode(const unsigned char* in, int n)
+        {
+          if(used + 4 > sizeof(buffer))
+            flush();
+          char* out = buffer + used;
+          out[0] = base64_table[in[0] >> 2];
+          out[1] = base64_table[((in[0] & 0x03) << 4) | (n > 1 ? in[1] >> 4 : 0)];
+          out[2] = n > 1 ? base64_table[((in[1] & 0x0f) << 2) | (n > 2 ? in[2] >> 6 : 0)] : '=';
+          out[3] = n > 2 ? base64_table[in[2] & 0x3f] : '=';
+          used += 4;
+        }
+
+        FILE* f;
+        bool base64;
+        unsigned char carry[3];
+        int pending;
+        char buffer[1 << 16];
+        size_t used;
+      };
+
+      int VtuWriter::DataArray::component_size(bool double_precision) const
+      {
+        switch(kind)
+        {
+        case ARRAY_DOUBLE:
+          return double_precision ? sizeof(double) : sizeof(float);
+        case ARRAY_TYPES:
+          return 1;
+        default:
+          return sizeof(int);
+        }
+      }
+
+      const char* VtuWriter::DataArray::type_name(bool double_precision) const
+      {
+        switch(kind)
+        {
+        case ARRAY_DOUBLE:
+          return double_precision ? "Float64" : "Float32";
+        case ARRAY_TYPES:
+          return "UInt8";
+        default:
+          return "Int32";
+        }
+      }
+
+      void VtuWriter::DataArray::fill(char* buffer, int first, int num, bool double_precision) const
+      {
+        switch(kind)
+        {
+        case ARRAY_DOUBLE:
+          {
+            const double* src = (const double*) data + (size_t) first * stride;
+            if(double_precision)
+            {
+              double* dest = (double*) buffer;
+              for(int i = 0; i < num; i++, src += stride)
+              {
+                for(int j = 0; j < num_components; j++)
+                  *dest++ = src[j];
+                for(int j = num_components; j < out_components; j++)
+                  *dest++ = 0.0;
+              }
+            }
+            else
+            {
+              float* dest = (float*) buffer;
+              for(int i = 0; i < num; i++, src += stride)
+              {
+                for(int j = 0; j < num_components; j++)
+                  *dest++ = (float) src[j];
+                for(int j = num_components; j < out_components; j++)
+                  *dest++ = 0.0f;
+              }
+            }
+          }
+          break;
+        case ARRAY_INT:
+          {
+            const int* src = (const int*) data + (size_t) first * stride;
+            int* dest = (int*) buffer;
+            for(int i = 0; i < num; i++, src += stride)
+              for(int j = 0; j < num_components; j++)
+                *dest++ = src[j];
+          }
+          break;
+        case ARRAY_OFFSETS:
+          {
+            int* dest = (int*) buffer;
+            for(int i = 0; i < num; i++)
+              dest[i] = (first + i + 1) * param;
+          }
+          break;
+        case ARRAY_TYPES:
+          memset(buffer, param, num);
+          break;
+        }
+      }
+
+      VtuWriter::VtuWriter(VtuEncoding encoding, bool double_precision, int compression_level) : stream(NULL)
+      {
+        set_encoding(encoding);
+        set_double_precision(double_precision);
+        set_compression_level(compression_level);
+        clear();
+      }
+
+      VtuWriter::VtuWriter(const VtuWriter& other) : stream(NULL)
+      {
+        *this = other;
+      }
+
+      VtuWriter& VtuWriter::operator=(const VtuWriter& other)
+      {
+        encoding = other.encoding;
+        double_precision = other.double_precision;
+        compression_level = other.compression_level;
+        num_points = other.num_points;
+        num_cells = other.num_cells;
+        points = other.points;
+        connectivity = other.connectivity;
+        point_data = other.point_data;
+        cell_data = other.cell_data;
+        return *this;
+      }
+
+      VtuWriter::~VtuWriter()
+      {
+        if(stream != NULL)
+          fclose(stream);
+      }
+
+      void VtuWriter::set_encoding(VtuEncoding encoding)
+      {
+        this->encoding = encoding;
+      }
+
+      void VtuWriter::set_double_precision(bool double_precision)
+      {
+        this->double_precision = double_precision;
+      }
+
+      void VtuWriter::set_compression_level(int compression_level)
+      {
+        if(compression_level < 0 || compression_level > 9)
+          throw Hermes::Exceptions::ValueException("compression_level", compression_level, 0, 9);
+        if(compression_level > 0 && !compression_available())
+          throw Hermes::Exceptions::Exception("VTU compression requires Hermes built WITH_ZLIB.");
+        this->compression_level = compression_level;
+      }
+
+      bool VtuWriter::compression_available()
+      {
+#ifdef WITH_ZLIB
+        return true;
+#else
+        return false;
+#endif
+      }
+
+      VtuWriter::DataArray VtuWriter::make_array(const char* name, ArrayKind kind, const void* data, int stride, int num_components, int out_components, int count, int param) const
+      {
+        DataArray array;
+        array.name = name;
+        array.kind = kind;
+        array.data = data;
+        array.stride = stride;
+        array.num_components = num_components;
+        array.out_components = out_components;
+        array.count = count;
+        array.param = param;
+        return array;
+      }
+
+      void VtuWriter::set_points(int count, const double* coords, int stride, int dimension)
+      {
+        if(dimension != 2 && dimension != 3)
+          throw Hermes::Exceptions::ValueException("dimension", dimension, 2, 3);
+        num_points = count;
+        points = make_array("Points", ARRAY_DOUBLE, coords, stride, dimension, 3, count, 0);
+      }
+
+      void VtuWriter::set_cells(int count, const int* connectivity, int stride, int cell_size)
+      {
+        if(cell_size < 2 || cell_size > 4)
+          throw Hermes::Exceptions::ValueException("cell_size", cell_size, 2, 4);
+        num_cells = count;
+        this->connectivity = make_array("connectivity", ARRAY_INT, connectivity, stride, cell_size, cell_size, count, 0);
+      }
+
+      void VtuWriter::add_point_data(const char* name, const double* values, int stride, int num_components)
+      {
+        point_data.push_back(make_array(name, ARRAY_DOUBLE, values, stride, num_components, num_components == 2 ? 3 : num_components, -1, 0));
+      }
+
+      void VtuWriter::add_cell_data(const char* name, const double* values, int stride, int num_components)
+      {
+        cell_data.push_back(make_array(name, ARRAY_DOUBLE, values, stride, num_components, num_components == 2 ? 3 : num_components, -1, 0));
+      }
+
+      void VtuWriter::add_cell_data(const char* name, const int* values, int stride)
+      {
+        cell_data.push_back(make_array(name, ARRAY_INT, values, stride, 1, 1, -1, 0));
+      }
+
+      void VtuWriter::clear()
+      {
+        num_points = num_cells = 0;
+        points.data = connectivity.data = NULL;
+        point_data.clear();
+        cell_data.clear();
+      }
+
+      uint64_t VtuWriter::appended_size(const DataArray& array, const std::vector<char>* compressed) const
+      {
+        uint64_t header, data;
+        if(compressed != NULL)
+        {
+          uint64_t num_blocks = *(const uint64_t*) &(*compressed)[0];
+          header = (3 + num_blocks) * sizeof(uint64_t);
+          data = compressed->size() - header;
+        }
+        else
+        {
+          header = sizeof(uint64_t);
+          data = (uint64_t) array.count * array.out_components * array.component_size(double_precision);
+        }
+
+        if(encoding == HERMES_VTU_BASE64)
+          return base64_size(header) + base64_size(data);
+        return header + data;
+      }
+
+      void VtuWriter::compress_array(const DataArray& array, std::vector<char>& result)
+      {
+#ifdef WITH_ZLIB
+        int tuple_size = array.out_components * array.component_size(double_precision);
+        int block_tuples = std::max(1, VTU_BLOCK_SIZE / tuple_size);
+        uint64_t num_blocks = (array.count + block_tuples - 1) / block_tuples;
+        uint64_t last_tuples = array.count - (num_blocks > 0 ? (num_blocks - 1) * block_tuples : 0);
+
+        // Header: number of blocks, block size, size of the last block, compressed sizes of the blocks.
+        std::vector<uint64_t> header(3 + num_blocks);
+        header[0] = num_blocks;
+        header[1] = (uint64_t) block_tuples * tuple_size;
+        header[2] = num_blocks > 0 ? last_tuples * tuple_size : 0;
+
+        result.resize(header.size() * sizeof(uint64_t));
+        char* block = new char[block_tuples * tuple_size];
+        uLongf bound = compressBound(block_tuples * tuple_size);
+        for(uint64_t i = 0; i < num_blocks; i++)
+        {
+          int first = i * block_tuples;
+          int num = std::min(block_tuples, array.count - first);
+          array.fill(block, first, num, double_precision);
+
+          size_t offset = result.size();
+          result.resize(offset + bound);
+          uLongf compressed_size = bound;
+          if(compress2((Bytef*) &result[offset], &compressed_size, (const Bytef*) block, num * tuple_size, compression_level) != Z_OK)
+          {
+            delete [] block;
+            throw Hermes::Exceptions::Exception("Compression of VTU data failed.");
+          }
+          result.resize(offset + compressed_size);
+          header[3 + i] = compressed_size;
+        }
+        delete [] block;
+        memcpy(&result[0], &header[0], header.size() * sizeof(uint64_t));
+#else
+        // set_compression_level() does not allow compression without zlib.
+        result.clear();
+        throw Hermes::Exceptions::Exception("Compression of the VTU array %s requires Hermes built WITH_ZLIB.", array.name.c_str());
+#endif
+      }
+
+      void VtuWriter::write_array(Output& out, const DataArray& array, const std::vector<char>* compressed)
+      {
+        if(compressed != NULL)
+        {
+          uint64_t num_blocks = *(const uint64_t*) &(*compressed)[0];
+          size_t header = (3 + num_blocks) * sizeof(uint64_t);
+          out.put(&(*compressed)[0], header);
+          out.end_part();
+          if(compressed->size() > header)
+            out.put(&(*compressed)[header], compressed->size() - header);
+          out.end_part();
+          return;
+        }
+
+        int tuple_size = array.out_components * array.component_size(double_precision);
+        uint64_t size = (uint64_t) array.count * tuple_size;
+        out.put((const char*) &size, sizeof(uint64_t));
+        out.end_part();
+
+        char* chunk = new char[VTU_CHUNK_TUPLES * tuple_size];
+        for(int first = 0; first < array.count; first += VTU_CHUNK_TUPLES)
+        {
+          int num = std::min(VTU_CHUNK_TUPLES, array.count - first);
+          array.fill(chunk, first, num, double_precision);
+          out.put(chunk, (size_t) num * tuple_size);
+        }
+        delete [] chunk;
+        out.end_part();
+      }
+
+      void VtuWriter::collect_arrays(std::vector<DataArray>& arrays) const
+      {
+        for(unsigned int i = 0; i < point_data.size(); i++)
+        {
+          arrays.push_back(point_data[i]);
+          arrays.back().count = num_points;
+        }
+        for(unsigned int i = 0; i < cell_data.size(); i++)
+        {
+          arrays.push_back(cell_data[i]);
+          arrays.back().count = num_cells;
+        }
+        arrays.push_back(points);
+        arrays.push_back(connectivity);
+        arrays.push_back(make_array("offsets", ARRAY_OFFSETS, NULL, 0, 1, 1, num_cells, connectivity.num_components));
+        // VTK cell types: line, triangle, quad.
+        static const int cell_types[5] = { 0, 0, 3, 5, 9 };
+        arrays.push_back(make_array("types", ARRAY_TYPES, NULL, 0, 1, 1, num_cells, cell_types[connectivity.num_components]));
+      }
+
+      void VtuWriter::write(const char* filename)
+      {
+        if(points.data == NULL || connectivity.data == NULL)
+          throw Hermes::Exceptions::Exception("Points and cells have to be set before writing a VTU file.");
+
+        // The arrays in the order of the appended section.
+        std::vector<DataArray> arrays;
+        collect_arrays(arrays);
+
+        // Compressed arrays have to be prepared before the header, as their sizes determine the offsets.
+        std::vector<std::vector<char> > compressed(compression_level > 0 ? arrays.size() : 0);
+        for(unsigned int i = 0; i < compressed.size(); i++)
+          compress_array(arrays[i], compressed[i]);
+
+        std::vector<uint64_t> offsets(arrays.size());
+        uint64_t offset = 0;
+        for(unsigned int i = 0; i < arrays.size(); i++)
+        {
+          offsets[i] = offset;
+          offset += appended_size(arrays[i], compressed.empty() ? NULL : &compressed[i]);
+        }
+
+        FILE* f = fopen(filename, "wb");
+        if(f == NULL)
+          throw Hermes::Exceptions::Exception("Could not open %s for writing.", filename);
+
+        int one = 1;
+        fprintf(f, "<?xml version=\"1.0\"?>\n");
+        fprintf(f, "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\"%s>\n",
+          *(char*) &one ? "LittleEndian" : "BigEndian", compression_level > 0 ? " compressor=\"vtkZLibDataCompressor\"" : "");
+        fprintf(f, "  <UnstructuredGrid>\n");
+        fprintf(f, "    <Piece NumberOfPoints=\"%d\" NumberOfCells=\"%d\">\n", num_points, num_cells);
+
+        size_t a = 0;
+        const char* sections[4] = { "PointData", "CellData", "Points", "Cells" };
+        size_t section_end[4] = { point_data.size(), point_data.size() + cell_data.size(), arrays.size() - 3, arrays.size() };
+        for(int s = 0; s < 4; s++)
+        {
+          fprintf(f, "      <%s>\n", sections[s]);
+          // The connectivity is a flat array of point indices.
+          for(; a < section_end[s]; a++)
+          {
+            fprintf(f, "        <DataArray type=\"%s\" Name=\"%s\" NumberOfComponents=\"%d\" format=\"appended\" offset=\"%llu\"/>\n",
+              arrays[a].type_name(double_precision), arrays[a].name.c_str(), s == 3 ? 1 : arrays[a].out_components, (unsigned long long) offsets[a]);
+          }
+          fprintf(f, "      </%s>\n", sections[s]);
+        }
+
+        fprintf(f, "    </Piece>\n");
+        fprintf(f, "  </UnstructuredGrid>\n");
+        fprintf(f, "  <AppendedData encoding=\"%s\">\n_", encoding == HERMES_VTU_BASE64 ? "base64" : "raw");
+
+        try
+        {
+          Output out(f, encoding == HERMES_VTU_BASE64);
+          for(unsigned int i = 0; i < arrays.size(); i++)
+            write_array(out, arrays[i], compressed.empty() ? NULL : &compressed[i]);
+          out.flush();
+        }
+        catch(std::exception&)
+        {
+          fclose(f);
+          throw;
+        }
+
+        fprintf(f, "\n  </AppendedData>\n");
+        fprintf(f, "</VTKFile>\n");
+        fclose(f);
+      }
+
+      void VtuWriter::begin_pieces(const char* filename)
+      {
+        if(stream != NULL)
+          throw Hermes::Exceptions::Exception("VtuWriter::begin_pieces() called while another file is being written.");
+        stream = fopen(filename, "wb");
+        if(stream == NULL)
+          throw Hermes::Exceptions::Exception("Could not open %s for writing.", filename);
+
+        int one = 1;
+        fprintf(stream, "<?xml version=\"1.0\"?>\n");
+        fprintf(stream, "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\"%s>\n",
+          *(char*) &one ? "LittleEndian" : "BigEndian", compression_level > 0 ? " compressor=\"vtkZLibDataCompressor\"" : "");
+        fprintf(stream, "  <UnstructuredGrid>\n");
+      }
+
+      void VtuWriter::write_piece()
+      {
+        if(stream == NULL)
+          throw Hermes::Exceptions::Exception("VtuWriter::write_piece() called without begin_pieces().");
+        if(points.data == NULL || connectivity.data == NULL)
+          throw Hermes::Exceptions::Exception("Points and cells have to be set before writing a VTU file.");
+
+        std::vector<DataArray> arrays;
+        collect_arrays(arrays);
+
+        fprintf(stream, "    <Piece NumberOfPoints=\"%d\" NumberOfCells=\"%d\">\n", num_points, num_cells);
+
+        size_t a = 0;
+        const char* sections[4] = { "PointData", "CellData", "Points", "Cells" };
+        size_t section_end[4] = { point_data.size(), point_data.size() + cell_data.size(), arrays.size() - 3, arrays.size() };
+        Output out(stream, true);
+        for(int s = 0; s < 4; s++)
+        {
+          fprintf(stream, "      <%s>\n", sections[s]);
+          for(; a < section_end[s]; a++)
+          {
+            fprintf(stream, "        <DataArray type=\"%s\" Name=\"%s\" NumberOfComponents=\"%d\" format=\"binary\">\n",
+              arrays[a].type_name(double_precision), arrays[a].name.c_str(), s == 3 ? 1 : arrays[a].out_components);
+            if(compression_level > 0)
+            {
+              std::vector<char> compressed;
+              compress_array(arrays[a], compressed);
+              write_array(out, arrays[a], &compressed);
+            }
+            else
+              write_array(out, arrays[a], NULL);
+            out.flush();
+            fprintf(stream, "\n        </DataArray>\n");
+          }
+          fprintf(stream, "      </%s>\n", sections[s]);
+        }
+        fprintf(stream, "    </Piece>\n");
+      }
+
+      void VtuWriter::end_pieces()
+      {
+        if(stream == NULL)
+          throw Hermes::Exceptions::Exception("VtuWriter::end_pieces() called without begin_pieces().");
+        fprintf(stream, "  </UnstructuredGrid>\n");
+        fprintf(stream, "</VTKFile>\n");
+        int result = fclose(stream);
+        stream = NULL;
+        if(result != 0)
+          throw Hermes::Exceptions::Exception("Error writing a VTU file.");
+      }
+
+      PvdWriter::PvdWriter(const char* filename) : filename(filename)
+      {
+      }
+
+      void PvdWriter::add_dataset(double time, const char* vtu_filename, int part)
+      {
+        DataSet dataset;
+        dataset.time = time;
+        dataset.part = part;
+        dataset.file = vtu_filename;
+        datasets.push_back(dataset);
+        save();
+      }
+
+      void PvdWriter::save() const
+      {
+        FILE* f = fopen(filename.c_str(), "w");
+        if(f == NULL)
+          throw Hermes::Exceptions::Exception("Could not open %s for writing.", filename.c_str());
+
+        fprintf(f, "<?xml version=\"1.0\"?>\n");
+        fprintf(f, "<VTKFile type=\"Collection\" version=\"0.1\">\n");
+        fprintf(f, "  <Collection>\n");
+        for(unsigned int i = 0; i < datasets.size(); i++)
+          fprintf(f, "    <DataSet timestep=\"%.17g\" part=\"%d\" file=\"%s\"/>\n", datasets[i].time, datasets[i].part, datasets[i].file.c_str());
+        fprintf(f, "  </Collection>\n");
+        fprintf(f, "</VTKFile>\n");
+        fclose(f);
+      }
+    }
+  }
+}
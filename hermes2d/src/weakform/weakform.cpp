@@ -38,6 +38,21 @@ namespace Hermes
     {
       this->neq = neq;
       this->is_matfree = mat_free;
+      this->quad_2d = &g_quad_2d_std;
+    }
+
+    template<typename Scalar>
+    void WeakForm<Scalar>::set_quad_2d(Quad2D* quad_2d)
+    {
+      if(quad_2d == NULL)
+        throw Hermes::Exceptions::NullException(1);
+      this->quad_2d = quad_2d;
+    }
+
+    template<typename Scalar>
+    Quad2D* WeakForm<Scalar>::get_quad_2d() const
+    {
+      return this->quad_2d;
     }
 
     template<typename Scalar>
@@ -122,6 +137,7 @@ namespace Hermes
           newExt.push_back(otherWf->forms[i]->ext[ext_i]->clone());
         this->forms.back()->set_ext(newExt);
         this->forms.back()->wf = this;
+        this->forms.back()->quad_2d = otherWf->forms[i]->quad_2d;
 
         if(dynamic_cast<MatrixFormVol<Scalar>*>(otherWf->forms[i]) != NULL)
           this->mfvol.push_back(dynamic_cast<MatrixFormVol<Scalar>*>(this->forms.back()));
@@ -179,7 +195,7 @@ namespace Hermes
     }
 
     template<typename Scalar>
-    Form<Scalar>::Form() : scaling_factor(1.0), u_ext_offset(0), wf(NULL)
+    Form<Scalar>::Form() : scaling_factor(1.0), u_ext_offset(0), wf(NULL), quad_2d(NULL)
     {
       areas.push_back(HERMES_ANY);
       stage_time = 0.0;
@@ -226,6 +242,12 @@ namespace Hermes
       this->scaling_factor = scalingFactor;
     }
 
+    template<typename Scalar>
+    Quad2D* Form<Scalar>::get_quad_2d() const
+    {
+      return this->quad_2d;
+    }
+
     template<typename Scalar>
     void Form<Scalar>::set_uExtOffset(int u_ext_offset)
     {
@@ -301,6 +323,12 @@ namespace Hermes
       return this->sym;
     }
 
+    template<typename Scalar>
+    void MatrixFormVol<Scalar>::set_quad_2d(Quad2D* quad_2d)
+    {
+      this->quad_2d = quad_2d;
+    }
+
     template<typename Scalar>
     MatrixFormVol<Scalar>* MatrixFormVol<Scalar>::clone() const
     {
@@ -383,6 +411,12 @@ namespace Hermes
     {
     }
 
+    template<typename Scalar>
+    void VectorFormVol<Scalar>::set_quad_2d(Quad2D* quad_2d)
+    {
+      this->quad_2d = quad_2d;
+    }
+
     template<typename Scalar>
     Scalar VectorForm<Scalar>::value(int n, double *wt, Func<Scalar> *u_ext[], Func<double> *v,
       Geom<double> *e, Func<Scalar> **ext) const
@@ -0,0 +1,338 @@
+#define HERMES_REPORT_ALL
+#define HERMES_REPORT_FILE "application.log"
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Algebra;
+using namespace Hermes::Hermes2D;
+using namespace Hermes::Hermes2D::Views;
+
+// This test saves a mesh, a space, a solution and the matrix of the problem to the binary files
+// (see Hermes::BinaryFile), loads them back and compares them with the originals. It checks that
+// a corrupt header and a truncated file are refused, and that the VTU files of the solution
+// (plain and streamed) contain the linearization.
+//
+// PDE: Poisson equation -Laplace u = 1.
+//
+// Domain: Unit square with a triangle attached to its right side, refined with a hanging node.
+//
+// BC: Homogeneous Dirichlet.
+
+const int P_INIT = 3;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM = 2;                       // Number of initial uniform mesh refinements.
+const int CHUNK_SIZE = 7;                         // Number of elements in one piece of the streamed VTU file.
+
+static bool passed = true;
+
+static void check(bool condition, const char* what)
+{
+  if(!condition)
+  {
+    printf("Check failed: %s.\n", what);
+    passed = false;
+  }
+}
+
+static std::vector<char> read_file(const char* filename)
+{
+  std::vector<char> content;
+  FILE* f = fopen(filename, "rb");
+  if(f == NULL)
+    return content;
+  char buffer[4096];
+  size_t read;
+  while((read = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    content.insert(content.end(), buffer, buffer + read);
+  fclose(f);
+  return content;
+}
+
+static void write_file(const char* filename, const std::vector<char>& content, size_t size)
+{
+  FILE* f = fopen(filename, "wb");
+  if(size > 0)
+    fwrite(&content[0], 1, size, f);
+  fclose(f);
+}
+
+// Writes a copy of the file with a damaged header and a copy truncated in the middle.
+static void damage_file(const char* filename)
+{
+  std::vector<char> content = read_file(filename);
+  check(content.size() > BinaryFile::header_size, "binary file has data after the header");
+  std::string name(filename);
+  write_file((name + ".truncated").c_str(), content, content.size() / 2);
+  content[0] = 'X';
+  write_file((name + ".corrupt").c_str(), content, content.size());
+}
+
+static bool mesh_load_fails(const char* filename)
+{
+  try
+  {
+    Mesh mesh;
+    MeshReaderH2DBinary mloader;
+    mloader.load(filename, &mesh);
+  }
+  catch(std::exception&)
+  {
+    return true;
+  }
+  return false;
+}
+
+static bool space_load_fails(const char* filename, Mesh* mesh)
+{
+  try
+  {
+    delete Space<double>::load_binary(filename, mesh);
+  }
+  catch(std::exception&)
+  {
+    return true;
+  }
+  return false;
+}
+
+static bool solution_load_fails(const char* filename, Space<double>* space)
+{
+  try
+  {
+    Solution<double> sln;
+    sln.load_binary(filename, space);
+  }
+  catch(std::exception&)
+  {
+    return true;
+  }
+  return false;
+}
+
+static bool matrix_load_fails(const char* filename)
+{
+  try
+  {
+    UMFPackMatrix<double> mat;
+    mat.load_mmap(filename);
+  }
+  catch(std::exception&)
+  {
+    return true;
+  }
+  return false;
+}
+
+static double value_at(Solution<double>* sln, double x, double y)
+{
+  Func<double>* value = sln->get_pt_value(x, y);
+  double result = value->val[0];
+  value->free_fn();
+  delete value;
+  return result;
+}
+
+// Number of the vertices of the active elements.
+static int count_active_vertices(Mesh* mesh)
+{
+  std::set<int> vertices;
+  Element* e;
+  for_all_active_elements(e, mesh)
+    for(int i = 0; i < e->get_nvert(); i++)
+      vertices.insert(e->vn[i]->id);
+  return vertices.size();
+}
+
+// Values of the attribute (e.g. NumberOfPoints) of all pieces of a VTU file.
+static std::vector<int> vtu_piece_attributes(const std::vector<char>& content, const char* attribute)
+{
+  std::vector<int> values;
+  std::string text(content.begin(), content.end());
+  std::string pattern = std::string(attribute) + "=\"";
+  for(size_t position = text.find("<Piece "); position != std::string::npos; position = text.find("<Piece ", position + 1))
+  {
+    size_t start = text.find(pattern, position);
+    if(start != std::string::npos)
+      values.push_back(atoi(text.c_str() + start + pattern.size()));
+  }
+  return values;
+}
+
+// Sizes of the pieces and the area they cover.
+class PieceStatistics : public LinearizerOutput
+{
+public:
+  PieceStatistics() : area(0.0) {}
+
+  virtual void write_piece(const double3* verts, int vertex_count, const int3* tris, const int* tri_markers, int triangle_count)
+  {
+    vertex_counts.push_back(vertex_count);
+    triangle_counts.push_back(triangle_count);
+    for(int i = 0; i < triangle_count; i++)
+    {
+      const double3 &a = verts[tris[i][0]], &b = verts[tris[i][1]], &c = verts[tris[i][2]];
+      area += fabs((b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0])) / 2;
+    }
+  }
+
+  std::vector<int> vertex_counts, triangle_counts;
+  double area;
+};
+
+int main(int argc, char* argv[])
+{
+  // Create the mesh.
+  double2 vertices[5] = { { 0.0, 0.0 }, { 1.0, 0.0 }, { 1.0, 1.0 }, { 0.0, 1.0 }, { 2.0, 0.5 } };
+  int4 quads[1] = { { 0, 1, 2, 3 } };
+  int3 triangles[1] = { { 1, 4, 2 } };
+  std::string quad_markers[1] = { "Square" }, triangle_markers[1] = { "Triangle" };
+  int2 boundary_edges[5] = { { 0, 1 }, { 1, 4 }, { 4, 2 }, { 2, 3 }, { 3, 0 } };
+  std::string boundary_markers[5] = { "Bdy", "Bdy", "Bdy", "Bdy", "Bdy" };
+  Mesh mesh;
+  mesh.create(5, vertices, 1, triangles, triangle_markers, 1, quads, quad_markers, 5, boundary_edges, boundary_markers);
+
+  // Refine all elements, then one more to get hanging nodes (and a refinement history to reproduce).
+  for(int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements();
+  Element* e;
+  for_all_active_elements(e, &mesh)
+  {
+    if(e->is_quad() && e->vn[0]->x > 0.4 && e->vn[0]->y > 0.4)
+    {
+      mesh.refine_element_id(e->id);
+      break;
+    }
+  }
+
+  // Solve the problem, with orders varying over the elements.
+  DefaultEssentialBCConst<double> bc_essential("Bdy", 0.0);
+  EssentialBCs<double> bcs(&bc_essential);
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  int i = 0;
+  for_all_active_elements(e, &mesh)
+    space.set_element_order(e->id, i++ % 3 + 2);
+  space.assign_dofs();
+
+  Hermes1DFunction<double> lambda(1.0);
+  Hermes2DFunction<double> src(-1.0);
+  WeakFormsH1::DefaultWeakFormPoisson<double> wf(HERMES_ANY, &lambda, &src);
+  DiscreteProblem<double> dp(&wf, &space);
+  UMFPackMatrix<double> matrix;
+  UMFPackVector<double> rhs;
+  dp.assemble(&matrix, &rhs);
+  UMFPackLinearMatrixSolver<double> solver(&matrix, &rhs);
+  solver.solve();
+  Solution<double> sln;
+  Solution<double>::vector_to_solution(solver.get_sln_vector(), &space, &sln);
+  int ndof = space.get_num_dofs();
+
+  // Mesh.
+  MeshReaderH2DBinary mloader;
+  mloader.save("mesh.h2db", &mesh);
+  Mesh loaded_mesh;
+  mloader.load("mesh.h2db", &loaded_mesh);
+  check(loaded_mesh.get_num_elements() == mesh.get_num_elements(), "number of elements of the loaded mesh");
+  check(loaded_mesh.get_num_active_elements() == mesh.get_num_active_elements(), "number of active elements of the loaded mesh");
+  check(count_active_vertices(&loaded_mesh) == count_active_vertices(&mesh), "number of vertices of the loaded mesh");
+  check(loaded_mesh.get_max_element_id() == mesh.get_max_element_id(), "element ids of the loaded mesh");
+  // the vertex ids may differ, the refinements are repeated one by one
+  for_all_active_elements(e, &mesh)
+  {
+    Element* loaded = loaded_mesh.get_element(e->id);
+    bool same = loaded->active && loaded->get_nvert() == e->get_nvert() && loaded->marker == e->marker;
+    for(int j = 0; same && j < e->get_nvert(); j++)
+      same = loaded->vn[j]->x == e->vn[j]->x && loaded->vn[j]->y == e->vn[j]->y;
+    check(same, "elements of the loaded mesh");
+  }
+
+  // Space.
+  space.save_binary("space.h2db");
+  Space<double>* loaded_space = Space<double>::load_binary("space.h2db", &loaded_mesh, &bcs);
+  check(loaded_space->get_num_dofs() == ndof, "number of DOFs of the loaded space");
+  for_all_active_elements(e, &mesh)
+    check(loaded_space->get_element_order(e->id) == space.get_element_order(e->id), "element orders of the loaded space");
+
+  // Solution.
+  sln.save_binary("sln.h2db");
+  Solution<double> loaded_sln;
+  loaded_sln.load_binary("sln.h2db", loaded_space);
+  for_all_active_elements(e, &mesh)
+  {
+    // the element center and a point near the first vertex
+    double x = 0.0, y = 0.0;
+    for(int j = 0; j < e->get_nvert(); j++)
+    {
+      x += e->vn[j]->x / e->get_nvert();
+      y += e->vn[j]->y / e->get_nvert();
+    }
+    check(fabs(value_at(&loaded_sln, x, y) - value_at(&sln, x, y)) < 1e-12, "values of the loaded solution");
+    x = 0.9 * e->vn[0]->x + 0.1 * x;
+    y = 0.9 * e->vn[0]->y + 0.1 * y;
+    check(fabs(value_at(&loaded_sln, x, y) - value_at(&sln, x, y)) < 1e-12, "values of the loaded solution");
+  }
+
+  // Matrix, mapped by load_mmap(), solved again.
+  matrix.save_binary("matrix.csc", &rhs);
+  UMFPackMatrix<double> loaded_matrix;
+  UMFPackVector<double> loaded_rhs;
+  loaded_matrix.load_mmap("matrix.csc", &loaded_rhs);
+  check(loaded_matrix.get_size() == matrix.get_size() && loaded_matrix.get_nnz() == matrix.get_nnz(), "size of the loaded matrix");
+  if(loaded_matrix.get_size() == matrix.get_size() && loaded_matrix.get_nnz() == matrix.get_nnz())
+  {
+    unsigned int size = matrix.get_size(), nnz = matrix.get_nnz();
+    check(memcmp(loaded_matrix.get_Ap(), matrix.get_Ap(), (size + 1) * sizeof(int)) == 0
+      && memcmp(loaded_matrix.get_Ai(), matrix.get_Ai(), nnz * sizeof(int)) == 0
+      && memcmp(loaded_matrix.get_Ax(), matrix.get_Ax(), nnz * sizeof(double)) == 0, "arrays of the loaded matrix");
+    bool same_rhs = loaded_rhs.length() == rhs.length();
+    for(unsigned int j = 0; same_rhs && j < rhs.length(); j++)
+      same_rhs = loaded_rhs.get(j) == rhs.get(j);
+    check(same_rhs, "right-hand side of the loaded matrix");
+
+    UMFPackLinearMatrixSolver<double> loaded_solver(&loaded_matrix, &loaded_rhs);
+    loaded_solver.solve();
+    bool same_sln = true;
+    for(int j = 0; j < ndof; j++)
+      same_sln = same_sln && fabs(loaded_solver.get_sln_vector()[j] - solver.get_sln_vector()[j]) < 1e-12;
+    check(same_sln, "solution of the loaded matrix");
+  }
+
+  // Damaged files.
+  damage_file("mesh.h2db");
+  damage_file("space.h2db");
+  damage_file("sln.h2db");
+  damage_file("matrix.csc");
+  check(mesh_load_fails("mesh.h2db.corrupt") && mesh_load_fails("mesh.h2db.truncated"), "damaged mesh files refused");
+  check(space_load_fails("space.h2db.corrupt", &loaded_mesh) && space_load_fails("space.h2db.truncated", &loaded_mesh), "damaged space files refused");
+  check(solution_load_fails("sln.h2db.corrupt", loaded_space) && solution_load_fails("sln.h2db.truncated", loaded_space), "damaged solution files refused");
+  check(matrix_load_fails("matrix.csc.corrupt") && matrix_load_fails("matrix.csc.truncated"), "damaged matrix files refused");
+  check(mesh_load_fails("sln.h2db") && matrix_load_fails("mesh.h2db"), "files of other types refused");
+
+  // VTU files.
+  Linearizer lin;
+  lin.save_solution_vtu(&sln, "sln.vtu", "u");
+  std::vector<char> vtu = read_file("sln.vtu");
+  std::vector<int> points = vtu_piece_attributes(vtu, "NumberOfPoints"), cells = vtu_piece_attributes(vtu, "NumberOfCells");
+  check(points.size() == 1 && points[0] == lin.get_num_vertices() && cells.size() == 1 && cells[0] == lin.get_num_triangles(), "size of the VTU file");
+
+  PieceStatistics statistics;
+  lin.process_solution_streamed(&sln, &statistics, H2D_FN_VAL_0, HERMES_EPS_NORMAL, CHUNK_SIZE);
+  check(statistics.vertex_counts.size() > 1, "more pieces of the streamed linearization");
+  check(fabs(statistics.area - 1.5) < 1e-12, "area covered by the streamed linearization");
+  lin.save_solution_vtu_streamed(&sln, "sln_streamed.vtu", "u", true, H2D_FN_VAL_0, HERMES_EPS_NORMAL, VtuWriter(), CHUNK_SIZE);
+  vtu = read_file("sln_streamed.vtu");
+  check(vtu_piece_attributes(vtu, "NumberOfPoints") == statistics.vertex_counts
+    && vtu_piece_attributes(vtu, "NumberOfCells") == statistics.triangle_counts, "pieces of the streamed VTU file");
+  check(std::string(vtu.begin(), vtu.end()).find("</VTKFile>") != std::string::npos, "end of the streamed VTU file");
+
+  delete loaded_space;
+
+  if(passed)
+  {
+    printf("Success!\n");
+    return 0;
+  }
+  else
+  {
+    printf("Failure!\n");
+    return -1;
+  }
+}
@@ -136,6 +136,28 @@ namespace Hermes
         return item;
       }
 
+      /// Appends 'count' new items at the end of the array, regardless of
+      /// the unused items. The new items therefore get consecutive ids, which
+      /// is what bulk operations (e.g. uniform mesh refinement) rely on.
+      /// \return The id of the first appended item.
+      int append(int count)
+      {
+        int first = size;
+        for (int i = 0; i < count; i++)
+        {
+          if (!(size & HERMES_PAGE_MASK))
+          {
+            TYPE* new_page = new TYPE[HERMES_PAGE_SIZE];
+            pages.push_back(new_page);
+          }
+          TYPE* item = pages[size >> HERMES_PAGE_BITS] + (size & HERMES_PAGE_MASK);
+          item->id = size++;
+          item->used = 1;
+        }
+        nitems += count;
+        return first;
+      }
+
       /// Removes the given item from the array, ie., marks it as unused.
       /// Note that the array is never physically shrinked. This should not
       /// be a problem, since meshes tend to grow rather than become smaller.
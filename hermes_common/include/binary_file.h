@@ -0,0 +1,178 @@
+// This file is part of HermesCommon
+//
+// Hermes is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes; if not, see <http://www.gnu.prg/licenses/>.
+/*! \file binary_file.h
+\brief Versioned binary files of raw little-endian arrays, read through a memory mapping.
+*/
+#ifndef __HERMES_COMMON_BINARY_FILE_H
+#define __HERMES_COMMON_BINARY_FILE_H
+
+#include "common.h"
+#include "exceptions.h"
+
+namespace Hermes
+{
+  /// Layout of the binary files:
+  /// - header: magic "HERMESBF" (8 bytes), type tag (8 bytes, e.g. "MESH"), format version (uint32),
+  ///   byte order mark 0x01020304 (uint32),
+  /// - a sequence of arrays, each one is the number of items (uint64), the item size in bytes (uint32),
+  ///   a reserved uint32, the raw items and zero padding to a multiple of 8 bytes.
+  /// The layout of the sequence is given by the type tag and the version. All items are stored in the
+  /// little-endian byte order of the supported platforms, so that reading is a plain memory copy
+  /// (or no copy at all, see BinaryFileReader::read_array()) without any per-value parsing.
+  namespace BinaryFile
+  {
+    /// Size of the header.
+    const unsigned int header_size = 24;
+    /// Size of the header of an array.
+    const unsigned int array_header_size = 16;
+  }
+
+  /// Writer of a binary file, see BinaryFile for the layout.
+  /// Typical usage:
+  /// BinaryFileWriter writer("mesh.bin", "MESH", 1);
+  /// writer.write_value(nvert);
+  /// writer.write_array(coords, 2 * nvert);
+  /// writer.close();
+  class HERMES_API BinaryFileWriter
+  {
+  public:
+    /// Opens the file and writes the header.
+    /// \param[in] type Type tag, at most 8 characters.
+    /// \param[in] version Version of the layout of the given type.
+    BinaryFileWriter(const char* filename, const char* type, unsigned int version);
+    /// Writes the header and all the arrays to the end of image instead of a file, the image can be
+    /// written to a file later, e.g. by a background thread, the result is identical to writing the file directly.
+    BinaryFileWriter(std::vector<char>& image, const char* type, unsigned int version);
+    /// Closes the file if close() has not been called.
+    ~BinaryFileWriter();
+
+    /// Writes an array of count items.
+    template<typename T>
+    void write_array(const T* data, uint64_t count)
+    {
+      this->write_raw(data, count, sizeof(T));
+    }
+
+    /// Writes an array of one item.
+    template<typename T>
+    void write_value(const T& value)
+    {
+      this->write_raw(&value, 1, sizeof(T));
+    }
+
+    /// Writes a string as an array of chars.
+    void write_string(const std::string& value);
+
+    /// Flushes and closes the file, throws on a write error.
+    void close();
+
+  protected:
+    void write_header(const char* type, unsigned int version);
+    void write_raw(const void* data, uint64_t count, unsigned int item_size);
+    void write_bytes(const void* data, size_t bytes);
+    void check(bool ok);
+
+    FILE* file;
+    std::string filename;
+    /// Target of the writer created with an image, NULL otherwise.
+    std::vector<char>* image;
+  };
+
+  /// Read-only memory mapping of a whole file.
+  class HERMES_API MappedFile
+  {
+  public:
+    /// Maps the file, throws if it can not be opened.
+    /// \param[in] copy_on_write The mapped data may be written to, the changes are private to the mapping
+    /// (the pages are copied when written to) and never get to the file.
+    MappedFile(const char* filename, bool copy_on_write = false);
+    /// Unmaps the file.
+    ~MappedFile();
+
+    const char* get_data() const { return this->data; }
+    uint64_t get_size() const { return this->size; }
+
+  protected:
+    const char* data;
+    uint64_t size;
+#ifdef WIN32
+    void* file_handle;
+    void* mapping_handle;
+#else
+    int fd;
+#endif
+
+  private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+  };
+
+  /// Reader of a binary file written by BinaryFileWriter, the arrays have to be read in the order they were written.
+  /// The file is memory-mapped, read_array() returns pointers right into the mapping, valid until the reader is destroyed.
+  class HERMES_API BinaryFileReader
+  {
+  public:
+    /// Maps the file and checks the header.
+    /// \param[in] type Expected type tag.
+    /// \param[in] max_version Newest version of the layout the caller understands.
+    /// \param[in] copy_on_write See MappedFile, the arrays returned by read_array() may then be written to.
+    BinaryFileReader(const char* filename, const char* type, unsigned int max_version, bool copy_on_write = false);
+
+    /// Version of the layout the file was written with.
+    unsigned int get_version() const { return this->version; }
+
+    /// Returns the next array.
+    /// \param[out] count Number of items.
+    template<typename T>
+    const T* read_array(uint64_t& count)
+    {
+      return (const T*)this->read_raw(count, sizeof(T));
+    }
+
+    /// Copies the next array to data, it has to have exactly count items.
+    template<typename T>
+    void read_array(T* data, uint64_t count)
+    {
+      uint64_t file_count;
+      const void* file_data = this->read_raw(file_count, sizeof(T));
+      if(file_count != count)
+        throw Hermes::Exceptions::Exception("%s: array of %llu items expected, %llu found.", this->filename.c_str(), (unsigned long long)count, (unsigned long long)file_count);
+      if(count > 0)
+        memcpy(data, file_data, count * sizeof(T));
+    }
+
+    /// Reads the next array of one item.
+    template<typename T>
+    T read_value()
+    {
+      T value;
+      this->read_array(&value, 1);
+      return value;
+    }
+
+    /// Reads the next array of chars.
+    std::string read_string();
+
+  protected:
+    const void* read_raw(uint64_t& count, unsigned int item_size);
+
+    MappedFile file;
+    std::string filename;
+    unsigned int version;
+    /// Offset of the next array.
+    uint64_t position;
+  };
+}
+#endif
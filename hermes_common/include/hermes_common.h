@@ -38,6 +38,7 @@
 #include "compat.h"
 #include "callstack.h"
 #include "vector.h"
+#include "binary_file.h"
 #include "tables.h"
 #include "array.h"
 #include "qsort.h"
@@ -273,7 +273,10 @@ namespace Hermes
       /// \brief Hermes binary format
       ///
       DF_HERMES_BIN,
-      DF_MATRIX_MARKET ///< Matrix Market which can be read by pysparse library
+      DF_MATRIX_MARKET, ///< Matrix Market which can be read by pysparse library
+      /// \brief Binary CSC container (CSC matrices only)
+      /// see CSCMatrix::save_binary() for the layout, can be loaded by CSCMatrix::load_mmap()
+      DF_HERMES_CSC
     };
 
     /// \brief General (abstract) matrix representation in Hermes.
@@ -364,6 +367,24 @@ namespace Hermes
       /// @param[in] col  - column index
       virtual void pre_add_ij(unsigned int row, unsigned int col);
 
+      /// Gathers the indices added by pre_add_ij() in the compressed column form: the sorted
+      /// row indices of column i are row_idx[col_ptr[i]], ..., row_idx[col_ptr[i + 1] - 1].
+      /// The gathered indices are released, the matrix is then allocated by alloc_with_structure().
+      ///
+      /// @param[out] col_ptr - start of each column in row_idx (size + 1 items), allocated by new[]
+      /// @param[out] row_idx - row indices, allocated by new[]
+      void extract_structure(int*& col_ptr, int*& row_idx);
+
+      /// Allocates the matrix with a known structure, instead of the sequence
+      /// prealloc(), pre_add_ij(), alloc(). The default implementation feeds the
+      /// structure through this sequence, formats that store the structure in the
+      /// compressed column form copy it directly.
+      ///
+      /// @param[in] n       - number of unknowns
+      /// @param[in] col_ptr - start of each column in row_idx (n + 1 items)
+      /// @param[in] row_idx - sorted row indices of each column
+      virtual void alloc_with_structure(unsigned int n, const int* col_ptr, const int* row_idx);
+
       /// Finish manipulation with matrix (called before solving)
       virtual void finish() { }
 
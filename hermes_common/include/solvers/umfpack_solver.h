@@ -25,6 +25,7 @@
 #ifdef WITH_UMFPACK
 #include "linear_matrix_solver.h"
 #include "matrix.h"
+#include "binary_file.h"
 
 using namespace Hermes::Algebra;
 
@@ -62,6 +63,7 @@ namespace Hermes
       CSCMatrix(unsigned int size);
       virtual ~CSCMatrix();
       virtual void alloc();
+      virtual void alloc_with_structure(unsigned int n, const int* col_ptr, const int* row_idx);
       virtual void free();
       virtual Scalar get(unsigned int m, unsigned int n);
       virtual void zero();
@@ -103,7 +105,26 @@ namespace Hermes
       /// @return pointer to #Ax
       Scalar *get_Ax();
 
+      /// Saves the matrix and optionally the right-hand side to a binary CSC container, a Hermes::BinaryFile
+      /// of type "CSC" holding the arrays: size of Scalar (uint32), matrix size (uint32), #Ap (size + 1 ints),
+      /// #Ai (nnz ints), #Ax (nnz Scalars), right-hand side (size Scalars, empty if there is none).
+      /// dump() with DF_HERMES_CSC writes the same container without the right-hand side.
+      void save_binary(const char* filename, Vector<Scalar>* rhs = NULL);
+
+      /// Loads a matrix saved by save_binary(). The file is memory-mapped (copy-on-write) and #Ap, #Ai, #Ax
+      /// point right into the mapping, nothing is copied or parsed. The mapping is released by free().
+      /// @param[out] rhs If not NULL, the right-hand side stored in the file is copied to it.
+      void load_mmap(const char* filename, Vector<Scalar>* rhs = NULL);
+
+      /// Version of the layout written by save_binary().
+      static const unsigned int binary_format_version = 1;
+
     protected:
+      /// Writes the binary CSC container, rhs may be NULL.
+      void write_binary(BinaryFileWriter& writer, const Scalar* rhs);
+      /// dump() with DF_HERMES_CSC.
+      void dump_binary(FILE* file);
+
       // UMFPack specific data structures for storing the system matrix (CSC format).
       /// Matrix entries (column-wise).
       Scalar *Ax;
@@ -113,6 +134,8 @@ namespace Hermes
       int *Ap;
       /// Number of non-zero entries ( =  Ap[size]).
       unsigned int nnz;
+      /// The file #Ap, #Ai and #Ax are mapped from by load_mmap(), NULL if they are allocated.
+      BinaryFileReader* mapped_file;
       template <typename T> friend class Hermes::Solvers::UMFPackLinearMatrixSolver;
       template <typename T> friend class Hermes::Solvers::UMFPackIterator;
       template<typename T> friend SparseMatrix<T>*  create_matrix();
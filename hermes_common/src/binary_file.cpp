@@ -0,0 +1,257 @@
+// This file is part of HermesCommon
+//
+// Hermes is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes; if not, see <http://www.gnu.prg/licenses/>.
+#include "binary_file.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Hermes
+{
+  static const char binary_file_magic[8] = { 'H', 'E', 'R', 'M', 'E', 'S', 'B', 'F' };
+  static const uint32_t binary_file_byte_order_mark = 0x01020304;
+
+  static bool little_endian_host()
+  {
+    uint32_t mark = binary_file_byte_order_mark;
+    return *((unsigned char*)&mark) == 0x04;
+  }
+
+  static void make_type_tag(const char* type, char* tag)
+  {
+    if(strlen(type) > 8)
+      throw Hermes::Exceptions::Exception("Binary file type tag '%s' is longer than 8 characters.", type);
+    memset(tag, 0, 8);
+    memcpy(tag, type, strlen(type));
+  }
+
+  BinaryFileWriter::BinaryFileWriter(const char* filename, const char* type, unsigned int version) : file(NULL), filename(filename), image(NULL)
+  {
+    if(!little_endian_host())
+      throw Hermes::Exceptions::Exception("Binary files are only supported on little-endian platforms.");
+
+    this->file = fopen(filename, "wb");
+    if(this->file == NULL)
+      throw Hermes::Exceptions::Exception("Could not open %s for writing.", filename);
+
+    this->write_header(type, version);
+  }
+
+  BinaryFileWriter::BinaryFileWriter(std::vector<char>& image, const char* type, unsigned int version) : file(NULL), filename("memory image"), image(&image)
+  {
+    if(!little_endian_host())
+      throw Hermes::Exceptions::Exception("Binary files are only supported on little-endian platforms.");
+
+    this->write_header(type, version);
+  }
+
+  void BinaryFileWriter::write_header(const char* type, unsigned int version)
+  {
+    char tag[8];
+    make_type_tag(type, tag);
+
+    uint32_t version_value = version;
+    this->write_bytes(binary_file_magic, 8);
+    this->write_bytes(tag, 8);
+    this->write_bytes(&version_value, sizeof(uint32_t));
+    this->write_bytes(&binary_file_byte_order_mark, sizeof(uint32_t));
+  }
+
+  BinaryFileWriter::~BinaryFileWriter()
+  {
+    if(this->file != NULL)
+      fclose(this->file);
+  }
+
+  void BinaryFileWriter::check(bool ok)
+  {
+    if(!ok)
+    {
+      if(this->file != NULL)
+        fclose(this->file);
+      this->file = NULL;
+      throw Hermes::Exceptions::Exception("Error writing %s.", this->filename.c_str());
+    }
+  }
+
+  void BinaryFileWriter::write_bytes(const void* data, size_t bytes)
+  {
+    if(this->image != NULL)
+      this->image->insert(this->image->end(), (const char*)data, (const char*)data + bytes);
+    else
+      check(fwrite(data, 1, bytes, this->file) == bytes);
+  }
+
+  void BinaryFileWriter::write_raw(const void* data, uint64_t count, unsigned int item_size)
+  {
+    if(this->file == NULL && this->image == NULL)
+      throw Hermes::Exceptions::Exception("Binary file %s has already been closed.", this->filename.c_str());
+
+    uint32_t header[4];
+    memcpy(header, &count, sizeof(uint64_t));
+    header[2] = item_size;
+    header[3] = 0;
+    this->write_bytes(header, 4 * sizeof(uint32_t));
+
+    uint64_t bytes = count * item_size;
+    if(bytes > 0)
+      this->write_bytes(data, (size_t)bytes);
+
+    static const char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    if(bytes % 8)
+      this->write_bytes(padding, (size_t)(8 - bytes % 8));
+  }
+
+  void BinaryFileWriter::write_string(const std::string& value)
+  {
+    this->write_raw(value.c_str(), value.length(), 1);
+  }
+
+  void BinaryFileWriter::close()
+  {
+    if(this->file == NULL)
+      return;
+    bool ok = (fflush(this->file) == 0);
+    ok = (fclose(this->file) == 0) && ok;
+    this->file = NULL;
+    if(!ok)
+      throw Hermes::Exceptions::Exception("Error writing %s.", this->filename.c_str());
+  }
+
+#ifdef WIN32
+  MappedFile::MappedFile(const char* filename, bool copy_on_write) : data(NULL), size(0), file_handle(INVALID_HANDLE_VALUE), mapping_handle(NULL)
+  {
+    this->file_handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(this->file_handle == INVALID_HANDLE_VALUE)
+      throw Hermes::Exceptions::Exception("Could not open %s.", filename);
+
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(this->file_handle, &file_size);
+    this->size = file_size.QuadPart;
+    if(this->size == 0)
+      return;
+
+    this->mapping_handle = CreateFileMappingA(this->file_handle, NULL, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+    if(this->mapping_handle != NULL)
+      this->data = (const char*)MapViewOfFile(this->mapping_handle, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+    if(this->data == NULL)
+    {
+      if(this->mapping_handle != NULL)
+        CloseHandle(this->mapping_handle);
+      CloseHandle(this->file_handle);
+      throw Hermes::Exceptions::Exception("Could not map %s.", filename);
+    }
+  }
+
+  MappedFile::~MappedFile()
+  {
+    if(this->data != NULL)
+      UnmapViewOfFile(this->data);
+    if(this->mapping_handle != NULL)
+      CloseHandle(this->mapping_handle);
+    CloseHandle(this->file_handle);
+  }
+#else
+  MappedFile::MappedFile(const char* filename, bool copy_on_write) : data(NULL), size(0), fd(-1)
+  {
+    this->fd = open(filename, O_RDONLY);
+    if(this->fd < 0)
+      throw Hermes::Exceptions::Exception("Could not open %s.", filename);
+
+    struct stat file_stat;
+    if(fstat(this->fd, &file_stat) != 0)
+    {
+      ::close(this->fd);
+      throw Hermes::Exceptions::Exception("Could not read the size of %s.", filename);
+    }
+    this->size = file_stat.st_size;
+    if(this->size == 0)
+      return;
+
+    void* mapping = mmap(NULL, (size_t)this->size, copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, this->fd, 0);
+    if(mapping == MAP_FAILED)
+    {
+      ::close(this->fd);
+      throw Hermes::Exceptions::Exception("Could not map %s.", filename);
+    }
+    this->data = (const char*)mapping;
+  }
+
+  MappedFile::~MappedFile()
+  {
+    if(this->data != NULL)
+      munmap((void*)this->data, (size_t)this->size);
+    ::close(this->fd);
+  }
+#endif
+
+  BinaryFileReader::BinaryFileReader(const char* filename, const char* type, unsigned int max_version, bool copy_on_write) : file(filename, copy_on_write), filename(filename), version(0), position(BinaryFile::header_size)
+  {
+    if(!little_endian_host())
+      throw Hermes::Exceptions::Exception("Binary files are only supported on little-endian platforms.");
+
+    const char* data = this->file.get_data();
+    if(this->file.get_size() < BinaryFile::header_size || memcmp(data, binary_file_magic, 8) != 0)
+      throw Hermes::Exceptions::Exception("%s is not a Hermes binary file.", filename);
+
+    char tag[8];
+    make_type_tag(type, tag);
+    if(memcmp(data + 8, tag, 8) != 0)
+      throw Hermes::Exceptions::Exception("%s does not contain data of type %s.", filename, type);
+
+    uint32_t byte_order_mark;
+    memcpy(&this->version, data + 16, sizeof(uint32_t));
+    memcpy(&byte_order_mark, data + 20, sizeof(uint32_t));
+    if(byte_order_mark != binary_file_byte_order_mark)
+      throw Hermes::Exceptions::Exception("%s has an unsupported byte order.", filename);
+    if(this->version > max_version)
+      throw Hermes::Exceptions::Exception("%s has version %u, only versions up to %u are supported.", filename, this->version, max_version);
+  }
+
+  const void* BinaryFileReader::read_raw(uint64_t& count, unsigned int item_size)
+  {
+    if(this->position + BinaryFile::array_header_size > this->file.get_size())
+      throw Hermes::Exceptions::Exception("%s is truncated.", this->filename.c_str());
+
+    const char* header = this->file.get_data() + this->position;
+    uint32_t file_item_size;
+    memcpy(&count, header, sizeof(uint64_t));
+    memcpy(&file_item_size, header + 8, sizeof(uint32_t));
+    if(file_item_size != item_size)
+      throw Hermes::Exceptions::Exception("%s: item size %u expected, %u found.", this->filename.c_str(), item_size, file_item_size);
+
+    uint64_t bytes = count * item_size;
+    if(bytes / item_size != count || this->position + BinaryFile::array_header_size + bytes > this->file.get_size())
+      throw Hermes::Exceptions::Exception("%s is truncated.", this->filename.c_str());
+
+    this->position += BinaryFile::array_header_size + bytes;
+    if(this->position % 8)
+      this->position += 8 - this->position % 8;
+
+    return header + BinaryFile::array_header_size;
+  }
+
+  std::string BinaryFileReader::read_string()
+  {
+    uint64_t length;
+    const char* chars = this->read_array<char>(length);
+    return std::string(chars, (size_t)length);
+  }
+}
@@ -275,15 +275,11 @@ namespace Hermes
 
     MeshLoadFailureException::MeshLoadFailureException(const char * reason, ...) : Exception()
     {
-      char * text = new char[strlen(reason)+1];
-
-      // print the message
+      // print the message (into the buffer allocated by Exception())
       va_list arglist;
       va_start(arglist, reason);
-      vsprintf(text, reason, arglist);
+      vsnprintf(message, 1000, reason, arglist);
       va_end(arglist);
-
-      message = text;
     }
 
     MeshLoadFailureException::MeshLoadFailureException(const MeshLoadFailureException&e)
@@ -300,15 +296,11 @@ namespace Hermes
 
     SpaceLoadFailureException::SpaceLoadFailureException(const char * reason, ...) : Exception()
     {
-      char * text = new char[strlen(reason)+1];
-
-      // print the message
+      // print the message (into the buffer allocated by Exception())
       va_list arglist;
       va_start(arglist, reason);
-      vsprintf(text, reason, arglist);
+      vsnprintf(message, 1000, reason, arglist);
       va_end(arglist);
-
-      message = text;
     }
 
     SpaceLoadFailureException::SpaceLoadFailureException(const SpaceLoadFailureException&e)
@@ -325,15 +317,11 @@ namespace Hermes
 
     SolutionSaveFailureException::SolutionSaveFailureException(const char * reason, ...) : Exception()
     {
-      char * text = new char[strlen(reason)+1];
-
-      // print the message
+      // print the message (into the buffer allocated by Exception())
       va_list arglist;
       va_start(arglist, reason);
-      vsprintf(text, reason, arglist);
+      vsnprintf(message, 1000, reason, arglist);
       va_end(arglist);
-
-      message = text;
     }
 
     SolutionSaveFailureException::SolutionSaveFailureException(const SolutionSaveFailureException&e)
@@ -350,15 +338,11 @@ namespace Hermes
 
     SolutionLoadFailureException::SolutionLoadFailureException(const char * reason, ...) : Exception()
     {
-      char * text = new char[strlen(reason)+1];
-
-      // print the message
+      // print the message (into the buffer allocated by Exception())
       va_list arglist;
       va_start(arglist, reason);
-      vsprintf(text, reason, arglist);
+      vsnprintf(message, 1000, reason, arglist);
       va_end(arglist);
-
-      message = text;
     }
 
     SolutionLoadFailureException::SolutionLoadFailureException(const SolutionLoadFailureException&e)
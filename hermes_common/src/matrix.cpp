@@ -193,6 +193,38 @@ int Hermes::Algebra::SparseMatrix<Scalar>::sort_and_store_indices(Page *page, in
   return q - buffer;
 }
 
+template<typename Scalar>
+void Hermes::Algebra::SparseMatrix<Scalar>::extract_structure(int*& col_ptr, int*& row_idx)
+{
+  assert(this->pages != NULL);
+
+  col_ptr = new int[this->size + 1];
+  int num_indices = this->get_num_indices();
+  row_idx = new int[num_indices];
+
+  // sort the indices and remove duplicities
+  int pos = 0;
+  for (unsigned int i = 0; i < this->size; i++)
+  {
+    col_ptr[i] = pos;
+    pos += this->sort_and_store_indices(this->pages[i], row_idx + pos, row_idx + num_indices);
+  }
+  col_ptr[this->size] = pos;
+
+  delete [] this->pages;
+  this->pages = NULL;
+}
+
+template<typename Scalar>
+void Hermes::Algebra::SparseMatrix<Scalar>::alloc_with_structure(unsigned int n, const int* col_ptr, const int* row_idx)
+{
+  this->prealloc(n);
+  for (unsigned int col = 0; col < n; col++)
+    for (int i = col_ptr[col]; i < col_ptr[col + 1]; i++)
+      this->pre_add_ij(row_idx[i], col);
+  this->alloc();
+}
+
 template<typename Scalar>
 int Hermes::Algebra::SparseMatrix<Scalar>::get_num_indices()
 {
@@ -272,6 +272,8 @@ namespace Hermes
     template<typename Scalar>
     bool EpetraMatrix<Scalar>::dump(FILE *file, const char *var_name, EMatrixDumpFormat fmt, char* number_format)
     {
+      if(fmt == DF_HERMES_CSC)
+        throw Hermes::Exceptions::Exception("EpetraMatrix can not be dumped in DF_HERMES_CSC, only CSCMatrix can.");
       return false;
     }
 
@@ -213,6 +213,9 @@ namespace Hermes
       // TODO
       switch (fmt)
       {
+      case DF_HERMES_CSC:
+        throw Hermes::Exceptions::Exception("MumpsMatrix can not be dumped in DF_HERMES_CSC, only CSCMatrix can.");
+
       case DF_PLAIN_ASCII:
         fprintf(file, "%d\n", this->size);
         fprintf(file, "%d\n", nnz);
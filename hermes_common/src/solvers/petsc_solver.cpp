@@ -215,6 +215,9 @@ namespace Hermes
     {
       switch (fmt)
       {
+      case DF_HERMES_CSC:
+        throw Hermes::Exceptions::Exception("PetscMatrix can not be dumped in DF_HERMES_CSC, only CSCMatrix can.");
+
       case DF_MATLAB_SPARSE: //only to stdout
         PetscViewer  viewer = PETSC_VIEWER_STDOUT_SELF;
         PetscViewerSetFormat(viewer, PETSC_VIEWER_ASCII_MATLAB);
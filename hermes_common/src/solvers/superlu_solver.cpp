@@ -228,6 +228,9 @@ namespace Hermes
       // TODO
       switch (fmt)
       {
+      case DF_HERMES_CSC:
+        throw Hermes::Exceptions::Exception("SuperLUMatrix can not be dumped in DF_HERMES_CSC, only CSCMatrix can.");
+
       case DF_MATLAB_SPARSE:
         fprintf(file, "%% Size: %dx%d\n%% Nonzeros: %d\ntemp = zeros(%d, 3);\ntemp =[\n", this->size, this->size, Ap[this->size], Ap[this->size]);
         for (unsigned int j = 0; j < this->size; j++)
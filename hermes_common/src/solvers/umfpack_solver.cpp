@@ -60,7 +60,7 @@ namespace Hermes
     }
 
     template<typename Scalar>
-    CSCMatrix<Scalar>::CSCMatrix()
+    CSCMatrix<Scalar>::CSCMatrix() : mapped_file(NULL)
     {
       this->size = 0; nnz = 0;
       Ap = NULL;
@@ -69,7 +69,7 @@ namespace Hermes
     }
 
     template<typename Scalar>
-    CSCMatrix<Scalar>::CSCMatrix(unsigned int size)
+    CSCMatrix<Scalar>::CSCMatrix(unsigned int size) : mapped_file(NULL)
     {
       this->size = size;
       this->alloc();
@@ -130,10 +130,35 @@ namespace Hermes
       memset(Ax, 0, sizeof(Scalar) * nnz);
     }
 
+    template<typename Scalar>
+    void CSCMatrix<Scalar>::alloc_with_structure(unsigned int n, const int* col_ptr, const int* row_idx)
+    {
+      free();
+      this->size = n;
+
+      // the structure is already in the CSC form
+      Ap = new int[this->size + 1];
+      memcpy(Ap, col_ptr, sizeof(int) * (this->size + 1));
+      nnz = Ap[this->size];
+      Ai = new int[nnz];
+      memcpy(Ai, row_idx, sizeof(int) * nnz);
+
+      Ax = new Scalar[nnz];
+      memset(Ax, 0, sizeof(Scalar) * nnz);
+    }
+
     template<typename Scalar>
     void CSCMatrix<Scalar>::free()
     {
       nnz = 0;
+      if(mapped_file != NULL)
+      {
+        delete mapped_file;
+        mapped_file = NULL;
+        Ap = Ai = NULL;
+        Ax = NULL;
+        return;
+      }
       if(Ap != NULL)
       {
         delete [] Ap;
@@ -318,6 +343,94 @@ namespace Hermes
             add(rows[i], cols[j], mat[i][j]);
     }
 
+    template<typename Scalar>
+    void CSCMatrix<Scalar>::write_binary(BinaryFileWriter& writer, const Scalar* rhs)
+    {
+      writer.write_value((uint32_t)sizeof(Scalar));
+      writer.write_value((uint32_t)this->size);
+      writer.write_array(Ap, this->size + 1);
+      writer.write_array(Ai, nnz);
+      writer.write_array(Ax, nnz);
+      writer.write_array(rhs, rhs == NULL ? 0 : this->size);
+    }
+
+    template<typename Scalar>
+    void CSCMatrix<Scalar>::save_binary(const char* filename, Vector<Scalar>* rhs)
+    {
+      Scalar* rhs_values = NULL;
+      if(rhs != NULL)
+      {
+        if(rhs->length() != this->size)
+          throw Hermes::Exceptions::Exception("The right-hand side has a different size than the matrix in CSCMatrix::save_binary().");
+        rhs_values = new Scalar[this->size];
+        rhs->extract(rhs_values);
+      }
+
+      BinaryFileWriter writer(filename, "CSC", binary_format_version);
+      write_binary(writer, rhs_values);
+      writer.close();
+      delete [] rhs_values;
+    }
+
+    template<typename Scalar>
+    void CSCMatrix<Scalar>::load_mmap(const char* filename, Vector<Scalar>* rhs)
+    {
+      free();
+      BinaryFileReader* reader = new BinaryFileReader(filename, "CSC", binary_format_version, true);
+      try
+      {
+        if(reader->read_value<uint32_t>() != sizeof(Scalar))
+          throw Hermes::Exceptions::Exception("%s: the matrix was saved with a different Scalar type.", filename);
+        unsigned int size = reader->read_value<uint32_t>();
+
+        // the arrays are mapped copy-on-write, writing to them is fine
+        uint64_t ap_count, ai_count, ax_count, rhs_count;
+        int* ap = const_cast<int*>(reader->read_array<int>(ap_count));
+        int* ai = const_cast<int*>(reader->read_array<int>(ai_count));
+        Scalar* ax = const_cast<Scalar*>(reader->read_array<Scalar>(ax_count));
+        const Scalar* rhs_values = reader->read_array<Scalar>(rhs_count);
+        if(ap_count != size + 1 || ap[0] != 0 || ap[size] < 0 || ai_count != (uint64_t)ap[size] || ax_count != ai_count)
+          throw Hermes::Exceptions::Exception("%s: inconsistent sizes of the CSC arrays.", filename);
+        // Ap[0] = 0 and Ap[size] = nnz, a nondecreasing Ap thus stays within [0, nnz].
+        for (unsigned int i = 0; i < size; i++)
+          if(ap[i] > ap[i + 1])
+            throw Hermes::Exceptions::Exception("%s: the column pointers (Ap) decrease after column %u.", filename, i);
+        for (uint64_t i = 0; i < ai_count; i++)
+          if(ai[i] < 0 || (unsigned int)ai[i] >= size)
+            throw Hermes::Exceptions::Exception("%s: the row index (Ai) %d is out of the matrix size %u.", filename, ai[i], size);
+        if(rhs != NULL && rhs_count != size)
+          throw Hermes::Exceptions::Exception("%s does not contain a right-hand side.", filename);
+
+        if(rhs != NULL)
+        {
+          rhs->alloc(size);
+          for (unsigned int i = 0; i < size; i++)
+            rhs->set(i, rhs_values[i]);
+        }
+
+        this->size = size;
+        this->nnz = ai_count;
+        this->Ap = ap;
+        this->Ai = ai;
+        this->Ax = ax;
+        this->mapped_file = reader;
+      }
+      catch(...)
+      {
+        delete reader;
+        throw;
+      }
+    }
+
+    template<typename Scalar>
+    void CSCMatrix<Scalar>::dump_binary(FILE* file)
+    {
+      std::vector<char> image;
+      BinaryFileWriter writer(image, "CSC", binary_format_version);
+      write_binary(writer, NULL);
+      this->hermes_fwrite(&image[0], 1, image.size(), file);
+    }
+
     double inline real(double x)
     {
       return x;
@@ -343,6 +456,10 @@ namespace Hermes
     {
       switch (fmt)
       {
+      case DF_HERMES_CSC:
+        dump_binary(file);
+        return true;
+
       case DF_MATLAB_SPARSE:
         fprintf(file, "%% Size: %dx%d\n%% Nonzeros: %d\ntemp = zeros(%d, 3);\ntemp =[\n",
           this->size, this->size, nnz, nnz);
@@ -448,6 +565,10 @@ namespace Hermes
     {
       switch (fmt)
       {
+      case DF_HERMES_CSC:
+        dump_binary(file);
+        return true;
+
       case DF_MATLAB_SPARSE:
         fprintf(file, "%% Size: %dx%d\n%% Nonzeros: %d\ntemp = zeros(%d, 3);\ntemp =[\n",
           this->size, this->size, nnz, nnz);